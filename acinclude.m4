@@ -532,6 +532,25 @@ AC_DEFUN([SETUP_POSTGRESQL],
 			AC_LANG_RESTORE
 		fi
 
+		# Check for PQsetSingleRowMode
+		if test "$BUILD_STATIC" = "yes"
+		then
+			AC_MSG_CHECKING(for PQsetSingleRowMode in libpq.a)
+			if test "$(nm ${PG_LIB}/libpq.a | grep -c PQsetSingleRowMode)" -gt 0
+			then
+				AC_MSG_RESULT(present)
+				HAVE_SINGLE_ROW_MODE="yes"
+			else
+				AC_MSG_RESULT(not present)
+				HAVE_SINGLE_ROW_MODE="no"
+			fi
+		else
+			AC_LANG_SAVE
+			AC_LANG_C
+			AC_CHECK_LIB(pq, PQsetSingleRowMode, [HAVE_SINGLE_ROW_MODE=yes], [HAVE_SINGLE_ROW_MODE=no])
+			AC_LANG_RESTORE
+		fi
+
 		AC_LANG_SAVE
 		AC_LANG_C
 
@@ -676,6 +695,10 @@ AC_DEFUN([SETUP_POSTGRESQL],
 		then
 			CPPFLAGS="$CPPFLAGS -DHAVE_CONNINFO_PARSE"
 		fi
+		if test "$HAVE_SINGLE_ROW_MODE" = "yes"
+		then
+			CPPFLAGS="$CPPFLAGS -DHAVE_SINGLE_ROW_MODE"
+		fi
 		if test "$HAVE_DATABASEDESIGNER" = "yes"
 		then
 			CPPFLAGS="$CPPFLAGS -DDATABASEDESIGNER"
@@ -876,6 +899,12 @@ AC_DEFUN([SUMMARY],
 	else
 		echo "PostgreSQL PQconninfoParse support:     Missing"
 	fi
+	if test "$HAVE_SINGLE_ROW_MODE" = yes
+	then
+		echo "PostgreSQL single-row mode support:     Present"
+	else
+		echo "PostgreSQL single-row mode support:     Missing"
+	fi
 	if test "$PG_SSL" = yes
 	then
 		echo "PostgreSQL SSL support:			Present"
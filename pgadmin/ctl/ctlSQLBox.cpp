@@ -18,6 +18,7 @@
 
 // App headers
 #include "db/pgSet.h"
+#include "db/pgCompletionIndex.h"
 #include "ctl/ctlSQLBox.h"
 #include "dlg/dlgFindReplace.h"
 #include "frm/menu.h"
@@ -25,6 +26,9 @@
 
 wxString ctlSQLBox::sqlKeywords;
 
+// The plans explained in a tab which can be compared
+#define EXPLAIN_MAX_RUNS  10
+
 // Additional pl/pgsql keywords we should highlight
 wxString plpgsqlKeywords = wxT(" elsif exception exit loop raise record return text while");
 //
@@ -208,6 +212,18 @@ int ctlSQLBox::GetOrigin()
 	return m_origin;
 }
 
+void ctlSQLBox::AddExplainRun(const wxString &json)
+{
+	// Plans can be large, only the last ones are kept
+	if (m_explainRuns.GetCount() >= EXPLAIN_MAX_RUNS)
+		m_explainRuns.RemoveAt(0);
+
+	ExplainRun run;
+	run.json = json;
+	run.time = wxDateTime::Now();
+	m_explainRuns.Add(run);
+}
+
 void ctlSQLBox::SetFilename(wxString &filename)
 {
 	m_filename = filename;
@@ -892,6 +908,33 @@ ctlSQLBox::~ctlSQLBox()
 }
 
 
+/*
+ * Join completions as a tab separated "char*-string", the way
+ * tab-complete.c returns them.
+ */
+static char *CompletionString(const wxArrayString &completions)
+{
+	wxString ret = wxString();
+	wxString tmp;
+
+	for (size_t i = 0; i < completions.GetCount(); i++)
+	{
+		tmp = completions[i];
+		if (tmp.Mid(tmp.Length() - 1) == wxT("."))
+			ret += tmp + wxT("\t");
+		else
+			ret += tmp + wxT(" \t");
+	}
+
+	ret.Trim();
+	// Trims both space and tab, but we want to keep the space!
+	if (ret.Length() > 0)
+		ret += wxT(" ");
+
+	return strdup(ret.mb_str(wxConvUTF8));
+}
+
+
 /*
  * Callback function from tab-complete.c, bridging the gap between C++ and C.
  * Execute a query using the C++ APIs, returning it as a tab separated
@@ -907,31 +950,35 @@ char *pg_query_to_single_ordered_string(char *query, void *dbptr)
 	if (!res)
 		return NULL;
 
-	wxString ret = wxString();
-	wxString tmp;
+	wxArrayString completions;
 
 	while (!res->Eof())
 	{
-		tmp =  res->GetVal(0);
-		if (tmp.Mid(tmp.Length() - 1) == wxT("."))
-			ret += tmp + wxT("\t");
-		else
-			ret += tmp + wxT(" \t");
-
+		completions.Add(res->GetVal(0));
 		res->MoveNext();
 	}
 
-	if(res)
-	{
-		delete res;
-		res = NULL;
-	}
-	ret.Trim();
-	// Trims both space and tab, but we want to keep the space!
-	if (ret.Length() > 0)
-		ret += wxT(" ");
+	delete res;
 
-	return strdup(ret.mb_str(wxConvUTF8));
+	return CompletionString(completions);
+}
+
+
+/*
+ * Callback function from tab-complete.c, answering from the local index of
+ * identifiers instead of the server. Returns NULL if there is no index yet,
+ * or it does not know that kind of completion.
+ */
+extern "C"
+char *pg_complete_from_index(int kind, const char *relkinds, const char *text, const char *addon, void *dbptr)
+{
+	wxArrayString completions;
+
+	if (!pgCompletionIndex::Complete((pgConn *)dbptr, kind, wxString(relkinds, wxConvUTF8),
+	                                 wxString(text, wxConvUTF8), wxString(addon, wxConvUTF8), completions))
+		return NULL;
+
+	return CompletionString(completions);
 }
 
 
@@ -119,7 +119,7 @@ wxString ctlSQLGrid::GetExportLine(int row, int col1, int col2)
 	return GetExportLine(row, cols);
 }
 
-wxString ctlSQLGrid::GetExportLine(int row, wxArrayInt cols)
+wxString ctlSQLGrid::GetExportLine(int row, const wxArrayInt &cols)
 {
 	wxString str;
 	unsigned int col;
@@ -127,27 +127,30 @@ wxString ctlSQLGrid::GetExportLine(int row, wxArrayInt cols)
 	if (GetNumberCols() == 0)
 		return str;
 
+	// The options are read from the configuration, so only once per line
+	wxString colSeparator = settings->GetCopyColSeparator();
+	wxString quoteChar = settings->GetCopyQuoteChar();
+	int quoting = settings->GetCopyQuoting();
+
 	for (col = 0 ; col < cols.Count() ; col++)
 	{
 		if (col > 0)
-			str.Append(settings->GetCopyColSeparator());
-
-		wxString text = GetCellValue(row, cols[col]);
+			str.Append(colSeparator);
 
 		bool needQuote  = false;
-		if (settings->GetCopyQuoting() == 1)
+		if (quoting == 1)
 		{
 			needQuote = IsColText(cols[col]);
 		}
-		else if (settings->GetCopyQuoting() == 2)
+		else if (quoting == 2)
 			/* Quote everything */
 			needQuote = true;
 
 		if (needQuote)
-			str.Append(settings->GetCopyQuoteChar());
-		str.Append(text);
+			str.Append(quoteChar);
+		str.Append(GetCellValue(row, cols[col]));
 		if (needQuote)
-			str.Append(settings->GetCopyQuoteChar());
+			str.Append(quoteChar);
 	}
 	return str;
 }
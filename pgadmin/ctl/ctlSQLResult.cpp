@@ -109,31 +109,21 @@ bool ctlSQLResult::IsColText(int col)
 
 int ctlSQLResult::Execute(const wxString &query, int resultToRetrieve, wxWindow *caller, long eventId, void *data)
 {
-	wxGridTableMessage *msg;
-	sqlResultTable *table = (sqlResultTable *)GetTable();
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_DELETED, 0, GetNumberRows());
-	ProcessTableMessage(*msg);
-	delete msg;
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_DELETED, 0, GetNumberCols());
-	ProcessTableMessage(*msg);
-	delete msg;
-
+	ClearData();
 	Abort();
 
-	colNames.Empty();
-	colTypes.Empty();
-	colTypClasses.Empty();
-
 	thread = new pgQueryThread(conn, query, resultToRetrieve, caller, eventId, data);
 
+	// Show the rows, while they are arriving
+	if (settings->GetStreamResults())
+		thread->EnableStreaming(settings->GetStreamMaxRows());
+
 	if (thread->Create() != wxTHREAD_NO_ERROR)
 	{
 		Abort();
 		return -1;
 	}
 
-	((sqlResultTable *)GetTable())->SetThread(thread);
-
 	thread->Run();
 	return RunStatus();
 }
@@ -143,7 +133,7 @@ int ctlSQLResult::Abort()
 {
 	if (thread)
 	{
-		((sqlResultTable *)GetTable())->SetThread(0);
+		((sqlResultTable *)GetTable())->SetDataSet(NULL);
 
 		if (thread->IsRunning())
 		{
@@ -167,6 +157,41 @@ void ctlSQLResult::DisplayData(bool single)
 	if (thread->ReturnCode() != PGRES_TUPLES_OK)
 		return;
 
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	pgSet *set = thread->DataSet();
+
+	if (!single && table->GetDataSet() == set)
+	{
+		/*
+		 * The rows streamed in so far are displayed already. Add the
+		 * remaining ones, and complete the column types, which could not
+		 * be looked up while the query was running.
+		 */
+		Freeze();
+		AppendRows(set->NumRows());
+
+		long col, nCols = set->NumCols();
+		for (col = 0 ; col < nCols ; col++)
+		{
+			colTypes[col] = set->ColFullType(col);
+
+			if (colTypClasses[col] != set->ColTypClass(col))
+			{
+				colTypClasses[col] = set->ColTypClass(col);
+
+				if (set->ColTypClass(col) == PGTYPCLASS_NUMERIC)
+				{
+					wxGridCellAttr *attr = new wxGridCellAttr();
+					attr->SetAlignment(wxALIGN_RIGHT, wxALIGN_TOP);
+					SetColAttr(col, attr);
+				}
+			}
+		}
+		GetGridColLabelWindow()->Refresh();
+		Thaw();
+		return;
+	}
+
 	rowcountSuppressed = single;
 	Freeze();
 
@@ -175,53 +200,124 @@ void ctlSQLResult::DisplayData(bool single)
 	 * columns, then append the correct number of them. Probably is a
 	 * better way to do this.
 	 */
+	ClearData();
+	table->SetDataSet(set);
+
 	wxGridTableMessage *msg;
-	sqlResultTable *table = (sqlResultTable *)GetTable();
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_DELETED, 0, GetNumberRows());
-	ProcessTableMessage(*msg);
-	delete msg;
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_DELETED, 0, GetNumberCols());
-	ProcessTableMessage(*msg);
-	delete msg;
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, NumRows());
-	ProcessTableMessage(*msg);
-	delete msg;
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_APPENDED, thread->DataSet()->NumCols());
+	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_APPENDED, set->NumCols());
 	ProcessTableMessage(*msg);
 	delete msg;
+	AppendRows(set->NumRows());
 
 	if (single)
 	{
-		colNames.Add(thread->DataSet()->ColName(0));
+		colNames.Add(set->ColName(0));
 		colTypes.Add(wxT(""));
 		colTypClasses.Add(0L);
 
 		AutoSizeColumn(0, false, false);
 	}
 	else
+		SetupColumns(set);
+
+	Thaw();
+}
+
+
+void ctlSQLResult::DisplayPartialData()
+{
+	if (!thread || !thread->IsStreaming() || !thread->IsRunning())
+		return;
+
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	pgSet *set = thread->DataSet();
+
+	if (!set)
+		return;
+
+	Freeze();
+
+	if (table->GetDataSet() != set)
 	{
-		long col, nCols = thread->DataSet()->NumCols();
+		// The first rows of a result-set have arrived
+		ClearData();
+		rowcountSuppressed = false;
+		table->SetDataSet(set);
+
+		wxGridTableMessage *msg;
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_APPENDED, set->NumCols());
+		ProcessTableMessage(*msg);
+		delete msg;
+		AppendRows(set->NumRows());
+
+		// Column sizes are based on the first rows only
+		SetupColumns(set);
+	}
+	else
+		AppendRows(set->NumRows());
 
-		AutoSizeColumns(false);
+	Thaw();
+}
 
-		for (col = 0 ; col < nCols ; col++)
-		{
-			colNames.Add(thread->DataSet()->ColName(col));
-			colTypes.Add(thread->DataSet()->ColFullType(col));
-			colTypClasses.Add(thread->DataSet()->ColTypClass(col));
 
-			if (thread->DataSet()->ColTypClass(col) == PGTYPCLASS_NUMERIC)
-			{
-				/*
-				 * For numeric columns, set alignment to right.
-				 */
-				wxGridCellAttr *attr = new wxGridCellAttr();
-				attr->SetAlignment(wxALIGN_RIGHT, wxALIGN_TOP);
-				SetColAttr(col, attr);
-			}
+void ctlSQLResult::ClearData()
+{
+	wxGridTableMessage *msg;
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_DELETED, 0, GetNumberRows());
+	ProcessTableMessage(*msg);
+	delete msg;
+	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_DELETED, 0, GetNumberCols());
+	ProcessTableMessage(*msg);
+	delete msg;
+
+	table->SetDataSet(NULL);
+
+	colNames.Empty();
+	colTypes.Empty();
+	colTypClasses.Empty();
+}
+
+
+void ctlSQLResult::SetupColumns(pgSet *set)
+{
+	long col, nCols = set->NumCols();
+
+	AutoSizeColumns(false);
+
+	for (col = 0 ; col < nCols ; col++)
+	{
+		colNames.Add(set->ColName(col));
+		colTypes.Add(set->ColFullType(col));
+		colTypClasses.Add(set->ColTypClass(col));
+
+		if (set->ColTypClass(col) == PGTYPCLASS_NUMERIC)
+		{
+			/*
+			 * For numeric columns, set alignment to right.
+			 */
+			wxGridCellAttr *attr = new wxGridCellAttr();
+			attr->SetAlignment(wxALIGN_RIGHT, wxALIGN_TOP);
+			SetColAttr(col, attr);
 		}
 	}
-	Thaw();
+}
+
+
+void ctlSQLResult::AppendRows(long rows)
+{
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	long known = table->GetNumberRows();
+
+	if (rows <= known)
+		return;
+
+	table->SetNumberRows(rows);
+
+	wxGridTableMessage *msg;
+	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, rows - known);
+	ProcessTableMessage(*msg);
+	delete msg;
 }
 
 
@@ -314,83 +410,102 @@ void ctlSQLResult::OnGridSelect(wxGridRangeSelectEvent &event)
 
 wxString sqlResultTable::GetValue(int row, int col)
 {
-	if (thread && thread->DataValid())
+	if (set && row < numRows)
 	{
 		if (col >= 0)
 		{
-			thread->DataSet()->Locate(row + 1);
-			if (settings->GetIndicateNull() && thread->DataSet()->IsNull(col))
+			set->Locate(row + 1);
+			if (indicateNull && set->IsNull(col))
 				return wxT("<NULL>");
 			else
 			{
+				size_t len;
+				const wxChar *val = set->GetValPtr(col, len);
 
-				wxString decimalMark = wxT(".");
-				wxString s = thread->DataSet()->GetVal(col);
+				if (!val)
+					return wxEmptyString;
 
-				if(thread->DataSet()->ColTypClass(col) == PGTYPCLASS_NUMERIC &&
-				        settings->GetDecimalMark().Length() > 0)
+				if (set->ColTypClass(col) == PGTYPCLASS_NUMERIC &&
+				        thousandsSeparator.Length() > 0)
 				{
-					decimalMark = settings->GetDecimalMark();
-					s.Replace(wxT("."), decimalMark);
+					wxString s(val, len);
+					wxString mark = wxT(".");
+
+					if (decimalMark.Length() > 0)
+					{
+						mark = decimalMark;
+						s.Replace(wxT("."), mark);
+					}
 
-				}
-				if (thread->DataSet()->ColTypClass(col) == PGTYPCLASS_NUMERIC &&
-				        settings->GetThousandsSeparator().Length() > 0)
-				{
 					/* Add thousands separator */
-					size_t pos = s.find(decimalMark);
+					size_t pos = s.find(mark);
 					if (pos == wxString::npos)
 						pos = s.length();
 					while (pos > 3)
 					{
 						pos -= 3;
 						if (pos > 1 || !s.StartsWith(wxT("-")))
-							s.insert(pos, settings->GetThousandsSeparator());
+							s.insert(pos, thousandsSeparator);
 					}
 					return s;
 				}
+				else if (len > maxColSize)
+					return wxString(val, maxColSize) + wxT(" (...)");
 				else
-				{
-					wxString data = thread->DataSet()->GetVal(col);
-
-					if (data.Length() > (size_t)settings->GetMaxColSize())
-						return thread->DataSet()->GetVal(col).Left(settings->GetMaxColSize()) + wxT(" (...)");
-					else
-						return thread->DataSet()->GetVal(col);
-				}
+					return wxString(val, len);
 			}
 		}
 		else
-			return thread->DataSet()->ColName(col);
+			return set->ColName(col);
 	}
 	return wxEmptyString;
 }
 
 sqlResultTable::sqlResultTable()
 {
-	thread = NULL;
+	set = NULL;
+	numRows = 0;
+	indicateNull = false;
+	maxColSize = 0;
+}
+
+void sqlResultTable::SetDataSet(pgSet *s, long rows)
+{
+	set = s;
+	numRows = rows;
+
+	if (set)
+	{
+		// The grid reads the cells over and over while scrolling
+		set->SetCacheValues(true);
+
+		indicateNull = settings->GetIndicateNull();
+		maxColSize = settings->GetMaxColSize();
+		decimalMark = settings->GetDecimalMark();
+		thousandsSeparator = settings->GetThousandsSeparator();
+	}
 }
 
 int sqlResultTable::GetNumberRows()
 {
-	if (thread && thread->DataValid())
-		return thread->DataSet()->NumRows();
+	if (set)
+		return numRows;
 	return 0;
 }
 
 
 wxString sqlResultTable::GetColLabelValue(int col)
 {
-	if (thread && thread->DataValid())
-		return thread->DataSet()->ColName(col) + wxT("\n") +
-		       thread->DataSet()->ColFullType(col);
+	if (set)
+		return set->ColName(col) + wxT("\n") +
+		       set->ColFullType(col);
 	return wxEmptyString;
 }
 
 int sqlResultTable::GetNumberCols()
 {
-	if (thread && thread->DataValid())
-		return thread->DataSet()->NumCols();
+	if (set)
+		return set->NumCols();
 	return 0;
 }
 
@@ -16,12 +16,24 @@
 #include "pgAdmin3.h"
 #include "ctl/ctlTree.h"
 
+#include "db/pgQueryThread.h"
+#include "db/pgQueryResultEvent.h"
+#include "frm/frmMain.h"
 #include "schema/pgObject.h"
 #include "schema/pgCollection.h"
 #include "schema/pgServer.h"
 
+// Objects are added to the tree this many at a time, giving the user
+// interface a chance to respond in between
+#define LOAD_BATCH_ROWS     500
+#define LOAD_INTERVAL       10
+
 BEGIN_EVENT_TABLE(ctlTree, wxTreeCtrl)
 	EVT_CHAR(ctlTree::OnChar)
+	EVT_TREE_DELETE_ITEM(wxID_ANY,      ctlTree::OnItemDeleted)
+	EVT_PGQUERYPROGRESS(TREE_LOAD_COMPLETE, ctlTree::OnLoadProgress)
+	EVT_PGQUERYRESULT(TREE_LOAD_COMPLETE,   ctlTree::OnLoadResult)
+	EVT_TIMER(TREE_LOAD_COMPLETE,       ctlTree::OnLoadTimer)
 END_EVENT_TABLE()
 
 
@@ -170,6 +182,10 @@ void ctlTree::OnChar(wxKeyEvent &event)
 			return;
 		}
 	}
+	else if (keyCode == WXK_ESCAPE && CancelLoading(GetSelection()))
+	{
+		return;
+	}
 	else
 	{
 		event.Skip(true);
@@ -177,7 +193,8 @@ void ctlTree::OnChar(wxKeyEvent &event)
 }
 
 ctlTree::ctlTree(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size, long style)
-	: wxTreeCtrl(parent, id, pos, size, style), m_findTimer(NULL)
+	: wxTreeCtrl(parent, id, pos, size, style), m_findTimer(NULL),
+	  m_loadTimer(this, TREE_LOAD_COMPLETE), m_removingPlaceholder(false)
 {
 }
 
@@ -186,6 +203,13 @@ ctlTree::~ctlTree()
 	if ( m_findTimer )
 		delete m_findTimer;
 	m_findTimer = NULL;
+
+	m_loadTimer.Stop();
+	while (m_loaders.GetCount())
+	{
+		delete m_loaders.Item(0);
+		m_loaders.RemoveAt(0);
+	}
 }
 
 
@@ -372,6 +396,302 @@ void ctlTree::NavigateTree(int keyCode)
 
 //////////////////////
 
+ctlTreeLoader::ctlTreeLoader(pgCollection *coll, pgConn *cn)
+{
+	collection = coll;
+	item = coll->GetId();
+	conn = cn;
+	thread = NULL;
+	rowsAdded = 0;
+	completed = false;
+}
+
+
+ctlTreeLoader::~ctlTreeLoader()
+{
+	if (thread)
+	{
+		if (thread->IsRunning())
+		{
+			thread->CancelExecution();
+			thread->Wait();
+		}
+		delete thread;
+	}
+	if (conn)
+		delete conn;
+}
+
+
+bool ctlTree::LoadObjects(pgCollection *collection)
+{
+	pgaFactory *factory = collection->GetFactory();
+	if (!factory || !collection->GetConnection() || IsLoading(collection->GetId()))
+		return false;
+
+	wxString query = factory->GetObjectsQuery(collection);
+	if (query.IsEmpty())
+		return false;
+
+	// The connection of the database stays available for everything else
+	pgConn *conn = collection->GetConnection()->Duplicate();
+	if (!conn)
+		return false;
+	if (conn->GetStatus() != PGCONN_OK)
+	{
+		delete conn;
+		return false;
+	}
+
+	ctlTreeLoader *loader = new ctlTreeLoader(collection, conn);
+
+	loader->thread = new pgQueryThread(conn, query, -1, this, TREE_LOAD_COMPLETE, loader);
+	loader->thread->SetEventOnCancellation(false);
+	loader->thread->EnableStreaming();
+
+	if (loader->thread->Create() != wxTHREAD_NO_ERROR)
+	{
+		delete loader->thread;
+		loader->thread = NULL;
+		delete loader;
+		return false;
+	}
+
+	m_loaders.Add(loader);
+	AddPlaceholder(loader);
+	collection->UpdateChildCount(this, 1);
+
+	loader->thread->Run();
+	return true;
+}
+
+
+bool ctlTree::IsLoading(const wxTreeItemId &item)
+{
+	for (size_t i = 0; i < m_loaders.GetCount(); i++)
+	{
+		if (m_loaders.Item(i)->item == item)
+			return true;
+	}
+	return false;
+}
+
+
+void ctlTree::CompleteLoading(const wxTreeItemId &item)
+{
+	for (size_t i = 0; i < m_loaders.GetCount(); i++)
+	{
+		ctlTreeLoader *loader = m_loaders.Item(i);
+		if (loader->item == item)
+		{
+			wxBusyCursor wait;
+
+			if (loader->thread->IsRunning())
+				loader->thread->Wait();
+			loader->completed = true;
+
+			while (AddLoadedObjects(loader))
+				;
+			FinishLoading(loader);
+			return;
+		}
+	}
+}
+
+
+bool ctlTree::CancelLoading(const wxTreeItemId &item)
+{
+	bool cancelled = false;
+	size_t i = 0;
+
+	if (!item)
+		return false;
+
+	while (i < m_loaders.GetCount())
+	{
+		ctlTreeLoader *loader = m_loaders.Item(i);
+
+		// Cancel the loads of the item, and below it
+		bool found = (loader->placeholder == item);
+		for (wxTreeItemId parent = loader->item; parent && !found; parent = GetItemParent(parent))
+			found = (parent == item);
+
+		if (!found)
+		{
+			i++;
+			continue;
+		}
+
+		m_loaders.RemoveAt(i);
+		wxTreeItemId collItem = loader->item;
+		wxString name = wxGetTranslation(loader->collection->GetName());
+		delete loader;
+
+		// Selecting the collection again will start over
+		m_removingPlaceholder = true;
+		DeleteChildren(collItem);
+		m_removingPlaceholder = false;
+		SetItemText(collItem, name + wxT(" (") + _("cancelled") + wxT(")"));
+
+		cancelled = true;
+	}
+
+	return cancelled;
+}
+
+
+void ctlTree::AddPlaceholder(ctlTreeLoader *loader)
+{
+	loader->placeholder = wxTreeCtrl::AppendItem(loader->item, _("Loading... (press Esc to cancel)"));
+}
+
+
+void ctlTree::RemovePlaceholder(ctlTreeLoader *loader)
+{
+	if (loader->placeholder)
+	{
+		m_removingPlaceholder = true;
+		Delete(loader->placeholder);
+		m_removingPlaceholder = false;
+
+		loader->placeholder = wxTreeItemId();
+	}
+}
+
+
+bool ctlTree::AddLoadedObjects(ctlTreeLoader *loader)
+{
+	pgSet *set = loader->thread->DataSet();
+	if (!set)
+		return false;
+
+	long rows = set->NumRows();
+	if (loader->rowsAdded >= rows)
+		return false;
+
+	long last = wxMin(rows, loader->rowsAdded + LOAD_BATCH_ROWS);
+	pgaFactory *factory = loader->collection->GetFactory();
+
+	Freeze();
+
+	// The placeholder stays the last child
+	RemovePlaceholder(loader);
+	while (loader->rowsAdded < last)
+	{
+		set->Locate(++loader->rowsAdded);
+
+		pgObject *object = factory->CreateObject(loader->collection, set);
+		if (object)
+			AppendObject(loader->collection, object);
+	}
+	AddPlaceholder(loader);
+	loader->collection->UpdateChildCount(this, 1);
+
+	Thaw();
+
+	return last < rows;
+}
+
+
+void ctlTree::ProcessLoaders()
+{
+	bool pending = false;
+	size_t i = 0;
+
+	while (i < m_loaders.GetCount())
+	{
+		ctlTreeLoader *loader = m_loaders.Item(i);
+
+		if (AddLoadedObjects(loader))
+			pending = true;
+		else if (loader->completed)
+		{
+			FinishLoading(loader);
+			continue;
+		}
+		i++;
+	}
+
+	if (pending && !m_loadTimer.IsRunning())
+		m_loadTimer.Start(LOAD_INTERVAL, wxTIMER_ONE_SHOT);
+}
+
+
+void ctlTree::FinishLoading(ctlTreeLoader *loader)
+{
+	m_loaders.Remove(loader);
+
+	if (loader->thread->IsRunning())
+		loader->thread->Wait();
+
+	if (loader->thread->ReturnCode() != PGRES_TUPLES_OK)
+	{
+		wxLogError(_("Could not load the %s:\n%s"),
+		           wxString(wxGetTranslation(loader->collection->GetName())).c_str(),
+		           loader->thread->GetMessagesAndClear().c_str());
+	}
+
+	RemovePlaceholder(loader);
+	loader->collection->UpdateChildCount(this);
+
+	// Show the objects, if the collection is being looked at
+	wxTreeItemId item = loader->item;
+	delete loader;
+
+	if (winMain && GetSelection() == item)
+		winMain->execSelChange(item, true);
+}
+
+
+void ctlTree::OnLoadProgress(pgQueryResultEvent &event)
+{
+	if (m_loaders.Index((ctlTreeLoader *)event.GetClientData()) != wxNOT_FOUND)
+		ProcessLoaders();
+}
+
+
+void ctlTree::OnLoadResult(pgQueryResultEvent &event)
+{
+	ctlTreeLoader *loader = (ctlTreeLoader *)event.GetClientData();
+
+	if (m_loaders.Index(loader) != wxNOT_FOUND)
+	{
+		loader->completed = true;
+		ProcessLoaders();
+	}
+}
+
+
+void ctlTree::OnLoadTimer(wxTimerEvent &event)
+{
+	ProcessLoaders();
+}
+
+
+void ctlTree::OnItemDeleted(wxTreeEvent &event)
+{
+	event.Skip();
+
+	if (m_removingPlaceholder)
+		return;
+
+	// The collection went away (e.g. refreshed), so its objects are not
+	// needed anymore
+	for (size_t i = 0; i < m_loaders.GetCount(); i++)
+	{
+		ctlTreeLoader *loader = m_loaders.Item(i);
+		if (loader->item == event.GetItem() || loader->placeholder == event.GetItem())
+		{
+			loader->placeholder = wxTreeItemId();
+			m_loaders.RemoveAt(i);
+			delete loader;
+			break;
+		}
+	}
+}
+
+//////////////////////
+
 treeObjectIterator::treeObjectIterator(ctlTree *brow, pgObject *obj)
 {
 	browser = brow;
@@ -12,14 +12,20 @@
 
 // wxWindows headers
 #include <wx/wx.h>
+#include <wx/dcbuffer.h>
 
 // App headers
 #include "pgAdmin3.h"
 
 #include "ctl/explainCanvas.h"
+#include "ctl/explainPlan.h"
+#include "ctl/explainNodeList.h"
+
+#define PIXPERUNIT  20
 
 
 BEGIN_EVENT_TABLE(ExplainCanvas, wxShapeCanvas)
+	EVT_PAINT(ExplainCanvas::OnPaint)
 	EVT_MOTION(ExplainCanvas::OnMouseMotion)
 END_EVENT_TABLE()
 
@@ -31,18 +37,49 @@ ExplainCanvas::ExplainCanvas(wxWindow *parent)
 	GetDiagram()->SetCanvas(this);
 	SetBackgroundColour(*wxWHITE);
 	popup = NULL;
+	plan = NULL;
+	nodeList = NULL;
+	markedShape = NULL;
+	maxLevel = 0;
+	x0 = y0 = xoffs = yoffs = 0;
 }
 
 
 ExplainCanvas::~ExplainCanvas()
 {
+	// The list may be gone already
+	nodeList = NULL;
+	Clear();
 }
 
 
 void ExplainCanvas::Clear()
 {
-	GetDiagram()->DeleteAllShapes();
+	// DeleteAllShapes() would look for each shape in the whole list
+	// again, when it gets deleted
+	wxNode *current = GetDiagram()->GetShapeList()->GetFirst();
+	while (current)
+	{
+		wxShape *s = (wxShape *)current->GetData();
+		s->SetCanvas(NULL);
+		delete s;
+		current = current->GetNext();
+	}
+	GetDiagram()->RemoveAllShapes();
+
+	columns.Clear();
+	columnStart.Clear();
+	maxLevel = 0;
 	rootShape = NULL;
+	markedShape = NULL;
+
+	if (plan)
+	{
+		if (nodeList)
+			nodeList->SetPlan(NULL);
+		delete plan;
+		plan = NULL;
+	}
 }
 
 
@@ -57,7 +94,6 @@ void ExplainCanvas::SetExplainString(const wxString &str)
 	AddShape(rootShape);
 
 	ExplainShape *last = rootShape;
-	int maxLevel = 0;
 
 	wxStringTokenizer lines(str, wxT("\n"));
 
@@ -122,59 +158,264 @@ void ExplainCanvas::SetExplainString(const wxString &str)
 		last = s;
 	}
 
+	LayoutShapes();
+}
 
-	int x0 = (int)(rootShape->GetWidth() * 3);
-	int y0 = (int)(rootShape->GetHeight() * 3 / 2);
-	int xoffs = (int)(rootShape->GetWidth() * 3);
-	int yoffs = (int)(rootShape->GetHeight() * 5 / 4);
 
-	wxNode *current = GetDiagram()->GetShapeList()->GetFirst();
-	while (current)
+bool ExplainCanvas::SetExplainJson(const wxString &str)
+{
+	ExplainPlan *newPlan = ExplainPlan::Parse(str);
+	if (!newPlan)
+		return false;
+
+	Clear();
+	plan = newPlan;
+
+	rootShape = ExplainShape::Create(0, NULL, wxEmptyString);
+	AddShape(rootShape);
+
+	for (size_t i = 0; i < plan->GetRoots().GetCount(); i++)
+		AddNodeShapes(plan->GetRoots().Item(i), rootShape, 1);
+
+	LayoutShapes();
+
+	if (nodeList)
+		nodeList->SetPlan(plan);
+
+	return true;
+}
+
+
+void ExplainCanvas::ShowNode(ExplainNode *node)
+{
+	for (size_t i = 0; i < columns.GetCount(); i++)
 	{
-		ExplainShape *s = (ExplainShape *)current->GetData();
+		ExplainShape *s = columns.Item(i);
+		if (s->GetNode() != node)
+			continue;
 
-		if (!s->totalShapes)
-			s->totalShapes = 1;
-		if (s->GetUpper())
-			s->GetUpper()->totalShapes += s->totalShapes;
-		current = current->GetNext();
+		if (markedShape)
+			markedShape->SetMarked(false);
+		markedShape = s;
+		s->SetMarked(true);
+
+		// In the middle of the window, if the plan is that large
+		int w, h;
+		GetClientSize(&w, &h);
+		Scroll(wxMax((int)(s->GetX() - w / 2) / PIXPERUNIT, 0), wxMax((int)(s->GetY() - h / 2) / PIXPERUNIT, 0));
+		Refresh();
+		break;
 	}
+}
 
-	current = GetDiagram()->GetShapeList()->GetLast();
-	while (current)
+
+void ExplainCanvas::AddNodeShapes(ExplainNode *node, ExplainShape *upper, long level)
+{
+	ExplainShape *s = ExplainShape::Create(level, upper, node);
+	if (!s)
+		return;
+	s->SetCanvas(this);
+	InsertShape(s);
+	s->Show(true);
+
+	if (level > maxLevel)
+		maxLevel = level;
+
+	for (size_t i = 0; i < node->GetKids().GetCount(); i++)
+		AddNodeShapes(node->GetKids().Item(i), s, level + 1);
+}
+
+
+void ExplainCanvas::LayoutShapes()
+{
+	x0 = (int)(rootShape->GetWidth() * 3);
+	y0 = (int)(rootShape->GetHeight() * 3 / 2);
+	xoffs = (int)(rootShape->GetWidth() * 3);
+	yoffs = (int)(rootShape->GetHeight() * 5 / 4);
+
+	// Count the shapes of each level, then have the levels follow
+	// each other in the columns
+	columnStart.Clear();
+	columnStart.Add(0, maxLevel + 2);
+	CountShapes(rootShape);
+
+	int level;
+	for (level = 1; level <= maxLevel + 1; level++)
+		columnStart[level] += columnStart[level - 1];
+
+	wxArrayInt next = columnStart;
+	columns.Clear();
+	columns.Add(NULL, columnStart.Last());
+
+	rootShape->SetX(y0 + maxLevel * xoffs);
+	rootShape->SetY(y0);
+	PlaceShapes(rootShape, next);
+
+	int w = (maxLevel * xoffs + x0 * 2 + PIXPERUNIT - 1) / PIXPERUNIT;
+	int h = (rootShape->totalShapes * yoffs + y0 * 2 + PIXPERUNIT - 1) / PIXPERUNIT;
+
+	SetScrollbars(PIXPERUNIT, PIXPERUNIT, w, h);
+}
+
+
+void ExplainCanvas::CountShapes(ExplainShape *s)
+{
+	s->totalShapes = 0;
+	s->usedShapes = 0;
+
+	for (size_t i = 0; i < s->kids.GetCount(); i++)
 	{
-		ExplainShape *s = (ExplainShape *)current->GetData();
+		CountShapes(s->kids.Item(i));
+		s->totalShapes += s->kids.Item(i)->totalShapes;
+	}
+	if (!s->totalShapes)
+		s->totalShapes = 1;
 
-		s->SetX(y0 + (maxLevel - s->GetLevel()) * xoffs);
-		ExplainShape *upper = s->GetUpper();
+	columnStart[s->GetLevel() + 1]++;
+}
 
-		if (upper)
-		{
-			s->SetY(upper->GetY() + upper->usedShapes * yoffs);
-			upper->usedShapes += s->totalShapes;
 
-			// We don't require to draw a line from the root shape to its
-			// childrens
-			if (upper != rootShape)
-			{
-				wxLineShape *l = new ExplainLine(s, upper);
-				l->Show(true);
-				AddShape(l);
-			}
+void ExplainCanvas::PlaceShapes(ExplainShape *s, wxArrayInt &next)
+{
+	// Shapes are placed from the top down, so each column is sorted
+	columns[next[s->GetLevel()]++] = s;
+
+	for (size_t i = 0; i < s->kids.GetCount(); i++)
+	{
+		ExplainShape *kid = s->kids.Item(i);
+
+		kid->SetX(y0 + (maxLevel - kid->GetLevel()) * xoffs);
+		kid->SetY(s->GetY() + s->usedShapes * yoffs);
+		s->usedShapes += kid->totalShapes;
+
+		// We don't require to draw a line from the root shape to its
+		// childrens
+		if (s != rootShape)
+		{
+			kid->line = new ExplainLine(kid, s);
+			kid->line->Show(true);
+			InsertShape(kid->line);
 		}
+
+		PlaceShapes(kid, next);
+	}
+}
+
+
+size_t ExplainCanvas::FindInColumn(int level, double y, bool subtrees)
+{
+	size_t lo = columnStart[level], hi = columnStart[level + 1];
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		ExplainShape *s = columns.Item(mid);
+
+		double bottom = s->GetY();
+		if (subtrees)
+			bottom += (s->totalShapes - 1) * yoffs;
+
+		if (bottom < y)
+			lo = mid + 1;
 		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+void ExplainCanvas::DrawShapes(wxDC &dc, const wxRect &rect)
+{
+	if (!rootShape)
+		return;
+
+	// Labels may be wider than their shapes
+	double top = rect.GetTop() - yoffs, bottom = rect.GetBottom() + yoffs;
+	int level;
+	size_t i, end;
+
+	// The lines first, from the shapes of a level to their kids
+	for (level = 1; level < maxLevel; level++)
+	{
+		int x = y0 + (maxLevel - level) * xoffs;
+		if (x < rect.GetLeft())
+			continue;
+
+		end = columnStart[level + 1];
+		for (i = FindInColumn(level, top, true); i < end && columns.Item(i)->GetY() <= bottom; i++)
 		{
-			s->SetY(y0);
+			ExplainShape *s = columns.Item(i);
+			for (size_t k = 0; k < s->kids.GetCount(); k++)
+			{
+				ExplainShape *kid = s->kids.Item(k);
+				wxRect r((int)kid->GetX(), (int)s->GetY() - yoffs / 2, x - (int)kid->GetX(), (int)(kid->GetY() - s->GetY()) + yoffs);
+				if (kid->line && r.Intersects(rect))
+					kid->line->Draw(dc);
+			}
 		}
+	}
+
+	for (level = 1; level <= maxLevel; level++)
+	{
+		int x = y0 + (maxLevel - level) * xoffs;
+		if (x + xoffs < rect.GetLeft() || x - xoffs > rect.GetRight())
+			continue;
 
-		current = current->GetPrevious();
+		end = columnStart[level + 1];
+		for (i = FindInColumn(level, top, false); i < end && columns.Item(i)->GetY() <= bottom; i++)
+			columns.Item(i)->Draw(dc);
 	}
+}
 
-#define PIXPERUNIT  20
-	int w = (maxLevel * xoffs + x0 * 2 + PIXPERUNIT - 1) / PIXPERUNIT;
-	int h = (rootShape->totalShapes * yoffs + y0 * 2 + PIXPERUNIT - 1) / PIXPERUNIT;
 
-	SetScrollbars(PIXPERUNIT, PIXPERUNIT, w, h);
+void ExplainCanvas::OnPaint(wxPaintEvent &ev)
+{
+	// The same as wxShapeCanvas::OnPaint(), but only drawing what's
+	// to be painted again
+#if OGL_USE_BUFFERED_PAINT
+	RecreateBuffer();
+	wxBufferedPaintDC dc(this, m_bufferBitmap);
+#else
+	wxPaintDC dc(this);
+#endif
+
+	PrepareDC(dc);
+
+	DrawBackground(dc, true);
+
+	wxRect rect = GetUpdateRegion().GetBox();
+	CalcUnscrolledPosition(rect.x, rect.y, &rect.x, &rect.y);
+	DrawShapes(dc, rect);
+
+	dc.SetUserScale(1.0, 1.0);
+}
+
+
+wxShape *ExplainCanvas::FindShape(double x, double y, int *attachment, wxClassInfo *info, wxShape *notImage)
+{
+	if (!rootShape || !xoffs)
+		return NULL;
+
+	// Only the column of x may have it
+	int level = maxLevel - WXROUND((x - y0) / xoffs);
+	if (level < 1 || level > maxLevel)
+		return NULL;
+
+	size_t end = columnStart[level + 1];
+	for (size_t i = FindInColumn(level, y - yoffs, false); i < end && columns.Item(i)->GetY() <= y + yoffs; i++)
+	{
+		ExplainShape *s = columns.Item(i);
+		int hitAttachment;
+		double distance;
+
+		if (s != notImage && s->IsShown() && (!info || s->IsKindOf(info)) &&
+		        s->HitTest(x, y, &hitAttachment, &distance))
+		{
+			if (attachment)
+				*attachment = hitAttachment;
+			return s;
+		}
+	}
+	return NULL;
 }
 
 
@@ -261,7 +502,7 @@ private:
 	ExplainPopup *popup;
 	void OnPaint(wxPaintEvent &ev);
 
-	wxString m_desc, m_detail, m_condition, m_cost, m_actual;
+	wxString m_desc, m_detail, m_condition, m_cost, m_actual, m_analysis;
 
 	DECLARE_EVENT_TABLE()
 };
@@ -288,6 +529,7 @@ ExplainText::ExplainText(ExplainPopup *parent, ExplainShape *s) : wxWindow(paren
 	m_condition = s->condition;
 	m_cost = s->cost;
 	m_actual = s->actual;
+	m_analysis = s->analysis;
 
 	int w1, w2, h;
 	dc.GetTextExtent(m_desc, &w1, &h);
@@ -300,6 +542,8 @@ ExplainText::ExplainText(ExplainPopup *parent, ExplainShape *s) : wxWindow(paren
 	if (w1 < w2)    w1 = w2;
 	dc.GetTextExtent(m_actual, &w2, &h);
 	if (w1 < w2)    w1 = w2;
+	dc.GetTextExtent(m_analysis, &w2, &h);
+	if (w1 < w2)    w1 = w2;
 
 	int n = 2;
 	if (!m_detail.IsEmpty())
@@ -310,6 +554,8 @@ ExplainText::ExplainText(ExplainPopup *parent, ExplainShape *s) : wxWindow(paren
 		n++;
 	if (!m_actual.IsEmpty())
 		n++;
+	if (!m_analysis.IsEmpty())
+		n++;
 
 	if (!h)
 		h = GetCharHeight();
@@ -379,6 +625,11 @@ void ExplainText::OnPaint(wxPaintEvent &ev)
 		y += yoffs;
 		dc.DrawText(m_actual, x, y);
 	}
+	if (!m_analysis.IsEmpty())
+	{
+		y += yoffs;
+		dc.DrawText(m_analysis, x, y);
+	}
 
 #if wxUSE_POPUPWIN
 
@@ -0,0 +1,264 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// explainNodeList.cpp - The nodes of a plan, by what they took
+//
+//////////////////////////////////////////////////////////////////////////
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// App headers
+#include "pgAdmin3.h"
+#include "ctl/explainCanvas.h"
+#include "ctl/explainNodeList.h"
+
+// The columns of the list
+enum
+{
+	NODECOL_NAME = 0,
+	NODECOL_SHARE,
+	NODECOL_EXCLUSIVE,
+	NODECOL_INCLUSIVE,
+	NODECOL_COST,
+	NODECOL_ROWS,
+	NODECOL_PLANROWS,
+	NODECOL_ERROR,
+	NODECOL_LOOPS,
+	NODECOL_HIT,
+	NODECOL_READ
+};
+
+// Rows taking less than this of the total are not coloured
+#define NODELIST_MIN_SHARE  0.05
+
+
+BEGIN_EVENT_TABLE(ExplainNodeList, ctlListView)
+	EVT_LIST_COL_CLICK(wxID_ANY,        ExplainNodeList::OnColumnClick)
+	EVT_LIST_ITEM_SELECTED(wxID_ANY,    ExplainNodeList::OnItemSelected)
+END_EVENT_TABLE()
+
+
+ExplainNodeList::ExplainNodeList(wxWindow *parent, ExplainCanvas *canvas)
+	: ctlListView(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_VIRTUAL | wxSUNKEN_BORDER)
+{
+	explainCanvas = canvas;
+	sortColumn = NODECOL_SHARE;
+	sortAscending = false;
+
+	AddColumn(_("Node"), 120);
+	AddColumn(_("% of total"), 40, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Exclusive ms"), 50, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Inclusive ms"), 50, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Exclusive cost"), 50, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Rows"), 40, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Planned rows"), 40, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Estimate"), 50, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Loops"), 30, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Shared hit"), 40, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Shared read"), 40, wxLIST_FORMAT_RIGHT);
+}
+
+
+void ExplainNodeList::SetPlan(ExplainPlan *plan)
+{
+	DeleteAllItems();
+	nodes.Clear();
+
+	if (plan)
+	{
+		for (size_t i = 0; i < plan->GetRoots().GetCount(); i++)
+			AddNodes(plan->GetRoots().Item(i));
+		SortNodes();
+	}
+
+	SetItemCount(nodes.GetCount());
+	Refresh();
+}
+
+
+void ExplainNodeList::AddNodes(ExplainNode *node)
+{
+	nodes.Add(node);
+	for (size_t i = 0; i < node->GetKids().GetCount(); i++)
+		AddNodes(node->GetKids().Item(i));
+}
+
+
+void ExplainNodeList::Sort(int col, bool ascending)
+{
+	// The selected item would be another node now
+	long item = GetFirstSelected();
+	while (item >= 0)
+	{
+		Select(item, false);
+		item = GetNextSelected(item);
+	}
+
+	sortColumn = col;
+	sortAscending = ascending;
+	SortNodes();
+	Refresh();
+}
+
+
+// The nodes are sorted by one thread only, the UI one
+static int sortCol;
+static int sortDirection;
+
+static double GetNodeValue(ExplainNode *node, int col)
+{
+	switch (col)
+	{
+		case NODECOL_SHARE:
+			return node->share;
+		case NODECOL_EXCLUSIVE:
+			return node->exclusiveTime;
+		case NODECOL_INCLUSIVE:
+			return node->GetTime();
+		case NODECOL_COST:
+			return node->exclusiveCost;
+		case NODECOL_ROWS:
+			return node->analyzed ? node->actualRows : -1;
+		case NODECOL_PLANROWS:
+			return node->planRows;
+		case NODECOL_ERROR:
+			return node->GetRowsError();
+		case NODECOL_LOOPS:
+			return node->analyzed ? node->actualLoops : -1;
+		case NODECOL_HIT:
+			return node->sharedHit;
+		case NODECOL_READ:
+			return node->sharedRead;
+	}
+	return 0;
+}
+
+static int ExplainNodeCmp(ExplainNode **a, ExplainNode **b)
+{
+	int res = 0;
+
+	if (sortCol == NODECOL_NAME)
+		res = (*a)->GetName().Cmp((*b)->GetName());
+	else
+	{
+		double va = GetNodeValue(*a, sortCol), vb = GetNodeValue(*b, sortCol);
+		if (va < vb)
+			res = -1;
+		else if (va > vb)
+			res = 1;
+	}
+
+	// The larger share first, among equal ones
+	if (!res && (*a)->share != (*b)->share)
+		return (*a)->share > (*b)->share ? -1 : 1;
+
+	return res * sortDirection;
+}
+
+
+void ExplainNodeList::SortNodes()
+{
+	if (nodes.GetCount() < 2)
+		return;
+
+	sortCol = sortColumn;
+	sortDirection = sortAscending ? 1 : -1;
+	nodes.Sort(ExplainNodeCmp);
+}
+
+
+wxString ExplainNodeList::OnGetItemText(long item, long col) const
+{
+	if (item < 0 || item >= (long)nodes.GetCount())
+		return wxEmptyString;
+
+	ExplainNode *node = nodes.Item(item);
+	bool executed = node->analyzed && node->actualLoops > 0;
+
+	switch (col)
+	{
+		case NODECOL_NAME:
+			return node->GetName();
+		case NODECOL_SHARE:
+			return wxString::Format(wxT("%.1f"), node->share * 100);
+		case NODECOL_EXCLUSIVE:
+			if (node->exclusiveTime >= 0)
+				return wxString::Format(wxT("%.3f"), node->exclusiveTime);
+			break;
+		case NODECOL_INCLUSIVE:
+			if (node->GetTime() >= 0)
+				return wxString::Format(wxT("%.3f"), node->GetTime());
+			break;
+		case NODECOL_COST:
+			return wxString::Format(wxT("%.2f"), node->exclusiveCost);
+		case NODECOL_ROWS:
+			if (node->analyzed)
+				return wxString::Format(wxT("%.0f"), node->actualRows);
+			break;
+		case NODECOL_PLANROWS:
+			return wxString::Format(wxT("%.0f"), node->planRows);
+		case NODECOL_ERROR:
+			if (executed)
+			{
+				if (node->GetRowsError() < 1.05)
+					return _("right");
+				else if (node->IsUnderestimated())
+					return wxString::Format(_("%.1fx under"), node->GetRowsError());
+				else
+					return wxString::Format(_("%.1fx over"), node->GetRowsError());
+			}
+			break;
+		case NODECOL_LOOPS:
+			if (node->analyzed)
+				return wxString::Format(wxT("%.0f"), node->actualLoops);
+			break;
+		case NODECOL_HIT:
+			if (node->sharedHit || node->sharedRead)
+				return NumToStr(node->sharedHit);
+			break;
+		case NODECOL_READ:
+			if (node->sharedHit || node->sharedRead)
+				return NumToStr(node->sharedRead);
+			break;
+	}
+	return wxEmptyString;
+}
+
+
+wxListItemAttr *ExplainNodeList::OnGetItemAttr(long item) const
+{
+	if (item < 0 || item >= (long)nodes.GetCount() || nodes.Item(item)->share < NODELIST_MIN_SHARE)
+		return NULL;
+
+	// Coloured like its shape
+	wxListItemAttr *itemAttr = (wxListItemAttr *)&attr;
+	itemAttr->SetBackgroundColour(ExplainShape::GetHeatColour(nodes.Item(item)->share));
+	return itemAttr;
+}
+
+
+void ExplainNodeList::OnColumnClick(wxListEvent &ev)
+{
+	int col = ev.GetColumn();
+	if (col < 0)
+		return;
+
+	// Numbers are sorted the largest first, to start with
+	if (col == sortColumn)
+		Sort(col, !sortAscending);
+	else
+		Sort(col, col == NODECOL_NAME);
+}
+
+
+void ExplainNodeList::OnItemSelected(wxListEvent &ev)
+{
+	long item = ev.GetIndex();
+	if (item >= 0 && item < (long)nodes.GetCount())
+		explainCanvas->ShowNode(nodes.Item(item));
+}
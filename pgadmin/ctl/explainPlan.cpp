@@ -0,0 +1,853 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// explainPlan.cpp - Plans of EXPLAIN (FORMAT JSON)
+//
+//////////////////////////////////////////////////////////////////////////
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// App headers
+#include "pgAdmin3.h"
+#include "ctl/explainPlan.h"
+
+#include <wx/arrimpl.cpp>
+WX_DEFINE_OBJARRAY(ExplainRunArray);
+WX_DEFINE_OBJARRAY(ExplainDiffRowArray);
+
+// Deeper documents are not taken as plans, rather than running out of stack
+#define JSON_MAX_DEPTH  4096
+
+
+// A value of a JSON document
+class explainJsonValue;
+WX_DEFINE_ARRAY_PTR(explainJsonValue *, explainJsonValueArray);
+
+class explainJsonValue
+{
+public:
+	enum
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	explainJsonValue(int t)
+	{
+		type = t;
+		number = 0;
+	}
+	~explainJsonValue()
+	{
+		WX_CLEAR_ARRAY(items);
+	}
+
+	// The value of the key of an object, NULL if there is none
+	const explainJsonValue *Get(const wxString &key) const
+	{
+		int pos = keys.Index(key);
+		return pos == wxNOT_FOUND ? NULL : items.Item(pos);
+	}
+
+	// The value, the way it is shown in the text of a plan
+	wxString GetText() const
+	{
+		if (type != JSON_ARRAY)
+			return text;
+
+		wxString str;
+		for (size_t i = 0; i < items.GetCount(); i++)
+		{
+			wxString item = items.Item(i)->GetText();
+			if (item.IsEmpty())
+				continue;
+			if (!str.IsEmpty())
+				str += wxT(", ");
+			str += item;
+		}
+		return str;
+	}
+
+	int type;
+	// Strings; numbers and booleans as they were written
+	wxString text;
+	double number;
+	// The items of an array, or the values of the keys of an object
+	explainJsonValueArray items;
+	wxArrayString keys;
+};
+
+
+class explainJsonParser
+{
+public:
+	explainJsonParser(const wxString &str)
+		: json(str)
+	{
+		pos = json.c_str();
+	}
+
+	// The document; NULL, if it is not valid JSON
+	explainJsonValue *Parse()
+	{
+		explainJsonValue *value = ParseValue(0);
+		SkipSpace();
+		if (value && *pos)
+		{
+			delete value;
+			return NULL;
+		}
+		return value;
+	}
+
+private:
+	void SkipSpace()
+	{
+		while (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')
+			pos++;
+	}
+
+	bool SkipWord(const wxChar *word)
+	{
+		size_t len = wxStrlen(word);
+		if (wxStrncmp(pos, word, len))
+			return false;
+		pos += len;
+		return true;
+	}
+
+	// The four hex digits of a \u escape at p
+	static bool ParseHex(const wxChar *p, unsigned long &code)
+	{
+		code = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (!wxIsxdigit(p[i]))
+				return false;
+			code = code * 16 + (wxIsdigit(p[i]) ? p[i] - '0' : (wxToupper(p[i]) - 'A' + 10));
+		}
+		return true;
+	}
+
+	explainJsonValue *ParseValue(int depth);
+	bool ParseString(wxString &str);
+
+	wxString json;
+	const wxChar *pos;
+};
+
+
+explainJsonValue *explainJsonParser::ParseValue(int depth)
+{
+	if (depth > JSON_MAX_DEPTH)
+		return NULL;
+
+	SkipSpace();
+
+	explainJsonValue *value = NULL;
+	if (*pos == '{' || *pos == '[')
+	{
+		bool object = (*pos == '{');
+		wxChar close = object ? '}' : ']';
+
+		value = new explainJsonValue(object ? explainJsonValue::JSON_OBJECT : explainJsonValue::JSON_ARRAY);
+		pos++;
+		SkipSpace();
+		if (*pos == close)
+		{
+			pos++;
+			return value;
+		}
+
+		while (true)
+		{
+			if (object)
+			{
+				wxString key;
+				SkipSpace();
+				if (!ParseString(key))
+					break;
+				SkipSpace();
+				if (*pos != ':')
+					break;
+				pos++;
+				value->keys.Add(key);
+			}
+
+			explainJsonValue *item = ParseValue(depth + 1);
+			if (!item)
+				break;
+			value->items.Add(item);
+
+			SkipSpace();
+			if (*pos == ',')
+				pos++;
+			else if (*pos == close)
+			{
+				pos++;
+				return value;
+			}
+			else
+				break;
+		}
+		delete value;
+		return NULL;
+	}
+	else if (*pos == '"')
+	{
+		value = new explainJsonValue(explainJsonValue::JSON_STRING);
+		if (!ParseString(value->text))
+		{
+			delete value;
+			return NULL;
+		}
+	}
+	else if (SkipWord(wxT("true")))
+	{
+		value = new explainJsonValue(explainJsonValue::JSON_BOOL);
+		value->text = wxT("true");
+		value->number = 1;
+	}
+	else if (SkipWord(wxT("false")))
+	{
+		value = new explainJsonValue(explainJsonValue::JSON_BOOL);
+		value->text = wxT("false");
+	}
+	else if (SkipWord(wxT("null")))
+		value = new explainJsonValue(explainJsonValue::JSON_NULL);
+	else
+	{
+		const wxChar *start = pos;
+		while ((*pos >= '0' && *pos <= '9') || *pos == '-' || *pos == '+' || *pos == '.' || *pos == 'e' || *pos == 'E')
+			pos++;
+		if (pos == start)
+			return NULL;
+
+		value = new explainJsonValue(explainJsonValue::JSON_NUMBER);
+		value->text = wxString(start, pos - start);
+		value->number = StrToDouble(value->text);
+	}
+	return value;
+}
+
+
+bool explainJsonParser::ParseString(wxString &str)
+{
+	if (*pos != '"')
+		return false;
+	pos++;
+
+	const wxChar *start = pos;
+	while (*pos != '"')
+	{
+		if (!*pos)
+			return false;
+
+		if (*pos != '\\')
+		{
+			pos++;
+			continue;
+		}
+
+		str.Append(start, pos - start);
+		pos++;
+		switch (*pos)
+		{
+			case 'b':
+				str += '\b';
+				break;
+			case 'f':
+				str += '\f';
+				break;
+			case 'n':
+				str += '\n';
+				break;
+			case 'r':
+				str += '\r';
+				break;
+			case 't':
+				str += '\t';
+				break;
+			case 'u':
+			{
+				unsigned long code;
+				if (!ParseHex(pos + 1, code) || (code >= 0xdc00 && code <= 0xdfff))
+					return false;
+				pos += 4;
+
+				// Characters beyond the BMP come as a pair of surrogates
+				if (code >= 0xd800 && code <= 0xdbff)
+				{
+					unsigned long low;
+					if (pos[1] != '\\' || pos[2] != 'u' || !ParseHex(pos + 3, low) || low < 0xdc00 || low > 0xdfff)
+						return false;
+					pos += 6;
+
+					if (sizeof(wxChar) == 2)
+					{
+						str += (wxChar)code;
+						str += (wxChar)low;
+						break;
+					}
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+				}
+				str += (wxChar)code;
+				break;
+			}
+			case 0:
+				return false;
+			default:
+				str += *pos;
+				break;
+		}
+		pos++;
+		start = pos;
+	}
+	str.Append(start, pos - start);
+	pos++;
+
+	return true;
+}
+
+
+ExplainNode::ExplainNode(ExplainNode *up)
+{
+	upper = up;
+
+	startupCost = 0;
+	totalCost = 0;
+	planRows = 0;
+	planWidth = 0;
+
+	analyzed = false;
+	actualStartup = -1;
+	actualTotal = -1;
+	actualRows = 0;
+	actualLoops = 0;
+
+	sharedHit = 0;
+	sharedRead = 0;
+	localHit = 0;
+	localRead = 0;
+	tempRead = 0;
+	tempWritten = 0;
+
+	exclusiveTime = -1;
+	exclusiveCost = 0;
+	share = 0;
+}
+
+
+ExplainNode::~ExplainNode()
+{
+	WX_CLEAR_ARRAY(kids);
+}
+
+
+double ExplainNode::GetRowsError() const
+{
+	if (!analyzed || actualLoops == 0)
+		return 1;
+
+	// Both per loop; a row is the least either can be
+	double actual = wxMax(actualRows, 1), planned = wxMax(planRows, 1);
+	return actual > planned ? actual / planned : planned / actual;
+}
+
+
+wxString ExplainNode::GetHeading() const
+{
+	wxString str = GetName();
+
+	str += wxString::Format(wxT("  (cost=%.2f..%.2f rows=%.0f width=%ld)"),
+	                        startupCost, totalCost, planRows, planWidth);
+
+	if (analyzed)
+	{
+		if (actualLoops == 0)
+			str += wxT(" (never executed)");
+		else if (actualTotal < 0)
+			str += wxString::Format(wxT(" (actual rows=%.0f loops=%.0f)"), actualRows, actualLoops);
+		else
+			str += wxString::Format(wxT(" (actual time=%.3f..%.3f rows=%.0f loops=%.0f)"),
+			                        actualStartup, actualTotal, actualRows, actualLoops);
+	}
+
+	return str;
+}
+
+
+wxString ExplainNode::GetName() const
+{
+	// Named like src/backend/commands/explain.c does it for text
+	wxString str = nodeType;
+
+	if (nodeType == wxT("Aggregate"))
+	{
+		if (strategy == wxT("Sorted"))
+			str = wxT("GroupAggregate");
+		else if (strategy == wxT("Hashed"))
+			str = wxT("HashAggregate");
+		else if (strategy == wxT("Mixed"))
+			str = wxT("MixedAggregate");
+	}
+	else if (nodeType == wxT("SetOp"))
+	{
+		if (strategy == wxT("Hashed"))
+			str = wxT("HashSetOp");
+		if (!setopCommand.IsEmpty())
+			str += wxT(" ") + setopCommand;
+	}
+	else if (nodeType == wxT("ModifyTable") && !operation.IsEmpty())
+		str = operation;
+
+	if (!joinType.IsEmpty() && joinType != wxT("Inner"))
+	{
+		if (nodeType.EndsWith(wxT(" Join")))
+			str = nodeType.BeforeLast(' ');
+		str += wxT(" ") + joinType + wxT(" Join");
+	}
+
+	if (!indexName.IsEmpty())
+	{
+		if (scanDirection == wxT("Backward"))
+			str += wxT(" Backward");
+		if (nodeType == wxT("Bitmap Index Scan"))
+			str += wxT(" on ");
+		else
+			str += wxT(" using ");
+		str += qtIdent(indexName);
+	}
+
+	wxString target;
+	if (!relationName.IsEmpty())
+		target = relationName;
+	else if (!functionName.IsEmpty())
+		target = functionName;
+	else if (!cteName.IsEmpty())
+		target = cteName;
+
+	if (!target.IsEmpty())
+	{
+		str += wxT(" on ");
+		if (!schema.IsEmpty())
+			str += qtIdent(schema) + wxT(".");
+		str += qtIdent(target);
+		if (!alias.IsEmpty() && alias != target)
+			str += wxT(" ") + qtIdent(alias);
+	}
+	else if (!alias.IsEmpty())
+		str += wxT(" on ") + qtIdent(alias);
+
+	return str;
+}
+
+
+ExplainNode *ExplainPlan::ReadNode(const explainJsonValue *value, ExplainNode *upper, size_t &count)
+{
+	if (value->type != explainJsonValue::JSON_OBJECT)
+		return NULL;
+
+	ExplainNode *node = new ExplainNode(upper);
+	count++;
+
+	for (size_t i = 0; i < value->keys.GetCount(); i++)
+	{
+		const wxString &key = value->keys.Item(i);
+		const explainJsonValue *item = value->items.Item(i);
+
+		if (key == wxT("Plans"))
+		{
+			for (size_t k = 0; k < item->items.GetCount(); k++)
+			{
+				ExplainNode *kid = ReadNode(item->items.Item(k), node, count);
+				if (kid)
+					node->kids.Add(kid);
+			}
+		}
+		else if (key == wxT("Node Type"))
+			node->nodeType = item->text;
+		else if (key == wxT("Strategy"))
+			node->strategy = item->text;
+		else if (key == wxT("Join Type"))
+			node->joinType = item->text;
+		else if (key == wxT("Operation"))
+			node->operation = item->text;
+		else if (key == wxT("Command"))
+			node->setopCommand = item->text;
+		else if (key == wxT("Parent Relationship"))
+			node->parentRelationship = item->text;
+		else if (key == wxT("Subplan Name"))
+			node->subplanName = item->text;
+		else if (key == wxT("Relation Name"))
+			node->relationName = item->text;
+		else if (key == wxT("Schema"))
+			node->schema = item->text;
+		else if (key == wxT("Alias"))
+			node->alias = item->text;
+		else if (key == wxT("Index Name"))
+			node->indexName = item->text;
+		else if (key == wxT("Scan Direction"))
+			node->scanDirection = item->text;
+		else if (key == wxT("CTE Name"))
+			node->cteName = item->text;
+		else if (key == wxT("Function Name"))
+			node->functionName = item->text;
+		else if (key == wxT("Startup Cost"))
+			node->startupCost = item->number;
+		else if (key == wxT("Total Cost"))
+			node->totalCost = item->number;
+		else if (key == wxT("Plan Rows"))
+			node->planRows = item->number;
+		else if (key == wxT("Plan Width"))
+			node->planWidth = (long)item->number;
+		else if (key == wxT("Actual Startup Time"))
+			node->actualStartup = item->number;
+		else if (key == wxT("Actual Total Time"))
+			node->actualTotal = item->number;
+		else if (key == wxT("Actual Rows"))
+			node->actualRows = item->number;
+		else if (key == wxT("Actual Loops"))
+		{
+			node->actualLoops = item->number;
+			node->analyzed = true;
+		}
+		else if (key == wxT("Shared Hit Blocks"))
+			node->sharedHit = (long)item->number;
+		else if (key == wxT("Shared Read Blocks"))
+			node->sharedRead = (long)item->number;
+		else if (key == wxT("Local Hit Blocks"))
+			node->localHit = (long)item->number;
+		else if (key == wxT("Local Read Blocks"))
+			node->localRead = (long)item->number;
+		else if (key == wxT("Temp Read Blocks"))
+			node->tempRead = (long)item->number;
+		else if (key == wxT("Temp Written Blocks"))
+			node->tempWritten = (long)item->number;
+		else if (item->type == explainJsonValue::JSON_BOOL)
+		{
+			// The text format only mentions the flags set, too
+			if (item->number)
+			{
+				node->detailNames.Add(key);
+				node->detailValues.Add(item->text);
+			}
+		}
+		else if (item->type != explainJsonValue::JSON_OBJECT && item->type != explainJsonValue::JSON_NULL)
+		{
+			wxString text = item->GetText();
+			if (!text.IsEmpty())
+			{
+				node->detailNames.Add(key);
+				node->detailValues.Add(text);
+			}
+		}
+	}
+
+	return node;
+}
+
+
+ExplainPlan::ExplainPlan()
+{
+	count = 0;
+	timed = false;
+	planningTime = -1;
+	executionTime = -1;
+}
+
+
+ExplainPlan::~ExplainPlan()
+{
+	WX_CLEAR_ARRAY(roots);
+}
+
+
+ExplainPlan *ExplainPlan::Parse(const wxString &json)
+{
+	if (!json.Strip(wxString::leading).StartsWith(wxT("[")))
+		return NULL;
+
+	explainJsonParser parser(json);
+	explainJsonValue *doc = parser.Parse();
+	if (!doc)
+		return NULL;
+
+	// An array of the statements, each an object with the plan of it
+	ExplainPlan *plan = new ExplainPlan();
+	for (size_t i = 0; i < doc->items.GetCount(); i++)
+	{
+		const explainJsonValue *statement = doc->items.Item(i);
+		const explainJsonValue *value;
+		if (statement->type != explainJsonValue::JSON_OBJECT || !(value = statement->Get(wxT("Plan"))))
+			continue;
+
+		ExplainNode *root = ReadNode(value, NULL, plan->count);
+		if (!root)
+			continue;
+		plan->roots.Add(root);
+
+		value = statement->Get(wxT("Planning Time"));
+		if (value)
+			plan->planningTime = wxMax(plan->planningTime, 0) + value->number;
+
+		// Called so before 9.4
+		value = statement->Get(wxT("Execution Time"));
+		if (!value)
+			value = statement->Get(wxT("Total Runtime"));
+		if (value)
+			plan->executionTime = wxMax(plan->executionTime, 0) + value->number;
+	}
+	delete doc;
+
+	if (plan->roots.IsEmpty())
+	{
+		delete plan;
+		return NULL;
+	}
+
+	size_t i;
+	for (i = 0; i < plan->roots.GetCount(); i++)
+		plan->timed = plan->timed || plan->roots.Item(i)->GetTime() >= 0;
+
+	double total = 0;
+	for (i = 0; i < plan->roots.GetCount(); i++)
+	{
+		ExplainNode *root = plan->roots.Item(i);
+		plan->Analyze(root);
+		total += plan->timed ? wxMax(root->GetTime(), 0) : root->totalCost;
+	}
+	for (i = 0; i < plan->roots.GetCount(); i++)
+		plan->SetShares(plan->roots.Item(i), total);
+
+	return plan;
+}
+
+
+void ExplainPlan::Analyze(ExplainNode *node)
+{
+	double time = node->GetTime(), cost = node->totalCost;
+
+	for (size_t i = 0; i < node->kids.GetCount(); i++)
+	{
+		ExplainNode *kid = node->kids.Item(i);
+		Analyze(kid);
+
+		if (kid->GetTime() > 0)
+			time -= kid->GetTime();
+		cost -= kid->totalCost;
+	}
+
+	// The kids may seem to take more than the node, e.g. below a Limit,
+	// or with the loops of parallel workers
+	if (node->GetTime() >= 0)
+		node->exclusiveTime = wxMax(time, 0);
+	node->exclusiveCost = wxMax(cost, 0);
+}
+
+
+void ExplainPlan::SetShares(ExplainNode *node, double total)
+{
+	double exclusive = timed ? node->exclusiveTime : node->exclusiveCost;
+	if (total > 0 && exclusive > 0)
+		node->share = wxMin(exclusive / total, 1);
+
+	for (size_t i = 0; i < node->kids.GetCount(); i++)
+		SetShares(node->kids.Item(i), total);
+}
+
+
+double ExplainPlan::GetTotalTime() const
+{
+	if (executionTime >= 0)
+		return executionTime;
+	if (!timed)
+		return -1;
+
+	double total = 0;
+	for (size_t i = 0; i < roots.GetCount(); i++)
+		total += wxMax(roots.Item(i)->GetTime(), 0);
+	return total;
+}
+
+
+double ExplainPlan::GetTotalCost() const
+{
+	double total = 0;
+	for (size_t i = 0; i < roots.GetCount(); i++)
+		total += roots.Item(i)->totalCost;
+	return total;
+}
+
+
+WX_DECLARE_STRING_HASH_MAP(wxArrayInt, ExplainKidMap);
+
+ExplainPlanDiff::ExplainPlanDiff(ExplainPlan *before, ExplainPlan *after)
+{
+	size_t i;
+	for (i = 0; i < before->GetRoots().GetCount(); i++)
+		AddSignatures(before->GetRoots().Item(i));
+	for (i = 0; i < after->GetRoots().GetCount(); i++)
+		AddSignatures(after->GetRoots().Item(i));
+
+	// The statements are the same, in the same order
+	for (i = 0; i < before->GetRoots().GetCount() || i < after->GetRoots().GetCount(); i++)
+	{
+		if (i >= after->GetRoots().GetCount())
+			AddUnmatched(before->GetRoots().Item(i), true, 0);
+		else if (i >= before->GetRoots().GetCount())
+			AddUnmatched(after->GetRoots().Item(i), false, 0);
+		else
+			MatchNodes(before->GetRoots().Item(i), after->GetRoots().Item(i), 0);
+	}
+}
+
+
+wxString ExplainPlanDiff::AddSignatures(ExplainNode *node)
+{
+	wxArrayString names;
+
+	if (!node->relationName.IsEmpty())
+		names.Add(node->schema + wxT(".") + node->relationName);
+	else if (!node->functionName.IsEmpty())
+		names.Add(node->schema + wxT(".") + node->functionName);
+	else if (!node->cteName.IsEmpty())
+		names.Add(node->cteName);
+
+	for (size_t i = 0; i < node->GetKids().GetCount(); i++)
+	{
+		wxString kid = AddSignatures(node->GetKids().Item(i));
+		if (!kid.IsEmpty())
+			names.Add(kid);
+	}
+	names.Sort();
+
+	wxString signature;
+	for (size_t n = 0; n < names.GetCount(); n++)
+	{
+		if (n)
+			signature += wxT(",");
+		signature += names.Item(n);
+	}
+
+	signatures[node] = signature;
+	return signature;
+}
+
+
+void ExplainPlanDiff::MatchNodes(ExplainNode *before, ExplainNode *after, int depth)
+{
+	ExplainDiffRow row;
+	row.before = before;
+	row.after = after;
+	row.depth = depth;
+	row.changes = GetChanges(before, after);
+	rows.Add(row);
+
+	const ExplainNodeArray &beforeKids = before->GetKids(), &afterKids = after->GetKids();
+	wxArrayInt pairs, used;
+	pairs.Add(-1, beforeKids.GetCount());
+	used.Add(0, afterKids.GetCount());
+
+	// The kids having the same relations below them first, e.g. the
+	// sides of a join swapped
+	ExplainKidMap afterSignatures;
+	size_t i, j;
+	for (j = 0; j < afterKids.GetCount(); j++)
+	{
+		const wxString &signature = signatures[afterKids.Item(j)];
+		if (!signature.IsEmpty())
+			afterSignatures[signature].Add(j);
+	}
+	for (i = 0; i < beforeKids.GetCount(); i++)
+	{
+		ExplainKidMap::iterator it = afterSignatures.find(signatures[beforeKids.Item(i)]);
+		if (it == afterSignatures.end() || it->second.IsEmpty())
+			continue;
+
+		pairs[i] = it->second.Item(0);
+		used[pairs[i]] = 1;
+		it->second.RemoveAt(0);
+	}
+
+	// Then the others by their place
+	j = 0;
+	for (i = 0; i < beforeKids.GetCount(); i++)
+	{
+		if (pairs[i] >= 0)
+			continue;
+		while (j < afterKids.GetCount() && used[j])
+			j++;
+		if (j >= afterKids.GetCount())
+			break;
+
+		pairs[i] = j;
+		used[j] = 1;
+	}
+
+	for (i = 0; i < beforeKids.GetCount(); i++)
+	{
+		if (pairs[i] >= 0)
+			MatchNodes(beforeKids.Item(i), afterKids.Item(pairs[i]), depth + 1);
+		else
+			AddUnmatched(beforeKids.Item(i), true, depth + 1);
+	}
+	for (j = 0; j < afterKids.GetCount(); j++)
+	{
+		if (!used[j])
+			AddUnmatched(afterKids.Item(j), false, depth + 1);
+	}
+}
+
+
+void ExplainPlanDiff::AddUnmatched(ExplainNode *node, bool before, int depth)
+{
+	ExplainDiffRow row;
+	row.before = before ? node : NULL;
+	row.after = before ? NULL : node;
+	row.depth = depth;
+	rows.Add(row);
+
+	for (size_t i = 0; i < node->GetKids().GetCount(); i++)
+		AddUnmatched(node->GetKids().Item(i), before, depth + 1);
+}
+
+
+wxString ExplainPlanDiff::GetChanges(ExplainNode *before, ExplainNode *after)
+{
+	wxArrayString changes;
+
+	if (before->nodeType != after->nodeType || before->joinType != after->joinType ||
+	        before->strategy != after->strategy || before->indexName != after->indexName)
+		changes.Add(wxString::Format(_("was %s"), before->GetName().c_str()));
+
+	// Estimates are told apart only if one is at least twice the other
+	double planned = wxMax(before->planRows, 1), planned2 = wxMax(after->planRows, 1);
+	if (planned >= planned2 * 2 || planned2 >= planned * 2)
+		changes.Add(wxString::Format(_("planned rows %.0f -> %.0f"), before->planRows, after->planRows));
+
+	if (before->analyzed && after->analyzed && before->actualLoops > 0 && after->actualLoops > 0)
+	{
+		double error = before->GetRowsError(), error2 = after->GetRowsError();
+		if (error >= error2 * 2 || error2 >= error * 2)
+			changes.Add(wxString::Format(_("estimate off %.1fx -> %.1fx"), error, error2));
+	}
+
+	wxString str;
+	for (size_t i = 0; i < changes.GetCount(); i++)
+	{
+		if (i)
+			str += wxT("; ");
+		str += changes.Item(i);
+	}
+	return str;
+}
@@ -17,6 +17,7 @@
 // App headers
 #include "pgAdmin3.h"
 #include "ctl/explainCanvas.h"
+#include "ctl/explainPlan.h"
 
 #include <wx/docview.h>
 
@@ -82,6 +83,13 @@ ExplainShape::ExplainShape(const wxImage &bmp, const wxString &description, long
 	totalShapes = 0;
 	usedShapes = 0;
 	m_rootShape = false;
+	costLow = 0;
+	costHigh = 0;
+	rows = 0;
+	width = 0;
+	line = NULL;
+	node = NULL;
+	marked = false;
 }
 
 
@@ -138,6 +146,20 @@ void ExplainShape::OnDraw(wxDC &dc)
 	x = WXROUND(m_xpos - bmp.GetWidth() / 2.0);
 	y = WXROUND(m_ypos - GetHeight() / 2.0);
 
+	// The more of the total the node took, the redder
+	if (node && node->share >= 0.01)
+	{
+		dc.SetPen(*wxTRANSPARENT_PEN);
+		dc.SetBrush(*wxTheBrushList->FindOrCreateBrush(GetHeatColour(node->share), wxSOLID));
+		dc.DrawRectangle(x - BMP_BORDER, y - BMP_BORDER, bmp.GetWidth() + BMP_BORDER * 2, bmp.GetHeight() + BMP_BORDER * 2);
+	}
+	if (marked)
+	{
+		dc.SetPen(*wxThePenList->FindOrCreatePen(*wxBLUE, 2, wxSOLID));
+		dc.SetBrush(*wxTRANSPARENT_BRUSH);
+		dc.DrawRectangle(x - BMP_BORDER * 2, y - BMP_BORDER * 2, bmp.GetWidth() + BMP_BORDER * 4, bmp.GetHeight() + BMP_BORDER * 4);
+	}
+
 	dc.DrawBitmap(bmp, x, y, true);
 
 	int w, h;
@@ -151,6 +173,13 @@ void ExplainShape::OnDraw(wxDC &dc)
 }
 
 
+wxColour ExplainShape::GetHeatColour(double share)
+{
+	// From light yellow to red
+	return wxColour(255, (unsigned char)(255 - 191 * share), (unsigned char)(204 - 172 * share));
+}
+
+
 void ExplainShape::OnLeftClick(double x, double y, int keys, int attachment)
 {
 	((ExplainCanvas *)GetCanvas())->ShowPopup(this);
@@ -444,6 +473,7 @@ ExplainShape *ExplainShape::Create(long level, ExplainShape *last, const wxStrin
 	{
 		s->kidNo = last->kidCount;
 		last->kidCount++;
+		last->kids.Add(s);
 	}
 	else
 		s->kidNo = 0;
@@ -485,10 +515,58 @@ ExplainShape *ExplainShape::Create(long level, ExplainShape *last, const wxStrin
 }
 
 
+ExplainShape *ExplainShape::Create(long level, ExplainShape *last, ExplainNode *node)
+{
+	// Shown the same as the text of the node would be
+	ExplainShape *s = Create(level, last, node->GetHeading());
+	if (!s)
+		return 0;
+
+	s->node = node;
+
+	if (!node->subplanName.IsEmpty())
+		s->SetCondition(node->subplanName);
+
+	for (size_t i = 0; i < node->detailNames.GetCount(); i++)
+		s->SetCondition(node->detailNames.Item(i) + wxT(": ") + node->detailValues.Item(i));
+
+	if (node->sharedHit || node->sharedRead)
+		s->SetCondition(wxString::Format(wxT("Buffers: shared hit=%ld read=%ld"), node->sharedHit, node->sharedRead));
+
+	if (node->exclusiveTime >= 0)
+		s->analysis = wxString::Format(_("Exclusive time: %.3f ms (%.1f%%)"), node->exclusiveTime, node->share * 100);
+	else
+		s->analysis = wxString::Format(_("Exclusive cost: %.2f (%.1f%%)"), node->exclusiveCost, node->share * 100);
+
+	if (node->analyzed && node->actualLoops > 0 && node->GetRowsError() >= 2)
+	{
+		s->analysis += wxT(", ");
+		if (node->IsUnderestimated())
+			s->analysis += wxString::Format(_("rows underestimated %.0f times"), node->GetRowsError());
+		else
+			s->analysis += wxString::Format(_("rows overestimated %.0f times"), node->GetRowsError());
+	}
+
+	return s;
+}
+
+
+void ExplainShape::AddLineTo(ExplainLine *l, ExplainShape *upper)
+{
+	// Plans may have thousands of kids to a node
+	m_lines.Append(l);
+	upper->m_lines.Append(l);
+
+	l->SetFrom(this);
+	l->SetTo(upper);
+	l->SetAttachments(0, 0);
+}
+
+
 ExplainLine::ExplainLine(ExplainShape *from, ExplainShape *to, double weight)
 {
 	SetCanvas(from->GetCanvas());
-	from->AddLine(this, to);
+	from->AddLineTo(this, to);
 	MakeLineControlPoints(4);
 
 	width = (int) log(from->GetAverageCost());
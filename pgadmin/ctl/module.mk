@@ -26,6 +26,8 @@ pgadmin3_SOURCES += \
         ctl/ctlTree.cpp \
 		ctl/ctlProgressStatusBar.cpp \
         ctl/explainCanvas.cpp \
+        ctl/explainNodeList.cpp \
+        ctl/explainPlan.cpp \
         ctl/explainShape.cpp \
         ctl/timespin.cpp \
         ctl/xh_calb.cpp \
@@ -11,6 +11,8 @@
 
 pgadmin3_SOURCES += \
 	db/keywords.c \
+	db/pgCatalogCache.cpp \
+	db/pgCompletionIndex.cpp \
 	db/pgConn.cpp \
 	db/pgSet.cpp \
 	db/pgQueryThread.cpp
@@ -0,0 +1,475 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgCatalogCache.cpp - Client-side snapshot of the catalogs of a database
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// App headers
+#include "db/pgConn.h"
+#include "db/pgSet.h"
+#include "db/pgCatalogCache.h"
+
+#include <wx/arrimpl.cpp>
+WX_DEFINE_OBJARRAY(pgCatalogNamespaceArray);
+WX_DEFINE_OBJARRAY(pgCatalogTypeArray);
+WX_DEFINE_OBJARRAY(pgCatalogFunctionArray);
+WX_DEFINE_OBJARRAY(pgCatalogAttributeArray);
+
+// The server is asked for changes at most this often (in seconds)
+#define CATALOG_CHECK_INTERVAL  60
+
+// Relations kept in the snapshot (no indexes, toast tables or composite types)
+#define CATALOG_RELKINDS        wxT("'r','v','m','f','p','x','S'")
+
+// Columns of up to this many relations are loaded by their OIDs
+#define CATALOG_MAX_OID_LIST    200
+
+WX_DECLARE_STRING_HASH_MAP(pgCatalogCache *, pgCatalogCacheMap);
+static pgCatalogCacheMap catalogCaches;
+
+
+pgCatalogCache::pgCatalogCache()
+{
+	reloadAll = false;
+}
+
+
+pgCatalogCache::~pgCatalogCache()
+{
+	pgCatalogRelationMap::iterator it;
+	for (it = relations.begin(); it != relations.end(); ++it)
+		delete it->second;
+}
+
+
+wxString pgCatalogCache::GetKey(pgConn *conn)
+{
+	return conn->GetHostName() + wxT(":") + NumToStr((long)conn->GetPort()) + wxT("/") + conn->GetDbname();
+}
+
+
+pgCatalogCache *pgCatalogCache::Get(pgConn *conn)
+{
+	if (!conn)
+		return NULL;
+
+	wxString key = GetKey(conn);
+	pgCatalogCache *cache;
+
+	pgCatalogCacheMap::iterator it = catalogCaches.find(key);
+	if (it == catalogCaches.end())
+	{
+		cache = new pgCatalogCache();
+		catalogCaches[key] = cache;
+	}
+	else
+		cache = it->second;
+
+	cache->Refresh(conn);
+	return cache;
+}
+
+
+void pgCatalogCache::Invalidate(pgConn *conn, bool reload)
+{
+	if (!conn)
+		return;
+
+	pgCatalogCacheMap::iterator it = catalogCaches.find(GetKey(conn));
+	if (it != catalogCaches.end())
+	{
+		it->second->Expire();
+		if (reload)
+			it->second->reloadAll = true;
+	}
+}
+
+
+void pgCatalogCache::ClearAll()
+{
+	pgCatalogCacheMap::iterator it;
+	for (it = catalogCaches.begin(); it != catalogCaches.end(); ++it)
+		delete it->second;
+	catalogCaches.clear();
+}
+
+
+bool pgCatalogCache::Refresh(pgConn *conn, bool force)
+{
+	wxDateTime now = wxDateTime::Now();
+
+	if (reloadAll)
+		force = true;
+
+	if (!force && lastCheck.IsValid() &&
+	        (now - lastCheck).GetSeconds() < CATALOG_CHECK_INTERVAL)
+		return true;
+
+	// Changed or new rows have a new xmin, rewritten relations a new
+	// relfilenode, so a single round trip tells which catalogs changed.
+	// Columns renamed, dropped etc. only change their pg_attribute rows.
+	pgSet *stamps = conn->ExecuteSet(
+	                    wxT("SELECT (SELECT count(*)::text || ':' || coalesce(sum(xmin::text::bigint), 0)::text\n")
+	                    wxT("          FROM pg_namespace) AS nsp,\n")
+	                    wxT("       (SELECT count(*)::text || ':' || coalesce(sum(xmin::text::bigint), 0)::text || ':' || coalesce(sum(relfilenode::text::bigint), 0)::text\n")
+	                    wxT("          FROM pg_class WHERE relkind IN (") CATALOG_RELKINDS wxT(")) AS rel,\n")
+	                    wxT("       (SELECT count(*)::text || ':' || coalesce(sum(att.xmin::text::bigint), 0)::text\n")
+	                    wxT("          FROM pg_attribute att JOIN pg_class cl ON cl.oid=att.attrelid\n")
+	                    wxT("         WHERE cl.relkind IN (") CATALOG_RELKINDS wxT(")) AS att,\n")
+	                    wxT("       (SELECT count(*)::text || ':' || coalesce(sum(xmin::text::bigint), 0)::text\n")
+	                    wxT("          FROM pg_type) AS typ,\n")
+	                    wxT("       (SELECT count(*)::text || ':' || coalesce(sum(xmin::text::bigint), 0)::text\n")
+	                    wxT("          FROM pg_proc) AS pro"), false);
+
+	if (!stamps)
+		return false;
+
+	lastCheck = now;
+	reloadAll = false;
+
+	if (force || stamps->GetVal(wxT("nsp")) != nspStamp)
+	{
+		LoadNamespaces(conn);
+		nspStamp = stamps->GetVal(wxT("nsp"));
+	}
+	if (force || stamps->GetVal(wxT("rel")) != relStamp)
+	{
+		if (force)
+		{
+			pgCatalogRelationMap::iterator it;
+			for (it = relations.begin(); it != relations.end(); ++it)
+				delete it->second;
+			relations.clear();
+			relationsByName.clear();
+		}
+		LoadRelations(conn);
+		relStamp = stamps->GetVal(wxT("rel"));
+	}
+	if (force || stamps->GetVal(wxT("att")) != attStamp)
+	{
+		CheckAttributes(conn);
+		attStamp = stamps->GetVal(wxT("att"));
+	}
+	if (force || stamps->GetVal(wxT("typ")) != typStamp)
+	{
+		LoadTypes(conn);
+		typStamp = stamps->GetVal(wxT("typ"));
+	}
+	if (force || stamps->GetVal(wxT("pro")) != proStamp)
+	{
+		LoadFunctions(conn);
+		proStamp = stamps->GetVal(wxT("pro"));
+	}
+
+	delete stamps;
+	return true;
+}
+
+
+void pgCatalogCache::LoadNamespaces(pgConn *conn)
+{
+	pgSet *set = conn->ExecuteSet(wxT("SELECT oid, nspname FROM pg_namespace ORDER BY nspname"), false);
+	if (!set)
+		return;
+
+	namespaces.Empty();
+	while (!set->Eof())
+	{
+		pgCatalogNamespace nsp;
+		nsp.oid = set->GetOid(0);
+		nsp.name = set->GetVal(1);
+		namespaces.Add(nsp);
+
+		set->MoveNext();
+	}
+	delete set;
+}
+
+
+void pgCatalogCache::LoadRelations(pgConn *conn)
+{
+	pgSet *set = conn->ExecuteSet(
+	                 wxT("SELECT oid, relnamespace, relname, relkind, xmin, relfilenode\n")
+	                 wxT("  FROM pg_class\n")
+	                 wxT(" WHERE relkind IN (") CATALOG_RELKINDS wxT(")"), false);
+	if (!set)
+		return;
+
+	// Only the relations, which are new or changed, lose their columns
+	pgCatalogRelationMap current;
+	while (!set->Eof())
+	{
+		OID oid = set->GetOid(0);
+		pgCatalogRelation *rel;
+
+		pgCatalogRelationMap::iterator it = relations.find(oid);
+		if (it != relations.end() && it->second->xmin == set->GetVal(4) &&
+		        it->second->relfilenode == set->GetOid(5))
+		{
+			rel = it->second;
+			relations.erase(it);
+		}
+		else
+		{
+			if (it != relations.end())
+			{
+				delete it->second;
+				relations.erase(it);
+			}
+
+			rel = new pgCatalogRelation();
+			rel->oid = oid;
+			rel->nspOid = set->GetOid(1);
+			rel->name = set->GetVal(2);
+			rel->kind = set->GetVal(3)[0];
+			rel->xmin = set->GetVal(4);
+			rel->relfilenode = set->GetOid(5);
+			rel->attributesLoaded = false;
+		}
+		current[oid] = rel;
+
+		set->MoveNext();
+	}
+	delete set;
+
+	// Whatever is left, has been dropped
+	pgCatalogRelationMap::iterator it;
+	for (it = relations.begin(); it != relations.end(); ++it)
+		delete it->second;
+
+	relations = current;
+
+	relationsByName.clear();
+	for (it = relations.begin(); it != relations.end(); ++it)
+		relationsByName[NameKey(it->second->nspOid, it->second->name)] = it->second;
+}
+
+
+void pgCatalogCache::LoadAttributes(pgConn *conn, const wxString &restriction)
+{
+	pgSet *set = conn->ExecuteSet(
+	                 wxT("SELECT attrelid, attname, attnum, atttypid, attnotnull\n")
+	                 wxT("  FROM pg_attribute att\n")
+	                 wxT("  JOIN pg_class cl ON cl.oid=att.attrelid\n")
+	                 wxT(" WHERE ") + restriction + wxT("\n")
+	                 wxT("   AND cl.relkind IN (") CATALOG_RELKINDS wxT(")\n")
+	                 wxT("   AND attisdropped IS FALSE\n")
+	                 wxT(" ORDER BY attrelid, attnum"), false);
+	if (!set)
+		return;
+
+	pgCatalogRelation *rel = NULL;
+	while (!set->Eof())
+	{
+		OID relOid = set->GetOid(0);
+		if (!rel || rel->oid != relOid)
+		{
+			rel = GetRelation(relOid);
+
+			// Relations loaded already keep their columns
+			if (rel && rel->attributesLoaded)
+				rel = NULL;
+			else if (rel)
+				rel->attributes.Empty();
+		}
+
+		if (rel)
+		{
+			pgCatalogAttribute att;
+			att.name = set->GetVal(1);
+			att.num = set->GetLong(2);
+			att.typeOid = set->GetOid(3);
+			att.notNull = set->GetBool(4);
+			rel->attributes.Add(att);
+		}
+
+		set->MoveNext();
+	}
+	delete set;
+}
+
+
+void pgCatalogCache::CheckAttributes(pgConn *conn)
+{
+	pgSet *set = conn->ExecuteSet(
+	                 wxT("SELECT attrelid, count(*)::text || ':' || sum(att.xmin::text::bigint)::text\n")
+	                 wxT("  FROM pg_attribute att\n")
+	                 wxT("  JOIN pg_class cl ON cl.oid=att.attrelid\n")
+	                 wxT(" WHERE cl.relkind IN (") CATALOG_RELKINDS wxT(")\n")
+	                 wxT(" GROUP BY attrelid"), false);
+	if (!set)
+		return;
+
+	// The columns are loaded again with their next use
+	while (!set->Eof())
+	{
+		pgCatalogRelation *rel = GetRelation(set->GetOid(0));
+		if (rel && rel->attStamp != set->GetVal(1))
+		{
+			rel->attStamp = set->GetVal(1);
+			rel->attributesLoaded = false;
+			rel->attributes.Empty();
+		}
+
+		set->MoveNext();
+	}
+	delete set;
+}
+
+
+void pgCatalogCache::LoadMissingAttributes(pgConn *conn)
+{
+	wxString oids;
+	size_t missing = 0;
+
+	pgCatalogRelationMap::iterator it;
+	for (it = relations.begin(); it != relations.end(); ++it)
+	{
+		if (!it->second->attributesLoaded)
+		{
+			if (missing++)
+				oids += wxT(",");
+			oids += NumToStr(it->second->oid);
+		}
+	}
+	if (!missing)
+		return;
+
+	// Name a few changed relations, rather than reading all columns again
+	if (missing <= CATALOG_MAX_OID_LIST)
+		LoadAttributes(conn, wxT("att.attrelid IN (") + oids + wxT(")"));
+	else
+		LoadAttributes(conn, wxT("true"));
+
+	for (it = relations.begin(); it != relations.end(); ++it)
+		it->second->attributesLoaded = true;
+}
+
+
+void pgCatalogCache::LoadTypes(pgConn *conn)
+{
+	pgSet *set = conn->ExecuteSet(wxT("SELECT oid, typnamespace, typname FROM pg_type ORDER BY typname"), false);
+	if (!set)
+		return;
+
+	types.Empty();
+	while (!set->Eof())
+	{
+		pgCatalogType typ;
+		typ.oid = set->GetOid(0);
+		typ.nspOid = set->GetOid(1);
+		typ.name = set->GetVal(2);
+		types.Add(typ);
+
+		set->MoveNext();
+	}
+	delete set;
+}
+
+
+void pgCatalogCache::LoadFunctions(pgConn *conn)
+{
+	wxString sql;
+
+	if (conn->BackendMinimumVersion(8, 4))
+		sql = wxT("SELECT oid, pronamespace, proname, pg_get_function_identity_arguments(oid)\n");
+	else
+		sql = wxT("SELECT oid, pronamespace, proname, oidvectortypes(proargtypes)\n");
+	sql += wxT("  FROM pg_proc ORDER BY proname");
+
+	pgSet *set = conn->ExecuteSet(sql, false);
+	if (!set)
+		return;
+
+	functions.Empty();
+	while (!set->Eof())
+	{
+		pgCatalogFunction func;
+		func.oid = set->GetOid(0);
+		func.nspOid = set->GetOid(1);
+		func.name = set->GetVal(2);
+		func.arguments = set->GetVal(3);
+		functions.Add(func);
+
+		set->MoveNext();
+	}
+	delete set;
+}
+
+
+OID pgCatalogCache::FindNamespace(const wxString &name)
+{
+	for (size_t i = 0; i < namespaces.GetCount(); i++)
+	{
+		if (namespaces[i].name == name)
+			return namespaces[i].oid;
+	}
+	return 0;
+}
+
+
+wxString pgCatalogCache::NameKey(OID nspOid, const wxString &name)
+{
+	return NumToStr(nspOid) + wxT(".") + name;
+}
+
+
+pgCatalogRelation *pgCatalogCache::FindRelation(OID nspOid, const wxString &name)
+{
+	pgCatalogRelationNameMap::iterator it = relationsByName.find(NameKey(nspOid, name));
+	if (it == relationsByName.end())
+		return NULL;
+	return it->second;
+}
+
+
+pgCatalogRelation *pgCatalogCache::GetRelation(OID oid)
+{
+	pgCatalogRelationMap::iterator it = relations.find(oid);
+	if (it == relations.end())
+		return NULL;
+	return it->second;
+}
+
+
+void pgCatalogCache::GetRelations(OID nspOid, const wxString &kinds, pgCatalogRelationArray &result)
+{
+	pgCatalogRelationMap::iterator it;
+	for (it = relations.begin(); it != relations.end(); ++it)
+	{
+		if (it->second->nspOid == nspOid && kinds.Find(it->second->kind) != wxNOT_FOUND)
+			result.Add(it->second);
+	}
+}
+
+
+const pgCatalogAttributeArray *pgCatalogCache::GetAttributes(pgConn *conn, OID relOid)
+{
+	pgCatalogRelation *rel = GetRelation(relOid);
+	if (!rel)
+		return NULL;
+
+	if (!rel->attributesLoaded)
+	{
+		LoadAttributes(conn, wxT("cl.relnamespace = ") + NumToStr(rel->nspOid));
+
+		pgCatalogRelationMap::iterator it;
+		for (it = relations.begin(); it != relations.end(); ++it)
+		{
+			if (it->second->nspOid == rel->nspOid)
+				it->second->attributesLoaded = true;
+		}
+	}
+
+	return &rel->attributes;
+}
@@ -0,0 +1,416 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgCompletionIndex.cpp - Local index of identifiers for tab completion
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// App headers
+#include "db/pgConn.h"
+#include "db/pgSet.h"
+#include "db/pgCatalogCache.h"
+#include "db/pgCompletionIndex.h"
+
+// An index older than this (in seconds) gets refreshed with its next use
+#define COMPLETION_REFRESH_INTERVAL  60
+
+const wxString pgCompletionIndex::relKinds = wxT("rvmfpxS");
+
+
+class pgCompletionIndexThread;
+
+// The index of a database, and what it is built from. The catalog
+// snapshot and the connection are only used by the refresh thread.
+class pgCompletionSource
+{
+public:
+	pgCompletionSource()
+	{
+		index = NULL;
+		conn = NULL;
+		thread = NULL;
+		refreshing = false;
+		reload = false;
+	}
+
+	pgCompletionIndex *index;
+	// The last refresh thread, waited for before the next one
+	pgCompletionIndexThread *thread;
+	wxDateTime built;
+	bool refreshing;
+	// The next refresh loads the catalogs again in full
+	bool reload;
+
+	pgConn *conn;
+	pgCatalogCache catalog;
+	wxString stamp;
+};
+
+WX_DECLARE_STRING_HASH_MAP(pgCompletionSource *, pgCompletionSourceMap);
+WX_DEFINE_ARRAY_PTR(pgCompletionSource *, pgCompletionSourceArray);
+WX_DECLARE_HASH_MAP(OID, int, wxIntegerHash, wxIntegerEqual, completionPositionMap);
+WX_DECLARE_HASH_MAP(OID, wxString, wxIntegerHash, wxIntegerEqual, completionNameMap);
+WX_DECLARE_STRING_HASH_MAP(int, completionFirstMap);
+static pgCompletionSourceMap completionSources;
+
+// Guards the sources against their refresh threads
+static wxCriticalSection completionLock;
+
+
+class pgCompletionIndexThread : public wxThread
+{
+public:
+	pgCompletionIndexThread(pgCompletionSource *src, bool reloadAll)
+		: wxThread(wxTHREAD_JOINABLE), source(src), reload(reloadAll)
+	{
+	}
+
+	void *Entry();
+
+private:
+	pgCompletionSource *source;
+	bool reload;
+};
+
+
+void *pgCompletionIndexThread::Entry()
+{
+	pgConn *conn = source->conn;
+	pgCompletionIndex *index = NULL;
+	wxString stamp;
+
+	source->catalog.Expire();
+	if (conn->GetStatus() == PGCONN_OK && source->catalog.Refresh(conn, reload))
+	{
+		source->catalog.LoadMissingAttributes(conn);
+
+		pgSet *set = conn->ExecuteSet(
+		                 wxT("SELECT n.nspname\n")
+		                 wxT("  FROM generate_series(1, array_upper(current_schemas(true), 1)) s(i)\n")
+		                 wxT("  JOIN pg_namespace n ON n.nspname = (current_schemas(true))[s.i]\n")
+		                 wxT(" ORDER BY s.i"), false);
+		if (set)
+		{
+			wxArrayString searchPath;
+			stamp = source->catalog.GetStamp();
+			while (!set->Eof())
+			{
+				searchPath.Add(set->GetVal(0));
+				stamp += wxT("/") + set->GetVal(0);
+				set->MoveNext();
+			}
+			delete set;
+
+			if (reload || stamp != source->stamp)
+				index = new pgCompletionIndex(&source->catalog, searchPath);
+		}
+	}
+
+	pgCompletionIndex *old = NULL;
+	{
+		wxCriticalSectionLocker lock(completionLock);
+
+		if (index)
+		{
+			old = source->index;
+			source->index = index;
+			source->stamp = stamp;
+		}
+		source->built = wxDateTime::Now();
+		source->refreshing = false;
+	}
+
+	// Completions only use the index with the lock held
+	if (old)
+		delete old;
+
+	return NULL;
+}
+
+
+pgCompletionIndex::pgCompletionIndex(pgCatalogCache *catalog, const wxArrayString &searchPath)
+{
+	const pgCatalogNamespaceArray &nsps = catalog->GetNamespaces();
+	const pgCatalogRelationMap &rels = catalog->GetRelations();
+	const pgCatalogFunctionArray &funcs = catalog->GetFunctions();
+
+	// Position of each schema in the search path, -1 if not in it
+	completionPositionMap positions;
+	completionNameMap nspNames;
+	OID catalogOid = 0;
+
+	size_t i;
+	for (i = 0; i < nsps.GetCount(); i++)
+	{
+		nspNames[nsps[i].oid] = qtIdent(nsps[i].name);
+		positions[nsps[i].oid] = searchPath.Index(nsps[i].name);
+		schemas.Add(qtIdent(nsps[i].name));
+
+		if (nsps[i].name == wxT("pg_catalog"))
+			catalogOid = nsps[i].oid;
+	}
+
+	// A name is visible in the first schema of the search path having it
+	completionFirstMap first;
+
+	pgCatalogRelationMap::const_iterator it;
+	for (it = rels.begin(); it != rels.end(); ++it)
+	{
+		int pos = positions[it->second->nspOid];
+		if (pos < 0)
+			continue;
+
+		completionFirstMap::iterator f = first.find(it->second->name);
+		if (f == first.end() || f->second > pos)
+			first[it->second->name] = pos;
+	}
+
+	for (it = rels.begin(); it != rels.end(); ++it)
+	{
+		pgCatalogRelation *rel = it->second;
+		int kind = relKinds.Find(rel->kind);
+		if (kind == wxNOT_FOUND)
+			continue;
+
+		wxString name = qtIdent(rel->name);
+		qualifiedRelations[kind].Add(nspNames[rel->nspOid] + wxT(".") + name);
+
+		int pos = positions[rel->nspOid];
+		if (pos < 0 || first[rel->name] != pos)
+			continue;
+
+		if (rel->nspOid == catalogOid)
+			catalogRelations[kind].Add(name);
+		else
+			visibleRelations[kind].Add(name);
+
+		wxArrayString &cols = columns[name];
+		for (size_t a = 0; a < rel->attributes.GetCount(); a++)
+		{
+			if (rel->attributes[a].num > 0)
+				cols.Add(qtIdent(rel->attributes[a].name));
+		}
+		cols.Sort();
+	}
+
+	for (i = 0; i < funcs.GetCount(); i++)
+	{
+		wxString name = qtIdent(funcs[i].name);
+		qualifiedFunctions.Add(nspNames[funcs[i].nspOid] + wxT(".") + name);
+		if (positions[funcs[i].nspOid] >= 0)
+			visibleFunctions.Add(name);
+	}
+
+	schemas.Sort();
+	for (i = 0; i < relKinds.Length(); i++)
+	{
+		visibleRelations[i].Sort();
+		catalogRelations[i].Sort();
+		qualifiedRelations[i].Sort();
+	}
+	visibleFunctions.Sort();
+	qualifiedFunctions.Sort();
+}
+
+
+bool pgCompletionIndex::Complete(pgConn *conn, int kind, const wxString &relkinds, const wxString &text,
+                                 const wxString &addon, wxArrayString &result)
+{
+	if (!conn)
+		return false;
+
+	wxString key = pgCatalogCache::GetKey(conn);
+	pgCompletionSource *source;
+
+	wxCriticalSectionLocker lock(completionLock);
+
+	pgCompletionSourceMap::iterator it = completionSources.find(key);
+	if (it == completionSources.end())
+	{
+		source = new pgCompletionSource();
+		completionSources[key] = source;
+	}
+	else
+		source = it->second;
+
+	// Start a refresh, if it's due, and answer from what we have
+	if (!source->refreshing && (!source->built.IsValid() ||
+	                            (wxDateTime::Now() - source->built).GetSeconds() >= COMPLETION_REFRESH_INTERVAL))
+	{
+		// Done with the index, at most it is deleting the one replaced
+		if (source->thread)
+		{
+			source->thread->Wait();
+			delete source->thread;
+			source->thread = NULL;
+		}
+
+		if (source->conn && source->conn->GetStatus() != PGCONN_OK)
+		{
+			delete source->conn;
+			source->conn = NULL;
+		}
+		if (!source->conn)
+			source->conn = conn->Duplicate();
+
+		if (source->conn)
+		{
+			pgCompletionIndexThread *thread = new pgCompletionIndexThread(source, source->reload);
+			if (thread->Create() == wxTHREAD_NO_ERROR && thread->Run() == wxTHREAD_NO_ERROR)
+			{
+				source->thread = thread;
+				source->refreshing = true;
+				source->reload = false;
+			}
+			else
+				delete thread;
+		}
+	}
+
+	pgCompletionIndex *index = source->index;
+	if (!index)
+		return false;
+
+	size_t i;
+	switch (kind)
+	{
+		case COMPLETE_INDEX_SCHEMAS:
+			AddMatches(index->schemas, text, result);
+			break;
+
+		case COMPLETE_INDEX_RELATIONS:
+			for (i = 0; i < relkinds.Length(); i++)
+			{
+				int k = relKinds.Find(relkinds[i]);
+				if (k == wxNOT_FOUND)
+					return false;
+
+				AddMatches(index->visibleRelations[k], text, result);
+				if (text.StartsWith(wxT("pg_")))
+					AddMatches(index->catalogRelations[k], text, result);
+				index->CompleteSchemaPart(index->qualifiedRelations[k], text, result);
+			}
+			break;
+
+		case COMPLETE_INDEX_FUNCTIONS:
+			AddMatches(index->visibleFunctions, text, result);
+			index->CompleteSchemaPart(index->qualifiedFunctions, text, result);
+			break;
+
+		case COMPLETE_INDEX_ATTRIBUTES:
+		{
+			pgCompletionColumnMap::iterator cols = index->columns.find(addon);
+			if (cols != index->columns.end())
+				AddMatches(cols->second, text, result);
+			break;
+		}
+
+		default:
+			return false;
+	}
+
+	// Same as the UNION of the completion queries
+	result.Sort();
+	for (i = result.GetCount(); i > 1; i--)
+	{
+		if (result[i - 1] == result[i - 2])
+			result.RemoveAt(i - 1);
+	}
+	return true;
+}
+
+
+void pgCompletionIndex::Invalidate(pgConn *conn)
+{
+	if (!conn)
+		return;
+
+	wxString key = pgCatalogCache::GetKey(conn);
+
+	wxCriticalSectionLocker lock(completionLock);
+
+	pgCompletionSourceMap::iterator it = completionSources.find(key);
+	if (it != completionSources.end())
+	{
+		it->second->built = wxDateTime();
+		it->second->reload = true;
+	}
+}
+
+
+void pgCompletionIndex::CompleteSchemaPart(const wxArrayString &qualified, const wxString &text, wxArrayString &result)
+{
+	// The schemas the text may still be leading to
+	wxArrayString matching;
+	for (size_t i = 0; i < schemas.GetCount(); i++)
+	{
+		wxString prefix = schemas[i] + wxT(".");
+		if (prefix.StartsWith(text) || text.StartsWith(prefix))
+			matching.Add(prefix);
+	}
+
+	// Offer the schemas while there are several, their objects once
+	// there is just one
+	if (matching.GetCount() > 1)
+		AddMatches(matching, text, result);
+	else if (matching.GetCount() == 1)
+		AddMatches(qualified, text, result);
+}
+
+
+void pgCompletionIndex::AddMatches(const wxArrayString &names, const wxString &prefix, wxArrayString &result)
+{
+	// The names are sorted, so the matches are in one run
+	size_t lo = 0, hi = names.GetCount();
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (names[mid].Cmp(prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	while (lo < names.GetCount() && names[lo].StartsWith(prefix))
+		result.Add(names[lo++]);
+}
+
+
+void pgCompletionIndex::ClearAll()
+{
+	// The refresh threads take the lock when they are done, so they are
+	// waited for without it
+	pgCompletionSourceArray sources;
+	{
+		wxCriticalSectionLocker lock(completionLock);
+
+		pgCompletionSourceMap::iterator it;
+		for (it = completionSources.begin(); it != completionSources.end(); ++it)
+			sources.Add(it->second);
+		completionSources.clear();
+	}
+
+	for (size_t i = 0; i < sources.GetCount(); i++)
+	{
+		pgCompletionSource *source = sources.Item(i);
+		if (source->thread)
+		{
+			source->thread->Wait();
+			delete source->thread;
+		}
+		if (source->index)
+			delete source->index;
+		if (source->conn)
+			delete source->conn;
+		delete source;
+	}
+}
@@ -334,6 +334,8 @@ void pgConn::Close()
 	}
 	conn = 0;
 	connStatus = PGCONN_BAD;
+
+	ClearTypeCache();
 }
 
 
@@ -762,6 +764,8 @@ bool pgConn::ExecuteVoid(const wxString &sql, bool reportError)
 		return false;
 	}
 
+	CheckTypeCache(qryRes);
+
 	// Cleanup & exit
 	PQclear(qryRes);
 	return  true;
@@ -851,6 +855,163 @@ pgSet *pgConn::ExecuteSet(const wxString &sql, bool reportError)
 	return new pgSet();
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Data type cache
+//////////////////////////////////////////////////////////////////////////
+
+wxString pgConn::TypeModKey(OID typeOid, long typeMod)
+{
+	return NumToStr(typeOid) + wxT(":") + NumToStr(typeMod);
+}
+
+
+void pgConn::CacheTypes(const wxArrayLong &typeOids, const wxArrayLong &typeMods)
+{
+	wxASSERT(typeOids.GetCount() == typeMods.GetCount());
+
+	wxArrayString queued;
+	wxString sql;
+	size_t i;
+
+	{
+		wxCriticalSectionLocker lock(typeCacheLock);
+
+		for (i = 0 ; i < typeOids.GetCount() ; i++)
+		{
+			OID typeOid = (OID)typeOids[i];
+			wxString key = TypeModKey(typeOid, typeMods[i]);
+
+			if ((typeCache.find(typeOid) != typeCache.end() &&
+			        typeModCache.find(key) != typeModCache.end()) ||
+			        queued.Index(key) != wxNOT_FOUND)
+				continue;
+			queued.Add(key);
+
+			if (!sql.IsEmpty())
+				sql += wxT("\nUNION ALL ");
+			sql += wxT("SELECT oid, format_type(oid, NULL) AS typname, ")
+			       wxT("CASE WHEN typbasetype=0 THEN oid ELSE typbasetype END AS basetype, ")
+			       wxT("format_type(oid, ") + NumToStr(typeMods[i]) + wxT(") AS fulltypname, ") +
+			       NumToStr(typeMods[i]) + wxT(" AS typmod\n")
+			       wxT("  FROM pg_type WHERE oid=") + NumToStr(typeOid);
+		}
+	}
+
+	if (sql.IsEmpty())
+		return;
+
+	pgSet *set = ExecuteSet(sql);
+	if (!set)
+		return;
+
+	wxCriticalSectionLocker lock(typeCacheLock);
+
+	while (!set->Eof())
+	{
+		OID typeOid = set->GetOid(wxT("oid"));
+
+		pgTypeCacheEntry &entry = typeCache[typeOid];
+		entry.name = set->GetVal(wxT("typname"));
+		entry.baseType = set->GetOid(wxT("basetype"));
+
+		typeModCache[TypeModKey(typeOid, set->GetLong(wxT("typmod")))] = set->GetVal(wxT("fulltypname"));
+
+		set->MoveNext();
+	}
+	delete set;
+}
+
+
+wxString pgConn::GetTypeName(OID typeOid)
+{
+	for (int pass = 0 ; pass < 2 ; pass++)
+	{
+		{
+			wxCriticalSectionLocker lock(typeCacheLock);
+
+			pgTypeCache::iterator it = typeCache.find(typeOid);
+			if (it != typeCache.end())
+				return it->second.name;
+		}
+
+		if (!pass)
+		{
+			wxArrayLong typeOids, typeMods;
+			typeOids.Add((long)typeOid);
+			typeMods.Add(-1);
+			CacheTypes(typeOids, typeMods);
+		}
+	}
+
+	return wxEmptyString;
+}
+
+
+wxString pgConn::GetFullTypeName(OID typeOid, long typeMod)
+{
+	wxString key = TypeModKey(typeOid, typeMod);
+
+	for (int pass = 0 ; pass < 2 ; pass++)
+	{
+		{
+			wxCriticalSectionLocker lock(typeCacheLock);
+
+			wxStringToStringHashMap::iterator it = typeModCache.find(key);
+			if (it != typeModCache.end())
+				return it->second;
+		}
+
+		if (!pass)
+		{
+			wxArrayLong typeOids, typeMods;
+			typeOids.Add((long)typeOid);
+			typeMods.Add(typeMod);
+			CacheTypes(typeOids, typeMods);
+		}
+	}
+
+	return wxEmptyString;
+}
+
+
+OID pgConn::GetBaseType(OID typeOid)
+{
+	// Resolved together with the name
+	GetTypeName(typeOid);
+
+	wxCriticalSectionLocker lock(typeCacheLock);
+
+	pgTypeCache::iterator it = typeCache.find(typeOid);
+	if (it != typeCache.end())
+		return it->second.baseType;
+	return 0;
+}
+
+
+// Forget the cached types after a command, which may have created, altered
+// or dropped types or changed their visibility (search_path)
+void pgConn::CheckTypeCache(PGresult *res)
+{
+	if (!res || PQresultStatus(res) != PGRES_COMMAND_OK)
+		return;
+
+	wxString cmd = wxString(PQcmdStatus(res), wxConvUTF8).BeforeFirst(' ');
+
+	if (cmd == wxT("CREATE") || cmd == wxT("ALTER") || cmd == wxT("DROP") ||
+	        cmd == wxT("SET") || cmd == wxT("RESET") || cmd == wxT("DISCARD") ||
+	        cmd == wxT("ROLLBACK"))
+		ClearTypeCache();
+}
+
+
+void pgConn::ClearTypeCache()
+{
+	wxCriticalSectionLocker lock(typeCacheLock);
+
+	typeCache.clear();
+	typeModCache.clear();
+}
+
 //////////////////////////////////////////////////////////////////////////
 // COPY functions
 //////////////////////////////////////////////////////////////////////////
@@ -880,6 +1041,51 @@ bool pgConn::StartCopy(const wxString query)
 	return  true;
 }
 
+bool pgConn::StartCopyOut(const wxString query)
+{
+	if (GetStatus() != PGCONN_OK)
+		return false;
+
+	PGresult *qryRes;
+
+	wxLogSql(wxT("COPY query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), query.c_str());
+
+	// The copy may run for a long time, so allow it to be cancelled
+	SetConnCancel();
+	qryRes = PQexec(conn, query.mb_str(*conv));
+	lastResultStatus = PQresultStatus(qryRes);
+	SetLastResultError(qryRes);
+	PQclear(qryRes);
+
+	if (lastResultStatus != PGRES_COPY_OUT)
+	{
+		ResetConnCancel();
+		LogError(false);
+		return false;
+	}
+
+	return true;
+}
+
+int pgConn::GetCopyData(char **buffer)
+{
+	*buffer = NULL;
+
+	// Blocks until a whole row is available
+	int result = PQgetCopyData(conn, buffer, 0);
+
+	if (result < 0)
+		ResetConnCancel();
+
+	return result;
+}
+
+void pgConn::FreeCopyData(char *buffer)
+{
+	if (buffer)
+		PQfreemem(buffer);
+}
+
 bool pgConn::PutCopyData(const char *data, long count)
 {
 	// Execute the query and get the status
@@ -908,6 +1114,7 @@ bool pgConn::GetCopyFinalStatus(void)
 	// Get status
 	qryRes = PQgetResult(conn);
 	lastResultStatus = PQresultStatus(qryRes);
+	SetLastResultError(qryRes);
 
 	// Check for errors
 	if (lastResultStatus != PGRES_COMMAND_OK)
@@ -17,6 +17,10 @@
 // PostgreSQL headers
 #include <libpq-fe.h>
 
+#ifndef __WXMSW__
+#include <sys/select.h>
+#endif
+
 // App headers
 #include "db/pgSet.h"
 #include "db/pgConn.h"
@@ -26,6 +30,12 @@
 #include "utils/sysLogger.h"
 
 const wxEventType PGQueryResultEvent = wxNewEventType();
+const wxEventType PGQueryProgressEvent = wxNewEventType();
+
+// Streamed rows are added to the result-set in chunks of this many rows,
+// or at least this often (in milliseconds)
+#define STREAM_CHUNK_ROWS   1000
+#define STREAM_INTERVAL     100
 
 // default notice processor for the pgQueryThread
 // we do assume that the argument passed will be always the
@@ -46,9 +56,11 @@ void pgNoticeProcessor(void *_arg, const char *_message)
 pgQueryThread::pgQueryThread(pgConn *_conn, wxEvtHandler *_caller,
                              PQnoticeProcessor _processor, void *_noticeHandler) :
 	wxThread(wxTHREAD_JOINABLE), m_currIndex(-1), m_conn(_conn),
+	m_completed(0), m_queueCond(m_queueLock),
 	m_cancelled(false), m_multiQueries(true), m_useCallable(false),
 	m_caller(_caller), m_processor(pgNoticeProcessor), m_noticeHandler(NULL),
-	m_eventOnCancellation(true)
+	m_eventOnCancellation(true), m_streaming(false), m_streamWindow(0),
+	m_streamSet(NULL), m_streamChunk(NULL), m_streamResult(NULL), m_streamSkipped(0)
 {
 	// check if we can really use the enterprisedb callable statement and
 	// required
@@ -96,9 +108,11 @@ pgQueryThread::pgQueryThread(pgConn *_conn, wxEvtHandler *_caller,
 pgQueryThread::pgQueryThread(pgConn *_conn, const wxString &_qry,
                              int _resultToRetrieve, wxWindow *_caller, long _eventId, void *_data)
 	: wxThread(wxTHREAD_JOINABLE), m_currIndex(-1), m_conn(_conn),
+	  m_completed(0), m_queueCond(m_queueLock),
 	  m_cancelled(false), m_multiQueries(false), m_useCallable(false),
 	  m_caller(NULL), m_processor(pgNoticeProcessor), m_noticeHandler(NULL),
-	  m_eventOnCancellation(true)
+	  m_eventOnCancellation(true), m_streaming(false), m_streamWindow(0),
+	  m_streamSet(NULL), m_streamChunk(NULL), m_streamResult(NULL), m_streamSkipped(0)
 {
 	if (m_conn && m_conn->conn)
 	{
@@ -122,22 +136,98 @@ void pgQueryThread::SetEventOnCancellation(bool eventOnCancelled)
 	m_eventOnCancellation = eventOnCancelled;
 }
 
-void pgQueryThread::AddQuery(const wxString &_qry, pgParamsArray *_params,
-                             long _eventId, void *_data, bool _useCallable, int _resultToRetrieve)
+void pgQueryThread::EnableStreaming(long maxRows)
 {
+#ifdef HAVE_SINGLE_ROW_MODE
+	// The result-set of a multiple queries thread can be released by the
+	// caller at any time (DeleteReleasedQueries), hence - only supported for
+	// the single query
+	if (!m_multiQueries)
+	{
+		m_streaming = true;
+		m_streamWindow = maxRows;
+	}
+#endif
+}
+
+int pgQueryThread::AddQuery(const wxString &_qry, pgParamsArray *_params,
+                            long _eventId, void *_data, bool _useCallable, int _resultToRetrieve)
+{
+	wxMutexLocker lock(m_queueLock);
+
 	m_queries.Add(
 	    new pgBatchQuery(_qry, _params, _eventId, _data,
 	                     // use callable statement only if supported
 	                     m_useCallable && _useCallable, _resultToRetrieve));
 
 	wxLogInfo(wxT("queueing (%ld): %s"), GetId(), _qry.c_str());
+
+	// Wake up the thread waiting for it
+	m_queueCond.Broadcast();
+
+	return m_queries.GetCount() - 1;
+}
+
+
+int pgQueryThread::AddPreparedQuery(const wxString &_name, const wxString &_qry,
+                                    pgParamsArray *_params)
+{
+	wxMutexLocker lock(m_queueLock);
+
+	pgBatchQuery *query = new pgBatchQuery(_qry, _params);
+	query->m_stmtName = _name;
+	m_queries.Add(query);
+
+	wxLogInfo(wxT("queueing (%ld) as %s: %s"), GetId(), _name.c_str(), _qry.c_str());
+
+	m_queueCond.Broadcast();
+
+	return m_queries.GetCount() - 1;
+}
+
+
+bool pgQueryThread::WaitForQuery(int _idx, long timeout)
+{
+	wxMutexLocker lock(m_queueLock);
+
+	if (m_completed <= _idx)
+		m_queueCond.WaitTimeout(timeout);
+
+	return m_completed > _idx;
+}
+
+
+void pgQueryThread::ClearQueries()
+{
+	// Not while a query is being executed, or waiting to be
+	wxMutexLocker lock(m_queriesLock);
+	wxMutexLocker queueLock(m_queueLock);
+
+	if (m_completed < (int)m_queries.GetCount())
+		return;
+
+	WX_CLEAR_ARRAY(m_queries);
+	m_currIndex = -1;
+	m_completed = 0;
 }
 
 
 pgQueryThread::~pgQueryThread()
 {
 	m_conn->RegisterNoticeProcessor(0, 0);
+
+	// Streamed result-sets, which have not been handed over as the result
+	// (i.e. the execution has been cancelled), belong to the thread
+	if (m_currIndex >= 0)
+	{
+		RetireStreamedSet(m_streamSet);
+		RetireStreamedSet(m_streamResult);
+	}
+	if (m_streamChunk)
+		PQclear(m_streamChunk);
+
 	WX_CLEAR_ARRAY(m_queries);
+	WX_CLEAR_ARRAY(m_retiredSets);
 }
 
 
@@ -213,8 +303,66 @@ int pgQueryThread::Execute()
 		return(RaiseEvent(rc));
 	}
 
+	// Execute as a prepared statement, preparing it first when needed
+	if (!m_queries[m_currIndex]->m_stmtName.IsEmpty() && !useCallable)
+	{
+		int    pCount = params ? params->GetCount() : 0;
+		int    idx    = 0;
+		bool   sent   = true;
+
+		Oid         *pOids    = (Oid *)malloc((pCount + 1) * sizeof(Oid));
+		const char **pParams  = (const char **)malloc((pCount + 1) * sizeof(const char *));
+		int         *pLens    = (int *)malloc((pCount + 1) * sizeof(int));
+		int         *pFormats = (int *)malloc((pCount + 1) * sizeof(int));
+
+		for (; idx < pCount; idx++)
+		{
+			pgParam *param = (*params)[idx];
+
+			pOids[idx] = param->m_type;
+			pParams[idx] = (const char *)param->m_val;
+			pLens[idx] = param->m_len;
+			pFormats[idx] = param->GetFormat();
+		}
+
+		wxString &stmtName = m_queries[m_currIndex]->m_stmtName;
+		wxCharBuffer stmtBuf = stmtName.mb_str(wxConvUTF8);
+
+		if (m_prepared.Index(stmtName) == wxNOT_FOUND)
+		{
+			PGresult *res = PQprepare(m_conn->conn, stmtBuf, queryBuf, pCount, pOids);
+
+			if (PQresultStatus(res) == PGRES_COMMAND_OK)
+				m_prepared.Add(stmtName);
+			else
+			{
+				rc = PQresultStatus(res);
+				err.SetError(res, &conv);
+				AppendMessage(wxString(PQresultErrorMessage(res), conv));
+				sent = false;
+			}
+			PQclear(res);
+		}
+
+		if (sent && PQsendQueryPrepared(m_conn->conn, stmtBuf, pCount, pParams, pLens, pFormats, 0) != 1)
+		{
+			rc = pgQueryResultEvent::PGQ_ERROR_SEND_QUERY;
+
+			err.msg_primary = _("Failed to run PQsendQueryPrepared in pgQueryThread.\n") +
+			                  wxString(PQerrorMessage(m_conn->conn), conv);
+			sent = false;
+		}
+
+		free(pOids);
+		free(pParams);
+		free(pLens);
+		free(pFormats);
+
+		if (!sent)
+			return(RaiseEvent(rc));
+	}
 	// Honour the parameters (if any)
-	if (params && params->GetCount() > 0)
+	else if (params && params->GetCount() > 0)
 	{
 		int    pCount = params->GetCount();
 		int    ret    = 0,
@@ -333,12 +481,23 @@ return_with_error:
 
 			return(RaiseEvent(rc));
 		}
+
+#ifdef HAVE_SINGLE_ROW_MODE
+		// Rows will now be delivered one by one, and collected into the
+		// result-set, which is available while the query is still running
+		if (m_streaming && !PQsetSingleRowMode(m_conn->conn))
+			wxLogInfo(wxT("Could not activate the single-row mode, the result will not be streamed"));
+#endif
 	}
 
 continue_without_error:
 	int resultsRetrieved = 0;
 	PGresult *lastResult = 0;
 	bool connExecutionCancelled = false;
+	// Do result and lastResult terminate a streamed result-set?
+	bool resultStreamed = false, lastResultStreamed = false;
+
+	m_streamLastFlush = m_streamLastEvent = wxGetLocalTimeMillis();
 
 	while (true)
 	{
@@ -416,8 +575,9 @@ continue_without_error:
 
 		if (PQisBusy(m_conn->conn))
 		{
-			Yield();
-			this->Sleep(10);
+			// Hand over the rows received so far, before waiting for more
+			FlushStreamedRows(false);
+			WaitForInput(10);
 
 			continue;
 		}
@@ -426,15 +586,56 @@ continue_without_error:
 		// otherwise the last result set will be returned.
 		// all others are discarded
 		PGresult *res = PQgetResult(m_conn->conn);
+		bool resStreamed = false;
 
 		if (!res)
 			break;
 
+#ifdef HAVE_SINGLE_ROW_MODE
+		if (PQresultStatus(res) == PGRES_SINGLE_TUPLE)
+		{
+			bool keep = (resultToRetrieve <= 0 || resultsRetrieved + 1 == resultToRetrieve);
+
+			// Take all the rows, libpq has already received, before reading
+			// from the socket again
+			do
+			{
+				StreamRow(res, keep);
+				res = NULL;
+
+				if (PQisBusy(m_conn->conn))
+					break;
+				res = PQgetResult(m_conn->conn);
+			}
+			while (res && PQresultStatus(res) == PGRES_SINGLE_TUPLE);
+
+			if (!res)
+				continue;
+		}
+
+		// An empty PGRES_TUPLES_OK result follows the last row of a statement
+		if (m_streamSet && PQresultStatus(res) == PGRES_TUPLES_OK)
+		{
+			FlushStreamedRows(true);
+
+			if (m_streamSkipped)
+				AppendMessage(wxString::Format(
+				                  _("query result exceeded the limit of %ld rows, %ld rows discarded.\n"),
+				                  m_streamWindow, m_streamSkipped));
+
+			RetireStreamedSet(m_streamResult);
+			m_streamResult = m_streamSet;
+			m_streamSet = NULL;
+			resStreamed = true;
+		}
+#endif
+
 		if((PQresultStatus(res) == PGRES_NONFATAL_ERROR) ||
 		        (PQresultStatus(res) == PGRES_FATAL_ERROR) ||
 		        (PQresultStatus(res) == PGRES_BAD_RESPONSE))
 		{
 			result = res;
+			resultStreamed = false;
 			err.SetError(res, &conv);
 
 			// Wait for the execution to be finished
@@ -483,6 +684,8 @@ continue_without_error:
 			break;
 		}
 
+		m_conn->CheckTypeCache(res);
+
 #if defined (__WXMSW__) || (EDB_LIBPQ)
 		// there should be 2 results in the callable statement - the first is the
 		// dummy, the second contains our out params.
@@ -597,6 +800,7 @@ continue_without_error:
 		if (!m_cancelled && resultsRetrieved == resultToRetrieve)
 		{
 			result = res;
+			resultStreamed = resStreamed;
 			insertedOid = PQoidValue(res);
 			if (insertedOid && insertedOid != (Oid) - 1)
 				AppendMessage(wxString::Format(_("query inserted one row with oid %d.\n"), insertedOid));
@@ -614,6 +818,7 @@ continue_without_error:
 			PQclear(lastResult);
 		}
 		lastResult = res;
+		lastResultStreamed = resStreamed;
 	}
 
 out_of_consume_input_loop:
@@ -635,7 +840,20 @@ out_of_consume_input_loop:
 	}
 
 	if (!result)
+	{
 		result = lastResult;
+		resultStreamed = lastResultStreamed;
+	}
+
+	// Rows streamed in for any other statement, are not part of the result
+	if (m_streamChunk)
+	{
+		PQclear(m_streamChunk);
+		m_streamChunk = NULL;
+	}
+	RetireStreamedSet(m_streamSet);
+	if (!resultStreamed)
+		RetireStreamedSet(m_streamResult);
 
 	err.SetError(result, &conv);
 
@@ -644,8 +862,23 @@ out_of_consume_input_loop:
 	rc = PQresultStatus(result);
 	if (rc == PGRES_TUPLES_OK)
 	{
-		dataSet = new pgSet(result, m_conn, conv, m_conn->needColQuoting);
-		dataSet->MoveFirst();
+		if (resultStreamed)
+		{
+			// The rows are already there, and the connection can be used
+			// for the catalog lookups again
+			dataSet = m_streamResult;
+			m_streamResult = NULL;
+			dataSet->SetStreaming(false);
+
+			PQclear(result);
+			result = NULL;
+		}
+		else
+		{
+			// The current row of a streamed set is the reader's already
+			dataSet = new pgSet(result, m_conn, conv, m_conn->needColQuoting);
+			dataSet->MoveFirst();
+		}
 	}
 	else if (rc == PGRES_COMMAND_OK)
 	{
@@ -671,13 +904,146 @@ out_of_consume_input_loop:
 		return(RaiseEvent(rc));
 	}
 
-	insertedOid = PQoidValue(result);
+	insertedOid = result ? PQoidValue(result) : 0;
 	if (insertedOid == (Oid) - 1)
 		insertedOid = 0;
 
 	return(RaiseEvent(1));
 }
 
+void pgQueryThread::StreamRow(PGresult *row, bool keep)
+{
+	// Rows of a result, which will not be returned, are discarded right away
+	if (!keep || m_cancelled)
+	{
+		PQclear(row);
+		return;
+	}
+
+	if (!m_streamSet)
+	{
+		// A new statement is returning rows now, so the rows of the earlier
+		// one will not be returned
+		RetireStreamedSet(m_streamResult);
+
+		m_streamSet = new pgSet(PQcopyResult(row, PG_COPYRES_ATTRS), m_conn,
+		                        *(m_conn->conv), m_conn->needColQuoting);
+		m_streamSet->SetStreaming(true);
+		m_streamSkipped = 0;
+	}
+
+	long received = m_streamSet->NumRows() + (m_streamChunk ? PQntuples(m_streamChunk) : 0);
+
+	if (m_streamWindow > 0 && received >= m_streamWindow)
+	{
+		m_streamSkipped++;
+		PQclear(row);
+		return;
+	}
+
+	if (!m_streamChunk)
+		m_streamChunk = PQcopyResult(row, PG_COPYRES_ATTRS);
+
+	int tuple = PQntuples(m_streamChunk),
+	    nCols = PQnfields(row);
+
+	for (int col = 0; col < nCols; col++)
+	{
+		if (PQgetisnull(row, 0, col))
+			PQsetvalue(m_streamChunk, tuple, col, NULL, -1);
+		else
+			PQsetvalue(m_streamChunk, tuple, col, PQgetvalue(row, 0, col),
+			           PQgetlength(row, 0, col));
+	}
+	PQclear(row);
+
+	FlushStreamedRows(false);
+}
+
+
+void pgQueryThread::FlushStreamedRows(bool force)
+{
+	if (!m_streamChunk)
+		return;
+
+	wxLongLong now = wxGetLocalTimeMillis();
+	bool firstRows = (m_streamSet->NumRows() == 0);
+
+	// The very first row is handed over immediately, the others in chunks
+	if (!force && !firstRows && PQntuples(m_streamChunk) < STREAM_CHUNK_ROWS &&
+	        now - m_streamLastFlush < STREAM_INTERVAL)
+		return;
+
+	m_streamSet->AppendRows(m_streamChunk);
+	m_streamChunk = NULL;
+	m_streamLastFlush = now;
+
+	if (firstRows)
+		m_queries[m_currIndex]->m_resultSet = m_streamSet;
+
+	if (firstRows || now - m_streamLastEvent >= STREAM_INTERVAL)
+	{
+		m_streamLastEvent = now;
+		RaiseProgressEvent();
+	}
+}
+
+
+void pgQueryThread::RetireStreamedSet(pgSet *&set)
+{
+	if (!set)
+		return;
+
+	if (m_queries[m_currIndex]->m_resultSet == set)
+		m_queries[m_currIndex]->m_resultSet = NULL;
+
+	m_retiredSets.Add(set);
+	set = NULL;
+}
+
+
+bool pgQueryThread::WaitForInput(long timeout)
+{
+	int sock = PQsocket(m_conn->conn);
+
+	if (sock < 0)
+	{
+		this->Sleep(timeout);
+		return false;
+	}
+
+	fd_set readfds;
+	struct timeval tv;
+
+	FD_ZERO(&readfds);
+	FD_SET(sock, &readfds);
+
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+
+	return (select(sock + 1, &readfds, NULL, NULL, &tv) > 0);
+}
+
+
+int pgQueryThread::RaiseProgressEvent()
+{
+#if !defined(PGSCLI)
+	if (m_caller)
+	{
+		pgQueryResultEvent progressEvent(GetId(), m_queries[m_currIndex],
+		                                 m_queries[m_currIndex]->m_eventID, PGQueryProgressEvent);
+
+		progressEvent.SetClientData(m_queries[m_currIndex]->m_data);
+		progressEvent.SetInt(m_queries[m_currIndex]->m_resultSet ?
+		                     m_queries[m_currIndex]->m_resultSet->NumRows() : 0);
+
+		m_caller->AddPendingEvent(progressEvent);
+	}
+#endif
+	return 0;
+}
+
+
 int pgQueryThread::RaiseEvent(int _retval)
 {
 #if !defined(PGSCLI)
@@ -700,7 +1066,13 @@ void *pgQueryThread::Entry()
 {
 	do
 	{
-		if (m_currIndex < (((int)m_queries.GetCount()) - 1))
+		bool pending;
+		{
+			wxMutexLocker lock(m_queueLock);
+			pending = m_currIndex < (((int)m_queries.GetCount()) - 1);
+		}
+
+		if (pending)
 		{
 			// Create the PGcancel object to enable cancelling the running
 			// query
@@ -725,12 +1097,28 @@ void *pgQueryThread::Entry()
 
 			// reset the PGcancel object
 			m_conn->ResetConnCancel();
+
+			// A statement, which has been deallocated behind our back, will
+			// be prepared again next time
+			pgBatchQuery *query = m_queries[m_currIndex];
+			if (!query->m_stmtName.IsEmpty() && query->m_err.sql_state == wxT("26000"))
+				m_prepared.Remove(query->m_stmtName);
+
+			wxMutexLocker lock(m_queueLock);
+			m_completed++;
+			m_queueCond.Broadcast();
 		}
 
 		if (!m_multiQueries || m_cancelled)
 			break;
 
-		wxThread::Sleep(10);
+		if (!pending)
+		{
+			// Wait for the next query (cancellation is noticed within 10ms)
+			wxMutexLocker lock(m_queueLock);
+			if (m_currIndex >= (((int)m_queries.GetCount()) - 1))
+				m_queueCond.WaitTimeout(10);
+		}
 	}
 	while (true);
 
@@ -824,8 +1212,8 @@ bool pgBatchQuery::Release()
 }
 
 pgQueryResultEvent::pgQueryResultEvent(
-    unsigned long _thrdId, pgBatchQuery *_qry, int _id) :
-	wxCommandEvent(PGQueryResultEvent, _id), m_thrdId(_thrdId),
+    unsigned long _thrdId, pgBatchQuery *_qry, int _id, wxEventType _type) :
+	wxCommandEvent(_type, _id), m_thrdId(_thrdId),
 	m_query(_qry) { }
 
 pgQueryResultEvent::pgQueryResultEvent(const pgQueryResultEvent &_ev)
@@ -852,22 +1240,23 @@ pgParam::pgParam(Oid _type, void *_val, int _len, short _mode)
 pgParam::pgParam(Oid _oid, wxString *_val, wxMBConv *_conv, short _mode)
 	: m_mode(_mode)
 {
+	// The length is that of the converted string, in bytes
+	wxCharBuffer buf;
 	if (m_mode == PG_PARAM_OUT || !_val)
 	{
 		m_len = 0;
 	}
 	else
 	{
-		m_len = _val->Len();
+		buf = _val->mb_str(*(_conv != NULL ? _conv : &wxConvLocal));
+		m_len = buf ? strlen(buf) : 0;
 	}
 	if (_val)
 	{
 		char *str = (char *)malloc(m_len + 1);
-		if (!_val->IsEmpty() && _mode != PG_PARAM_OUT)
+		if (m_len > 0)
 		{
-			strncpy(str,
-			        (const char *)_val->mb_str(
-			            *(_conv != NULL ? _conv : &wxConvLocal)), m_len);
+			memcpy(str, (const char *)buf, m_len);
 			str[m_len] = '\0';
 		}
 		else
@@ -23,6 +23,47 @@
 #include "utils/sysLogger.h"
 #include "utils/pgDefs.h"
 
+// Number of rows converted at once for a column, and the maximum number of
+// characters kept in the cache of the converted values
+#define CACHE_BLOCK_ROWS    256
+#define CACHE_MAX_CHARS     (8 * 1024 * 1024)
+
+// The converted values of a column, for a block of rows
+class pgSetBlock
+{
+public:
+	pgSetBlock(long rows)
+	{
+		numRows = rows;
+		offsets = new size_t[rows + 1];
+		nulls = new unsigned char[(rows + 7) / 8];
+		memset(nulls, 0, (rows + 7) / 8);
+	}
+	~pgSetBlock()
+	{
+		delete [] offsets;
+		delete [] nulls;
+	}
+
+	void SetNull(long row)
+	{
+		nulls[row / 8] |= (1 << (row % 8));
+	}
+	bool IsNull(long row) const
+	{
+		return (nulls[row / 8] & (1 << (row % 8))) != 0;
+	}
+
+	long numRows;
+	// All the values, one after another
+	wxString values;
+	// Start of each value in values, followed by the end of the last one
+	size_t *offsets;
+	// Null bitmap
+	unsigned char *nulls;
+};
+
+
 pgSet::pgSet()
 	: conv(wxConvLibc)
 {
@@ -31,6 +72,11 @@ pgSet::pgSet()
 	nCols = 0;
 	nRows = 0;
 	pos = 0;
+	isStreaming = false;
+	lastChunk = 0;
+	typesResolved = false;
+	cacheValues = false;
+	cacheSize = 0;
 }
 
 pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt)
@@ -40,6 +86,11 @@ pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt)
 
 	conn = newConn;
 	res = newRes;
+	isStreaming = false;
+	lastChunk = 0;
+	typesResolved = false;
+	cacheValues = false;
+	cacheSize = 0;
 
 	// Make sure we have tuples
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
@@ -66,7 +117,99 @@ pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt)
 
 pgSet::~pgSet()
 {
-	PQclear(res);
+	ClearCache();
+
+	if (chunks.IsEmpty())
+		PQclear(res);
+	else
+	{
+		// res is the first chunk of a streamed result
+		for (size_t i = 0 ; i < chunks.GetCount() ; i++)
+			PQclear(chunks[i]);
+	}
+}
+
+
+void pgSet::AppendRows(PGresult *chunk)
+{
+	wxASSERT(PQnfields(chunk) == nCols);
+
+	long chunkRows = PQntuples(chunk);
+	if (!chunkRows)
+	{
+		PQclear(chunk);
+		return;
+	}
+
+	wxCriticalSectionLocker lock(chunkLock);
+
+	if (chunks.IsEmpty())
+	{
+		// The result given to the constructor holds the column definitions
+		// (and possibly the first rows)
+		chunks.Add(res);
+		chunkStarts.Add(0L);
+	}
+	chunks.Add(chunk);
+	chunkStarts.Add(nRows);
+
+	nRows += chunkRows;
+}
+
+
+void pgSet::SetStreaming(bool streaming)
+{
+	wxCriticalSectionLocker lock(chunkLock);
+
+	// The set is not shared yet when streaming starts
+	if (streaming && !nRows)
+		pos = 1;
+	isStreaming = streaming;
+}
+
+
+PGresult *pgSet::RowResult(long row, int &tuple) const
+{
+	wxCriticalSectionLocker lock(chunkLock);
+
+	if (chunks.IsEmpty())
+	{
+		tuple = row;
+		return res;
+	}
+
+	size_t chunk = lastChunk;
+
+	// Rows are mostly read in order, hence - try the last chunk first
+	if (chunk >= chunks.GetCount() || row < chunkStarts[chunk] ||
+	        row >= chunkStarts[chunk] + PQntuples(chunks[chunk]))
+	{
+		size_t low = 0, high = chunks.GetCount() - 1;
+
+		while (low < high)
+		{
+			size_t mid = (low + high + 1) / 2;
+
+			if (chunkStarts[mid] <= row)
+				low = mid;
+			else
+				high = mid - 1;
+		}
+		chunk = low;
+		lastChunk = chunk;
+	}
+
+	tuple = row - chunkStarts[chunk];
+	return chunks[chunk];
+}
+
+
+bool pgSet::IsNull(const int col) const
+{
+	int tuple;
+	PGresult *rowRes = RowResult(tuple);
+
+	return (PQgetisnull(rowRes, tuple, col) != 0);
 }
 
 
@@ -103,15 +246,50 @@ pgTypClass pgSet::ColTypClass(const int col) const
 	if (colClasses[col] != 0)
 		return (pgTypClass)colClasses[col];
 
-	wxString typoid = ExecuteScalar(
-	                      wxT("SELECT CASE WHEN typbasetype=0 THEN oid else typbasetype END AS basetype\n")
-	                      wxT("  FROM pg_type WHERE oid=") + NumToStr(ColTypeOid(col)));
+	// The connection is busy while streaming, domains will be resolved
+	// to their base type once the result is complete
+	if (IsStreaming())
+		return TypClassFromOid(ColTypeOid(col));
 
-	switch (StrToLong(typoid))
+	ResolveTypes();
+
+	return (pgTypClass)colClasses[col];
+}
+
+
+// Look up the types of all columns at once, the first time one is needed
+void pgSet::ResolveTypes() const
+{
+	if (typesResolved || !conn)
+		return;
+
+	wxArrayLong typeOids, typeMods;
+	int col;
+
+	for (col = 0 ; col < nCols ; col++)
+	{
+		typeOids.Add((long)ColTypeOid(col));
+		typeMods.Add(ColTypeMod(col));
+	}
+	conn->CacheTypes(typeOids, typeMods);
+
+	for (col = 0 ; col < nCols ; col++)
+	{
+		colTypes[col] = conn->GetTypeName(ColTypeOid(col));
+		colFullTypes[col] = conn->GetFullTypeName(ColTypeOid(col), ColTypeMod(col));
+		colClasses[col] = TypClassFromOid(conn->GetBaseType(ColTypeOid(col)));
+	}
+
+	typesResolved = true;
+}
+
+
+pgTypClass pgSet::TypClassFromOid(OID typeOid)
+{
+	switch (typeOid)
 	{
 		case PGOID_TYPE_BOOL:
-			colClasses[col] = PGTYPCLASS_BOOL;
-			break;
+			return PGTYPCLASS_BOOL;
 		case PGOID_TYPE_INT8:
 		case PGOID_TYPE_INT2:
 		case PGOID_TYPE_INT4:
@@ -124,28 +302,22 @@ pgTypClass pgSet::ColTypClass(const int col) const
 		case PGOID_TYPE_MONEY:
 		case PGOID_TYPE_BIT:
 		case PGOID_TYPE_NUMERIC:
-			colClasses[col] = PGTYPCLASS_NUMERIC;
-			break;
+			return PGTYPCLASS_NUMERIC;
 		case PGOID_TYPE_BYTEA:
 		case PGOID_TYPE_CHAR:
 		case PGOID_TYPE_NAME:
 		case PGOID_TYPE_TEXT:
 		case PGOID_TYPE_VARCHAR:
-			colClasses[col] = PGTYPCLASS_STRING;
-			break;
+			return PGTYPCLASS_STRING;
 		case PGOID_TYPE_TIMESTAMP:
 		case PGOID_TYPE_TIMESTAMPTZ:
 		case PGOID_TYPE_TIME:
 		case PGOID_TYPE_TIMETZ:
 		case PGOID_TYPE_INTERVAL:
-			colClasses[col] = PGTYPCLASS_DATE;
-			break;
+			return PGTYPCLASS_DATE;
 		default:
-			colClasses[col] = PGTYPCLASS_OTHER;
-			break;
+			return PGTYPCLASS_OTHER;
 	}
-
-	return (pgTypClass)colClasses[col];
 }
 
 
@@ -153,30 +325,20 @@ wxString pgSet::ColType(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	if (!colTypes[col].IsEmpty())
-		return colTypes[col];
-
-	wxString szSQL, szResult;
-	szSQL.Printf(wxT("SELECT format_type(oid,NULL) as typname FROM pg_type WHERE oid = %d"), (int)ColTypeOid(col));
-	szResult = ExecuteScalar(szSQL);
-	colTypes[col] = szResult;
+	if (!IsStreaming())
+		ResolveTypes();
 
-	return szResult;
+	return colTypes[col];
 }
 
 wxString pgSet::ColFullType(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	if (!colFullTypes[col].IsEmpty())
-		return colFullTypes[col];
+	if (!IsStreaming())
+		ResolveTypes();
 
-	wxString szSQL, szResult;
-	szSQL.Printf(wxT("SELECT format_type(oid,%d) as typname FROM pg_type WHERE oid = %d"), (int)ColTypeMod(col), (int)ColTypeOid(col));
-	szResult = ExecuteScalar(szSQL);
-	colFullTypes[col] = szResult;
-
-	return szResult;
+	return colFullTypes[col];
 }
 
 int pgSet::ColScale(const int col) const
@@ -233,13 +395,19 @@ char *pgSet::GetCharPtr(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	return PQgetvalue(res, pos - 1, col);
+	int tuple;
+	PGresult *rowRes = RowResult(tuple);
+
+	return PQgetvalue(rowRes, tuple, col);
 }
 
 
 char *pgSet::GetCharPtr(const wxString &col) const
 {
-	return PQgetvalue(res, pos - 1, ColNumber(col));
+	int tuple;
+	PGresult *rowRes = RowResult(tuple);
+
+	return PQgetvalue(rowRes, tuple, ColNumber(col));
 }
 
 
@@ -247,10 +415,123 @@ wxString pgSet::GetVal(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
+	if (cacheValues)
+	{
+		size_t len;
+		const wxChar *val = GetValPtr(col, len);
+
+		if (!val)
+			return wxEmptyString;
+		return wxString(val, len);
+	}
+
 	return wxString(GetCharPtr(col), conv);
 }
 
 
+const wxChar *pgSet::GetValPtr(const int col, size_t &len) const
+{
+	wxASSERT(col < nCols && col >= 0);
+
+	len = 0;
+	if (pos < 1 || pos > NumRows())
+		return NULL;
+
+	pgSetBlock *block = GetBlock(col);
+	long row = (pos - 1) % CACHE_BLOCK_ROWS;
+
+	if (block->IsNull(row))
+		return NULL;
+
+	len = block->offsets[row + 1] - block->offsets[row];
+	return ((const wxChar *)block->values.c_str()) + block->offsets[row];
+}
+
+
+pgSetBlock *pgSet::GetBlock(const int col) const
+{
+	long blockNo = (pos - 1) / CACHE_BLOCK_ROWS,
+	     firstRow = blockNo * CACHE_BLOCK_ROWS,
+	     blockRows = wxMin((long)CACHE_BLOCK_ROWS, NumRows() - firstRow),
+	     key = blockNo * nCols + col;
+
+	pgSetBlock *block;
+	pgSetBlockMap::iterator it = cacheBlocks.find(key);
+
+	if (it != cacheBlocks.end())
+	{
+		block = it->second;
+
+		// The last block of a streamed result-set may have grown
+		if (block->numRows == blockRows)
+			return block;
+
+		cacheSize -= block->values.Length();
+		cacheBlocks.erase(it);
+		cacheOrder.Remove(key);
+		delete block;
+	}
+
+	while (cacheSize > CACHE_MAX_CHARS && !cacheOrder.IsEmpty())
+	{
+		it = cacheBlocks.find(cacheOrder[0]);
+		cacheOrder.RemoveAt(0);
+
+		if (it != cacheBlocks.end())
+		{
+			cacheSize -= it->second->values.Length();
+			delete it->second;
+			cacheBlocks.erase(it);
+		}
+	}
+
+	block = new pgSetBlock(blockRows);
+
+	PGresult *rowRes;
+	int tuple;
+	long row;
+	size_t bytes = 0;
+
+	for (row = 0 ; row < blockRows ; row++)
+	{
+		rowRes = RowResult(firstRow + row, tuple);
+		bytes += PQgetlength(rowRes, tuple, col);
+	}
+	block->values.Alloc(bytes);
+
+	for (row = 0 ; row < blockRows ; row++)
+	{
+		rowRes = RowResult(firstRow + row, tuple);
+		block->offsets[row] = block->values.Length();
+
+		if (PQgetisnull(rowRes, tuple, col))
+			block->SetNull(row);
+		else
+			block->values.Append(wxString(PQgetvalue(rowRes, tuple, col), conv));
+	}
+	block->offsets[blockRows] = block->values.Length();
+
+	cacheBlocks[key] = block;
+	cacheOrder.Add(key);
+	cacheSize += block->values.Length();
+
+	return block;
+}
+
+
+void pgSet::ClearCache()
+{
+	pgSetBlockMap::iterator it;
+
+	for (it = cacheBlocks.begin() ; it != cacheBlocks.end() ; ++it)
+		delete it->second;
+
+	cacheBlocks.clear();
+	cacheOrder.Empty();
+	cacheSize = 0;
+}
+
+
 wxString pgSet::GetVal(const wxString &colname) const
 {
 	return GetVal(ColNumber(colname));
@@ -261,7 +542,7 @@ long pgSet::GetLong(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = GetCharPtr(col);
 	if (c)
 		return atol(c);
 	else
@@ -271,7 +552,7 @@ long pgSet::GetLong(const int col) const
 
 long pgSet::GetLong(const wxString &col) const
 {
-	char *c = PQgetvalue(res, pos - 1, ColNumber(col));
+	char *c = GetCharPtr(col);
 	if (c)
 		return atol(c);
 	else
@@ -283,7 +564,7 @@ bool pgSet::GetBool(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = GetCharPtr(col);
 	if (c)
 	{
 		if (*c == 't' || *c == '1' || !strcmp(c, "on"))
@@ -355,7 +636,7 @@ wxULongLong pgSet::GetLongLong(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = GetCharPtr(col);
 	if (c)
 		return atolonglong(c);
 	else
@@ -372,7 +653,7 @@ OID pgSet::GetOid(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = GetCharPtr(col);
 	if (c)
 		return (OID)strtoul(c, 0, 10);
 	else
@@ -0,0 +1,257 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// dlgExplainDiff.cpp - Compare two plans explained in a query tab
+//
+//////////////////////////////////////////////////////////////////////////
+
+// wxWindows headers
+#include <wx/xrc/xmlres.h>
+
+// App headers
+#include "pgAdmin3.h"
+
+#include "dlg/dlgExplainDiff.h"
+
+
+// pointer to controls
+#define cbBefore          CTRL_CHOICE("cbBefore")
+#define cbAfter           CTRL_CHOICE("cbAfter")
+#define stTotals          CTRL_STATIC("stTotals")
+
+// The columns of the list
+enum
+{
+	DIFFCOL_BEFORE = 0,
+	DIFFCOL_AFTER,
+	DIFFCOL_CHANGES,
+	DIFFCOL_VALUEBEFORE,
+	DIFFCOL_VALUEAFTER,
+	DIFFCOL_DELTA,
+	DIFFCOL_ROWSBEFORE,
+	DIFFCOL_ROWSAFTER
+};
+
+
+ExplainDiffList::ExplainDiffList(wxWindow *parent)
+	: ctlListView(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_VIRTUAL | wxSUNKEN_BORDER)
+{
+	planDiff = NULL;
+	planTimed = false;
+
+	changedAttr.SetBackgroundColour(wxColour(255, 224, 178));
+	unmatchedAttr.SetBackgroundColour(wxColour(224, 224, 224));
+
+	AddColumn(_("Before"), 150);
+	AddColumn(_("After"), 150);
+	AddColumn(_("Changes"), 150);
+	AddColumn(wxEmptyString, 60, wxLIST_FORMAT_RIGHT);
+	AddColumn(wxEmptyString, 60, wxLIST_FORMAT_RIGHT);
+	AddColumn(wxEmptyString, 60, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Rows before"), 70, wxLIST_FORMAT_RIGHT);
+	AddColumn(_("Rows after"), 70, wxLIST_FORMAT_RIGHT);
+}
+
+
+void ExplainDiffList::SetDiff(ExplainPlanDiff *diff, bool timed)
+{
+	planDiff = diff;
+	planTimed = timed;
+
+	if (timed)
+	{
+		SetHeading(DIFFCOL_VALUEBEFORE, _("ms before"));
+		SetHeading(DIFFCOL_VALUEAFTER, _("ms after"));
+		SetHeading(DIFFCOL_DELTA, _("ms change"));
+	}
+	else
+	{
+		SetHeading(DIFFCOL_VALUEBEFORE, _("Cost before"));
+		SetHeading(DIFFCOL_VALUEAFTER, _("Cost after"));
+		SetHeading(DIFFCOL_DELTA, _("Cost change"));
+	}
+
+	SetItemCount(diff ? diff->GetRows().GetCount() : 0);
+	Refresh();
+}
+
+
+void ExplainDiffList::SetHeading(int col, const wxString &text)
+{
+	wxListItem item;
+	item.SetMask(wxLIST_MASK_TEXT);
+	item.SetText(text);
+	SetColumn(col, item);
+}
+
+
+double ExplainDiffList::GetValue(ExplainNode *node) const
+{
+	return planTimed ? node->exclusiveTime : node->exclusiveCost;
+}
+
+
+wxString ExplainDiffList::OnGetItemText(long item, long col) const
+{
+	if (!planDiff || item < 0 || item >= (long)planDiff->GetRows().GetCount())
+		return wxEmptyString;
+
+	const ExplainDiffRow &row = planDiff->GetRows().Item(item);
+	wxString format = planTimed ? wxT("%.3f") : wxT("%.2f");
+	wxString deltaFormat = planTimed ? wxT("%+.3f") : wxT("%+.2f");
+	ExplainNode *node = NULL;
+
+	switch (col)
+	{
+		case DIFFCOL_BEFORE:
+		case DIFFCOL_AFTER:
+			node = col == DIFFCOL_BEFORE ? row.before : row.after;
+			if (node)
+				return wxString(wxT(' '), row.depth * 3) + node->GetName();
+			break;
+		case DIFFCOL_CHANGES:
+			if (!row.after)
+				return _("removed");
+			if (!row.before)
+				return _("added");
+			return row.changes;
+		case DIFFCOL_VALUEBEFORE:
+		case DIFFCOL_VALUEAFTER:
+			node = col == DIFFCOL_VALUEBEFORE ? row.before : row.after;
+			if (node && GetValue(node) >= 0)
+				return wxString::Format(format, GetValue(node));
+			break;
+		case DIFFCOL_DELTA:
+		{
+			double before = row.before ? GetValue(row.before) : 0;
+			double after = row.after ? GetValue(row.after) : 0;
+			if (before >= 0 && after >= 0)
+				return wxString::Format(deltaFormat, after - before);
+			break;
+		}
+		case DIFFCOL_ROWSBEFORE:
+		case DIFFCOL_ROWSAFTER:
+			node = col == DIFFCOL_ROWSBEFORE ? row.before : row.after;
+			if (node && node->analyzed)
+				return wxString::Format(wxT("%.0f / %.0f"), node->actualRows, node->planRows);
+			else if (node)
+				return wxString::Format(wxT("%.0f"), node->planRows);
+			break;
+	}
+	return wxEmptyString;
+}
+
+
+wxListItemAttr *ExplainDiffList::OnGetItemAttr(long item) const
+{
+	if (!planDiff || item < 0 || item >= (long)planDiff->GetRows().GetCount())
+		return NULL;
+
+	const ExplainDiffRow &row = planDiff->GetRows().Item(item);
+	if (!row.before || !row.after)
+		return (wxListItemAttr *)&unmatchedAttr;
+	if (!row.changes.IsEmpty())
+		return (wxListItemAttr *)&changedAttr;
+	return NULL;
+}
+
+
+BEGIN_EVENT_TABLE(dlgExplainDiff, pgDialog)
+	EVT_CHOICE(XRCID("cbBefore"),     dlgExplainDiff::OnChangeRun)
+	EVT_CHOICE(XRCID("cbAfter"),      dlgExplainDiff::OnChangeRun)
+END_EVENT_TABLE()
+
+
+dlgExplainDiff::dlgExplainDiff(wxWindow *parent, const ExplainRunArray &runs)
+{
+	planDiff = NULL;
+
+	SetFont(settings->GetSystemFont());
+	LoadResource(parent, wxT("dlgExplainDiff"));
+	RestorePosition();
+
+	// The list is virtual, so it is not one the resource can create
+	lstNodes = new ExplainDiffList(this);
+	wxXmlResource::Get()->AttachUnknownControl(wxT("lstNodes"), lstNodes);
+
+	for (size_t i = 0; i < runs.GetCount(); i++)
+	{
+		ExplainPlan *plan = ExplainPlan::Parse(runs.Item(i).json);
+		plans.Add(plan);
+
+		wxString label = wxString::Format(wxT("%d: "), (int)i + 1) + runs.Item(i).time.FormatTime();
+		if (plan)
+			label += wxT("  ") + GetTotal(plan);
+		cbBefore->Append(label);
+		cbAfter->Append(label);
+	}
+
+	// The last two runs, to start with
+	if (runs.GetCount() > 1)
+	{
+		cbBefore->SetSelection(runs.GetCount() - 2);
+		cbAfter->SetSelection(runs.GetCount() - 1);
+	}
+	ShowDiff();
+}
+
+
+dlgExplainDiff::~dlgExplainDiff()
+{
+	SavePosition();
+
+	// The list shows the diff until it is gone
+	lstNodes->SetDiff(NULL, false);
+	if (planDiff)
+		delete planDiff;
+	WX_CLEAR_ARRAY(plans);
+}
+
+
+wxString dlgExplainDiff::GetTotal(ExplainPlan *plan) const
+{
+	if (plan->GetTotalTime() >= 0)
+		return wxString::Format(_("%.3f ms"), plan->GetTotalTime());
+	return wxString::Format(_("cost %.2f"), plan->GetTotalCost());
+}
+
+
+void dlgExplainDiff::OnChangeRun(wxCommandEvent &ev)
+{
+	ShowDiff();
+}
+
+
+void dlgExplainDiff::ShowDiff()
+{
+	lstNodes->SetDiff(NULL, false);
+	if (planDiff)
+	{
+		delete planDiff;
+		planDiff = NULL;
+	}
+	stTotals->SetLabel(wxEmptyString);
+
+	int b = cbBefore->GetSelection(), a = cbAfter->GetSelection();
+	if (b < 0 || a < 0 || !plans.Item(b) || !plans.Item(a))
+		return;
+
+	ExplainPlan *before = plans.Item(b), *after = plans.Item(a);
+
+	// Times are compared only if both runs have them
+	bool timed = before->GetTotalTime() >= 0 && after->GetTotalTime() >= 0;
+	double totalBefore = timed ? before->GetTotalTime() : before->GetTotalCost();
+	double totalAfter = timed ? after->GetTotalTime() : after->GetTotalCost();
+
+	wxString totals = wxString::Format(_("Total: %s -> %s"), GetTotal(before).c_str(), GetTotal(after).c_str());
+	if (totalBefore > 0)
+		totals += wxString::Format(wxT(" (%+.1f%%)"), (totalAfter - totalBefore) * 100 / totalBefore);
+	stTotals->SetLabel(totals);
+
+	planDiff = new ExplainPlanDiff(before, after);
+	lstNodes->SetDiff(planDiff, timed && before->IsTimed() && after->IsTimed());
+}
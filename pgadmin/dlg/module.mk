@@ -22,6 +22,7 @@ pgadmin3_SOURCES += \
 	dlg/dlgDatabase.cpp \
 	dlg/dlgDomain.cpp \
 	dlg/dlgEventTrigger.cpp \
+	dlg/dlgExplainDiff.cpp \
 	dlg/dlgExtension.cpp \
 	dlg/dlgEditGridOptions.cpp \
 	dlg/dlgFindReplace.cpp \
@@ -19,6 +19,7 @@
 #include "frm/frmMain.h"
 #include "frm/menu.h"
 #include "db/pgQueryThread.h"
+#include "db/pgQueryResultEvent.h"
 
 #include <wx/generic/gridctrl.h>
 #include <wx/clipbrd.h>
@@ -50,6 +51,17 @@
 
 #define CTRLID_LIMITCOMBO       4226
 
+// Rows written by a single statement, when saving or deleting in batches
+#define FLUSH_BATCH_ROWS        500
+
+// Rows fetched at once, when paging through a table
+#define EDITGRID_PAGE_ROWS      1000
+
+// Lines allocated at once by the cache
+#define CACHE_CHUNK_LINES       256
+// Rows read from the dataSet are dropped again, when they take more memory
+#define CACHE_MAX_BYTES         (64 * 1024 * 1024)
+
 
 BEGIN_EVENT_TABLE(frmEditGrid, pgFrame)
 	EVT_ERASE_BACKGROUND(       frmEditGrid::OnEraseBackground)
@@ -69,6 +81,9 @@ BEGIN_EVENT_TABLE(frmEditGrid, pgFrame)
 	EVT_MENU(MNU_CONTENTS,      frmEditGrid::OnContents)
 	EVT_MENU(MNU_COPY,          frmEditGrid::OnCopy)
 	EVT_MENU(MNU_PASTE,         frmEditGrid::OnPaste)
+	EVT_MENU(MNU_BATCHSAVE,     frmEditGrid::OnBatchSave)
+	EVT_MENU(MNU_PAGEROWS,      frmEditGrid::OnPageRows)
+	EVT_PGQUERYRESULT(EDITGRID_PAGE_COMPLETE, frmEditGrid::OnPageComplete)
 	EVT_MENU(MNU_LIMITBAR,      frmEditGrid::OnToggleLimitBar)
 	EVT_MENU(MNU_TOOLBAR,       frmEditGrid::OnToggleToolBar)
 	EVT_MENU(MNU_SCRATCHPAD,    frmEditGrid::OnToggleScratchPad)
@@ -100,6 +115,7 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 	thread = 0;
 	relkind = 0;
 	limit = 0;
+	estimatedRows = 0;
 	relid = (Oid)obj->GetOid();
 	editorCell = new sqlCell();
 
@@ -174,14 +190,24 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 	editMenu->Append(MNU_COPY, _("&Copy\tCtrl-C"), _("Copy selected cells to clipboard."));
 	editMenu->Append(MNU_PASTE, _("&Paste\tCtrl-V"), _("Paste data from the clipboard."));
 	editMenu->Append(MNU_DELETE, _("&Delete"), _("Delete selected rows."));
+	editMenu->AppendSeparator();
+	editMenu->Append(MNU_BATCHSAVE, _("&Batch save"), _("Keep changed rows until saved, and save them all at once."), wxITEM_CHECK);
 	editMenu->Enable(MNU_UNDO, false);
 	editMenu->Enable(MNU_DELETE, false);
 
+	// Batches are inserted with multi-row VALUES ... RETURNING
+	bool batchSave;
+	settings->Read(wxT("frmEditGrid/BatchSave"), &batchSave, false);
+	editMenu->Check(MNU_BATCHSAVE, batchSave && connection->BackendMinimumVersion(8, 2));
+	editMenu->Enable(MNU_BATCHSAVE, connection->BackendMinimumVersion(8, 2));
+
 
 	// View menu
 	viewMenu = new wxMenu();
 	viewMenu->Append(MNU_REFRESH, _("&Refresh\tF5"), _("Refresh."));
 	viewMenu->AppendSeparator();
+	viewMenu->Append(MNU_PAGEROWS, _("&Page through rows"), _("Fetch the rows of tables with a primary key page by page, while scrolling."), wxITEM_CHECK);
+	viewMenu->AppendSeparator();
 	viewMenu->Append(MNU_LIMITBAR, _("&Limit bar\tCtrl-Alt-L"), _("Show or hide the row limit options bar."), wxITEM_CHECK);
 	viewMenu->Append(MNU_SCRATCHPAD, _("S&cratch pad\tCtrl-Alt-S"), _("Show or hide the scratch pad."), wxITEM_CHECK);
 	viewMenu->Append(MNU_TOOLBAR, _("&Tool bar\tCtrl-Alt-T"), _("Show or hide the tool bar."), wxITEM_CHECK);
@@ -271,6 +297,9 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 		hasOids = table->GetHasOids();
 		tableName = table->GetSchema()->GetQuotedFullIdentifier() + wxT(".") + table->GetQuotedIdentifier();
 		primaryKeyColNumbers = table->GetPrimaryKeyColNumbers();
+		if (!primaryKeyColNumbers.IsEmpty())
+			primaryKey = table->GetQuotedPrimaryKey();
+		estimatedRows = table->GetEstimatedRows();
 		autoOrderBy = true; // default order by PK/OID will be discarded when a user defines his order
 		orderBy = table->GetQuotedPrimaryKey();
 		if (orderBy.IsEmpty() && hasOids)
@@ -321,6 +350,12 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 		hasOids = false;
 		tableName = catobj->GetSchema()->GetQuotedFullIdentifier() + wxT(".") + catobj->GetQuotedIdentifier();
 	}
+
+	// Pages are fetched by comparing the primary key as a row
+	bool pageRows;
+	settings->Read(wxT("frmEditGrid/PageRows"), &pageRows, false);
+	viewMenu->Check(MNU_PAGEROWS, pageRows && !primaryKey.IsEmpty() && connection->BackendMinimumVersion(8, 2));
+	viewMenu->Enable(MNU_PAGEROWS, !primaryKey.IsEmpty() && connection->BackendMinimumVersion(8, 2));
 }
 
 void frmEditGrid::OnEraseBackground(wxEraseEvent &event)
@@ -491,14 +526,15 @@ void frmEditGrid::OnCellChange(wxGridEvent &event)
 		{
 			if (table->LastRow() != event.GetRow())
 			{
-				doSkip = DoSave();
+				// In batch mode, the row only gets queued
+				doSkip = DoSave(false);
 			}
 		}
 		else if (sqlGrid->GetGridCursorRow() != event.GetRow())
 		{
-			toolBar->EnableTool(MNU_SAVE, false);
+			toolBar->EnableTool(MNU_SAVE, table->HasPendingLines());
 			toolBar->EnableTool(MNU_UNDO, false);
-			fileMenu->Enable(MNU_SAVE, false);
+			fileMenu->Enable(MNU_SAVE, table->HasPendingLines());
 			editMenu->Enable(MNU_UNDO, false);
 		}
 	}
@@ -826,7 +862,12 @@ void frmEditGrid::OnPaste(wxCommandEvent &ev)
 	}
 	else if(sqlGrid->GetNumberRows() > 0)
 	{
-		if (toolBar->GetToolEnabled(MNU_SAVE))
+		if (sqlGrid->GetTable()->GetBatchMode())
+		{
+			if (!DoSave(false))
+				return;
+		}
+		else if (toolBar->GetToolEnabled(MNU_SAVE))
 		{
 			wxMessageDialog msg(this, _("There is unsaved data in a row.\nDo you want to store to the database?"), _("Unsaved data"),
 			                    wxYES_NO | wxICON_QUESTION | wxCANCEL);
@@ -857,6 +898,38 @@ void frmEditGrid::OnPaste(wxCommandEvent &ev)
 	}
 }
 
+void frmEditGrid::OnBatchSave(wxCommandEvent &event)
+{
+	bool batch = editMenu->IsChecked(MNU_BATCHSAVE);
+
+	sqlTable *table = sqlGrid->GetTable();
+	if (table)
+	{
+		// Don't leave queued rows behind
+		if (!batch && table->HasPendingLines() && !DoSave())
+		{
+			editMenu->Check(MNU_BATCHSAVE, true);
+			return;
+		}
+		table->SetBatchMode(batch);
+	}
+
+	settings->WriteBool(wxT("frmEditGrid/BatchSave"), batch);
+}
+
+void frmEditGrid::OnPageRows(wxCommandEvent &event)
+{
+	settings->WriteBool(wxT("frmEditGrid/PageRows"), viewMenu->IsChecked(MNU_PAGEROWS));
+	OnRefresh(event);
+}
+
+void frmEditGrid::OnPageComplete(pgQueryResultEvent &event)
+{
+	sqlTable *table = sqlGrid->GetTable();
+	if (table)
+		table->PageComplete(event);
+}
+
 void frmEditGrid::OnHelp(wxCommandEvent &ev)
 {
 	DisplayHelp(wxT("editgrid"), HELP_PGADMIN);
@@ -1049,9 +1122,9 @@ void frmEditGrid::OnUndo(wxCommandEvent &event)
 	sqlGrid->GetTable()->UndoLine(sqlGrid->GetGridCursorRow());
 	sqlGrid->ForceRefresh();
 
-	toolBar->EnableTool(MNU_SAVE, false);
+	toolBar->EnableTool(MNU_SAVE, sqlGrid->GetTable()->HasPendingLines());
 	toolBar->EnableTool(MNU_UNDO, false);
-	fileMenu->Enable(MNU_SAVE, false);
+	fileMenu->Enable(MNU_SAVE, sqlGrid->GetTable()->HasPendingLines());
 	editMenu->Enable(MNU_UNDO, false);
 }
 
@@ -1089,18 +1162,22 @@ void frmEditGrid::OnSave(wxCommandEvent &event)
 		DoSave();
 }
 
-bool frmEditGrid::DoSave()
+bool frmEditGrid::DoSave(bool flush)
 {
 	sqlGrid->HideCellEditControl();
 	sqlGrid->SaveEditControlValue();
 	sqlGrid->DisableCellEditControl();
 
-	if (!sqlGrid->GetTable()->StoreLine())
+	sqlTable *table = sqlGrid->GetTable();
+	if (!table->StoreLine())
 		return false;
 
-	toolBar->EnableTool(MNU_SAVE, false);
+	if (flush && !table->FlushLines())
+		return false;
+
+	toolBar->EnableTool(MNU_SAVE, table->HasPendingLines());
 	toolBar->EnableTool(MNU_UNDO, false);
-	fileMenu->Enable(MNU_SAVE, false);
+	fileMenu->Enable(MNU_SAVE, table->HasPendingLines());
 	editMenu->Enable(MNU_UNDO, false);
 
 	return true;
@@ -1112,9 +1189,9 @@ void frmEditGrid::CancelChange()
 	sqlGrid->SaveEditControlValue();
 	sqlGrid->DisableCellEditControl();
 
-	toolBar->EnableTool(MNU_SAVE, false);
+	toolBar->EnableTool(MNU_SAVE, sqlGrid->GetTable()->HasPendingLines());
 	toolBar->EnableTool(MNU_UNDO, false);
-	fileMenu->Enable(MNU_SAVE, false);
+	fileMenu->Enable(MNU_SAVE, sqlGrid->GetTable()->HasPendingLines());
 	editMenu->Enable(MNU_UNDO, false);
 
 	sqlGrid->GetTable()->UndoLine(sqlGrid->GetGridCursorRow());
@@ -1229,9 +1306,12 @@ void frmEditGrid::OnDelete(wxCommandEvent &event)
 	// the user.
 	delrows.Sort(ArrayCmp);
 
-	// don't care a lot about optimizing here; doing it line by line
-	// just as sqlTable::DeleteRows does
+	// Delete them all with one statement, or if that fails, line by
+	// line just as sqlTable::DeleteRows does, to tell which ones fail
 	bool show_continue_message = true;
+	if (sqlGrid->GetTable()->DeleteRowList(delrows))
+		i = 0;
+
 	while (i--)
 	{
 		if (!sqlGrid->DeleteRows(delrows.Item(i), 1) &&
@@ -1408,8 +1488,29 @@ void frmEditGrid::Go()
 	{
 		qry += wxT("\n ORDER BY ") + orderBy;
 	}
+	// Without a limit, rows sorted by the primary key can be fetched
+	// page by page, continuing after the key of the last row fetched
+	int pageRows = 0;
+	bool pageDescending = false;
+	if (viewMenu->IsChecked(MNU_PAGEROWS) && limit <= 0 && !primaryKey.IsEmpty())
+	{
+		wxString ascending = primaryKey, descending = primaryKey;
+		ascending.Replace(wxT(","), wxT(" ASC,"));
+		ascending += wxT(" ASC");
+		descending.Replace(wxT(","), wxT(" DESC,"));
+		descending += wxT(" DESC");
+
+		if (orderBy == ascending || orderBy == descending)
+		{
+			pageRows = EDITGRID_PAGE_ROWS;
+			pageDescending = (orderBy == descending);
+		}
+	}
+
 	if (limit > 0)
 		qry += wxT(" LIMIT ") + wxString::Format(wxT("%i"), limit);
+	else if (pageRows > 0)
+		qry += wxT(" LIMIT ") + wxString::Format(wxT("%i"), pageRows);
 
 	thread = new pgQueryThread(connection, qry);
 	if (thread->Create() != wxTHREAD_NO_ERROR)
@@ -1483,7 +1584,15 @@ void frmEditGrid::Go()
 	// !!! Is it still required?
 	//sqlGrid->SetSize(10, 10);
 
-	sqlGrid->SetTable(new sqlTable(connection, thread, tableName, relid, hasOids, primaryKeyColNumbers, relkind), true);
+	sqlTable *table = new sqlTable(connection, thread, tableName, relid, hasOids, primaryKeyColNumbers, relkind);
+	if (pageRows > 0)
+	{
+		table->SetPaging(pageRows, pageDescending, rowFilter, orderBy, rowFilter.IsEmpty() ? estimatedRows : 0);
+		SetStatusText(table->GetPagingStatus(), 0);
+	}
+
+	sqlGrid->SetTable(table, true);
+	sqlGrid->GetTable()->SetBatchMode(editMenu->IsChecked(MNU_BATCHSAVE));
 	sqlGrid->AutoSizeColumns(false);
 
 	sqlGrid->EndBatch();
@@ -2286,17 +2395,27 @@ sqlTable::sqlTable(pgConn *conn, pgQueryThread *_thread, const wxString &tabName
 	rowsDeleted = 0;
 
 
-	dataPool = 0;
-	addPool = new cacheLinePool(500);       // arbitrary initial size
 	lastRow = -1;
+	batchMode = false;
 	int i;
 	lineIndex = 0;
 
+	pageRows = 0;
+	pageDescending = false;
+	morePages = false;
+	pageEstimate = 0;
+	pageThread = 0;
+	pageConn = 0;
+
 	nRows = thread->DataSet()->NumRows();
 	nCols = thread->DataSet()->NumCols();
 
+	cells = new cacheCellArena(nCols);
+	dataPool = 0;
+	addPool = new cacheLinePool(500, cells);        // arbitrary initial size
+
 	columns = new sqlCellAttr[nCols];
-	savedLine.cols = new wxString[nCols];
+	savedLine.cols = cells->Alloc();
 
 	// Get the "real" column list, including any dropped columns, as
 	// key positions etc do not ignore these.
@@ -2516,7 +2635,7 @@ sqlTable::sqlTable(pgConn *conn, pgQueryThread *_thread, const wxString &tabName
 
 	if (nRows)
 	{
-		dataPool = new cacheLinePool(nRows);
+		dataPool = new cacheLinePool(nRows, cells, CACHE_MAX_BYTES);
 		lineIndex = new int[nRows];
 		for (i = 0 ; i < nRows ; i++)
 			lineIndex[i] = i;
@@ -2532,12 +2651,30 @@ sqlTable::sqlTable(pgConn *conn, pgQueryThread *_thread, const wxString &tabName
 
 sqlTable::~sqlTable()
 {
+	if (pageThread)
+	{
+		if (pageThread->IsRunning())
+		{
+			pageThread->CancelExecution();
+			pageThread->Wait();
+		}
+		delete pageThread;
+	}
+
+	// the first page is the thread
+	size_t p;
+	for (p = 1 ; p < pages.GetCount() ; p++)
+		delete pages[p];
+
 	if (thread)
 		delete thread;
+	if (pageConn)
+		delete pageConn;
 	if (dataPool)
 		delete dataPool;
 
 	delete addPool;
+	delete cells;
 
 	delete[] columns;
 
@@ -2637,7 +2774,7 @@ bool sqlTable::CheckInCache(int row)
 	if (row >= nRows - rowsDeleted)
 		return true;
 
-	return dataPool->IsFilled(row);
+	return dataPool->IsFilled(lineIndex[row]);
 }
 
 
@@ -2654,9 +2791,8 @@ cacheLine *sqlTable::GetLine(int row)
 
 
 
-wxString sqlTable::MakeKey(cacheLine *line)
+void sqlTable::GetKeyColumns(wxArrayInt &keyCols)
 {
-	wxString whereClause;
 	if (!primaryKeyColNumbers.IsEmpty())
 	{
 		wxStringTokenizer collist(primaryKeyColNumbers, wxT(","));
@@ -2675,31 +2811,97 @@ wxString sqlTable::MakeKey(cacheLine *line)
 			// Translate the column location to the real location in the actual columns still present
 			cn = colMap[cn - 1];
 
-			wxString colval = line->cols[cn - offset];
-			if (colval.IsEmpty())
-				return wxEmptyString;
+			keyCols.Add(cn - offset);
+		}
+	}
+	else if (hasOids)
+		keyCols.Add(0);
+}
+
 
-			if (colval == wxT("''") && columns[cn - offset].typeName == wxT("text"))
-				colval = wxEmptyString;
+wxString sqlTable::KeyValue(const wxString *cols, int col)
+{
+	wxString colval = cols[col];
+	if (colval.IsEmpty())
+		return wxEmptyString;
 
-			if (!whereClause.IsEmpty())
-				whereClause += wxT(" AND ");
-			whereClause += qtIdent(columns[cn - offset].name) + wxT(" = ") + connection->qtDbString(colval);
+	// The oid
+	if (primaryKeyColNumbers.IsEmpty())
+		return colval;
 
-			if (columns[cn - offset].typeName != wxT(""))
-			{
-				whereClause += wxT("::");
-				whereClause += columns[cn - offset].displayTypeName;
-			}
-		}
+	if (colval == wxT("''") && columns[col].typeName == wxT("text"))
+		colval = wxEmptyString;
+
+	wxString value = connection->qtDbString(colval);
+	if (columns[col].typeName != wxT(""))
+	{
+		value += wxT("::");
+		value += columns[col].displayTypeName;
+	}
+	return value;
+}
+
+
+wxString sqlTable::MakeKey(cacheLine *line)
+{
+	// A line with a pending update is still found by its old key
+	const wxString *cols = line->original ? line->original : line->cols;
+
+	wxArrayInt keyCols;
+	GetKeyColumns(keyCols);
+
+	wxString whereClause;
+	for (size_t i = 0 ; i < keyCols.GetCount() ; i++)
+	{
+		wxString value = KeyValue(cols, keyCols[i]);
+		if (value.IsEmpty())
+			return wxEmptyString;
+
+		if (!whereClause.IsEmpty())
+			whereClause += wxT(" AND ");
+		whereClause += qtIdent(columns[keyCols[i]].name) + wxT(" = ") + value;
 	}
-	else if (hasOids)
-		whereClause = wxT("oid = ") + line->cols[0];
 
 	return whereClause;
 }
 
 
+wxString sqlTable::KeyTuple(const wxString *cols)
+{
+	wxArrayInt keyCols;
+	GetKeyColumns(keyCols);
+
+	wxString tuple;
+	for (size_t i = 0 ; i < keyCols.GetCount() ; i++)
+	{
+		wxString value = KeyValue(cols, keyCols[i]);
+		if (value.IsEmpty())
+			return wxEmptyString;
+
+		if (i)
+			tuple += wxT(", ");
+		tuple += value;
+	}
+
+	return wxT("(") + tuple + wxT(")");
+}
+
+
+void sqlTable::AddSavedKey(cacheLine *line, const wxString *oldCols)
+{
+	if (!IsPaging())
+		return;
+
+	// An update which keeps the key leaves the row where it was fetched
+	wxString key = KeyTuple(line->cols);
+	if (key.IsEmpty() || (oldCols && KeyTuple(oldCols) == key))
+		return;
+
+	if (savedKeys.Index(key) == wxNOT_FOUND)
+		savedKeys.Add(key);
+}
+
+
 
 void sqlTable::UndoLine(int row)
 {
@@ -2714,12 +2916,12 @@ void sqlTable::UndoLine(int row)
 			ctlMenuToolbar *tb = (ctlMenuToolbar *)((wxFrame *)GetView()->GetParent())->GetToolBar();
 			if (tb)
 			{
-				tb->EnableTool(MNU_SAVE, false);
+				tb->EnableTool(MNU_SAVE, HasPendingLines());
 				tb->EnableTool(MNU_UNDO, false);
 			}
 			wxMenu *fm = ((frmEditGrid *)GetView()->GetParent())->GetFileMenu();
 			if (fm)
-				fm->Enable(MNU_SAVE, false);
+				fm->Enable(MNU_SAVE, HasPendingLines());
 			wxMenu *em = ((frmEditGrid *)GetView()->GetParent())->GetEditMenu();
 			if (em)
 				em->Enable(MNU_UNDO, false);
@@ -2734,12 +2936,26 @@ bool sqlTable::StoreLine()
 	bool done = false;
 
 	GetView()->BeginBatch();
-	if (lastRow >= 0)
+	if (lastRow >= 0 && batchMode)
+	{
+		cacheLine *line = GetLine(lastRow);
+
+		done = QueueLine(line);
+		if (done)
+		{
+			line->stored = true;
+			lastRow = -1;
+		}
+		else
+			GetView()->SelectRow(lastRow);
+	}
+	else if (lastRow >= 0)
 	{
 		cacheLine *line = GetLine(lastRow);
 
 		int i;
 		wxString colList, valList;
+		bool storedBefore = line->stored;
 
 		if (line->stored)
 		{
@@ -2803,7 +3019,7 @@ bool sqlTable::StoreLine()
 
 						done = true;
 						rowsStored++;
-						((wxFrame *)GetView()->GetParent())->SetStatusText(wxString::Format(wxT("%d rows."), GetNumberStoredRows()));
+						ShowStatus(wxString::Format(wxT("%d rows."), GetNumberStoredRows()));
 						if (rowsAdded == rowsStored)
 							GetView()->AppendRows();
 
@@ -2839,6 +3055,7 @@ bool sqlTable::StoreLine()
 		}
 		if (done)
 		{
+			AddSavedKey(line, storedBefore ? savedLine.cols : 0);
 			line->stored = true;
 			lastRow = -1;
 		}
@@ -2869,7 +3086,7 @@ void sqlTable::SetValue(int row, int col, const wxString &value)
 			StoreLine();
 
 		if (!line->cols)
-			line->cols = new wxString[nCols];
+			line->cols = cells->Alloc();
 
 		// remember line contents for later reference in update ... where
 		int i;
@@ -2890,6 +3107,7 @@ void sqlTable::SetValue(int row, int col, const wxString &value)
 	if (em)
 		em->Enable(MNU_UNDO, true);
 	line->cols[col] = value;
+	line->cached = false;
 }
 
 
@@ -2898,6 +3116,11 @@ wxString sqlTable::GetValue(int row, int col)
 {
 	wxString val;
 	cacheLine *line;
+
+	// Prefetch the next page, before the last one is scrolled to
+	if (morePages && !pageThread && row >= nRows - rowsDeleted - pageRows / 2)
+		FetchPage();
+
 	if (row < nRows - rowsDeleted)
 		line = dataPool->Get(lineIndex[row]);
 	else
@@ -2911,31 +3134,30 @@ wxString sqlTable::GetValue(int row, int col)
 
 	if (!line->cols)
 	{
-		line->cols = new wxString[nCols];
+		line->cols = cells->Alloc();
 		if (row < nRows - rowsDeleted)
 		{
-			if (!thread)
+			pgSet *set = LocateLine(lineIndex[row]);
+			if (!set)
 			{
 				wxLogError(__("Unexpected empty cache line: dataSet already closed."));
 				return val;
 			}
 
 			line->stored = true;
-			if (lineIndex[row] != thread->DataSet()->CurrentPos() - 1)
-				thread->DataSet()->Locate(lineIndex[row] + 1);
 
 			int i;
 			for (i = 0 ; i < nCols ; i++)
 			{
 				wxString val;
-				if (thread->DataSet()->ColType(i) == wxT("bytea"))
+				if (set->ColTypeOid(i) == PGOID_TYPE_BYTEA)
 					val = _("<binary data>");
 				else
 				{
-					val = thread->DataSet()->GetVal(i);
+					val = set->GetVal(i);
 					if (val.IsEmpty())
 					{
-						if (!thread->DataSet()->IsNull(i))
+						if (!set->IsNull(i))
 							val = wxT("''");
 					}
 					else if (val == wxT("''"))
@@ -2945,7 +3167,9 @@ wxString sqlTable::GetValue(int row, int col)
 			}
 			rowsCached++;
 
-			if (rowsCached == nRows)
+			// Once lines were dropped, they may have to be read again
+			dataPool->SetCached(lineIndex[row]);
+			if (rowsCached == nRows && !dataPool->HasDropped() && !pageRows)
 			{
 				delete thread;
 				thread = 0;
@@ -2994,26 +3218,19 @@ bool sqlTable::DeleteRows(size_t pos, size_t rows)
 
 		if (line->stored)
 		{
-			wxString key = MakeKey(line);
-			wxASSERT(!key.IsEmpty());
-			bool done = connection->ExecuteVoid(wxT(
-			                                        "DELETE FROM ") + tableName + wxT(" WHERE ") + key);
-			if (!done)
-				break;
-
-			if ((int)pos < nRows - rowsDeleted)
-			{
-				rowsDeleted++;
-				if ((int)pos < nRows - rowsDeleted)
-					memmove(lineIndex + pos, lineIndex + pos + 1, sizeof(*lineIndex) * (nRows - rowsDeleted - pos));
-			}
-			else
+			// A line waiting to be inserted isn't in the database yet
+			if (!line->pending || line->original)
 			{
-				rowsAdded--;
-				if (GetLine(pos)->stored)
-					rowsStored--;
-				addPool->Delete(pos - (nRows - rowsDeleted));
+				wxString key = MakeKey(line);
+				wxASSERT(!key.IsEmpty());
+				bool done = connection->ExecuteVoid(wxT(
+				                                        "DELETE FROM ") + tableName + wxT(" WHERE ") + key);
+				if (!done)
+					break;
 			}
+
+			RemovePending(line);
+			RemoveLine(pos);
 			rowsDone++;
 		}
 		else
@@ -3035,161 +3252,951 @@ bool sqlTable::DeleteRows(size_t pos, size_t rows)
 }
 
 
-bool sqlTable::Paste()
+void sqlTable::RemoveLine(size_t pos)
 {
-	int row, col;
-	int start, pos, len;
-	wxArrayString data;
-	wxString text, quoteChar, colSep;
-	bool inQuotes, inData, skipSerial;
+	if ((int)pos < nRows - rowsDeleted)
+	{
+		rowsDeleted++;
+		if ((int)pos < nRows - rowsDeleted)
+			memmove(lineIndex + pos, lineIndex + pos + 1, sizeof(*lineIndex) * (nRows - rowsDeleted - pos));
+	}
+	else
+	{
+		rowsAdded--;
+		if (GetLine(pos)->stored)
+			rowsStored--;
+		addPool->Delete(pos - (nRows - rowsDeleted));
+	}
+}
 
-	if (!this)
-		return false;
 
-	if (wxTheClipboard->Open())
+void sqlTable::RemovePending(cacheLine *line)
+{
+	if (!line->pending)
+		return;
+
+	int index = pendingLines.Index(line);
+	if (index != wxNOT_FOUND)
+		pendingLines.RemoveAt(index);
+
+	line->pending = false;
+	if (line->original)
 	{
-		if (wxTheClipboard->IsSupported(wxDF_TEXT))
-		{
-			wxTextDataObject textData;
-			wxTheClipboard->GetData(textData);
-			text = textData.GetText();
-		}
-		else
-		{
-			wxTheClipboard->Close();
-			return false;
-		}
-		wxTheClipboard->Close();
+		delete[] line->original;
+		line->original = 0;
 	}
+}
+
+
+void sqlTable::SetPaging(int rows, bool descending, const wxString &filter, const wxString &order, double estimatedRows)
+{
+	pageRows = rows;
+	pageDescending = descending;
+	pageFilter = filter;
+	pageOrder = order;
+	pages.Add(thread);
+
+	// A short first page is all there is
+	morePages = (nRows == pageRows);
+	pageEstimate = estimatedRows;
+}
+
+
+wxString sqlTable::GetPagingStatus()
+{
+	if (!morePages)
+		return wxString::Format(wxPLURAL("%d row.", "%d rows.", nRows), nRows);
+	else if (pageEstimate <= nRows)
+		return wxString::Format(_("%d rows fetched, more while scrolling."), nRows);
 	else
+		return wxString::Format(_("%d of about %.0f rows fetched, more while scrolling."), nRows, pageEstimate);
+}
+
+
+pgSet *sqlTable::LocateLine(int lineNo)
+{
+	pgQueryThread *page = thread;
+	if (pageRows)
 	{
-		return false;
+		page = pages[lineNo / pageRows];
+		lineNo %= pageRows;
 	}
+	if (!page)
+		return 0;
+
+	pgSet *set = page->DataSet();
+	if (lineNo != set->CurrentPos() - 1)
+		set->Locate(lineNo + 1);
+	return set;
+}
 
-	start = pos = 0;
-	len = text.Len();
-	quoteChar = settings->GetCopyQuoteChar();
-	colSep = settings->GetCopyColSeparator();
-	inQuotes = inData = false;
 
-	while (pos < len && !(text[pos] == '\n' && !inQuotes))
+void sqlTable::FetchPage()
+{
+	// Continue after the key of the last row fetched
+	pgSet *set = pages.Last()->DataSet();
+	set->Locate(set->NumRows());
+
+	wxArrayInt keyCols;
+	GetKeyColumns(keyCols);
+
+	wxString keyList, valueList;
+	size_t i;
+	for (i = 0 ; i < keyCols.GetCount() ; i++)
 	{
-		if (!inData)
+		if (i)
 		{
-			if (text[pos] == quoteChar)
-			{
-				inQuotes = inData = true;
-				pos++;
-				start++;
-				continue;
-			}
-			else
-			{
-				inQuotes = false;
-			}
-			inData = true;
+			keyList += wxT(", ");
+			valueList += wxT(", ");
 		}
+		keyList += qtIdent(columns[keyCols[i]].name);
+		valueList += connection->qtDbString(set->GetVal(keyCols[i]));
+		if (!columns[keyCols[i]].typeName.IsEmpty())
+			valueList += wxT("::") + columns[keyCols[i]].displayTypeName;
+	}
+
+	wxString qry = wxT("SELECT ");
+	if (hasOids)
+		qry += wxT("oid, ");
+	qry += wxT("* FROM ") + tableName + wxT(" WHERE ");
+	if (!pageFilter.IsEmpty())
+		qry += wxT("(") + pageFilter + wxT(") AND ");
 
-		if (inQuotes && text[pos] == quoteChar &&
-		        (text[pos + 1] == colSep || text[pos + 1] == '\r' || text[pos + 1] == '\n'))
+	// Rows saved here with a key after the pages fetched are in the grid already
+	if (!savedKeys.IsEmpty())
+	{
+		qry += wxT("(") + keyList + wxT(") NOT IN (");
+		for (i = 0 ; i < savedKeys.GetCount() ; i++)
 		{
-			data.Add(text.Mid(start, pos - start));
-			start = (pos += 2);
-			inData = false;
+			if (i)
+				qry += wxT(", ");
+			qry += savedKeys[i];
 		}
-		else if (!inQuotes && text[pos] == colSep)
+		qry += wxT(") AND ");
+	}
+	qry += wxT("(") + keyList + (pageDescending ? wxT(") < (") : wxT(") > (")) + valueList + wxT(")")
+	       wxT("\n ORDER BY ") + pageOrder + wxString::Format(wxT(" LIMIT %i"), pageRows);
+
+	// The connection of the grid is kept free for storing the changes
+	if (!pageConn)
+	{
+		pageConn = connection->Duplicate();
+		if (pageConn && pageConn->GetStatus() != PGCONN_OK)
 		{
-			data.Add(text.Mid(start, pos - start));
-			start = ++pos;
-			inData = false;
+			delete pageConn;
+			pageConn = 0;
 		}
-		else
+		if (!pageConn)
 		{
-			pos++;
+			morePages = false;
+			return;
 		}
 	}
-	if (start < pos)
+
+	pageThread = new pgQueryThread(pageConn, qry, -1, GetView()->GetParent(), EDITGRID_PAGE_COMPLETE);
+	pageThread->SetEventOnCancellation(false);
+	if (pageThread->Create() != wxTHREAD_NO_ERROR)
 	{
-		if (inQuotes && text[pos - 1] == quoteChar)
-			data.Add(text.Mid(start, pos - start - 1));
-		else
-			data.Add(text.Mid(start, pos - start));
+		delete pageThread;
+		pageThread = 0;
+		morePages = false;
+		return;
 	}
+	pageThread->Run();
+}
 
-	row = GetNumberRows() - 1;
-	skipSerial = false;
 
-	for (col = 0; col < nCols; col++)
+void sqlTable::PageComplete(pgQueryResultEvent &event)
+{
+	// A page of an earlier table
+	if (!pageThread || event.GetThreadID() != (unsigned long)pageThread->GetId())
+		return;
+
+	if (pageThread->IsRunning())
+		pageThread->Wait();
+
+	pgQueryThread *page = pageThread;
+	pageThread = 0;
+
+	if (!page->DataValid())
 	{
-		if (columns[col].type == (unsigned int)PGOID_TYPE_SERIAL ||
-		        columns[col].type == (unsigned int)PGOID_TYPE_SERIAL8 ||
-		        columns[col].type == (unsigned int)PGOID_TYPE_SERIAL2)
-		{
-			wxMessageDialog msg(GetView()->GetParent(),
-			                    _("This table contains serial columns. Do you want to use the values in the clipboard for these columns?"),
-			                    _("Paste Data"), wxYES_NO | wxICON_QUESTION);
-			if (msg.ShowModal() != wxID_YES)
-			{
-				skipSerial = true;
-			}
-			break;
-		}
+		wxLogError(__("Could not fetch the next page of rows:\n%s"), page->GetConn()->GetLastError().c_str());
+		delete page;
+		morePages = false;
+		ShowStatus(GetPagingStatus());
+		return;
 	}
 
-	bool pasted = false;
-	for (col = (hasOids ? 1 : 0); col < nCols && col < (int)data.GetCount(); col++)
+	int rows = page->DataSet()->NumRows();
+	morePages = (rows == pageRows);
+	if (!rows)
 	{
-		if (!(skipSerial && (columns[col].type == (unsigned int)PGOID_TYPE_SERIAL ||
-		                     columns[col].type == (unsigned int)PGOID_TYPE_SERIAL8 ||
-		                     columns[col].type == (unsigned int)PGOID_TYPE_SERIAL2)))
-		{
-			SetValue(row, col, data.Item(col));
-			GetView()->SetGridCursor(row, col);
-			GetView()->MakeCellVisible(row, col);
-			pasted = true;
-		}
+		delete page;
+		ShowStatus(GetPagingStatus());
+		return;
 	}
-	GetView()->ForceRefresh();
+	pages.Add(page);
 
-	return pasted;
-}
+	// The new rows go after the ones fetched so far, before the added ones
+	int pos = nRows - rowsDeleted;
+	int *index = new int[nRows + rows];
+	if (lineIndex)
+	{
+		memcpy(index, lineIndex, sizeof(*lineIndex) * pos);
+		delete[] lineIndex;
+	}
+	int i;
+	for (i = 0 ; i < rows ; i++)
+		index[pos + i] = nRows + i;
+	lineIndex = index;
 
+	if (!dataPool)
+		dataPool = new cacheLinePool(nRows + rows, cells, CACHE_MAX_BYTES);
+	nRows += rows;
+	if (lastRow >= pos)
+		lastRow += rows;
+
+	wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_INSERTED, pos, rows);
+	GetView()->ProcessTableMessage(msg);
 
+	ShowStatus(GetPagingStatus());
+}
 
 
-wxGridCellAttr *sqlTable::GetAttr(int row, int col, wxGridCellAttr::wxAttrKind  kind)
+int sqlTable::FindRow(cacheLine *line)
 {
-	cacheLine *line = GetLine(row);
-	if (line && line->readOnly)
+	int row;
+
+	// Don't create the lines, which were never read
+	for (row = 0 ; row < nRows - rowsDeleted ; row++)
 	{
-		wxGridCellAttr *attr = new wxGridCellAttr(columns[col].attr);
-		attr->SetReadOnly();
-		return attr;
+		if (dataPool->IsFilled(lineIndex[row]) && dataPool->Get(lineIndex[row]) == line)
+			return row;
 	}
-	else
+	for (row = 0 ; row < rowsAdded ; row++)
 	{
-		columns[col].attr->IncRef();
-		return columns[col].attr;
+		if (addPool->IsFilled(row) && addPool->Get(row) == line)
+			return nRows - rowsDeleted + row;
 	}
+	return -1;
 }
 
 
+void sqlTable::ShowStatus(const wxString &text)
+{
+	wxFrame *frame = (wxFrame *)GetView()->GetParent();
+	frame->SetStatusText(text);
+	frame->Update();
+}
+
 
-wxString sqlCellAttr::Quote(pgConn *conn, const wxString &value)
+bool sqlTable::QueueLine(cacheLine *line)
 {
-	wxString str;
-	if (value.IsEmpty())
-		str = wxT("NULL");
-	else if (numeric)
-		str = conn->qtDbString(value);
-	else if (value == wxT("\\'\\'"))
-		str = conn->qtDbString(wxT("''"));
-	else if (value == wxT("''"))
-		str = wxT("''");
-	else if (type == PGOID_TYPE_BOOL)
-		str = value;
-	else if (type == PGOID_TYPE_BIT)
-		// Don't cast this one
+	int i;
+
+	if (line->stored)
+	{
+		// Waiting to be inserted already, with whatever it holds by then
+		if (line->pending && !line->original)
+			return true;
+
+		if (!line->original)
+		{
+			for (i = (hasOids ? 1 : 0) ; i < nCols ; i++)
+			{
+				if (savedLine.cols[i] != line->cols[i])
+					break;
+			}
+			if (i == nCols)
+				return true;
+
+			// Keep what is in the database, to find the row and to tell
+			// what has changed when flushing
+			line->original = new wxString[nCols];
+			for (i = 0 ; i < nCols ; i++)
+				line->original[i] = savedLine.cols[i];
+		}
+	}
+	else
+	{
+		for (i = 0 ; i < nCols ; i++)
+		{
+			if (!columns[i].attr->IsReadOnly() && !line->cols[i].IsEmpty())
+				break;
+		}
+		if (i == nCols)
+			return false;
+
+		rowsStored++;
+		if (rowsAdded == rowsStored)
+			GetView()->AppendRows();
+	}
+
+	if (!line->pending)
+	{
+		line->pending = true;
+		pendingLines.Add(line);
+	}
+	ShowStatus(wxString::Format(_("%d rows, %d changed rows not saved yet."), GetNumberStoredRows(), (int)pendingLines.GetCount()));
+
+	return true;
+}
+
+
+void sqlTable::GetChangedColumns(cacheLine *line, wxArrayInt &changed)
+{
+	for (int i = (hasOids ? 1 : 0) ; i < nCols ; i++)
+	{
+		if (line->original[i] != line->cols[i])
+			changed.Add(i);
+	}
+}
+
+
+pgSet *sqlTable::ExecuteInsert(const cacheLineArray &lines)
+{
+	wxString colList, valList;
+	size_t n;
+	int i;
+
+	for (i = 0 ; i < nCols ; i++)
+	{
+		if (!columns[i].attr->IsReadOnly())
+		{
+			if (!colList.IsEmpty())
+				colList += wxT(", ");
+			colList += qtIdent(columns[i].name);
+		}
+	}
+
+	// Empty cells get their default, as if left out of the column list
+	for (n = 0 ; n < lines.GetCount() ; n++)
+	{
+		wxString row;
+		for (i = 0 ; i < nCols ; i++)
+		{
+			if (!columns[i].attr->IsReadOnly())
+			{
+				if (!row.IsEmpty())
+					row += wxT(", ");
+				if (lines[n]->cols[i].IsEmpty())
+					row += wxT("DEFAULT");
+				else
+					row += columns[i].Quote(connection, lines[n]->cols[i]);
+			}
+		}
+		if (n)
+			valList += wxT(",\n       ");
+		valList += wxT("(") + row + wxT(")");
+	}
+
+	return connection->ExecuteSet(
+	           wxT("INSERT INTO ") + tableName
+	           + wxT("(") + colList
+	           + wxT(")\nVALUES ") + valList
+	           + (hasOids ? wxT("\nRETURNING oid, *") : wxT("\nRETURNING *")), false);
+}
+
+
+bool sqlTable::ExecuteUpdate(const cacheLineArray &lines, const wxArrayInt &changed)
+{
+	wxArrayInt keyCols;
+	GetKeyColumns(keyCols);
+
+	wxString setList, whereList, aliasList, valList;
+	size_t i, n;
+
+	for (i = 0 ; i < keyCols.GetCount() ; i++)
+	{
+		if (i)
+		{
+			aliasList += wxT(", ");
+			whereList += wxT(" AND ");
+		}
+		aliasList += wxString::Format(wxT("k%d"), (int)i);
+		whereList += wxT("t.") + qtIdent(columns[keyCols[i]].name) + wxString::Format(wxT(" = v.k%d"), (int)i);
+	}
+	for (i = 0 ; i < changed.GetCount() ; i++)
+	{
+		if (i)
+			setList += wxT(", ");
+		aliasList += wxString::Format(wxT(", c%d"), (int)i);
+		setList += qtIdent(columns[changed[i]].name) + wxString::Format(wxT(" = v.c%d"), (int)i);
+	}
+
+	for (n = 0 ; n < lines.GetCount() ; n++)
+	{
+		wxString row;
+		for (i = 0 ; i < keyCols.GetCount() ; i++)
+		{
+			wxString value = KeyValue(lines[n]->original, keyCols[i]);
+			wxASSERT(!value.IsEmpty());
+			if (i)
+				row += wxT(", ");
+			row += value;
+		}
+		for (i = 0 ; i < changed.GetCount() ; i++)
+			row += wxT(", ") + columns[changed[i]].Quote(connection, lines[n]->cols[changed[i]]);
+
+		if (n)
+			valList += wxT(",\n       ");
+		valList += wxT("(") + row + wxT(")");
+	}
+
+	return connection->ExecuteVoid(
+	           wxT("UPDATE ") + tableName + wxT(" t")
+	           + wxT("\n   SET ") + setList
+	           + wxT("\n  FROM (VALUES ") + valList + wxT(") v(") + aliasList + wxT(")")
+	           + wxT("\n WHERE ") + whereList, false);
+}
+
+
+bool sqlTable::FlushLines()
+{
+	if (pendingLines.IsEmpty())
+		return true;
+
+	wxBusyCursor wait;
+
+	size_t total = pendingLines.GetCount(), saved = 0;
+	size_t i, n;
+
+	// Inserts go first, updates grouped by the columns they change
+	cacheLineArray inserts, updates;
+	wxArrayString updateGroups;
+	for (i = 0 ; i < total ; i++)
+	{
+		cacheLine *line = pendingLines[i];
+		if (!line->original)
+			inserts.Add(line);
+		else
+		{
+			wxArrayInt changed;
+			GetChangedColumns(line, changed);
+			if (changed.IsEmpty())
+				continue;
+
+			wxString group;
+			for (n = 0 ; n < changed.GetCount() ; n++)
+				group += NumToStr((long)changed[n]) + wxT(",");
+
+			updates.Add(line);
+			updateGroups.Add(group);
+		}
+	}
+
+	pgSetArray results;
+	bool done = connection->ExecuteVoid(wxT("BEGIN"), false);
+
+	for (i = 0 ; done && i < inserts.GetCount() ; i += FLUSH_BATCH_ROWS)
+	{
+		cacheLineArray chunk;
+		for (n = i ; n < inserts.GetCount() && n < i + FLUSH_BATCH_ROWS ; n++)
+			chunk.Add(inserts[n]);
+
+		pgSet *set = ExecuteInsert(chunk);
+		results.Add(set);
+		done = (set != 0);
+
+		saved += chunk.GetCount();
+		ShowStatus(wxString::Format(_("Saving changed rows... %d of %d"), (int)saved, (int)total));
+	}
+
+	wxArrayString groups = updateGroups;
+	groups.Sort();
+	for (i = 0 ; done && i < groups.GetCount() ; i++)
+	{
+		if (i && groups[i] == groups[i - 1])
+			continue;
+
+		wxArrayInt changed;
+		wxStringTokenizer cols(groups[i], wxT(","));
+		while (cols.HasMoreTokens())
+		{
+			wxString col = cols.GetNextToken();
+			if (!col.IsEmpty())
+				changed.Add(StrToLong(col));
+		}
+
+		cacheLineArray chunk;
+		for (n = 0 ; done && n <= updates.GetCount() ; n++)
+		{
+			if (n < updates.GetCount() && updateGroups[n] == groups[i])
+				chunk.Add(updates[n]);
+
+			if (chunk.GetCount() == FLUSH_BATCH_ROWS || (n == updates.GetCount() && !chunk.IsEmpty()))
+			{
+				done = ExecuteUpdate(chunk, changed);
+
+				saved += chunk.GetCount();
+				ShowStatus(wxString::Format(_("Saving changed rows... %d of %d"), (int)saved, (int)total));
+				chunk.Clear();
+			}
+		}
+	}
+
+	if (done)
+		done = connection->ExecuteVoid(wxT("COMMIT"), false);
+
+	if (!done)
+	{
+		wxString error = connection->GetLastError();
+		connection->ExecuteVoid(wxT("ROLLBACK"), false);
+
+		for (i = 0 ; i < results.GetCount() ; i++)
+			delete results[i];
+
+		ShowFlushErrors(error);
+		ShowStatus(wxString::Format(_("%d rows, %d changed rows not saved yet."), GetNumberStoredRows(), (int)pendingLines.GetCount()));
+		return false;
+	}
+
+	// Take over what the server made of the inserted rows (defaults etc.)
+	for (i = 0 ; i < results.GetCount() ; i++)
+	{
+		pgSet *set = results[i];
+		size_t first = i * FLUSH_BATCH_ROWS;
+		size_t count = inserts.GetCount() - first;
+		if (count > FLUSH_BATCH_ROWS)
+			count = FLUSH_BATCH_ROWS;
+
+		for (n = 0 ; n < count ; n++)
+		{
+			cacheLine *line = inserts[first + n];
+
+			// Rows skipped by a trigger leave the lines without a key
+			if (set->NumRows() != (long)count)
+			{
+				line->readOnly = true;
+				continue;
+			}
+
+			for (int c = 0 ; c < nCols ; c++)
+				line->cols[c] = set->GetVal(columns[c].name);
+			set->MoveNext();
+		}
+		delete set;
+	}
+
+	for (i = 0 ; i < total ; i++)
+	{
+		cacheLine *line = pendingLines[i];
+		if (!line->readOnly)
+			AddSavedKey(line, line->original);
+		line->pending = false;
+		if (line->original)
+		{
+			delete[] line->original;
+			line->original = 0;
+		}
+	}
+	pendingLines.Clear();
+
+	GetView()->ForceRefresh();
+	ShowStatus(wxString::Format(wxT("%d rows."), GetNumberStoredRows()));
+
+	return true;
+}
+
+
+void sqlTable::ShowFlushErrors(const wxString &error)
+{
+	cacheLine *first = 0;
+	wxString firstError = error;
+	int failed = 0;
+
+	// Try the lines one by one, to tell the user which ones fail, and roll
+	// it all back afterwards
+	if (connection->ExecuteVoid(wxT("BEGIN"), false))
+	{
+		for (size_t i = 0 ; i < pendingLines.GetCount() ; i++)
+		{
+			cacheLine *line = pendingLines[i];
+			cacheLineArray single;
+			single.Add(line);
+
+			bool done = connection->ExecuteVoid(wxT("SAVEPOINT pgadmin_flush"), false);
+			if (!done)
+				break;
+
+			if (line->original)
+			{
+				wxArrayInt changed;
+				GetChangedColumns(line, changed);
+				done = changed.IsEmpty() || ExecuteUpdate(single, changed);
+			}
+			else
+			{
+				pgSet *set = ExecuteInsert(single);
+				done = (set != 0);
+				if (set)
+					delete set;
+			}
+
+			if (done)
+				connection->ExecuteVoid(wxT("RELEASE SAVEPOINT pgadmin_flush"), false);
+			else
+			{
+				if (!failed++)
+				{
+					first = line;
+					firstError = connection->GetLastError();
+				}
+				connection->ExecuteVoid(wxT("ROLLBACK TO SAVEPOINT pgadmin_flush"), false);
+			}
+		}
+		connection->ExecuteVoid(wxT("ROLLBACK"), false);
+	}
+
+	int row = first ? FindRow(first) : -1;
+	wxString msg;
+	if (row >= 0)
+		msg.Printf(wxPLURAL("None of the changed rows have been saved. %d row fails, row %d:\n\n%s",
+		                    "None of the changed rows have been saved. %d rows fail, the first one is row %d:\n\n%s",
+		                    failed), failed, row + 1, firstError.c_str());
+	else
+		msg.Printf(_("None of the changed rows have been saved:\n\n%s"), firstError.c_str());
+
+	wxMessageBox(msg, _("Save changed rows"), wxICON_ERROR | wxOK);
+
+	if (row >= 0)
+	{
+		GetView()->SelectRow(row);
+		GetView()->MakeCellVisible(row, 0);
+	}
+}
+
+
+// Keeps the lines of the pool while a list of rows is worked on
+class cacheLinePin
+{
+public:
+	cacheLinePin(cacheLinePool *linePool)
+	{
+		pool = linePool;
+		if (pool)
+			pool->Pin();
+	}
+	~cacheLinePin()
+	{
+		if (pool)
+			pool->Unpin();
+	}
+
+private:
+	cacheLinePool *pool;
+};
+
+
+bool sqlTable::DeleteRowList(const wxArrayInt &rows)
+{
+	wxArrayInt keyCols;
+	GetKeyColumns(keyCols);
+	if (keyCols.IsEmpty())
+		return false;
+
+	// The lines read for the keys are used again to remove them; a large
+	// selection must not drop them from the cache in between
+	cacheLinePin pin(dataPool);
+
+	wxString keyList;
+	wxArrayString keys;
+	size_t i, n;
+
+	for (i = 0 ; i < keyCols.GetCount() ; i++)
+	{
+		if (i)
+			keyList += wxT(", ");
+		keyList += qtIdent(columns[keyCols[i]].name);
+	}
+
+	for (i = 0 ; i < rows.GetCount() ; i++)
+	{
+		cacheLine *line = GetLine(rows[i]);
+		if (!line)
+			return false;
+
+		// If line->cols is null, it probably means we need to force the cacheline to be populated.
+		if (!line->cols)
+		{
+			GetValue(rows[i], 0);
+			line = GetLine(rows[i]);
+		}
+
+		// Lines waiting to be inserted are simply dropped
+		if (!line->stored || (line->pending && !line->original))
+			continue;
+
+		const wxString *cols = line->original ? line->original : line->cols;
+		wxString key;
+		for (n = 0 ; n < keyCols.GetCount() ; n++)
+		{
+			wxString value = KeyValue(cols, keyCols[n]);
+			if (value.IsEmpty())
+				return false;
+			if (n)
+				key += wxT(", ");
+			key += value;
+		}
+		keys.Add(wxT("(") + key + wxT(")"));
+	}
+
+	if (!keys.IsEmpty())
+	{
+		wxBusyCursor wait;
+
+		bool done = connection->ExecuteVoid(wxT("BEGIN"), false);
+		for (i = 0 ; done && i < keys.GetCount() ; i += FLUSH_BATCH_ROWS)
+		{
+			wxString keyValues;
+			for (n = i ; n < keys.GetCount() && n < i + FLUSH_BATCH_ROWS ; n++)
+			{
+				if (n > i)
+					keyValues += wxT(", ");
+				keyValues += keys[n];
+			}
+
+			done = connection->ExecuteVoid(wxT("DELETE FROM ") + tableName +
+			                               wxT(" WHERE (") + keyList + wxT(") IN (") + keyValues + wxT(")"), false);
+			ShowStatus(wxString::Format(_("Deleting rows... %d of %d"), (int)n, (int)keys.GetCount()));
+		}
+		if (done)
+			done = connection->ExecuteVoid(wxT("COMMIT"), false);
+
+		// Have the caller go row by row, telling which ones fail
+		if (!done)
+		{
+			connection->ExecuteVoid(wxT("ROLLBACK"), false);
+			return false;
+		}
+	}
+
+	// Remove the lines last to first, and tell the grid about each run of
+	// consecutive rows at once
+	size_t runStart = 0, runLength = 0;
+	i = rows.GetCount();
+	while (i--)
+	{
+		size_t pos = rows[i];
+		cacheLine *line = GetLine(pos);
+
+		if (line->stored)
+		{
+			if (runLength && pos + 1 != runStart)
+			{
+				wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED, runStart, runLength);
+				GetView()->ProcessTableMessage(msg);
+				runLength = 0;
+			}
+
+			RemovePending(line);
+			RemoveLine(pos);
+			runStart = pos;
+			runLength++;
+		}
+		else if (line->cols)
+		{
+			// last empty line won't be deleted, just cleared
+			for (int j = 0 ; j < nCols ; j++)
+				line->cols[j] = wxT("");
+		}
+	}
+	if (runLength)
+	{
+		wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED, runStart, runLength);
+		GetView()->ProcessTableMessage(msg);
+	}
+
+	return true;
+}
+
+
+bool sqlTable::Paste()
+{
+	int row, col;
+	int start, pos, len;
+	wxArrayString data;
+	wxString text, quoteChar, colSep;
+	bool inQuotes, inData, skipSerial;
+
+	if (!this)
+		return false;
+
+	if (wxTheClipboard->Open())
+	{
+		if (wxTheClipboard->IsSupported(wxDF_TEXT))
+		{
+			wxTextDataObject textData;
+			wxTheClipboard->GetData(textData);
+			text = textData.GetText();
+		}
+		else
+		{
+			wxTheClipboard->Close();
+			return false;
+		}
+		wxTheClipboard->Close();
+	}
+	else
+	{
+		return false;
+	}
+
+	start = pos = 0;
+	len = text.Len();
+	quoteChar = settings->GetCopyQuoteChar();
+	colSep = settings->GetCopyColSeparator();
+	skipSerial = false;
+
+	bool pasted = false, asked = false;
+	row = col = -1;
+
+	GetView()->BeginBatch();
+
+	// Every line of the clipboard becomes a new row
+	while (pos < len)
+	{
+		data.Clear();
+		start = pos;
+		inQuotes = inData = false;
+
+		while (pos < len && !(text[pos] == '\n' && !inQuotes))
+		{
+			if (!inData)
+			{
+				if (text[pos] == quoteChar)
+				{
+					inQuotes = inData = true;
+					pos++;
+					start++;
+					continue;
+				}
+				else
+				{
+					inQuotes = false;
+				}
+				inData = true;
+			}
+
+			if (inQuotes && text[pos] == quoteChar &&
+			        (text[pos + 1] == colSep || text[pos + 1] == '\r' || text[pos + 1] == '\n'))
+			{
+				data.Add(text.Mid(start, pos - start));
+				start = (pos += 2);
+				inData = false;
+			}
+			else if (!inQuotes && text[pos] == colSep)
+			{
+				data.Add(text.Mid(start, pos - start));
+				start = ++pos;
+				inData = false;
+			}
+			else
+			{
+				pos++;
+			}
+		}
+		if (start < pos)
+		{
+			if (inQuotes && text[pos - 1] == quoteChar)
+				data.Add(text.Mid(start, pos - start - 1));
+			else
+				data.Add(text.Mid(start, pos - start));
+		}
+		pos++;
+
+		if (!data.IsEmpty() && data.Last().EndsWith(wxT("\r")))
+			data.Last().RemoveLast();
+		if (data.IsEmpty() || (data.GetCount() == 1 && data[0].IsEmpty()))
+			continue;
+
+		// The previous line is stored (or queued, in batch mode) first
+		if (pasted && !StoreLine())
+			break;
+
+		row = GetNumberRows() - 1;
+
+		if (!asked)
+		{
+			asked = true;
+			for (col = 0; col < nCols; col++)
+			{
+				if (columns[col].type == (unsigned int)PGOID_TYPE_SERIAL ||
+				        columns[col].type == (unsigned int)PGOID_TYPE_SERIAL8 ||
+				        columns[col].type == (unsigned int)PGOID_TYPE_SERIAL2)
+				{
+					wxMessageDialog msg(GetView()->GetParent(),
+					                    _("This table contains serial columns. Do you want to use the values in the clipboard for these columns?"),
+					                    _("Paste Data"), wxYES_NO | wxICON_QUESTION);
+					if (msg.ShowModal() != wxID_YES)
+					{
+						skipSerial = true;
+					}
+					break;
+				}
+			}
+		}
+
+		for (col = (hasOids ? 1 : 0); col < nCols && col < (int)data.GetCount(); col++)
+		{
+			if (!(skipSerial && (columns[col].type == (unsigned int)PGOID_TYPE_SERIAL ||
+			                     columns[col].type == (unsigned int)PGOID_TYPE_SERIAL8 ||
+			                     columns[col].type == (unsigned int)PGOID_TYPE_SERIAL2)))
+			{
+				SetValue(row, col, data.Item(col));
+				pasted = true;
+			}
+		}
+	}
+
+	GetView()->EndBatch();
+
+	if (pasted)
+	{
+		GetView()->SetGridCursor(row, col - 1);
+		GetView()->MakeCellVisible(row, col - 1);
+	}
+	GetView()->ForceRefresh();
+
+	return pasted;
+}
+
+
+
+
+wxGridCellAttr *sqlTable::GetAttr(int row, int col, wxGridCellAttr::wxAttrKind  kind)
+{
+	cacheLine *line = GetLine(row);
+	if (line && line->readOnly)
+	{
+		wxGridCellAttr *attr = new wxGridCellAttr(columns[col].attr);
+		attr->SetReadOnly();
+		return attr;
+	}
+	else
+	{
+		columns[col].attr->IncRef();
+		return columns[col].attr;
+	}
+}
+
+
+
+wxString sqlCellAttr::Quote(pgConn *conn, const wxString &value)
+{
+	wxString str;
+	if (value.IsEmpty())
+		str = wxT("NULL");
+	else if (numeric)
+		str = conn->qtDbString(value);
+	else if (value == wxT("\\'\\'"))
+		str = conn->qtDbString(wxT("''"));
+	else if (value == wxT("''"))
+		str = wxT("''");
+	else if (type == PGOID_TYPE_BOOL)
+		str = value;
+	else if (type == PGOID_TYPE_BIT)
+		// Don't cast this one
 		return wxT("B'") + value + wxT("'");
 	else
 		str = conn->qtDbString(value);
@@ -3222,8 +4229,60 @@ int sqlCellAttr::precision()
 }
 
 
-cacheLinePool::cacheLinePool(int initialLines)
+cacheCellArena::cacheCellArena(int columns)
+{
+	nCols = columns;
+	chunkUsed = CACHE_CHUNK_LINES;
+}
+
+
+cacheCellArena::~cacheCellArena()
+{
+	size_t i;
+	for (i = 0 ; i < chunks.GetCount() ; i++)
+		delete[] chunks[i];
+}
+
+
+wxString *cacheCellArena::Alloc()
+{
+	if (!freeCells.IsEmpty())
+	{
+		wxString *cells = freeCells.Last();
+		freeCells.RemoveAt(freeCells.GetCount() - 1);
+		return cells;
+	}
+
+	if (chunkUsed == CACHE_CHUNK_LINES)
+	{
+		// at least one cell, for tables without columns
+		chunks.Add(new wxString[(nCols ? nCols : 1) * CACHE_CHUNK_LINES]);
+		chunkUsed = 0;
+	}
+	return chunks.Last() + nCols * chunkUsed++;
+}
+
+
+void cacheCellArena::Release(wxString *cells)
+{
+	int i;
+	for (i = 0 ; i < nCols ; i++)
+		cells[i] = wxEmptyString;
+	freeCells.Add(cells);
+}
+
+
+
+cacheLinePool::cacheLinePool(int initialLines, cacheCellArena *cells, size_t maxCachedBytes)
 {
+	arena = cells;
+	chunkUsed = CACHE_CHUNK_LINES;
+	cachedHead = 0;
+	cachedBytes = 0;
+	maxBytes = maxCachedBytes;
+	dropped = false;
+	pinned = 0;
+
 	ptr = new cacheLine*[initialLines];
 	if (ptr)
 	{
@@ -3241,15 +4300,50 @@ cacheLinePool::cacheLinePool(int initialLines)
 
 cacheLinePool::~cacheLinePool()
 {
+	// The cells belong to the arena
+	size_t i;
+	for (i = 0 ; i < chunks.GetCount() ; i++)
+		delete[] chunks[i];
+
 	if (ptr)
-	{
-		while (anzLines--)
-		{
-			if (ptr[anzLines])
-				delete ptr[anzLines];
-		}
 		delete[] ptr;
+}
+
+
+
+cacheLine *cacheLinePool::NewLine()
+{
+	if (!freeLines.IsEmpty())
+	{
+		cacheLine *line = freeLines.Last();
+		freeLines.RemoveAt(freeLines.GetCount() - 1);
+		return line;
+	}
+
+	if (chunkUsed == CACHE_CHUNK_LINES)
+	{
+		chunks.Add(new cacheLine[CACHE_CHUNK_LINES]);
+		chunkUsed = 0;
 	}
+	return chunks.Last() + chunkUsed++;
+}
+
+
+
+void cacheLinePool::FreeLine(cacheLine *line)
+{
+	if (line->cols)
+		arena->Release(line->cols);
+	if (line->original)
+		delete[] line->original;
+
+	line->cols = 0;
+	line->original = 0;
+	line->stored = false;
+	line->readOnly = false;
+	line->pending = false;
+	line->cached = false;
+	freeLines.Add(line);
 }
 
 
@@ -3258,21 +4352,14 @@ void cacheLinePool::Delete(int lineNo)
 {
 	if (ptr && lineNo >= 0 && lineNo < anzLines)
 	{
-#if 1
 		if (ptr[lineNo])
-			delete ptr[lineNo];
+			FreeLine(ptr[lineNo]);
 
 		if (lineNo < anzLines - 1)
 		{
 			// beware: overlapping copy
 			memmove(ptr + lineNo, ptr + lineNo + 1, sizeof(cacheLine *) * (anzLines - lineNo - 1));
 		}
-#else
-		cacheLine *c;
-		c = ptr[0];
-		ptr[0] = ptr[1];
-		ptr[1] = c;
-#endif
 		ptr[anzLines - 1] = 0;
 	}
 }
@@ -3284,9 +4371,10 @@ cacheLine *cacheLinePool::Get(int lineNo)
 
 	if (lineNo >= anzLines)
 	{
+		// Grow geometrically, so appending many lines stays linear
 		cacheLine **old = ptr;
 		int oldAnz = anzLines;
-		anzLines = lineNo + 100;
+		anzLines = wxMax(lineNo + 1, wxMax(oldAnz * 2, 16));
 		ptr = new cacheLine*[anzLines];
 		if (!ptr)
 		{
@@ -3300,14 +4388,14 @@ cacheLine *cacheLinePool::Get(int lineNo)
 				memcpy(ptr, old, sizeof(cacheLine *)*oldAnz);
 				delete[] old;
 			}
-			memset(ptr + oldAnz, 0, anzLines - oldAnz);
+			memset(ptr + oldAnz, 0, sizeof(cacheLine *) * (anzLines - oldAnz));
 		}
 	}
 
 	if (lineNo < anzLines)
 	{
 		if (!ptr[lineNo])
-			ptr[lineNo] = new cacheLine();
+			ptr[lineNo] = NewLine();
 		return ptr[lineNo];
 	}
 	return 0;
@@ -3316,7 +4404,50 @@ cacheLine *cacheLinePool::Get(int lineNo)
 
 bool cacheLinePool::IsFilled(int lineNo)
 {
-	return (lineNo < anzLines && ptr[lineNo]);
+	return (lineNo >= 0 && lineNo < anzLines && ptr[lineNo]);
+}
+
+
+void cacheLinePool::SetCached(int lineNo)
+{
+	if (!maxBytes || !IsFilled(lineNo))
+		return;
+
+	cacheLine *line = ptr[lineNo];
+	line->cached = true;
+
+	// roughly what the line takes, strings have some overhead of their own
+	size_t size = sizeof(cacheLine);
+	int i;
+	for (i = 0 ; i < arena->GetColumns() ; i++)
+		size += sizeof(wxString) + 16 + line->cols[i].Length() * sizeof(wxChar);
+
+	cachedLines.Add(lineNo);
+	cachedSizes.Add((int)size);
+	cachedBytes += size;
+
+	// Drop the lines read longest ago, which weren't changed since;
+	// never the one just read, which the caller is still using
+	while (!pinned && cachedBytes > maxBytes && cachedHead < cachedLines.GetCount() - 1)
+	{
+		int n = cachedLines[cachedHead];
+		cachedBytes -= cachedSizes[cachedHead];
+		cachedHead++;
+
+		if (ptr[n] && ptr[n]->cached)
+		{
+			FreeLine(ptr[n]);
+			ptr[n] = 0;
+			dropped = true;
+		}
+	}
+
+	if (cachedHead > 1024 && cachedHead > cachedLines.GetCount() / 2)
+	{
+		cachedLines.RemoveAt(0, cachedHead);
+		cachedSizes.RemoveAt(0, cachedHead);
+		cachedHead = 0;
+	}
 }
 
 
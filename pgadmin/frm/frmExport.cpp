@@ -14,6 +14,7 @@
 // App headers
 #include "pgAdmin3.h"
 #include <wx/file.h>
+#include <wx/progdlg.h>
 #include "frm/frmExport.h"
 #include "utils/sysSettings.h"
 #include "utils/misc.h"
@@ -32,6 +33,9 @@
 #define cbColSeparator  CTRL_COMBOBOX("cbColSeparator")
 #define cbQuoteChar     CTRL_COMBOBOX("cbQuoteChar")
 
+// Rows read from COPY are collected up to this size before writing them
+#define EXPORT_BUFFER_SIZE  (1024 * 1024)
+
 
 BEGIN_EVENT_TABLE(frmExport, pgDialog)
 	EVT_TEXT(XRCID("txtFilename"),          frmExport::OnChange)
@@ -217,33 +221,37 @@ bool frmExport::Export(pgSet *set)
 	}
 
 
+	// Read the options once, not for every value
+	wxString colSeparator = cbColSeparator->GetValue();
+	wxString qc = cbQuoteChar->GetValue();
+	wxString eol = rbCRLF->GetValue() ? wxT("\r\n") : wxT("\n");
+	bool quoteAll = rbQuoteAll->GetValue();
+	bool quoteStrings = rbQuoteStrings->GetValue();
+	bool unicode = rbUnicode->GetValue();
+
 	wxString text;
+	const wxChar *val;
+	size_t len;
 	OID typOid;
 
 	int row;
 	for (row = 0 ; row < rowCount ; row++)
 	{
+		line.Empty();
+
 		for (col = 0 ; col < colCount ; col++)
 		{
-			if (!col)
-				line = wxEmptyString;
-			else
-				line += cbColSeparator->GetValue();
+			if (col)
+				line += colSeparator;
 
-			bool needQuote = rbQuoteAll->GetValue();
+			bool needQuote = quoteAll;
 
 			if (set)
-			{
-				text = set->GetVal(col);
 				typOid = set->ColTypClass(col);
-			}
 			else
-			{
-				text = grid->OnGetItemText(row, col + 1);
 				typOid = grid->colTypClasses[col];
-			}
 
-			if (!needQuote && rbQuoteStrings->GetValue())
+			if (!needQuote && quoteStrings)
 			{
 				// find out if string
 				switch (typOid)
@@ -256,21 +264,34 @@ bool frmExport::Export(pgSet *set)
 						break;
 				}
 			}
+
+			if (set && !needQuote)
+			{
+				// Append the converted value directly
+				val = set->GetValPtr(col, len);
+				if (val)
+					line.Append(val, len);
+				continue;
+			}
+
+			if (set)
+				text = set->GetVal(col);
+			else
+				text = grid->OnGetItemText(row, col + 1);
+
 			if (needQuote)
 			{
-				wxString qc = cbQuoteChar->GetValue();
 				text.Replace(qc, qc + qc);
-				line += qc + text + qc;
+				line += qc;
+				line += text;
+				line += qc;
 			}
 			else
 				line += text;
 		}
-		if (rbCRLF->GetValue())
-			line += wxT("\r\n");
-		else
-			line += wxT("\n");
+		line += eol;
 
-		if (rbUnicode->GetValue())
+		if (unicode)
 			file.Write(line, wxConvUTF8);
 		else
 		{
@@ -278,7 +299,7 @@ bool frmExport::Export(pgSet *set)
 			if (!buf)
 				skipped++;
 			else
-				file.Write(line, wxConvLibc);
+				file.Write((const char *)buf, strlen(buf));
 		}
 
 		if (set)
@@ -298,6 +319,231 @@ bool frmExport::Export(pgSet *set)
 }
 
 
+bool frmExport::PrepareCopy(pgConn *conn, const wxString &query)
+{
+	copyQuery = wxEmptyString;
+	copyHeader = wxEmptyString;
+
+	// COPY (query) TO needs 8.2, and can't quote by data type on its own
+	// (the string columns are forced below), nor write multi-character or
+	// non-ASCII separators
+	if (!conn || !conn->BackendMinimumVersion(8, 2))
+		return false;
+
+	wxString colSeparator = cbColSeparator->GetValue();
+	wxString qc = cbQuoteChar->GetValue();
+	bool quoteAll = rbQuoteAll->GetValue();
+	bool quoteStrings = rbQuoteStrings->GetValue();
+
+	// CSV always has a quote character; without quoting it is only used
+	// for values that contain a separator, quote or line break
+	if (!quoteAll && !quoteStrings && qc.Length() != 1)
+		qc = wxT("\"");
+
+	if (colSeparator.Length() != 1 || qc.Length() != 1 || colSeparator == qc ||
+	        !colSeparator.IsAscii() || !qc.IsAscii() ||
+	        colSeparator == wxT("\r") || colSeparator == wxT("\n") || colSeparator == wxT("\\"))
+		return false;
+
+	// Only a single SELECT, VALUES, TABLE or WITH query; anything with a
+	// semicolon left inside is treated as a script
+	wxString sql = query;
+	sql.Trim(true).Trim(false);
+	while (sql.EndsWith(wxT(";")))
+	{
+		sql.RemoveLast();
+		sql.Trim(true);
+	}
+	if (sql.IsEmpty() || sql.Find(';') >= 0)
+		return false;
+
+	size_t wordlen = 0;
+	while (wordlen < sql.Length() && wxIsalpha(sql.GetChar(wordlen)))
+		wordlen++;
+
+	wxString keyword = sql.Left(wordlen).Lower();
+	if (keyword != wxT("select") && keyword != wxT("values") && keyword != wxT("table") && keyword != wxT("with"))
+		return false;
+
+	int txStatus = conn->GetTxStatus();
+	if (txStatus != PGCONN_TXSTATUS_IDLE && txStatus != PGCONN_TXSTATUS_INTRANS)
+		return false;
+
+	// Find the names and types of the columns without running the query.
+	// This also weeds out SELECT INTO and data-modifying WITH queries, which
+	// can't be copied; a savepoint keeps a failure from aborting the
+	// transaction the query will run in
+	bool inTransaction = (txStatus == PGCONN_TXSTATUS_INTRANS);
+	if (inTransaction && !conn->ExecuteVoid(wxT("SAVEPOINT pgadmin_export"), false))
+		return false;
+
+	pgSet *set = conn->ExecuteSet(wxT("SELECT * FROM (") + sql + wxT("\n) AS export LIMIT 0"), false);
+	bool probed = set && conn->GetLastResultStatus() == PGRES_TUPLES_OK && set->NumCols() > 0;
+
+	if (inTransaction)
+	{
+		if (!probed)
+			conn->ExecuteVoid(wxT("ROLLBACK TO SAVEPOINT pgadmin_export"), false);
+		conn->ExecuteVoid(wxT("RELEASE SAVEPOINT pgadmin_export"), false);
+	}
+
+	if (!probed)
+	{
+		if (set)
+			delete set;
+		return false;
+	}
+
+	wxString forceQuote;
+	wxStringToStringHashMap colNames;
+	int col;
+
+	for (col = 0 ; col < set->NumCols() ; col++)
+	{
+		wxString colName = set->ColName(col);
+
+		// FORCE QUOTE names the columns, so they must be unique
+		if (colNames.find(colName) != colNames.end())
+		{
+			delete set;
+			return false;
+		}
+		colNames[colName] = colName;
+
+		bool needQuote = quoteAll;
+		if (!needQuote && quoteStrings)
+		{
+			switch (set->ColTypClass(col))
+			{
+				case PGTYPCLASS_NUMERIC:
+				case PGTYPCLASS_BOOL:
+					break;
+				default:
+					needQuote = true;
+					break;
+			}
+		}
+
+		if (needQuote)
+		{
+			if (!forceQuote.IsEmpty())
+				forceQuote += wxT(", ");
+			forceQuote += qtIdent(colName);
+		}
+
+		// The header is written by us, quoted the same way as Export(pgSet*)
+		if (chkColnames->GetValue())
+		{
+			if (col)
+				copyHeader += colSeparator;
+
+			if (quoteAll || quoteStrings)
+			{
+				wxString hdr = colName;
+				hdr.Replace(qc, qc + qc);
+				copyHeader += qc + hdr + qc;
+			}
+			else
+				copyHeader += colName;
+		}
+	}
+	delete set;
+
+	if (chkColnames->GetValue())
+		copyHeader += rbCRLF->GetValue() ? wxT("\r\n") : wxT("\n");
+
+	copyQuery = wxT("COPY (") + sql + wxT("\n) TO STDOUT WITH DELIMITER ") + conn->qtDbString(colSeparator)
+	            + wxT(" CSV QUOTE ") + conn->qtDbString(qc);
+	if (!forceQuote.IsEmpty())
+		copyQuery += wxT(" FORCE QUOTE ") + forceQuote;
+
+	return true;
+}
+
+
+bool frmExport::Export(pgConn *conn, long &rows)
+{
+	rows = 0;
+
+	if (copyQuery.IsEmpty())
+		return false;
+
+	wxLogInfo(wxT("Exporting data with COPY"));
+
+	wxFile file(txtFilename->GetValue(), wxFile::write);
+	if (!file.IsOpened())
+	{
+		wxLogError(__("Failed to open file %s."), txtFilename->GetValue().c_str());
+		return false;
+	}
+
+	if (!conn->StartCopyOut(copyQuery))
+		return false;
+
+	exportCopyThread *thread = new exportCopyThread(conn, &file, copyHeader, rbUnicode->GetValue(), rbCRLF->GetValue());
+	if (thread->Create() != wxTHREAD_NO_ERROR)
+	{
+		delete thread;
+
+		// Leave the connection usable
+		conn->CancelExecution();
+		char *data;
+		while (conn->GetCopyData(&data) >= 0)
+			conn->FreeCopyData(data);
+		conn->GetCopyFinalStatus();
+		return false;
+	}
+	thread->Run();
+
+	wxProgressDialog progress(_("Export data"), _("Exporting data."), 100, parent,
+	                          wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME);
+
+	bool cancelled = false;
+	wxULongLong bytes;
+
+	while (thread->IsRunning())
+	{
+		wxMilliSleep(100);
+
+		thread->GetProgress(rows, bytes);
+		if (!cancelled && !progress.Pulse(wxString::Format(
+		                                      wxPLURAL("%ld row written (%s).", "%ld rows written (%s).", rows),
+		                                      rows, wxFileName::GetHumanReadableSize(bytes).c_str())))
+		{
+			cancelled = true;
+			conn->CancelExecution();
+		}
+	}
+	thread->Wait();
+	thread->GetProgress(rows, bytes);
+
+	bool writeFailed = thread->WriteFailed();
+	long skipped = thread->GetSkipped();
+	delete thread;
+
+	bool copied = conn->GetCopyFinalStatus();
+	file.Close();
+
+	if (writeFailed)
+	{
+		wxLogError(__("Failed to write file %s."), txtFilename->GetValue().c_str());
+		return false;
+	}
+	if (!copied || cancelled)
+		return false;
+
+	if (skipped)
+		wxLogError(wxPLURAL(
+		               "Data export incomplete.\n\n%d row contained characters that could not be converted to the local charset.\n\nPlease correct the data or try using UTF8 instead.",
+		               "Data export incomplete.\n\n%d rows contained characters that could not be converted to the local charset.\n\nPlease correct the data or try using UTF8 instead.",
+		               skipped), skipped);
+	else
+		wxMessageBox(_("Data export completed successfully."), _("Export data"), wxICON_INFORMATION | wxOK);
+
+	return true;
+}
+
+
 void frmExport::OnCancel(wxCommandEvent &ev)
 {
 	if (IsModal())
@@ -333,3 +579,120 @@ void frmExport::OnBrowseFile(wxCommandEvent &ev)
 		OnChange(ev);
 	}
 }
+
+
+
+exportCopyThread::exportCopyThread(pgConn *_conn, wxFile *_file, const wxString &_header, bool _unicode, bool _crlf)
+	: wxThread(wxTHREAD_JOINABLE)
+{
+	conn = _conn;
+	file = _file;
+	header = _header;
+	unicode = _unicode;
+	crlf = _crlf;
+	writeFailed = false;
+	skipped = 0;
+	rows = 0;
+
+	// The rows arrive in the client encoding; copy them as they are when
+	// that is what the file wants
+	passThrough = unicode && conn->GetConv() == &wxConvUTF8;
+
+	if (unicode)
+		fileConv = &wxConvUTF8;
+	else
+		fileConv = &wxConvLibc;
+}
+
+
+void *exportCopyThread::Entry()
+{
+	if (!header.IsEmpty())
+	{
+		wxCharBuffer buf = header.mb_str(*fileConv);
+		if (buf)
+			Write(buf, strlen(buf));
+	}
+
+	char *data;
+	int len;
+
+	while ((len = conn->GetCopyData(&data)) >= 0)
+	{
+		// After a failed write, only drain what the server still sends
+		if (!writeFailed && len > 0)
+		{
+			WriteRow(data, len);
+			if (writeFailed)
+				conn->CancelExecution();
+		}
+		conn->FreeCopyData(data);
+	}
+
+	Flush();
+
+	return NULL;
+}
+
+
+void exportCopyThread::WriteRow(const char *data, size_t len)
+{
+	// Every CSV row comes with its own trailing newline
+	if (len && data[len - 1] == '\n')
+		len--;
+
+	if (passThrough)
+		Write(data, len);
+	else
+	{
+		wxString row(data, *conn->GetConv(), len);
+		wxCharBuffer buf = row.mb_str(*fileConv);
+		if ((len && row.IsEmpty()) || !buf)
+		{
+			wxCriticalSectionLocker lock(progressLock);
+			skipped++;
+			return;
+		}
+		Write(buf, strlen(buf));
+	}
+
+	if (crlf)
+		Write("\r\n", 2);
+	else
+		Write("\n", 1);
+
+	wxCriticalSectionLocker lock(progressLock);
+	rows++;
+}
+
+
+void exportCopyThread::Write(const char *data, size_t len)
+{
+	if (buffer.GetDataLen() + len > EXPORT_BUFFER_SIZE)
+		Flush();
+
+	buffer.AppendData((void *)data, len);
+}
+
+
+void exportCopyThread::Flush()
+{
+	size_t len = buffer.GetDataLen();
+	if (!len || writeFailed)
+		return;
+
+	if (file->Write(buffer.GetData(), len) != len)
+		writeFailed = true;
+	buffer.SetDataLen(0);
+
+	wxCriticalSectionLocker lock(progressLock);
+	bytes += len;
+}
+
+
+void exportCopyThread::GetProgress(long &rowCount, wxULongLong &byteCount)
+{
+	wxCriticalSectionLocker lock(progressLock);
+	rowCount = rows;
+	byteCount = bytes;
+}
@@ -43,11 +43,20 @@
 #define gauge                         CTRL_GAUGE("gauge")
 #define lstColumnsToImport			  CTRL_CHECKLISTBOX("lstColumnsToImport")
 #define lstIgnoreForColumns			  CTRL_CHECKLISTBOX("lstIgnoreForColumns")
+#define cbStreams                     CTRL_COMBOBOX("cbStreams")
+#define chkSingleTransaction          CTRL_CHECKBOX("chkSingleTransaction")
+#define stProgress                    CTRL_STATIC("stProgress")
+
+// The file is read in pieces of this size, and sent in blocks of the whole
+// records they contain
+#define IMPORT_BLOCK_SIZE             (1024 * 1024)
 
 
 BEGIN_EVENT_TABLE(frmImport, pgDialog)
 	EVT_COMBOBOX(XRCID("cbFormat"),   frmImport::OnChangeFormat)
+	EVT_CHECKBOX(XRCID("chkSingleTransaction"), frmImport::OnChangeFormat)
 	EVT_BUTTON(wxID_OK,               frmImport::OnOK)
+	EVT_BUTTON(wxID_CANCEL,           frmImport::OnCancel)
 	EVT_BUTTON (wxID_HELP,            frmImport::OnHelp)
 END_EVENT_TABLE()
 
@@ -58,6 +67,8 @@ frmImport::frmImport(frmMain *form, pgObject *_object, pgConn *_conn)
 	connection = _conn;
 	object = _object;
 	done = false;
+	importing = false;
+	cancelled = false;
 
 	// Set-up window
 	SetFont(settings->GetSystemFont());
@@ -151,6 +162,19 @@ void frmImport::OnChangeFormat(wxCommandEvent &ev)
 	cbQuote->Enable(enabled);
 	cbEscape->Enable(enabled);
 	lstIgnoreForColumns->Enable(enabled);
+
+	// Parallel streams can't share a transaction, and binary files can't
+	// be split between them
+	cbStreams->Enable(cbFormat->GetValue() != wxT("binary") && !chkSingleTransaction->GetValue());
+}
+
+
+void frmImport::OnCancel(wxCommandEvent &ev)
+{
+	if (importing)
+		cancelled = true;
+	else
+		ev.Skip();
 }
 
 
@@ -163,9 +187,10 @@ void frmImport::OnOK(wxCommandEvent &ev)
 	bool someColumnsToIgnoreForNulls = false;
 	wxFileName fn;
 	wxFile *file;
-	bool copydone = false;
-	bool goterror = false;
-	int nCount = 8192;
+
+	// The dialogue is kept responsive while importing
+	if (importing)
+		return;
 
 	if (!done)
 	{
@@ -226,8 +251,6 @@ void frmImport::OnOK(wxCommandEvent &ev)
 				query += wxT(", NULL ") + connection->qtDbString(txtNull->GetValue());
 			if (cbFormat->GetValue() == wxT("csv"))
 			{
-				if (chkHeader->GetValue())
-					query += wxT(", HEADER");
 				if (!cbQuote->GetValue().IsEmpty())
 					query += wxT(", QUOTE ") + connection->qtDbString(cbQuote->GetValue());
 				if (!cbEscape->GetValue().IsEmpty())
@@ -256,8 +279,6 @@ void frmImport::OnOK(wxCommandEvent &ev)
 			if (cbFormat->GetValue() == wxT("csv"))
 			{
 				query += wxT("CSV ");
-				if (connection->BackendMinimumVersion(8, 0) && chkHeader->GetValue())
-					query += wxT("HEADER ");
 				if (connection->BackendMinimumVersion(8, 0) && !cbQuote->GetValue().IsEmpty())
 					query += wxT("QUOTE ") + connection->qtDbString(cbQuote->GetValue());
 				if (connection->BackendMinimumVersion(8, 0) && !cbEscape->GetValue().IsEmpty())
@@ -280,79 +301,513 @@ void frmImport::OnOK(wxCommandEvent &ev)
 		fn = wxFileName(pickerImportfile->GetPath());
 		file = new wxFile(fn.GetFullPath(), wxFile::read);
 
-		// Set range for gauge
-		gauge->SetRange(file->Length());
+		bool copied = RunCopy(query, file);
+
+		// Close CSV file
+		file->Close();
+		delete file;
 
-		// Start COPY
-		if (!connection->StartCopy(query))
+		if (copied)
 		{
-			goterror = true;
+			btnOK->SetLabel(wxT("Done"));
+			done = true;
 		}
+	}
+	else
+	{
+		Close();
+	}
+}
 
-		// Send COPY data
-		while (!copydone && !goterror)
-		{
-			// Read a buffer
-			char *buffer = new char[nCount + 4];
-			memset(buffer, 0, nCount + 4);
-			off_t len = file->Read(buffer, nCount);
+bool frmImport::RunCopy(const wxString &query, wxFile *file)
+{
+	int format = IMPORT_TEXT;
+	if (cbFormat->GetValue() == wxT("csv"))
+		format = IMPORT_CSV;
+	else if (cbFormat->GetValue() == wxT("binary"))
+		format = IMPORT_BINARY;
+
+	// The reader must find the same quotes and escapes as COPY does
+	char quote = '"', escape;
+	if (!cbQuote->GetValue().IsEmpty())
+	{
+		wxCharBuffer buf = cbQuote->GetValue().mb_str(*connection->GetConv());
+		if (buf)
+			quote = ((const char *)buf)[0];
+	}
+	escape = quote;
+	if (!cbEscape->GetValue().IsEmpty())
+	{
+		wxCharBuffer buf = cbEscape->GetValue().mb_str(*connection->GetConv());
+		if (buf)
+			escape = ((const char *)buf)[0];
+	}
+
+	long streamCount = 1;
+	if (cbStreams->IsEnabled())
+		cbStreams->GetValue().ToLong(&streamCount);
+	if (streamCount < 1)
+		streamCount = 1;
+
+	// Start a COPY on every stream; the first one uses the dialogue's own
+	// connection. Each parallel stream commits on its own
+	importQueue queue(streamCount * 2);
+	importStreamThreadArray streams;
+	bool goterror = false;
+	long i;
 
-			// If we read something, send it to the server
-			if (len > 0)
+	for (i = 0 ; i < streamCount ; i++)
+	{
+		pgConn *conn = connection;
+		if (i)
+		{
+			conn = connection->Duplicate();
+			if (conn->GetStatus() != PGCONN_OK)
 			{
-				if (!connection->PutCopyData(buffer, len))
-				{
-					goterror = true;
-				}
-				else
-				{
-					gauge->SetValue(gauge->GetValue() + len);
-					Update();
-				}
+				wxLogInfo(wxT("Could not open import stream %ld, using %ld"), i + 1, i);
+				delete conn;
+				break;
 			}
+		}
+
+		if (!conn->StartCopy(query))
+		{
+			if (i)
+				delete conn;
+			goterror = true;
+			break;
+		}
+
+		streams.Add(new importStreamThread(conn, &queue));
+	}
+
+	importReaderThread *reader = new importReaderThread(file, &queue, format, quote, escape,
+	        format == IMPORT_CSV && chkHeader->GetValue());
+
+	if (!goterror && reader->Create() != wxTHREAD_NO_ERROR)
+		goterror = true;
+	for (i = 0 ; !goterror && i < (long)streams.GetCount() ; i++)
+	{
+		if (streams.Item(i)->Create() != wxTHREAD_NO_ERROR)
+			goterror = true;
+	}
+
+	if (!goterror)
+	{
+		reader->Run();
+		for (i = 0 ; i < (long)streams.GetCount() ; i++)
+			streams.Item(i)->Run();
+
+		// Another click on OK must not start a second COPY on the connection
+		importing = true;
+		cancelled = false;
+		btnOK->Disable();
+		wxFileOffset fileLength = file->Length();
+		wxLongLong startTime = wxGetLocalTimeMillis();
+		gauge->SetRange(1000);
+		gauge->SetValue(0);
+
+		bool running = true;
+		while (running)
+		{
+			wxMilliSleep(100);
 
-			// If we read nothing, we're done
-			copydone = len == 0;
+			running = reader->IsRunning();
+			for (i = 0 ; i < (long)streams.GetCount() ; i++)
+				running = running || streams.Item(i)->IsRunning();
 
-			// Clean the buffer
-			delete[] buffer;
+			if (cancelled)
+				queue.Abort();
+
+			ShowProgress(streams, reader->GetBytesRead(), fileLength, wxGetLocalTimeMillis() - startTime);
+
+			// Keep the Cancel button working
+			wxSafeYield(this);
 		}
+		importing = false;
+		btnOK->Enable();
 
-		// Close CSV file
-		file->Close();
+		reader->Wait();
+		for (i = 0 ; i < (long)streams.GetCount() ; i++)
+		{
+			streams.Item(i)->Wait();
+			if (streams.Item(i)->Failed())
+				goterror = true;
+		}
 
-		// End COPY
+		if (cancelled || reader->ReadFailed())
+			goterror = true;
+	}
+	delete reader;
+
+	// End all the streams before collecting their results, so that a
+	// failure stops the others committing as far as possible
+	for (i = 0 ; i < (long)streams.GetCount() ; i++)
+	{
+		pgConn *conn = streams.Item(i)->GetConnection();
 		if (goterror)
+			conn->EndPutCopy(_("Copy failed!"));
+		else if (!conn->EndPutCopy(wxT("")))
+			goterror = true;
+	}
+
+	wxString errors;
+	for (i = 0 ; i < (long)streams.GetCount() ; i++)
+	{
+		pgConn *conn = streams.Item(i)->GetConnection();
+		if (!conn->GetCopyFinalStatus())
 		{
-			connection->EndPutCopy(_("Copy failed!"));
+			goterror = true;
+			if (errors.IsEmpty())
+				errors = conn->GetLastError();
 		}
+
+		if (conn != connection)
+			delete conn;
+		delete streams.Item(i);
+	}
+
+	if (goterror)
+	{
+		if (errors.IsEmpty())
+			errors = connection->GetLastError();
+		if (cancelled)
+			wxLogError(_("Copy cancelled."));
 		else
+			wxLogError(_("Copy failed!\n") + errors);
+	}
+
+	return !goterror;
+}
+
+
+void frmImport::ShowProgress(importStreamThreadArray &streams, wxFileOffset bytesRead, wxFileOffset fileLength, wxLongLong elapsed)
+{
+	if (fileLength > 0)
+		gauge->SetValue((int)(bytesRead * 1000 / fileLength));
+
+	long msecs = elapsed.ToLong();
+	if (msecs <= 0)
+		return;
+
+	wxString progress;
+	for (size_t i = 0 ; i < streams.GetCount() ; i++)
+	{
+		wxFileOffset rate = streams.Item(i)->GetBytesSent() * 1000 / msecs;
+
+		if (!progress.IsEmpty())
+			progress += wxT("   ");
+		progress += wxString::Format(_("Stream %d: %s/s"), (int)i + 1,
+		                             wxFileName::GetHumanReadableSize(wxULongLong(rate)).c_str());
+	}
+	stProgress->SetLabel(progress);
+	Update();
+}
+
+
+importQueue::importQueue(size_t _maxBlocks)
+	: changed(lock)
+{
+	maxBlocks = _maxBlocks;
+	closed = false;
+	aborted = false;
+}
+
+
+importQueue::~importQueue()
+{
+	for (size_t i = 0 ; i < blocks.GetCount() ; i++)
+		delete blocks.Item(i);
+}
+
+
+// Takes ownership of the block, and waits for room for it
+bool importQueue::Push(wxMemoryBuffer *block)
+{
+	wxMutexLocker locker(lock);
+
+	while (!aborted && blocks.GetCount() >= maxBlocks)
+		changed.Wait();
+
+	if (aborted)
+	{
+		delete block;
+		return false;
+	}
+
+	blocks.Add(block);
+	changed.Broadcast();
+	return true;
+}
+
+
+// Returns NULL when the data has run out, or the import was aborted
+wxMemoryBuffer *importQueue::Pop()
+{
+	wxMutexLocker locker(lock);
+
+	while (!aborted && !closed && blocks.IsEmpty())
+		changed.Wait();
+
+	if (aborted || blocks.IsEmpty())
+		return NULL;
+
+	wxMemoryBuffer *block = blocks.Item(0);
+	blocks.RemoveAt(0);
+	changed.Broadcast();
+	return block;
+}
+
+
+void importQueue::Close()
+{
+	wxMutexLocker locker(lock);
+	closed = true;
+	changed.Broadcast();
+}
+
+
+void importQueue::Abort()
+{
+	wxMutexLocker locker(lock);
+	aborted = true;
+	changed.Broadcast();
+}
+
+
+bool importQueue::IsAborted()
+{
+	wxMutexLocker locker(lock);
+	return aborted;
+}
+
+
+importReaderThread::importReaderThread(wxFile *_file, importQueue *_queue, int _format, char _quote, char _escape, bool _skipHeader)
+	: wxThread(wxTHREAD_JOINABLE)
+{
+	file = _file;
+	queue = _queue;
+	format = _format;
+	quote = _quote;
+	escape = _escape;
+	skipHeader = _skipHeader;
+	readFailed = false;
+	inQuotes = false;
+	afterEscape = false;
+	bytesRead = 0;
+}
+
+
+void *importReaderThread::Entry()
+{
+	wxMemoryBuffer *block = new wxMemoryBuffer(IMPORT_BLOCK_SIZE * 2);
+	size_t used = 0, scanned = 0;
+
+	while (!queue->IsAborted())
+	{
+		// Read the next piece behind the partial record left over
+		char *data = (char *)block->GetWriteBuf(used + IMPORT_BLOCK_SIZE);
+		ssize_t len = file->Read(data + used, IMPORT_BLOCK_SIZE);
+		if (len == wxInvalidOffset)
 		{
-			goterror = !connection->EndPutCopy(wxT(""));
+			block->UngetWriteBuf(used);
+			readFailed = true;
+			break;
 		}
+		used += len;
+		block->UngetWriteBuf(used);
 
-		// Get final status of the COPY command
-		if (!connection->GetCopyFinalStatus())
 		{
-			goterror = true;
+			wxCriticalSectionLocker lock(progressLock);
+			bytesRead += len;
 		}
 
-		if (goterror)
+		if (!len)
+			break;
+
+		if (format == IMPORT_BINARY)
 		{
-			wxLogError(_("Copy failed!\n") + connection->GetLastError());
+			queue->Push(block);
+			block = new wxMemoryBuffer(IMPORT_BLOCK_SIZE * 2);
+			used = 0;
+			continue;
 		}
-		else
+
+		if (skipHeader)
 		{
-			btnOK->SetLabel(wxT("Done"));
-			done = true;
+			size_t end = ScanRecords(data, scanned, used, true);
+			if (!end)
+			{
+				scanned = used;
+				continue;
+			}
+
+			// Drop the header line
+			memmove(data, data + end, used - end);
+			used -= end;
+			block->SetDataLen(used);
+			scanned = 0;
+			skipHeader = false;
 		}
+
+		size_t cut = ScanRecords(data, scanned, used, false);
+		scanned = used;
+
+		// Keep reading until a record ends
+		if (!cut)
+			continue;
+
+		// Send the whole records, and keep the partial one for the next block
+		wxMemoryBuffer *next = new wxMemoryBuffer(IMPORT_BLOCK_SIZE * 2);
+		next->AppendData(data + cut, used - cut);
+		block->SetDataLen(cut);
+		used -= cut;
+		scanned = used;
+
+		queue->Push(block);
+		block = next;
 	}
+
+	// The last record may have no line end; a lone header line is dropped
+	if (!readFailed && used && !skipHeader)
+		queue->Push(block);
+	else
+		delete block;
+
+	if (readFailed)
+		queue->Abort();
 	else
+		queue->Close();
+
+	return NULL;
+}
+
+
+// Scans data[start..len) for record ends, carrying the quoting state on
+// from the previous call. Returns the offset after the last record end
+// found (or the first, when asked to), or 0 if there is none
+size_t importReaderThread::ScanRecords(const char *data, size_t start, size_t len, bool first)
+{
+	size_t boundary = 0;
+
+	for (size_t pos = start ; pos < len ; pos++)
 	{
-		Close();
+		char c = data[pos];
+
+		if (format == IMPORT_CSV)
+		{
+			if (inQuotes)
+			{
+				if (afterEscape)
+				{
+					afterEscape = false;
+
+					// An escaped quote or escape character is data
+					if (c == quote || c == escape)
+						continue;
+
+					// When they are the same, the previous one closed the value
+					if (escape == quote)
+						inQuotes = false;
+				}
+				else if (c == escape)
+				{
+					afterEscape = true;
+					continue;
+				}
+				else if (c == quote)
+				{
+					inQuotes = false;
+					continue;
+				}
+
+				if (inQuotes)
+					continue;
+			}
+
+			if (c == quote)
+			{
+				inQuotes = true;
+				continue;
+			}
+		}
+		else
+		{
+			// A backslash escapes the next character, line ends included
+			if (afterEscape)
+			{
+				afterEscape = false;
+				continue;
+			}
+			if (c == '\\')
+			{
+				afterEscape = true;
+				continue;
+			}
+		}
+
+		if (c == '\n')
+		{
+			boundary = pos + 1;
+			if (first)
+				return boundary;
+		}
+	}
+
+	return boundary;
+}
+
+
+wxFileOffset importReaderThread::GetBytesRead()
+{
+	wxCriticalSectionLocker lock(progressLock);
+	return bytesRead;
+}
+
+
+importStreamThread::importStreamThread(pgConn *_conn, importQueue *_queue)
+	: wxThread(wxTHREAD_JOINABLE)
+{
+	conn = _conn;
+	queue = _queue;
+	failed = false;
+	bytesSent = 0;
+}
+
+
+void *importStreamThread::Entry()
+{
+	wxMemoryBuffer *block;
+
+	while ((block = queue->Pop()) != NULL)
+	{
+		size_t len = block->GetDataLen();
+		bool sent = conn->PutCopyData((const char *)block->GetData(), len);
+		delete block;
+
+		if (!sent)
+		{
+			// Stop the reader and the other streams too
+			failed = true;
+			queue->Abort();
+			break;
+		}
+
+		wxCriticalSectionLocker lock(progressLock);
+		bytesSent += len;
 	}
+
+	return NULL;
+}
+
+
+wxFileOffset importStreamThread::GetBytesSent()
+{
+	wxCriticalSectionLocker lock(progressLock);
+	return bytesSent;
 }
 
+
 importFactory::importFactory(menuFactoryList *list, wxMenu *mnu, ctlMenuToolbar *toolbar) : contextActionFactory(list)
 {
 	mnu->Append(id, _("&Import..."), _("Import CSV file into a relation"));
@@ -44,6 +44,8 @@
 #include "ctl/ctlSQLBox.h"
 #include "db/pgConn.h"
 #include "db/pgSet.h"
+#include "db/pgCatalogCache.h"
+#include "db/pgCompletionIndex.h"
 #include "agent/pgaJob.h"
 #include "schema/pgDatabase.h"
 #include "schema/pgServer.h"
@@ -574,6 +576,10 @@ void frmMain::Refresh(pgObject *data)
 				Refresh(eventTrgCol);
 		}
 
+		// The catalog snapshot and completion index get loaded again with their next use
+		pgCatalogCache::Invalidate(data->GetConnection(), true);
+		pgCompletionIndex::Invalidate(data->GetConnection());
+
 		// Scan the child nodes and make a list of those that are expanded
 		// This is not an exact science as node names may change etc.
 		wxArrayString expandedNodes;
@@ -707,6 +713,7 @@ void frmMain::ExpandChildNodes(wxTreeItemId node, wxArrayString &expandedNodes)
 		if (expandedNodes.Index(GetNodePath(child)) != wxNOT_FOUND)
 		{
 			browser->Expand(child);
+			browser->CompleteLoading(child);
 			ExpandChildNodes(child, expandedNodes);
 		}
 
@@ -754,6 +761,7 @@ bool frmMain::SetCurrentNode(wxTreeItemId node, const wxString &origPath)
 				browser->SelectItem(child, true);
 				browser->Expand(child);
 			}
+			browser->CompleteLoading(child);
 
 			if (actNodePath == path)
 			{
@@ -87,6 +87,8 @@
 #define chkIndicateNull             CTRL_CHECKBOX("chkIndicateNull")
 #define txtDecimalMark	            CTRL_TEXT("txtDecimalMark")
 #define chkColumnNames				CTRL_CHECKBOX("chkColumnNames")
+#define chkStreamResults            CTRL_CHECKBOX("chkStreamResults")
+#define txtStreamMaxRows            CTRL_TEXT("txtStreamMaxRows")
 #define txtThousandsSeparator       CTRL_TEXT("txtThousandsSeparator")
 #define chkAutoRollback             CTRL_CHECKBOX("chkAutoRollback")
 #define chkAutoCommit               CTRL_CHECKBOX("chkAutoCommit")
@@ -277,6 +279,7 @@ frmOptions::frmOptions(frmMain *parent)
 	wxTextValidator numval(wxFILTER_NUMERIC);
 	txtMaxRows->SetValidator(numval);
 	txtMaxColSize->SetValidator(numval);
+	txtStreamMaxRows->SetValidator(numval);
 	txtAutoRowCount->SetValidator(numval);
 	txtIndent->SetValidator(numval);
 	txtHistoryMaxQueries->SetValidator(numval);
@@ -309,6 +312,8 @@ frmOptions::frmOptions(frmMain *parent)
 	chkDoubleClickProperties->SetValue(settings->GetDoubleClickProperties());
 	txtDecimalMark->SetValue(settings->GetDecimalMark());
 	chkColumnNames->SetValue(settings->GetColumnNames());
+	chkStreamResults->SetValue(settings->GetStreamResults());
+	txtStreamMaxRows->SetValue(NumToStr(settings->GetStreamMaxRows()));
 	chkShowNotices->SetValue(settings->GetShowNotices());
 
 	txtPgHelpPath->SetValue(settings->GetPgHelpPath());
@@ -672,6 +677,8 @@ void frmOptions::OnOK(wxCommandEvent &ev)
 	settings->SetIndicateNull(chkIndicateNull->GetValue());
 	settings->SetDecimalMark(txtDecimalMark->GetValue());
 	settings->SetColumnNames(chkColumnNames->GetValue());
+	settings->SetStreamResults(chkStreamResults->GetValue());
+	settings->SetStreamMaxRows(StrToLong(txtStreamMaxRows->GetValue()));
 	settings->SetThousandsSeparator(txtThousandsSeparator->GetValue());
 	settings->SetAutoRollback(chkAutoRollback->GetValue());
 	settings->SetAutoCommit(chkAutoCommit->GetValue());
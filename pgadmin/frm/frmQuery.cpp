@@ -24,6 +24,7 @@
 #include <wx/aui/aui.h>
 #include <wx/bmpcbox.h>
 #include <wx/filefn.h>
+#include <wx/splitter.h>
 
 // App headers
 #include "frm/frmAbout.h"
@@ -31,12 +32,14 @@
 #include "frm/frmQuery.h"
 #include "frm/menu.h"
 #include "ctl/explainCanvas.h"
+#include "ctl/explainNodeList.h"
 #include "db/pgConn.h"
 
 #include "ctl/ctlMenuToolbar.h"
 #include "ctl/ctlSQLResult.h"
 #include "dlg/dlgSelectConnection.h"
 #include "dlg/dlgAddFavourite.h"
+#include "dlg/dlgExplainDiff.h"
 #include "dlg/dlgManageFavourites.h"
 #include "dlg/dlgManageMacros.h"
 #include "frm/frmReport.h"
@@ -52,6 +55,7 @@
 #include "schema/gpExtTable.h"
 #include "schema/pgServer.h"
 #include "utils/favourites.h"
+#include "utils/queryHistory.h"
 #include "utils/sysLogger.h"
 #include "utils/sysSettings.h"
 #include "utils/utffile.h"
@@ -86,6 +90,9 @@
 #define CTRLID_DATABASELABEL    4201
 #define CTL_SQLQUERYBOOK        4202
 
+// The newest queries of the history listed, unless they are filtered
+#define HISTORY_LISTED_QUERIES  100
+
 #define XML_FROM_WXSTRING(s) ((const xmlChar *)(const char *)s.mb_str(wxConvUTF8))
 #define WXSTRING_FROM_XML(s) wxString((char *)s, wxConvUTF8)
 #define XML_STR(s) ((const xmlChar *)s)
@@ -101,6 +108,7 @@ BEGIN_EVENT_TABLE(frmQuery, pgFrame)
 	EVT_SIZE(                       frmQuery::OnSize)
 	EVT_COMBOBOX(CTRLID_CONNECTION, frmQuery::OnChangeConnection)
 	EVT_COMBOBOX(CTL_SQLQUERYCBOX,  frmQuery::OnChangeQuery)
+	EVT_TEXT(CTL_SQLQUERYFILTER,    frmQuery::OnFilterQueries)
 	EVT_CLOSE(                      frmQuery::OnClose)
 	EVT_SET_FOCUS(                  frmQuery::OnSetFocus)
 	EVT_MENU(MNU_NEW,               frmQuery::OnNew)
@@ -124,6 +132,7 @@ BEGIN_EVENT_TABLE(frmQuery, pgFrame)
 	EVT_MENU(MNU_EXECFILE,          frmQuery::OnExecFile)
 	EVT_MENU(MNU_EXPLAIN,           frmQuery::OnExplain)
 	EVT_MENU(MNU_EXPLAINANALYZE,    frmQuery::OnExplain)
+	EVT_MENU(MNU_EXPLAINDIFF,       frmQuery::OnCompareExplain)
 	EVT_MENU(MNU_DOCOMMIT,          frmQuery::OnCommit)
 	EVT_MENU(MNU_DOROLLBACK,        frmQuery::OnRollback)
 	EVT_MENU(MNU_CANCEL,            frmQuery::OnCancel)
@@ -170,6 +179,7 @@ BEGIN_EVENT_TABLE(frmQuery, pgFrame)
 	EVT_TIMER(CTL_TIMERFRM,         frmQuery::OnTimer)
 // These fire when the queries complete
 	EVT_PGQUERYRESULT(QUERY_COMPLETE, frmQuery::OnQueryComplete)
+	EVT_PGQUERYPROGRESS(QUERY_COMPLETE, frmQuery::OnQueryProgress)
 	EVT_MENU(PGSCRIPT_COMPLETE,     frmQuery::OnScriptComplete)
 	EVT_AUINOTEBOOK_PAGE_CHANGED(CTL_NTBKCENTER, frmQuery::OnChangeNotebook)
 	EVT_AUINOTEBOOK_PAGE_CHANGED(CTL_SQLQUERYBOOK, frmQuery::OnSqlBookPageChanged)
@@ -329,6 +339,7 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	eo->Append(MNU_BUFFERS, _("Buffers"), _("Explain analyze query with (or without) buffers"), wxITEM_CHECK);
 	eo->Append(MNU_TIMING, _("Timing"), _("Explain analyze query with (or without) timing"), wxITEM_CHECK);
 	queryMenu->Append(MNU_EXPLAINOPTIONS, _("Explain &options"), eo, _("Options modifying Explain output"));
+	queryMenu->Append(MNU_EXPLAINDIFF, _("Compare plans..."), _("Compare two plans explained in this tab"));
 	queryMenu->AppendSeparator();
 	queryMenu->Append(MNU_SAVEHISTORY, _("Save history"), _("Save history of executed commands."));
 	queryMenu->Append(MNU_CLEARHISTORY, _("Clear history"), _("Clear history window."));
@@ -485,9 +496,13 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	// Query combobox
 	sqlQueries = new wxComboBox(pnlQuery, CTL_SQLQUERYCBOX, wxT(""), wxDefaultPosition, wxDefaultSize, wxArrayString(), wxCB_DROPDOWN | wxCB_READONLY);
 	sqlQueries->SetToolTip(_("Previous queries"));
-	LoadQueries();
 	boxHistory->Add(sqlQueries, 1, wxEXPAND | wxALL | wxALIGN_CENTER_VERTICAL, 1);
 
+	// Filter of the combobox
+	sqlQueriesFilter = new wxTextCtrl(pnlQuery, CTL_SQLQUERYFILTER, wxT(""), wxDefaultPosition, wxSize(150, -1));
+	sqlQueriesFilter->SetToolTip(_("Show only the previous queries containing this text"));
+	boxHistory->Add(sqlQueriesFilter, 0, wxALL | wxALIGN_CENTER_VERTICAL, 1);
+
 	// Delete Current button
 	btnDeleteCurrent = new wxButton(pnlQuery, CTL_DELETECURRENTBTN, _("Delete"));
 	btnDeleteCurrent->Enable(false);
@@ -495,9 +510,10 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 
 	// Delete All button
 	btnDeleteAll = new wxButton(pnlQuery, CTL_DELETEALLBTN, _("Delete All"));
-	btnDeleteAll->Enable(sqlQueries->GetCount() > 0);
 	boxHistory->Add(btnDeleteAll, 0, wxALL | wxALIGN_CENTER_VERTICAL, 1);
 
+	LoadQueries();
+
 	boxQuery->Add(boxHistory, 0, wxEXPAND | wxALL, 1);
 
 	// Create the other inner box sizer
@@ -522,7 +538,16 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	// Results pane
 	outputPane = new ctlAuiNotebook(this, CTL_NTBKGQB, wxDefaultPosition, wxSize(500, 300), wxAUI_NB_TOP | wxAUI_NB_TAB_SPLIT | wxAUI_NB_TAB_MOVE | wxAUI_NB_SCROLL_BUTTONS | wxAUI_NB_WINDOWLIST_BUTTON);
 	sqlResult = new ctlSQLResult(outputPane, conn, CTL_SQLRESULT, wxDefaultPosition, wxDefaultSize);
-	explainCanvas = new ExplainCanvas(outputPane);
+
+	// The plan, and its nodes by what they took
+	wxSplitterWindow *explainSplitter = new wxSplitterWindow(outputPane, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxSP_3D | wxSP_LIVE_UPDATE);
+	explainCanvas = new ExplainCanvas(explainSplitter);
+	ExplainNodeList *explainNodes = new ExplainNodeList(explainSplitter, explainCanvas);
+	explainCanvas->SetNodeList(explainNodes);
+	explainSplitter->SetSashGravity(1.0);
+	explainSplitter->SetMinimumPaneSize(50);
+	explainSplitter->SplitVertically(explainCanvas, explainNodes, -300);
+
 	msgResult = new wxTextCtrl(outputPane, CTL_MSGRESULT, wxT(""), wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY | wxTE_DONTWRAP);
 	msgResult->SetFont(settings->GetSQLFont());
 	msgHistory = new wxTextCtrl(outputPane, CTL_MSGHISTORY, wxT(""), wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY | wxTE_DONTWRAP);
@@ -542,7 +567,7 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	sqlNotebook->SetSelection(0);
 
 	outputPane->AddPage(sqlResult, _("Data Output"));
-	outputPane->AddPage(explainCanvas, _("Explain"));
+	outputPane->AddPage(explainSplitter, _("Explain"));
 	outputPane->AddPage(msgResult, _("Messages"));
 	outputPane->AddPage(msgHistory, _("History"));
 
@@ -1463,6 +1488,7 @@ void frmQuery::updateMenu(bool allowUpdateModelSize)
 
 	saveasImageMenu->Enable(MNU_SAVEAS_IMAGE_GQB, canSaveGQB);
 	saveasImageMenu->Enable(MNU_SAVEAS_IMAGE_EXPLAIN, canSaveExplain);
+	queryMenu->Enable(MNU_EXPLAINDIFF, sqlQuery && sqlQuery->GetExplainRuns().GetCount() > 1);
 
 	wxWindow *wnd = currentControl();
 	if (wnd == NULL)
@@ -2178,6 +2204,8 @@ void frmQuery::OnExplain(wxCommandEvent &event)
 			else
 				sql += wxT(", TIMING off ");
 		}
+		// Read as a tree by the explain canvas, rather than as text
+		sql += wxT(", FORMAT JSON");
 		sql += wxT(")");
 	}
 	else
@@ -2202,6 +2230,16 @@ void frmQuery::OnExplain(wxCommandEvent &event)
 	execQuery(sql, resultToRetrieve, true, offset, false, true, verbose);
 }
 
+
+void frmQuery::OnCompareExplain(wxCommandEvent &event)
+{
+	if (sqlQuery->GetExplainRuns().GetCount() < 2)
+		return;
+
+	dlgExplainDiff dlg(this, sqlQuery->GetExplainRuns());
+	dlg.ShowModal();
+}
+
 void frmQuery::OnCommit(wxCommandEvent &event)
 {
 	execQuery(wxT("COMMIT;"));
@@ -2532,6 +2570,36 @@ void frmQuery::execQuery(const wxString &query, int resultToRetrieve, bool singl
 	if (!queryMenu->IsChecked(MNU_AUTOCOMMIT) && conn->GetTxStatus() == PQTRANS_IDLE && !isBeginNotRequired(query))
 		conn->ExecuteVoid(wxT("BEGIN;"));
 
+	// Stream a single query straight to the file, rather than loading the
+	// whole result-set into memory first
+	if (qi->toFileExportForm && qi->toFileExportForm->PrepareCopy(conn, query))
+	{
+		long rowsTotal = 0;
+
+		SetStatusText(_("Writing data."), STATUSPOS_MSGS);
+		toolBar->EnableTool(MNU_CANCEL, false);
+		queryMenu->Enable(MNU_CANCEL, false);
+
+		bool written = qi->toFileExportForm->Export(conn, rowsTotal);
+
+		timer.Stop();
+		elapsedQuery = wxGetLocalTimeMillis() - startTimeQuery;
+		SetStatusText(ElapsedTimeToStr(elapsedQuery), STATUSPOS_SECS);
+		SetStatusText(wxString::Format(wxPLURAL("%ld row.", "%ld rows.", rowsTotal), rowsTotal), STATUSPOS_ROWS);
+
+		if (written)
+			SetStatusText(_("Data written to file."), STATUSPOS_MSGS);
+		else
+		{
+			showMessage(conn->GetLastError().Trim());
+			SetStatusText(_("Data export aborted."), STATUSPOS_MSGS);
+		}
+
+		delete qi;
+		completeQuery(written, false, false);
+		return;
+	}
+
 	if (sqlResult->Execute(query, resultToRetrieve, this, QUERY_COMPLETE, qi) >= 0)
 	{
 		// Return and wait for the result
@@ -2724,6 +2792,29 @@ bool frmQuery::isBeginNotRequired(wxString query)
 	return false;
 }
 
+// While the rows of a result are streamed in, we show them as they arrive.
+void frmQuery::OnQueryProgress(pgQueryResultEvent &ev)
+{
+	QueryExecInfo *qi = (QueryExecInfo *)ev.GetClientData();
+
+	// Results written to a file, and EXPLAIN plans are shown when complete
+	if (!qi || qi->toFileExportForm || qi->singleResult || qi->explain)
+		return;
+
+	sqlResult->DisplayPartialData();
+
+	if (sqlResult->NumRows() > 0 && outputPane->GetSelection() != 0)
+		outputPane->SetSelection(0);
+
+	SetStatusText(
+	    wxString::Format(
+	        wxPLURAL(
+	            "Retrieving data: %d row.",
+	            "Retrieving data: %d rows.",
+	            (int)sqlResult->NumRows()), (int)sqlResult->NumRows()),
+	    STATUSPOS_MSGS);
+}
+
 // When the query completes, it raises an event which we process here.
 void frmQuery::OnQueryComplete(pgQueryResultEvent &ev)
 {
@@ -2754,6 +2845,8 @@ void frmQuery::OnQueryComplete(pgQueryResultEvent &ev)
 
 	if (sqlResult->RunStatus() != PGRES_TUPLES_OK)
 	{
+		// Remove any rows streamed in, before the query failed
+		sqlResult->ClearData();
 		outputPane->SetSelection(2);
 		if (sqlResult->RunStatus() == PGRES_COMMAND_OK)
 		{
@@ -2977,52 +3070,16 @@ void frmQuery::OnQueryComplete(pgQueryResultEvent &ev)
 		if (executedQuery.IsNull())
 			executedQuery = sqlQueryExec->GetText();
 
-		// Same query, but without return feeds and carriage returns
-		wxString executedQueryWithoutReturns = executedQuery;
-		executedQueryWithoutReturns.Replace(wxT("\n"), wxT(" "));
-		executedQueryWithoutReturns.Replace(wxT("\r"), wxT(" "));
-		executedQueryWithoutReturns = executedQueryWithoutReturns.Trim();
-
 		if (executedQuery.Len() < (unsigned int)settings->GetHistoryMaxQuerySize())
 		{
-			// We put in the combo box the query without returns...
-			sqlQueries->Append(executedQueryWithoutReturns);
-
-			// .. but we save the query with returns in the array
-			// (so that we have the real query in the file)
-			histoQueries.Add(executedQuery);
-
-			// Finally, we save the queries
-			SaveQueries();
-		}
-
-		// Search a matching old query
-		unsigned int index = 0;
-		bool found = false;
-		while (!found && index < sqlQueries->GetCount())
-		{
-			found = sqlQueries->GetString(index) == executedQueryWithoutReturns;
-			if (!found)
-				index++;
-		}
-
-		// If we found one, delete it from the combobox and the array
-		if (found && index < (unsigned int)sqlQueries->GetCount() - 1)
-		{
-			histoQueries.RemoveAt(index);
-			sqlQueries->Delete(index);
+			// The history drops an older copy of the query
+			if (!queryHistory::Get()->Add(executedQuery, conn->GetDbname()))
+				wxMessageBox(_("Failed to write to history file!"));
+			else
+				AddQuery(executedQuery);
 		}
 	}
 
-	// Make sure only the maximum query number is enforced
-	while (sqlQueries->GetCount() > (unsigned int)settings->GetHistoryMaxQueries())
-	{
-		histoQueries.RemoveAt(0);
-		sqlQueries->Delete(0);
-	}
-
-	SaveQueries();
-
 	completeQuery(done, qi->explain, qi->verbose);
 	delete qi;
 }
@@ -3162,7 +3219,10 @@ void frmQuery::completeQuery(bool done, bool explain, bool verbose)
 					str.Append(sqlResult->OnGetItemText(i, 0));
 				}
 			}
-			explainCanvas->SetExplainString(str);
+			if (!explainCanvas->SetExplainJson(str))
+				explainCanvas->SetExplainString(str);
+			else if (sqlQueryExec)
+				sqlQueryExec->AddExplainRun(str);
 			outputPane->SetSelection(1);
 		}
 		updateMenu();
@@ -3358,118 +3418,98 @@ wxColour frmQuery::GetServerColour(pgConn *connection)
 
 void frmQuery::LoadQueries()
 {
-	xmlDocPtr doc;
-	xmlNodePtr cur;
-	xmlChar *key;
-
-	if (!wxFile::Access(settings->GetHistoryFile(), wxFile::read))
-		return;
+	queryHistory *history = queryHistory::Get();
+	history->Sync();
 
-	doc = xmlParseFile((const char *)settings->GetHistoryFile().mb_str(wxConvUTF8));
-	if (doc == NULL)
+	// Only a search reads all the texts
+	wxArrayInt positions;
+	wxString filter = sqlQueriesFilter->GetValue();
+	if (filter.IsEmpty())
 	{
-		wxMessageBox(_("Failed to load the history file!"));
-		::wxRemoveFile(settings->GetHistoryFile());
-		return;
+		size_t count = history->GetCount();
+		for (size_t i = count > HISTORY_LISTED_QUERIES ? count - HISTORY_LISTED_QUERIES : 0; i < count; i++)
+			positions.Add(i);
 	}
+	else
+		history->Search(filter, positions);
 
-	cur = xmlDocGetRootElement(doc);
-	if (cur == NULL)
-	{
-		xmlFreeDoc(doc);
-		return;
-	}
+	sqlQueries->Clear();
+	histoSerials.Clear();
+	for (size_t i = 0; i < positions.GetCount(); i++)
+		AppendQuery(positions.Item(i));
 
-	if (xmlStrcmp(cur->name, (const xmlChar *) "histoqueries"))
-	{
-		wxMessageBox(_("Failed to load the history file!"));
-		xmlFreeDoc(doc);
-		::wxRemoveFile(settings->GetHistoryFile());
-		return;
-	}
+	btnDeleteCurrent->Enable(false);
+	btnDeleteAll->Enable(history->GetCount() > 0);
+}
+
+
+void frmQuery::AppendQuery(size_t pos)
+{
+	queryHistory *history = queryHistory::Get();
+
+	// We put in the combo box the query without returns
+	wxString tmp = history->GetLabel(pos);
+	tmp.Replace(wxT("\n"), wxT(" "));
+	tmp.Replace(wxT("\r"), wxT(" "));
+	sqlQueries->Append(tmp);
+	histoSerials.Add(history->GetSerial(pos));
+}
 
-	cur = cur->xmlChildrenNode;
-	while (cur != NULL)
+
+// The query just added to the history, as its newest one
+void frmQuery::AddQuery(const wxString &query)
+{
+	queryHistory *history = queryHistory::Get();
+
+	// The older copy of the query, and the oldest queries, are gone
+	size_t i;
+	for (i = histoSerials.GetCount(); i > 0; i--)
 	{
-		if ((!xmlStrcmp(cur->name, (const xmlChar *)"histoquery")))
+		if (history->FindSerial(histoSerials.Item(i - 1)) == wxNOT_FOUND)
 		{
-			key = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
-
-			if (key)
-			{
-				if (WXSTRING_FROM_XML(key) != wxT(""))
-				{
-					wxString query = WXSTRING_FROM_XML(key);
-					wxString tmp = query;
-					tmp.Replace(wxT("\n"), wxT(" "));
-					tmp.Replace(wxT("\r"), wxT(" "));
-					sqlQueries->Append(tmp);
-					histoQueries.Add(query);
-				}
-				xmlFree(key);
-			}
+			sqlQueries->Delete(i - 1);
+			histoSerials.RemoveAt(i - 1);
 		}
-
-		cur = cur->next;
 	}
 
-	xmlFreeDoc(doc);
+	wxString filter = sqlQueriesFilter->GetValue();
+	if (filter.IsEmpty() || query.Lower().Find(filter.Lower()) != wxNOT_FOUND)
+		AppendQuery(history->GetCount() - 1);
 
-	// Make sure only the maximum query number is enforced
-	if (sqlQueries->GetCount() > (unsigned int)settings->GetHistoryMaxQueries())
+	if (filter.IsEmpty())
 	{
-		while (sqlQueries->GetCount() > (unsigned int)settings->GetHistoryMaxQueries())
+		while (histoSerials.GetCount() > HISTORY_LISTED_QUERIES)
 		{
-			histoQueries.RemoveAt(0);
 			sqlQueries->Delete(0);
+			histoSerials.RemoveAt(0);
 		}
-		SaveQueries();
 	}
 
-	return;
+	btnDeleteCurrent->Enable(sqlQueries->GetSelection() != wxNOT_FOUND);
+	btnDeleteAll->Enable(history->GetCount() > 0);
 }
 
 
-void frmQuery::SaveQueries()
+void frmQuery::OnFilterQueries(wxCommandEvent &event)
 {
-	size_t i;
-	xmlTextWriterPtr writer;
-
-	writer = xmlNewTextWriterFilename((const char *)settings->GetHistoryFile().mb_str(wxConvUTF8), 0);
-	if (!writer)
-	{
-		wxMessageBox(_("Failed to write to history file!"));
-		return;
-	}
-	xmlTextWriterSetIndent(writer, 1);
+	LoadQueries();
+}
 
-	if ((xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL) < 0) ||
-	        (xmlTextWriterStartElement(writer, XML_STR("histoqueries")) < 0))
-	{
-		wxMessageBox(_("Failed to write to history file!"));
-		xmlFreeTextWriter(writer);
-		return;
-	}
 
-	for (i = 0; i < histoQueries.GetCount(); i++)
-	{
-		xmlTextWriterStartElement(writer, XML_STR("histoquery"));
-		xmlTextWriterWriteString(writer, XML_FROM_WXSTRING(histoQueries.Item(i)));
-		xmlTextWriterEndElement(writer);
-	}
+void frmQuery::OnChangeQuery(wxCommandEvent &event)
+{
+	queryHistory *history = queryHistory::Get();
+	history->Sync();
 
-	if (xmlTextWriterEndDocument(writer) < 0)
+	// Another window, or another pgAdmin, may have deleted it
+	int pos = history->FindSerial(histoSerials.Item(sqlQueries->GetSelection()));
+	if (pos == wxNOT_FOUND)
 	{
-		wxMessageBox(_("Failed to write to history file!"));
+		LoadQueries();
+		return;
 	}
 
-	xmlFreeTextWriter(writer);
-}
-
-
-void frmQuery::OnChangeQuery(wxCommandEvent &event)
-{
-	wxString query = histoQueries.Item(sqlQueries->GetSelection());
+	wxString query = history->GetText(pos);
 	if (query.Length() > 0)
 	{
 		sqlQuery->SetText(query);
@@ -3493,12 +3533,8 @@ void frmQuery::OnDeleteCurrent(wxCommandEvent &event)
 	                     _("Confirm deletion"),
 	                     wxYES_NO | wxNO_DEFAULT | wxICON_EXCLAMATION).ShowModal() == wxID_YES )
 	{
-		histoQueries.RemoveAt(sqlQueries->GetSelection());
-		sqlQueries->Delete(sqlQueries->GetSelection());
-		sqlQueries->SetValue(wxT(""));
-		btnDeleteCurrent->Enable(false);
-		btnDeleteAll->Enable(sqlQueries->GetCount() > 0);
-		SaveQueries();
+		queryHistory::Get()->Delete(histoSerials.Item(sqlQueries->GetSelection()));
+		LoadQueries();
 	}
 }
 
@@ -3511,12 +3547,8 @@ void frmQuery::OnDeleteAll(wxCommandEvent &event)
 	                     _("Confirm deletion"),
 	                     wxYES_NO | wxNO_DEFAULT | wxICON_EXCLAMATION).ShowModal() == wxID_YES )
 	{
-		histoQueries.Clear();
-		sqlQueries->Clear();
-		sqlQueries->SetValue(wxT(""));
-		btnDeleteCurrent->Enable(false);
-		btnDeleteAll->Enable(false);
-		SaveQueries();
+		queryHistory::Get()->Clear();
+		LoadQueries();
 	}
 }
 
@@ -11,6 +11,8 @@
 
 #include "pgAdmin3.h"
 
+#include <float.h>
+
 // wxWindows headers
 #include <wx/wx.h>
 #include <wx/xrc/xmlres.h>
@@ -52,6 +54,15 @@
 
 #define CTRLID_DATABASE         4200
 
+// Rows kept in the log list
+#define LOG_MAX_ROWS            100000
+
+// Size of the reads of the logfile, it doubles while there is more to read
+#define LOG_MIN_CHUNK           262144
+#define LOG_MAX_CHUNK           8388608
+
+DEFINE_EVENT_TYPE(STATUS_REFRESH_EVENT)
+
 
 BEGIN_EVENT_TABLE(frmStatus, pgFrame)
 	EVT_MENU(MNU_EXIT,                            frmStatus::OnExit)
@@ -109,6 +120,8 @@ BEGIN_EVENT_TABLE(frmStatus, pgFrame)
 
 	EVT_COMBOBOX(CTRLID_DATABASE,                 frmStatus::OnChangeDatabase)
 
+	EVT_COMMAND(wxID_ANY, STATUS_REFRESH_EVENT,   frmStatus::OnRefreshed)
+
 	EVT_CLOSE(                                    frmStatus::OnClose)
 END_EVENT_TABLE();
 
@@ -142,6 +155,28 @@ int frmStatus::cboToRate()
 }
 
 
+// Make the connection quiet on the logs (only superusers can set these
+// parameters)
+static void QuietConnection(pgConn *conn)
+{
+	wxString initquery;
+
+	pgUser *user = new pgUser(conn->GetUser());
+	if (user)
+	{
+		if (user->GetSuperuser())
+		{
+			if (conn->BackendMinimumVersion(8, 0))
+				initquery = wxT("SET log_statement='none';SET log_duration='off';SET log_min_duration_statement=-1;");
+			else
+				initquery = wxT("SET log_statement='off';SET log_duration='off';SET log_min_duration_statement=-1;");
+			conn->ExecuteVoid(initquery, false);
+		}
+		delete user;
+	}
+}
+
+
 wxString frmStatus::rateToCboString(int rate)
 {
 	wxString rateStr;
@@ -173,7 +208,6 @@ wxString frmStatus::rateToCboString(int rate)
 
 frmStatus::frmStatus(frmMain *form, const wxString &_title, pgConn *conn) : pgFrame(NULL, _title)
 {
-	wxString initquery;
 	bool highlight = false;
 
 	dlgName = wxT("frmStatus");
@@ -182,7 +216,9 @@ frmStatus::frmStatus(frmMain *form, const wxString &_title, pgConn *conn) : pgFr
 
 	mainForm = form;
 	connection = conn;
-	locks_connection = conn;
+	refresher = NULL;
+	logReader = NULL;
+	logSerial = 0;
 
 	statusTimer = 0;
 	locksTimer = 0;
@@ -192,21 +228,7 @@ frmStatus::frmStatus(frmMain *form, const wxString &_title, pgConn *conn) : pgFr
 	logHasTimestamp = false;
 	logFormatKnown = false;
 
-	// Only superusers can set these parameters...
-	pgUser *user = new pgUser(connection->GetUser());
-	if (user)
-	{
-		if (user->GetSuperuser())
-		{
-			// Make the connection quiet on the logs
-			if (connection->BackendMinimumVersion(8, 0))
-				initquery = wxT("SET log_statement='none';SET log_duration='off';SET log_min_duration_statement=-1;");
-			else
-				initquery = wxT("SET log_statement='off';SET log_duration='off';SET log_min_duration_statement=-1;");
-			connection->ExecuteVoid(initquery, false);
-		}
-		delete user;
-	}
+	QuietConnection(connection);
 
 	// Notify wxAUI which frame to use
 	manager.SetManagedWindow(this);
@@ -377,8 +399,17 @@ frmStatus::frmStatus(frmMain *form, const wxString &_title, pgConn *conn) : pgFr
 	settings->Read(wxT("frmStatus/HighlightStatus"), &highlight, true);
 	viewMenu->Check(MNU_HIGHLIGHTSTATUS, highlight);
 
-	// Get our PID
-	backend_pid = connection->GetBackendPID();
+	// The activity, locks and transactions lists are read on their own
+	// connection, so that a busy server doesn't block the window
+	pgConn *refreshConn = connection->Duplicate();
+	QuietConnection(refreshConn);
+	refresher = new statusRefreshThread(this, refreshConn, connection->GetBackendPID());
+	if (refresher->Create() != wxTHREAD_NO_ERROR || refresher->Run() != wxTHREAD_NO_ERROR)
+	{
+		wxLogError(_("Failed to start the status refresh thread."));
+		delete refresher;
+		refresher = NULL;
+	}
 
 	// Create the refresh timer (quarter of a second)
 	// This is a horrible hack to get around the lack of a
@@ -401,6 +432,22 @@ frmStatus::~frmStatus()
 	// Delete the refresh timer
 	delete refreshUITimer;
 
+	// Stop the refresh thread, and its connections
+	if (refresher)
+	{
+		refresher->Stop();
+		refresher->Wait();
+		delete refresher;
+		refresher = NULL;
+	}
+	if (logReader)
+	{
+		logReader->Stop();
+		logReader->Wait();
+		delete logReader;
+		logReader = NULL;
+	}
+
 	// If the status window wasn't launched in standalone mode...
 	if (mainForm)
 		mainForm->RemoveFrame(this);
@@ -439,11 +486,6 @@ frmStatus::~frmStatus()
 	}
 
 	// If connection is still available, delete it
-	if (locks_connection && locks_connection != connection)
-	{
-		if (locks_connection->IsAlive())
-			delete locks_connection;
-	}
 	if (connection)
 	{
 		if (connection->IsAlive())
@@ -504,31 +546,21 @@ void frmStatus::OnExit(wxCommandEvent &event)
 
 void frmStatus::OnChangeDatabase(wxCommandEvent &ev)
 {
-	wxString initquery;
+	if (!connection || !refresher)
+		return;
 
-	if (locks_connection != connection)
-	{
-		delete locks_connection;
-	}
+	// The locks are read in the selected database, the refresh thread
+	// takes the connection over
+	pgConn *locksConn = new pgConn(connection->GetHostName(), connection->GetService(), connection->GetHostAddr(), cbDatabase->GetValue(),
+	                               connection->GetUser(), connection->GetPassword(), connection->GetPort(), connection->GetRole(), connection->GetSslMode(),
+	                               0, connection->GetApplicationName(), connection->GetSSLCert(), connection->GetSSLKey(), connection->GetSSLRootCert(), connection->GetSSLCrl(),
+	                               connection->GetSSLCompression());
 
-	locks_connection = new pgConn(connection->GetHostName(), connection->GetService(), connection->GetHostAddr(), cbDatabase->GetValue(),
-	                              connection->GetUser(), connection->GetPassword(), connection->GetPort(), connection->GetRole(), connection->GetSslMode(),
-	                              0, connection->GetApplicationName(), connection->GetSSLCert(), connection->GetSSLKey(), connection->GetSSLRootCert(), connection->GetSSLCrl(),
-	                              connection->GetSSLCompression());
+	QuietConnection(locksConn);
+	refresher->SetLocksConnection(locksConn);
 
-	pgUser *user = new pgUser(locks_connection->GetUser());
-	if (user)
-	{
-		if (user->GetSuperuser())
-		{
-			if (locks_connection->BackendMinimumVersion(8, 0))
-				initquery = wxT("SET log_statement='none';SET log_duration='off';SET log_min_duration_statement=-1;");
-			else
-				initquery = wxT("SET log_statement='off';SET log_duration='off';SET log_min_duration_statement=-1;");
-			locks_connection->ExecuteVoid(initquery, false);
-		}
-		delete user;
-	}
+	wxTimerEvent evt;
+	OnRefreshLocksTimer(evt);
 }
 
 
@@ -548,12 +580,12 @@ void frmStatus::AddStatusPane()
 	// Disable sort on Mac.
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), true);
 #endif
-	wxListCtrl *lstStatus = new wxListCtrl(pnlActivity, CTL_STATUSLIST, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxSUNKEN_BORDER);
+	statusList = new statusListView(pnlActivity, CTL_STATUSLIST);
 	// Now switch back
 #ifdef __WXMAC__
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), false);
 #endif
-	grdActivity->Add(lstStatus, 0, wxGROW, 3);
+	grdActivity->Add(statusList, 0, wxGROW, 3);
 
 	// Add the panel to the notebook
 	manager.AddPane(pnlActivity,
@@ -567,8 +599,7 @@ void frmStatus::AddStatusPane()
 	grdActivity->Fit(pnlActivity);
 
 	// Add each column to the list control
-	statusList = (ctlListView *)lstStatus;
-	statusList->AddColumn(_("PID"), 35);
+	statusList->AddNumberColumn(_("PID"), 35);
 	if (connection->BackendMinimumVersion(8, 5))
 		statusList->AddColumn(_("Application name"), 70);
 	statusList->AddColumn(_("Database"), 70);
@@ -589,10 +620,10 @@ void frmStatus::AddStatusPane()
 	}
 	if (connection->BackendMinimumVersion(9, 4))
 	{
-		statusList->AddColumn(_("Backend XID"), 35);
-		statusList->AddColumn(_("Backend XMin"), 35);
+		statusList->AddNumberColumn(_("Backend XID"), 35);
+		statusList->AddNumberColumn(_("Backend XMin"), 35);
 	}
-	statusList->AddColumn(_("Blocked by"), 35);
+	statusList->AddNumberColumn(_("Blocked by"), 35);
 	statusList->AddColumn(_("Query"), 500);
 
 	// Get through the list of columns to build the popup menu
@@ -652,12 +683,12 @@ void frmStatus::AddLockPane()
 	// Disable sort on Mac.
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), true);
 #endif
-	wxListCtrl *lstLocks = new wxListCtrl(pnlLock, CTL_LOCKLIST, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxSUNKEN_BORDER);
+	lockList = new statusListView(pnlLock, CTL_LOCKLIST);
 	// Now switch back
 #ifdef __WXMAC__
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), false);
 #endif
-	grdLock->Add(lstLocks, 0, wxGROW, 3);
+	grdLock->Add(lockList, 0, wxGROW, 3);
 
 	// Add the panel to the notebook
 	manager.AddPane(pnlLock,
@@ -671,17 +702,20 @@ void frmStatus::AddLockPane()
 	grdLock->Fit(pnlLock);
 
 	// Add each column to the list control
-	lockList = (ctlListView *)lstLocks;
-	lockList->AddColumn(wxT("PID"), 35);
+	lockList->AddNumberColumn(wxT("PID"), 35);
 	lockList->AddColumn(_("Database"), 50);
 	lockList->AddColumn(_("Relation"), 50);
 	lockList->AddColumn(_("User"), 50);
-	if (locks_connection->BackendMinimumVersion(8, 3))
+	if (connection->BackendMinimumVersion(8, 3))
+	{
 		lockList->AddColumn(_("XID"), 50);
-	lockList->AddColumn(_("TX"), 50);
+		lockList->AddColumn(_("TX"), 50);
+	}
+	else
+		lockList->AddNumberColumn(_("TX"), 50);
 	lockList->AddColumn(_("Mode"), 50);
 	lockList->AddColumn(_("Granted"), 50);
-	if (locks_connection->BackendMinimumVersion(7, 4))
+	if (connection->BackendMinimumVersion(7, 4))
 		lockList->AddColumn(_("Start"), 50);
 	lockList->AddColumn(_("Query"), 500);
 
@@ -741,12 +775,12 @@ void frmStatus::AddXactPane()
 	// Disable sort on Mac.
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), true);
 #endif
-	wxListCtrl *lstXacts = new wxListCtrl(pnlXacts, CTL_XACTLIST, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxSUNKEN_BORDER);
+	xactList = new statusListView(pnlXacts, CTL_XACTLIST);
 	// Now switch back
 #ifdef __WXMAC__
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), false);
 #endif
-	grdXacts->Add(lstXacts, 0, wxGROW, 3);
+	grdXacts->Add(xactList, 0, wxGROW, 3);
 
 	// Add the panel to the notebook
 	manager.AddPane(pnlXacts,
@@ -759,9 +793,6 @@ void frmStatus::AddXactPane()
 	pnlXacts->SetSizer(grdXacts);
 	grdXacts->Fit(pnlXacts);
 
-	// Add the xact list
-	xactList = (ctlListView *)lstXacts;
-
 	// We don't need this report if server release is less than 8.1
 	// GPDB doesn't have external global transactions.
 	// Perhaps we should use this display to show our
@@ -769,9 +800,15 @@ void frmStatus::AddXactPane()
 	if (!connection->BackendMinimumVersion(8, 1) || connection->GetIsGreenplum())
 	{
 		// manager.GetPane(wxT("Transactions")).Show(false);
-		lstXacts->InsertColumn(lstXacts->GetColumnCount(), _("Message"), wxLIST_FORMAT_LEFT, 800);
-		lstXacts->InsertItem(lstXacts->GetItemCount(), _("Prepared transactions not available on this server."), -1);
-		lstXacts->Enable(false);
+		xactList->InsertColumn(xactList->GetColumnCount(), _("Message"), wxLIST_FORMAT_LEFT, 800);
+
+		statusSnapshot *snap = new statusSnapshot(PANE_XACT);
+		statusRow *row = new statusRow;
+		row->cells.Add(_("Prepared transactions not available on this server."));
+		snap->rows.Add(row);
+		xactList->SetSnapshot(snap);
+
+		xactList->Enable(false);
 		xactTimer = NULL;
 
 		// We're done
@@ -779,7 +816,7 @@ void frmStatus::AddXactPane()
 	}
 
 	// Add each column to the list control
-	xactList->AddColumn(wxT("XID"), 50);
+	xactList->AddNumberColumn(wxT("XID"), 50);
 	xactList->AddColumn(_("Global ID"), 200);
 	xactList->AddColumn(_("Time"), 100);
 	xactList->AddColumn(_("Owner"), 50);
@@ -819,6 +856,7 @@ void frmStatus::AddXactPane()
 	// Initialize sort order
 	xactSortColumn = 2;
 	xactSortOrder = wxT("ASC");
+	xactList->Sort(xactSortColumn - 1, true);
 
 	// Create the timer
 	xactTimer = new wxTimer(this, TIMER_XACT_ID);
@@ -844,12 +882,12 @@ void frmStatus::AddLogPane()
 	// Disable sort on Mac.
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), true);
 #endif
-	wxListCtrl *lstLog = new wxListCtrl(pnlLog, CTL_LOGLIST, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxSUNKEN_BORDER);
+	logList = new logListView(pnlLog, CTL_LOGLIST, LOG_MAX_ROWS);
 	// Now switch back
 #ifdef __WXMAC__
 	wxSystemOptions::SetOption(wxT("mac.listctrl.always_use_generic"), false);
 #endif
-	grdLog->Add(lstLog, 0, wxGROW, 3);
+	grdLog->Add(logList, 0, wxGROW, 3);
 
 	// Add the panel to the notebook
 	manager.AddPane(pnlLog,
@@ -862,9 +900,6 @@ void frmStatus::AddLogPane()
 	pnlLog->SetSizer(grdLog);
 	grdLog->Fit(pnlLog);
 
-	// Add the log list
-	logList = (ctlListView *)lstLog;
-
 	// We don't need this report (but we need the pane)
 	// if server release is less than 8.0 or if server has no adminpack
 	if (!(connection->BackendMinimumVersion(8, 0) &&
@@ -891,7 +926,7 @@ void frmStatus::AddLogPane()
 		if (!connection->HasFeature(FEATURE_FILEREAD, true))
 		{
 			logList->InsertColumn(logList->GetColumnCount(), _("Message"), wxLIST_FORMAT_LEFT, 800);
-			logList->InsertItem(logList->GetItemCount(), _("Logs are not available for this server."), -1);
+			logList->AppendMessage(_("Logs are not available for this server."));
 			logList->Enable(false);
 			logTimer = NULL;
 			// We're done
@@ -946,8 +981,16 @@ void frmStatus::AddLogPane()
 	if (!connection->HasFeature(FEATURE_ROTATELOG))
 		btnRotateLog->Disable();
 
-	// Re-initialize variables
-	logfileLength = 0;
+	// The log is read on its own connection, which must not be logged
+	pgConn *logConn = connection->Duplicate();
+	QuietConnection(logConn);
+	logReader = new statusLogThread(this, logConn, logFormat, logFormatKnown, logHasTimestamp, settings->GetMaxServerLogSize());
+	if (logReader->Create() != wxTHREAD_NO_ERROR || logReader->Run() != wxTHREAD_NO_ERROR)
+	{
+		wxLogError(_("Failed to start the logfile reader thread."));
+		delete logReader;
+		logReader = NULL;
+	}
 
 	// Read logRate configuration
 	settings->Read(wxT("frmStatus/RefreshLogRate"), &logRate, 10);
@@ -1026,7 +1069,9 @@ void frmStatus::OnCopyQuery(wxCommandEvent &ev)
 
 	// Get the actual query
 	row = list->GetFirstSelected();
-	text.Append(queries.Item(row));
+	statusRow *data = statusList->GetRow(row);
+	if (data)
+		text.Append(data->query);
 
 	// Check if we have a query whose length is maximum
 	maxlength = 1024;
@@ -1217,9 +1262,7 @@ void frmStatus::OnDefaultView(wxCommandEvent &event)
 
 void frmStatus::OnHighlightStatus(wxCommandEvent &event)
 {
-	wxTimerEvent evt;
-
-	OnRefreshStatusTimer(evt);
+	statusList->SetHighlight(viewMenu->IsChecked(MNU_HIGHLIGHTSTATUS));
 }
 
 
@@ -1315,15 +1358,10 @@ void frmStatus::OnRefreshUITimer(wxTimerEvent &event)
 
 void frmStatus::OnRefreshStatusTimer(wxTimerEvent &event)
 {
-	long pid = 0;
-	wxString pidcol = connection->BackendMinimumVersion(9, 2) ? wxT("p.pid") : wxT("p.procpid");
-	wxString querycol = connection->BackendMinimumVersion(9, 2) ? wxT("query") : wxT("current_query");
-
 	if (! viewMenu->IsChecked(MNU_STATUSPAGE))
 		return;
 
-	checkConnection();
-	if (!connection)
+	if (!connection || !refresher)
 	{
 		statusTimer->Stop();
 		locksTimer->Stop();
@@ -1334,209 +1372,16 @@ void frmStatus::OnRefreshStatusTimer(wxTimerEvent &event)
 		return;
 	}
 
-	wxCriticalSectionLocker lock(gs_critsect);
-
-	long row = 0;
-	wxString q = wxT("SELECT ");
-
-	// PID
-	q += pidcol + wxT(" AS pid, ");
-
-	// Application name (when available)
-	if (connection->BackendMinimumVersion(8, 5))
-		q += wxT("application_name, ");
-
-	// Database, and user name
-	q += wxT("datname, usename,\n");
-
-	// Client connection method
-	if (connection->BackendMinimumVersion(8, 1))
-	{
-		q += wxT("CASE WHEN client_port=-1 THEN 'local pipe' ");
-		if (connection->BackendMinimumVersion(9, 1))
-			q += wxT("WHEN length(client_hostname)>0 THEN client_hostname||':'||client_port ");
-		q += wxT("ELSE textin(inet_out(client_addr))||':'||client_port END AS client,\n");
-	}
-
-	// Backend start timestamp
-	if (connection->BackendMinimumVersion(8, 1))
-		q += wxT("date_trunc('second', backend_start) AS backend_start, ");
-
-	// Query start timestamp (when available)
-	if (connection->BackendMinimumVersion(9, 2))
-	{
-		q += wxT("CASE WHEN state='active' THEN date_trunc('second', query_start)::text ELSE '' END ");
-	}
-	else if (connection->BackendMinimumVersion(7, 4))
-	{
-		q += wxT("CASE WHEN ") + querycol + wxT("='' OR ") + querycol + wxT("='<IDLE>' THEN '' ")
-		     wxT("     ELSE date_trunc('second', query_start)::text END ");
-	}
-	else
-	{
-		q += wxT("'' ");
-	}
-	q += wxT("AS query_start,\n");
-
-	// Transaction start timestamp
-	if (connection->BackendMinimumVersion(8, 3))
-		q += wxT("date_trunc('second', xact_start) AS xact_start, ");
-
-	// State
-	if (connection->BackendMinimumVersion(9, 2))
-		q += wxT("state, date_trunc('second', state_change) AS state_change, ");
-
-	// Xmin and XID
-	if (connection->BackendMinimumVersion(9, 4))
-		q += wxT("backend_xid::text, backend_xmin::text, ");
-
-	// Blocked by...
-	q +=   wxT("(SELECT min(l1.pid) FROM pg_locks l1 WHERE GRANTED AND (")
-	       wxT("relation IN (SELECT relation FROM pg_locks l2 WHERE l2.pid=") + pidcol + wxT(" AND NOT granted)")
-	       wxT(" OR ")
-	       wxT("transactionid IN (SELECT transactionid FROM pg_locks l3 WHERE l3.pid=") + pidcol + wxT(" AND NOT granted)")
-	       wxT(")) AS blockedby,\n");
-
-	// Query
-	q += querycol + wxT(" AS query,\n");
-
-	// Slow query?
-	if (connection->BackendMinimumVersion(9, 2))
-	{
-		q += wxT("CASE WHEN query_start IS NULL OR state<>'active' THEN false ELSE query_start < now() - '10 seconds'::interval END ");
-	}
-	else if (connection->BackendMinimumVersion(7, 4))
-	{
-		q += wxT("CASE WHEN query_start IS NULL OR ") + querycol + wxT(" LIKE '<IDLE>%' THEN false ELSE query_start < now() - '10 seconds'::interval END ");
-	}
-	else
-	{
-		q += wxT("false");
-	}
-	q += wxT("AS slowquery\n");
-
-	// And the rest of the query...
-	q += wxT("FROM pg_stat_activity p ")
-	     wxT("ORDER BY ") + NumToStr((long)statusSortColumn) + wxT(" ") + statusSortOrder;
-
-	pgSet *dataSet1 = connection->ExecuteSet(q);
-	if (dataSet1)
-	{
-		statusBar->SetStatusText(_("Refreshing status list."));
-		statusList->Freeze();
-
-		// Clear the queries array content
-		queries.Clear();
-
-		while (!dataSet1->Eof())
-		{
-			pid = dataSet1->GetLong(wxT("pid"));
-
-			// Update the UI
-			if (pid != backend_pid)
-			{
-				// Add the query content to the queries array
-				queries.Add(dataSet1->GetVal(wxT("query")));
-
-				if (row >= statusList->GetItemCount())
-				{
-					statusList->InsertItem(row, NumToStr(pid), -1);
-					row = statusList->GetItemCount() - 1;
-				}
-				else
-				{
-					statusList->SetItem(row, 0, NumToStr(pid));
-				}
-
-				wxString qry = dataSet1->GetVal(wxT("query"));
-
-				int colpos = 1;
-				if (connection->BackendMinimumVersion(8, 5))
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("application_name")));
-				statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("datname")));
-				statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("usename")));
-
-				if (connection->BackendMinimumVersion(8, 1))
-				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("client")));
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("backend_start")));
-				}
-				if (connection->BackendMinimumVersion(7, 4))
-				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("query_start")));
-				}
-
-				if (connection->BackendMinimumVersion(8, 3))
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("xact_start")));
-
-				if (connection->BackendMinimumVersion(9, 2))
-				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("state")));
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("state_change")));
-				}
-
-				if (connection->BackendMinimumVersion(9, 4))
-				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("backend_xid")));
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("backend_xmin")));
-				}
-
-				statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("blockedby")));
-				statusList->SetItem(row, colpos, qry);
-
-				// Colorize the new line
-				if (viewMenu->IsChecked(MNU_HIGHLIGHTSTATUS))
-				{
-					statusList->SetItemBackgroundColour(row,
-					                                    wxColour(settings->GetActiveProcessColour()));
-					if (qry == wxT("<IDLE>") || qry == wxT("<IDLE> in transaction0"))
-						statusList->SetItemBackgroundColour(row,
-						                                    wxColour(settings->GetIdleProcessColour()));
-					if (connection->BackendMinimumVersion(9, 2))
-					{
-						if (dataSet1->GetVal(wxT("state")) != wxT("active"))
-							statusList->SetItemBackgroundColour(row,
-							                                    wxColour(settings->GetIdleProcessColour()));
-					}
-
-					if (dataSet1->GetVal(wxT("blockedby")).Length() > 0)
-						statusList->SetItemBackgroundColour(row,
-						                                    wxColour(settings->GetBlockedProcessColour()));
-					if (dataSet1->GetBool(wxT("slowquery")))
-						statusList->SetItemBackgroundColour(row,
-						                                    wxColour(settings->GetSlowProcessColour()));
-				}
-				else
-					statusList->SetItemBackgroundColour(row, *wxWHITE);
-
-				row++;
-			}
-			dataSet1->MoveNext();
-		}
-		delete dataSet1;
-
-		while (row < statusList->GetItemCount())
-			statusList->DeleteItem(row);
-
-		statusList->Thaw();
-		wxListEvent ev;
-		OnSelStatusItem(ev);
-		statusBar->SetStatusText(_("Done."));
-	}
-	else
-		checkConnection();
+	refresher->Refresh(PANE_STATUS);
 }
 
 
 void frmStatus::OnRefreshLocksTimer(wxTimerEvent &event)
 {
-	long pid = 0;
-
 	if (! viewMenu->IsChecked(MNU_LOCKPAGE))
 		return;
 
-	checkConnection();
-	if (!locks_connection)
+	if (!connection || !refresher)
 	{
 		statusTimer->Stop();
 		locksTimer->Stop();
@@ -1547,123 +1392,7 @@ void frmStatus::OnRefreshLocksTimer(wxTimerEvent &event)
 		return;
 	}
 
-	wxCriticalSectionLocker lock(gs_critsect);
-
-	// There are no sort operator for xid before 8.3
-	if (!connection->BackendMinimumVersion(8, 3) && lockSortColumn == 5)
-	{
-		wxLogError(_("You cannot sort by transaction id on your PostgreSQL release. You need at least 8.3."));
-		lockSortColumn = 1;
-	}
-
-	long row = 0;
-	wxString sql;
-	if (locks_connection->BackendMinimumVersion(8, 3))
-	{
-		sql = wxT("SELECT pg_stat_get_backend_pid(svrid) AS pid, ")
-		      wxT("(SELECT datname FROM pg_database WHERE oid = pgl.database) AS dbname, ")
-		      wxT("coalesce(pgc.relname, pgl.relation::text) AS class, ")
-		      wxT("pg_get_userbyid(pg_stat_get_backend_userid(svrid)) as user, ")
-		      wxT("pgl.virtualxid::text, pgl.virtualtransaction::text AS transaction, pgl.mode, pgl.granted, ")
-		      wxT("date_trunc('second', pg_stat_get_backend_activity_start(svrid)) AS query_start, ")
-		      wxT("pg_stat_get_backend_activity(svrid) AS query ")
-		      wxT("FROM pg_stat_get_backend_idset() svrid, pg_locks pgl ")
-		      wxT("LEFT JOIN pg_class pgc ON pgl.relation=pgc.oid ")
-		      wxT("WHERE pgl.pid = pg_stat_get_backend_pid(svrid) ")
-		      wxT("ORDER BY ") + NumToStr((long)lockSortColumn) + wxT(" ") + lockSortOrder;
-	}
-	else if (locks_connection->BackendMinimumVersion(7, 4))
-	{
-		sql = wxT("SELECT pg_stat_get_backend_pid(svrid) AS pid, ")
-		      wxT("(SELECT datname FROM pg_database WHERE oid = pgl.database) AS dbname, ")
-		      wxT("coalesce(pgc.relname, pgl.relation::text) AS class, ")
-		      wxT("pg_get_userbyid(pg_stat_get_backend_userid(svrid)) as user, ")
-		      wxT("pgl.transaction, pgl.mode, pgl.granted, ")
-		      wxT("date_trunc('second', pg_stat_get_backend_activity_start(svrid)) AS query_start, ")
-		      wxT("pg_stat_get_backend_activity(svrid) AS query ")
-		      wxT("FROM pg_stat_get_backend_idset() svrid, pg_locks pgl ")
-		      wxT("LEFT JOIN pg_class pgc ON pgl.relation=pgc.oid ")
-		      wxT("WHERE pgl.pid = pg_stat_get_backend_pid(svrid) ")
-		      wxT("ORDER BY ") + NumToStr((long)lockSortColumn) + wxT(" ") + lockSortOrder;
-	}
-	else
-	{
-		sql = wxT("SELECT pg_stat_get_backend_pid(svrid) AS pid, ")
-		      wxT("(SELECT datname FROM pg_database WHERE oid = pgl.database) AS dbname, ")
-		      wxT("coalesce(pgc.relname, pgl.relation::text) AS class, ")
-		      wxT("pg_get_userbyid(pg_stat_get_backend_userid(svrid)) as user, ")
-		      wxT("pgl.transaction, pgl.mode, pgl.granted, ")
-		      wxT("pg_stat_get_backend_activity(svrid) AS query ")
-		      wxT("FROM pg_stat_get_backend_idset() svrid, pg_locks pgl ")
-		      wxT("LEFT JOIN pg_class pgc ON pgl.relation=pgc.oid ")
-		      wxT("WHERE pgl.pid = pg_stat_get_backend_pid(svrid) ")
-		      wxT("ORDER BY ") + NumToStr((long)lockSortColumn) + wxT(" ") + lockSortOrder;
-	}
-
-	pgSet *dataSet2 = locks_connection->ExecuteSet(sql);
-	if (dataSet2)
-	{
-		statusBar->SetStatusText(_("Refreshing locks list."));
-		lockList->Freeze();
-
-		while (!dataSet2->Eof())
-		{
-			pid = dataSet2->GetLong(wxT("pid"));
-
-			if (pid != backend_pid)
-			{
-				if (row >= lockList->GetItemCount())
-				{
-					lockList->InsertItem(row, NumToStr(pid), -1);
-					row = lockList->GetItemCount() - 1;
-				}
-				else
-				{
-					lockList->SetItem(row, 0, NumToStr(pid));
-				}
-
-				int colpos = 1;
-				lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("dbname")));
-				lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("class")));
-				lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("user")));
-				if (locks_connection->BackendMinimumVersion(8, 3))
-					lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("virtualxid")));
-				lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("transaction")));
-				lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("mode")));
-
-				if (dataSet2->GetVal(wxT("granted")) == wxT("t"))
-					lockList->SetItem(row, colpos++, _("Yes"));
-				else
-					lockList->SetItem(row, colpos++, _("No"));
-
-				wxString qry = dataSet2->GetVal(wxT("query"));
-
-				if (locks_connection->BackendMinimumVersion(7, 4))
-				{
-					if (qry.IsEmpty() || qry == wxT("<IDLE>"))
-						lockList->SetItem(row, colpos++, wxEmptyString);
-					else
-						lockList->SetItem(row, colpos++, dataSet2->GetVal(wxT("query_start")));
-				}
-				lockList->SetItem(row, colpos++, qry.Left(250));
-
-				row++;
-			}
-			dataSet2->MoveNext();
-		}
-
-		delete dataSet2;
-
-		while (row < lockList->GetItemCount())
-			lockList->DeleteItem(row);
-
-		lockList->Thaw();
-		wxListEvent ev;
-		OnSelLockItem(ev);
-		statusBar->SetStatusText(_("Done."));
-	}
-	else
-		checkConnection();
+	refresher->Refresh(PANE_LOCKS);
 }
 
 
@@ -1672,8 +1401,7 @@ void frmStatus::OnRefreshXactTimer(wxTimerEvent &event)
 	if (! viewMenu->IsEnabled(MNU_XACTPAGE) || ! viewMenu->IsChecked(MNU_XACTPAGE) || !xactTimer)
 		return;
 
-	checkConnection();
-	if (!connection)
+	if (!connection || !refresher)
 	{
 		statusTimer->Stop();
 		locksTimer->Stop();
@@ -1683,67 +1411,61 @@ void frmStatus::OnRefreshXactTimer(wxTimerEvent &event)
 		return;
 	}
 
-	wxCriticalSectionLocker lock(gs_critsect);
+	refresher->Refresh(PANE_XACT);
+}
 
-	// There are no sort operator for xid before 8.3
-	if (!connection->BackendMinimumVersion(8, 3) && xactSortColumn == 1)
-	{
-		wxLogError(_("You cannot sort by transaction id on your PostgreSQL release. You need at least 8.3."));
-		xactSortColumn = 2;
-	}
 
-	long row = 0;
-	wxString sql;
-	if (connection->BackendMinimumVersion(8, 3))
-		sql = wxT("SELECT transaction::text, gid, prepared, owner, database ")
-		      wxT("FROM pg_prepared_xacts ")
-		      wxT("ORDER BY ") + NumToStr((long)xactSortColumn) + wxT(" ") + xactSortOrder;
-	else
-		sql = wxT("SELECT transaction, gid, prepared, owner, database ")
-		      wxT("FROM pg_prepared_xacts ")
-		      wxT("ORDER BY ") + NumToStr((long)xactSortColumn) + wxT(" ") + xactSortOrder;
+// The refresh thread has read a list
+void frmStatus::OnRefreshed(wxCommandEvent &event)
+{
+	statusSnapshot *snap = (statusSnapshot *)event.GetClientData();
+	if (!snap)
+		return;
 
-	pgSet *dataSet3 = connection->ExecuteSet(sql);
-	if (dataSet3)
+	if (!snap->ok)
 	{
-		statusBar->SetStatusText(_("Refreshing transactions list."));
-		xactList->Freeze();
+		delete snap;
+		checkConnection();
+		return;
+	}
 
-		while (!dataSet3->Eof())
-		{
-			long xid = dataSet3->GetLong(wxT("transaction"));
+	wxListEvent ev;
 
-			if (row >= xactList->GetItemCount())
-			{
-				xactList->InsertItem(row, NumToStr(xid), -1);
-				row = xactList->GetItemCount() - 1;
-			}
+	// The lists take the snapshots over
+	switch (snap->pane)
+	{
+		case PANE_STATUS:
+			statusBar->SetStatusText(_("Refreshing status list."));
+			statusList->SetHighlight(viewMenu->IsChecked(MNU_HIGHLIGHTSTATUS));
+			statusList->SetSnapshot(snap);
+			if (currentPane == PANE_STATUS)
+				OnSelStatusItem(ev);
+			break;
+		case PANE_LOCKS:
+			statusBar->SetStatusText(_("Refreshing locks list."));
+			lockList->SetSnapshot(snap);
+			if (currentPane == PANE_LOCKS)
+				OnSelLockItem(ev);
+			break;
+		case PANE_XACT:
+			statusBar->SetStatusText(_("Refreshing transactions list."));
+			xactList->SetSnapshot(snap);
+			if (currentPane == PANE_XACT)
+				OnSelXactItem(ev);
+			break;
+		case PANE_LOG:
+			statusBar->SetStatusText(_("Refreshing log list."));
+			if (snap->serial == logSerial)
+				logList->AppendRows(snap);
 			else
-			{
-				xactList->SetItem(row, 0, NumToStr(xid));
-			}
-
-			int colpos = 1;
-			xactList->SetItem(row, colpos++, dataSet3->GetVal(wxT("gid")));
-			xactList->SetItem(row, colpos++, dataSet3->GetVal(wxT("prepared")));
-			xactList->SetItem(row, colpos++, dataSet3->GetVal(wxT("owner")));
-			xactList->SetItem(row, colpos++, dataSet3->GetVal(wxT("database")));
-
-			row++;
-			dataSet3->MoveNext();
-		}
-		delete dataSet3;
-
-		while (row < xactList->GetItemCount())
-			xactList->DeleteItem(row);
-
-		xactList->Thaw();
-		wxListEvent ev;
-		OnSelXactItem(ev);
-		statusBar->SetStatusText(_("Done."));
+				delete snap;
+			break;
+		default:
+			delete snap;
+			break;
 	}
-	else
-		checkConnection();
+
+	statusBar->SetStatusText(_("Done."));
 }
 
 
@@ -1753,7 +1475,7 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 		return;
 
 	checkConnection();
-	if (!connection)
+	if (!connection || !logReader)
 	{
 		statusTimer->Stop();
 		locksTimer->Stop();
@@ -1763,8 +1485,6 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 		return;
 	}
 
-	wxCriticalSectionLocker lock(gs_critsect);
-
 	if (connection->GetLastResultError().sql_state == wxT("42501"))
 	{
 		// Don't have superuser privileges, so can't do anything with the log display
@@ -1776,8 +1496,6 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 		return;
 	}
 
-	long newlen = 0;
-
 	if (logDirectory.IsEmpty())
 	{
 		// freshly started
@@ -1794,7 +1512,6 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 		}
 		if (fillLogfileCombo())
 		{
-			savedPartialLine.Clear();
 			cbLogfiles->SetSelection(0);
 			wxCommandEvent ev;
 			OnLoadLogfile(ev);
@@ -1804,9 +1521,9 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 		{
 			logDirectory = wxT("-");
 			if (connection->BackendMinimumVersion(8, 3))
-				logList->AppendItem(-1, wxString(_("logging_collector not enabled or log_filename misconfigured")));
+				logList->AppendMessage(_("logging_collector not enabled or log_filename misconfigured"));
 			else
-				logList->AppendItem(-1, wxString(_("redirect_stderr not enabled or log_filename misconfigured")));
+				logList->AppendMessage(_("redirect_stderr not enabled or log_filename misconfigured"));
 			cbLogfiles->Disable();
 			btnRotateLog->Disable();
 		}
@@ -1815,31 +1532,10 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 	if (logDirectory == wxT("-"))
 		return;
 
+	// The reader checks if the current logfile grew, and reads what was
+	// added
 	if (isCurrent)
-	{
-		// check if the current logfile changed
-		pgSet *set = connection->ExecuteSet(wxT("SELECT pg_file_length(") + connection->qtDbString(logfileName) + wxT(") AS len"));
-		if (set)
-		{
-			newlen = set->GetLong(wxT("len"));
-			delete set;
-		}
-		else
-		{
-			checkConnection();
-			return;
-		}
-		if (newlen > logfileLength)
-		{
-			statusBar->SetStatusText(_("Refreshing log list."));
-			addLogFile(logfileName, logfileTimestamp, newlen, logfileLength, false);
-			statusBar->SetStatusText(_("Done."));
-
-			// as long as there was new data, the logfile is probably the current
-			// one so we don't need to check for rotation
-			return;
-		}
-	}
+		logReader->Poll();
 
 	//
 	wxString newDirectory = connection->ExecuteScalar(wxT("SHOW log_directory"));
@@ -1862,11 +1558,10 @@ void frmStatus::OnRefreshLogTimer(wxTimerEvent &event)
 
 			while (newfiles--)
 			{
-				addLogLine(_("pgadmin:Logfile rotated."), false);
 				wxDateTime *ts = (wxDateTime *)cbLogfiles->wxItemContainer::GetClientData(pos++);
 				wxASSERT(ts != 0);
 
-				addLogFile(ts, skipFirst);
+				addLogFile(ts, skipFirst, true);
 				skipFirst = false;
 
 				pos++;
@@ -1889,11 +1584,7 @@ void frmStatus::OnRefresh(wxCommandEvent &event)
 
 void frmStatus::checkConnection()
 {
-	if (!locks_connection->IsAlive())
-	{
-		locks_connection = connection;
-	}
-	if (!connection->IsAlive())
+	if (connection && !connection->IsAlive())
 	{
 		delete connection;
 		connection = 0;
@@ -1910,7 +1601,7 @@ void frmStatus::checkConnection()
 }
 
 
-void frmStatus::addLogFile(wxDateTime *dt, bool skipFirst)
+void frmStatus::addLogFile(wxDateTime *dt, bool skipFirst, bool rotated)
 {
 	pgSet *set = connection->ExecuteSet(
 	                 wxT("SELECT filetime, filename, pg_file_length(filename) AS len ")
@@ -1920,510 +1611,18 @@ void frmStatus::addLogFile(wxDateTime *dt, bool skipFirst)
 	{
 		logfileName = set->GetVal(wxT("filename"));
 		logfileTimestamp = set->GetDateTime(wxT("filetime"));
-		long len = set->GetLong(wxT("len"));
-
-		logfileLength = 0;
-		addLogFile(logfileName, logfileTimestamp, len, logfileLength, skipFirst);
-
-		delete set;
-	}
-}
-
-
-void frmStatus::addLogFile(const wxString &filename, const wxDateTime timestamp, long len, long &read, bool skipFirst)
-{
-	wxString line;
-
-	if (skipFirst)
-	{
-		long maxServerLogSize = settings->GetMaxServerLogSize();
-
-		if (!logfileLength && maxServerLogSize && logfileLength > maxServerLogSize)
-		{
-			long maxServerLogSize = settings->GetMaxServerLogSize();
-			len = read - maxServerLogSize;
-		}
-		else
-			skipFirst = false;
-	}
-
-	// If GPDB 3.3 and later, log is normally in CSV format.  Let's get a whole log line before calling addLogLine,
-	// so we can do things smarter.
 
-	// PostgreSQL can log in CSV format, as well as regular format.  Normally, we'd only see
-	// the regular format logs here, because pg_logdir_ls only returns those.  But if pg_logdir_ls is
-	// changed to return the csv format log files, we should handle it.
-
-	bool csv_log_format = filename.Right(4) == wxT(".csv");
-
-	if (csv_log_format && savedPartialLine.length() > 0)
-	{
-		if (read == 0)  // Starting at beginning of log file
-			savedPartialLine.clear();
+		// A rotated logfile is shown after the previous one, the rows
+		// still coming for another logfile are dropped
+		if (rotated)
+			logReader->Open(logfileName, skipFirst, true);
 		else
-			line = savedPartialLine;
-	}
-
-	while (len > read)
-	{
-		statusBar->SetStatusText(_("Reading log from server..."));
-		pgSet *set = connection->ExecuteSet(wxT("SELECT pg_file_read(") +
-		                                    connection->qtDbString(filename) + wxT(", ") + NumToStr(read) + wxT(", 50000)"));
-		if (!set)
-		{
-			connection->IsAlive();
-			return;
-		}
-		char *raw = set->GetCharPtr(0);
-
-		if (!raw || !*raw)
 		{
-			delete set;
-			break;
+			logSerial = logReader->Open(logfileName, skipFirst, false);
+			logList->DeleteRows();
 		}
 
-		read += strlen(raw);
-
-		wxString str;
-		if (wxString(wxString(raw, wxConvLibc).wx_str(), wxConvUTF8).Len() > 0)
-			str = line + wxString(wxString(raw, wxConvLibc).wx_str(), wxConvUTF8);
-		else
-			str = line + wxTextBuffer::Translate(wxString(raw, set->GetConversion()), wxTextFileType_Unix);
-
 		delete set;
-
-		if (str.Len() == 0)
-		{
-			wxString msgstr = _("The server log contains entries in multiple encodings and cannot be displayed by pgAdmin.");
-			wxMessageBox(msgstr);
-			return;
-		}
-
-		if (csv_log_format)
-		{
-			// This will work for any DB using CSV format logs
-
-			if (logHasTimestamp)
-			{
-				// Right now, csv format logs from GPDB and PostgreSQL always start with a timestamp, so we count on that.
-
-				// And the only reason we need to do that is to make sure we are in sync.
-
-				// Bad things happen if we start in the middle of a
-				// double-quoted string, as we would never find a correct line terminator!
-
-				// In CSV logs, the first field must be a Timestamp, so must start with "2009" or "201" or "202" (at least for the next 20 years).
-				if (str.length() > 4 && str.Left(4) != wxT("2009") && str.Left(3) != wxT("201") && str.Left(3) != wxT("202"))
-				{
-					wxLogNotice(wxT("Log line does not start with timestamp: %s \n"), str.Mid(0, 100).c_str());
-					// Something isn't right, as we are not at the beginning of a csv log record.
-					// We should never get here, but if we do, try to handle it in a smart way.
-					str = str.Mid(str.Find(wxT("\n20")) + 1); // Try to re-sync.
-				}
-			}
-
-			CSVLineTokenizer tk(str);
-
-			logList->Freeze();
-
-			while (tk.HasMoreLines())
-			{
-				line.Clear();
-
-				bool partial;
-				str = tk.GetNextLine(partial);
-				if (partial)
-				{
-					line = str; // Start of a log line, but not complete.  Loop back, Read more data.
-					break;
-				}
-
-				// Some extra debug checking, assuming csv logs line start with timestamps.
-				// Not really necessary, but it is good for debugging if something isn't right.
-				if (logHasTimestamp)
-				{
-					// The first field must be a Timestamp, so must start with "2009" or "201" or "202" (at least for the next 20 years).
-					// This is just an extra check to make sure we haven't gotten out of sync with the log.
-					if (str.length() > 5 && str.Left(4) != wxT("2009") && str.Left(3) != wxT("201") && str.Left(3) != wxT("202"))
-					{
-						// BUG:  We are out of sync on the log
-						wxLogNotice(wxT("Log line does not start with timestamp: %s\n"), str.c_str());
-					}
-					else if (str.length() < 20)
-					{
-						// BUG:  We are out of sync on the log, or the log is garbled
-						wxLogNotice(wxT("Log line too short: %s\n"), str.c_str());
-					}
-				}
-
-				// Looks like we have a good complete CSV log record.
-				addLogLine(str.Trim(), true, true);
-			}
-
-			logList->Thaw();
-		}
-		else
-		{
-			// Non-csv format log file
-
-			bool hasCr = (str.Right(1) == wxT("\n"));
-
-			wxStringTokenizer tk(str, wxT("\n"));
-
-			logList->Freeze();
-
-			while (tk.HasMoreTokens())
-			{
-				str = tk.GetNextToken();
-				if (skipFirst)
-				{
-					// could be truncated
-					skipFirst = false;
-					continue;
-				}
-
-				if (tk.HasMoreTokens() || hasCr)
-					addLogLine(str.Trim());
-				else
-					line = str;
-			}
-
-			logList->Thaw();
-		}
-	}
-
-	savedPartialLine.clear();
-
-	if (!line.IsEmpty())
-	{
-		// We finished reading to the end of the log file, but still have some data left
-		if (csv_log_format)
-		{
-			savedPartialLine = line;    // Save partial log line for next read of the data file.
-			line.Clear();
-		}
-		else
-			addLogLine(line.Trim());
-	}
-
-}
-
-
-void frmStatus::addLogLine(const wxString &str, bool formatted, bool csv_log_format)
-{
-	int row = logList->GetItemCount();
-
-	int idxTimeStampCol = -1, idxLevelCol = -1;
-	int idxLogEntryCol = 0;
-
-	if (logFormatKnown)
-	{
-		// Known Format first will be level, then Log entry
-		// idxLevelCol : 0, idxLogEntryCol : 1, idxTimeStampCol : -1
-		idxLevelCol++;
-		idxLogEntryCol++;
-		if (logHasTimestamp)
-		{
-			// idxLevelCol : 1, idxLogEntryCol : 2, idxTimeStampCol : 0
-			idxTimeStampCol++;
-			idxLevelCol++;
-			idxLogEntryCol++;
-		}
-	}
-
-	if (!logFormatKnown)
-		logList->AppendItem(-1, str);
-	else if ((!csv_log_format) && str.Find(':') < 0)
-	{
-		// Must be a continuation of a previous line.
-		logList->InsertItem(row, wxEmptyString, -1);
-		logList->SetItem(row, idxLogEntryCol, str);
-	}
-	else if (!formatted)
-	{
-		// Not from a log, from pgAdmin itself.
-		if (logHasTimestamp)
-		{
-			logList->InsertItem(row, wxEmptyString, -1);
-			logList->SetItem(row, idxLevelCol, str.BeforeFirst(':'));
-		}
-		else
-		{
-			logList->InsertItem(row, str.BeforeFirst(':'), -1);
-		}
-		logList->SetItem(row, idxLogEntryCol, str.AfterFirst(':'));
-	}
-	else // formatted log
-	{
-		if (csv_log_format)
-		{
-			// Log is in CSV format (GPDB 3.3 and later, or Postgres if only csv log enabled)
-			// In this case, we are always supposed to have a complete log line in csv format in str when called.
-
-			if (logHasTimestamp && (str.Length() < 20 || (logHasTimestamp && (str[0] != wxT('2') || str[1] != wxT('0')))))
-			{
-				// Log line too short or does not start with an expected timestamp...
-				// Must be a continuation of the previous line or garbage,
-				// or we are out of sync in our CSV handling.
-				// We shouldn't ever get here.
-				logList->InsertItem(row, wxEmptyString, -1);
-				logList->SetItem(row, 2, str);
-			}
-			else
-			{
-				CSVTokenizer tk(str);
-
-				bool gpdb = connection->GetIsGreenplum();
-
-				// Get the fields from the CSV log.
-				wxString logTime = tk.GetNextToken();
-				wxString logUser = tk.GetNextToken();
-				wxString logDatabase = tk.GetNextToken();
-				wxString logPid = tk.GetNextToken();
-
-				wxString logSession;
-				wxString logCmdcount;
-				wxString logSegment;
-
-				if (gpdb)
-				{
-					wxString logThread =  tk.GetNextToken();        // GPDB specific
-					wxString logHost = tk.GetNextToken();
-					wxString logPort = tk.GetNextToken();           // GPDB (Postgres puts port with Host)
-					wxString logSessiontime = tk.GetNextToken();
-					wxString logTransaction = tk.GetNextToken();
-					logSession = tk.GetNextToken();
-					logCmdcount = tk.GetNextToken();
-					logSegment = tk.GetNextToken();
-					wxString logSlice = tk.GetNextToken();
-					wxString logDistxact = tk.GetNextToken();
-					wxString logLocalxact = tk.GetNextToken();
-					wxString logSubxact = tk.GetNextToken();
-				}
-				else
-				{
-					wxString logHost = tk.GetNextToken();       // Postgres puts port with Hostname
-					logSession = tk.GetNextToken();
-					wxString logLineNumber = tk.GetNextToken();
-					wxString logPsDisplay = tk.GetNextToken();
-					wxString logSessiontime = tk.GetNextToken();
-					wxString logVXid = tk.GetNextToken();
-					wxString logTransaction = tk.GetNextToken();
-				}
-
-				wxString logSeverity = tk.GetNextToken();
-				wxString logState = tk.GetNextToken();
-				wxString logMessage = tk.GetNextToken();
-				wxString logDetail = tk.GetNextToken();
-				wxString logHint = tk.GetNextToken();
-				wxString logQuery = tk.GetNextToken();
-				wxString logQuerypos = tk.GetNextToken();
-				wxString logContext = tk.GetNextToken();
-				wxString logDebug = tk.GetNextToken();
-				wxString logCursorpos = tk.GetNextToken();
-
-				wxString logStack;
-				if (gpdb)
-				{
-					wxString logFunction = tk.GetNextToken();       // GPDB.  Postgres puts func, file, and line together
-					wxString logFile = tk.GetNextToken();
-					wxString logLine = tk.GetNextToken();
-					logStack = tk.GetNextToken();                   // GPDB only.
-				}
-				else
-					wxString logFuncFileLine = tk.GetNextToken();
-
-				logList->InsertItem(row, logTime, -1);      // Insert timestamp (with time zone)
-
-				logList->SetItem(row, 1, logSeverity);
-
-				// Display the logMessage, breaking it into lines
-				wxStringTokenizer lm(logMessage, wxT("\n"));
-				logList->SetItem(row, 2, lm.GetNextToken());
-
-				logList->SetItem(row, 3, logSession);
-				logList->SetItem(row, 4, logCmdcount);
-				logList->SetItem(row, 5, logDatabase);
-				if ((!gpdb) || (logSegment.length() > 0 && logSegment != wxT("seg-1")))
-				{
-					logList->SetItem(row, 6, logSegment);
-				}
-				else
-				{
-					// If we are reading the masterDB log only, the logSegment won't
-					// have anything useful in it.  Look in the logMessage, and see if the
-					// segment info exists in there.  It will always be at the end.
-					if (logMessage.length() > 0 && logMessage[logMessage.length() - 1] == wxT(')'))
-					{
-						int segpos = -1;
-						segpos = logMessage.Find(wxT("(seg"));
-						if (segpos <= 0)
-							segpos = logMessage.Find(wxT("(mir"));
-						if (segpos > 0)
-						{
-							logSegment = logMessage.Mid(segpos + 1);
-							if (logSegment.Find(wxT(' ')) > 0)
-								logSegment = logSegment.Mid(0, logSegment.Find(wxT(' ')));
-							logList->SetItem(row, 6, logSegment);
-						}
-					}
-				}
-
-				// The rest of the lines from the logMessage
-				while (lm.HasMoreTokens())
-				{
-					int controw = logList->GetItemCount();
-					logList->InsertItem(controw, wxEmptyString, -1);
-					logList->SetItem(controw, 2, lm.GetNextToken());
-				}
-
-				// Add the detail
-				wxStringTokenizer ld(logDetail, wxT("\n"));
-				while (ld.HasMoreTokens())
-				{
-					int controw = logList->GetItemCount();
-					logList->InsertItem(controw, wxEmptyString, -1);
-					logList->SetItem(controw, 2, ld.GetNextToken());
-				}
-
-				// And the hint
-				wxStringTokenizer lh(logHint, wxT("\n"));
-				while (lh.HasMoreTokens())
-				{
-					int controw = logList->GetItemCount();
-					logList->InsertItem(controw, wxEmptyString, -1);
-					logList->SetItem(controw, 2, lh.GetNextToken());
-				}
-
-				if (logDebug.length() > 0)
-				{
-					wxString logState3 = logState.Mid(0, 3);
-					if (logState3 == wxT("426") || logState3 == wxT("22P") || logState3 == wxT("427")
-					        || logState3 == wxT("42P") || logState3 == wxT("458")
-					        || logMessage.Mid(0, 9) == wxT("duration:") || logSeverity == wxT("FATAL") || logSeverity == wxT("PANIC"))
-					{
-						// If not redundant, add the statement from the debug_string
-						wxStringTokenizer lh(logDebug, wxT("\n"));
-						if (lh.HasMoreTokens())
-						{
-							int controw = logList->GetItemCount();
-							logList->InsertItem(controw, wxEmptyString, -1);
-							logList->SetItem(controw, 2, wxT("statement: ") + lh.GetNextToken());
-						}
-						while (lh.HasMoreTokens())
-						{
-							int controw = logList->GetItemCount();
-							logList->InsertItem(controw, wxEmptyString, -1);
-							logList->SetItem(controw, 2, lh.GetNextToken());
-						}
-					}
-				}
-
-				if (gpdb)
-					if (logSeverity == wxT("PANIC") ||
-					        (logSeverity == wxT("FATAL") && logState != wxT("57P03") && logState != wxT("53300")))
-					{
-						// If this is a severe error, add the stack trace.
-						wxStringTokenizer ls(logStack, wxT("\n"));
-						if (ls.HasMoreTokens())
-						{
-							int controw = logList->GetItemCount();
-							logList->InsertItem(controw, wxEmptyString, -1);
-							logList->SetItem(controw, 1, wxT("STACK"));
-							logList->SetItem(controw, 2, ls.GetNextToken());
-						}
-						while (ls.HasMoreTokens())
-						{
-							int controw = logList->GetItemCount();
-							logList->InsertItem(controw, wxEmptyString, -1);
-							logList->SetItem(controw, 2, ls.GetNextToken());
-						}
-					}
-			}
-		}
-		else if (connection->GetIsGreenplum())
-		{
-			// Greenplum 3.2 and before.  log_line_prefix =  "%m|%u|%d|%p|%I|%X|:-"
-
-			wxString logSeverity;
-			// Skip prefix, get message.  In GPDB, always follows ":-".
-			wxString rest = str.Mid(str.Find(wxT(":-")) + 1) ;
-			if (rest.Length() > 0 && rest[0] == wxT('-'))
-				rest = rest.Mid(1);
-
-			// Separate loglevel from message
-
-			if (rest.Length() > 1 && rest[0] != wxT(' ') && rest.Find(':') > 0)
-			{
-				logSeverity = rest.BeforeFirst(':');
-				rest = rest.AfterFirst(':').Mid(2);
-			}
-
-			wxString ts = str.BeforeFirst(logFormat.c_str()[logFmtPos + 2]);
-			if (ts.Length() < 20  || (logHasTimestamp && (ts.Left(2) != wxT("20") || str.Find(':') < 0)))
-			{
-				// No Timestamp?  Must be a continuation of a previous line?
-				// Not sure if it is possible to get here.
-				logList->InsertItem(row, wxEmptyString, -1);
-				logList->SetItem(row, 2, rest);
-			}
-			else if (logSeverity.Length() > 1)
-			{
-				// Normal case:  Start of a new log record.
-				logList->InsertItem(row, ts, -1);
-				logList->SetItem(row, 1, logSeverity);
-				logList->SetItem(row, 2, rest);
-			}
-			else
-			{
-				// Continuation of previous line
-				logList->InsertItem(row, wxEmptyString, -1);
-				logList->SetItem(row, 2, rest);
-			}
-		}
-		else
-		{
-			// All Non-csv-format non-GPDB PostgreSQL systems.
-
-			wxString rest;
-
-			if (logHasTimestamp)
-			{
-				if (formatted)
-				{
-					rest = str.Mid(logFmtPos + 22).AfterFirst(':');
-					wxString ts = str.Mid(logFmtPos, str.Length() - rest.Length() - logFmtPos - 1);
-
-					int pos = ts.Find(logFormat.c_str()[logFmtPos + 2], true);
-					logList->InsertItem(row, ts.Left(pos), -1);
-					logList->SetItem(row, idxLevelCol, ts.Mid(pos + logFormat.Length() - logFmtPos - 2));
-					logList->SetItem(row, idxLogEntryCol, rest.Mid(2));
-				}
-				else
-				{
-					logList->InsertItem(row, wxEmptyString, -1);
-					logList->SetItem(row, idxLevelCol, str.BeforeFirst(':'));
-					logList->SetItem(row, idxLogEntryCol, str.AfterFirst(':').Mid(2));
-				}
-			}
-			else
-			{
-				if (formatted)
-					rest = str.Mid(logFormat.Length());
-				else
-					rest = str;
-
-				int pos = rest.Find(':');
-
-				if (pos < 0)
-					logList->InsertItem(row, rest, -1);
-				else
-				{
-					logList->InsertItem(row, rest.BeforeFirst(':'), -1);
-					logList->SetItem(row, idxLogEntryCol, rest.AfterFirst(':').Mid(2));
-				}
-			}
-		}
 	}
 }
 
@@ -2495,11 +1694,8 @@ void frmStatus::OnLoadLogfile(wxCommandEvent &event)
 		wxDateTime *ts = (wxDateTime *)cbLogfiles->wxItemContainer::GetClientData(showCurrent ? 1 : pos);
 		wxASSERT(ts != 0);
 
-		if (ts != NULL && (!logfileTimestamp.IsValid() || *ts != logfileTimestamp))
-		{
-			logList->DeleteAllItems();
+		if (ts != NULL && logReader && (!logfileTimestamp.IsValid() || *ts != logfileTimestamp))
 			addLogFile(ts, true);
-		}
 	}
 }
 
@@ -3021,7 +2217,7 @@ void frmStatus::SetColumnImage(ctlListView *list, int col, int image)
 
 void frmStatus::OnSortStatusGrid(wxListEvent &event)
 {
-	// Get the information for the SQL ORDER BY
+	// Get the sort column and order
 	if (statusSortColumn == event.GetColumn() + 1)
 	{
 		if (statusSortOrder == wxT("ASC"))
@@ -3035,7 +2231,6 @@ void frmStatus::OnSortStatusGrid(wxListEvent &event)
 		statusSortOrder = wxT("ASC");
 	}
 
-
 	// Re-initialize all columns' image
 	for (int i = 0; i < statusList->GetColumnCount(); i++)
 	{
@@ -3048,15 +2243,14 @@ void frmStatus::OnSortStatusGrid(wxListEvent &event)
 	else
 		SetColumnImage(statusList, statusSortColumn - 1, 1);
 
-	// Refresh grid
-	wxTimerEvent evt;
-	OnRefreshStatusTimer(evt);
+	// Sort the rows already read
+	statusList->Sort(statusSortColumn - 1, statusSortOrder == wxT("ASC"));
 }
 
 
 void frmStatus::OnSortLockGrid(wxListEvent &event)
 {
-	// Get the information for the SQL ORDER BY
+	// Get the sort column and order
 	if (lockSortColumn == event.GetColumn() + 1)
 	{
 		if (lockSortOrder == wxT("ASC"))
@@ -3070,13 +2264,6 @@ void frmStatus::OnSortLockGrid(wxListEvent &event)
 		lockSortOrder = wxT("ASC");
 	}
 
-	// There are no sort operator for xid before 8.3
-	if (!connection->BackendMinimumVersion(8, 3) && lockSortColumn == 5)
-	{
-		wxLogError(_("You cannot sort by transaction id on your PostgreSQL release. You need at least 8.3."));
-		lockSortColumn = 1;
-	}
-
 	// Re-initialize all columns' image
 	for (int i = 0; i < lockList->GetColumnCount(); i++)
 	{
@@ -3089,15 +2276,14 @@ void frmStatus::OnSortLockGrid(wxListEvent &event)
 	else
 		SetColumnImage(lockList, lockSortColumn - 1, 1);
 
-	// Refresh grid
-	wxTimerEvent evt;
-	OnRefreshLocksTimer(evt);
+	// Sort the rows already read
+	lockList->Sort(lockSortColumn - 1, lockSortOrder == wxT("ASC"));
 }
 
 
 void frmStatus::OnSortXactGrid(wxListEvent &event)
 {
-	// Get the information for the SQL ORDER BY
+	// Get the sort column and order
 	if (xactSortColumn == event.GetColumn() + 1)
 	{
 		if (xactSortOrder == wxT("ASC"))
@@ -3111,13 +2297,6 @@ void frmStatus::OnSortXactGrid(wxListEvent &event)
 		xactSortOrder = wxT("ASC");
 	}
 
-	// There are no sort operator for xid before 8.3
-	if (!connection->BackendMinimumVersion(8, 3) && xactSortColumn == 1)
-	{
-		wxLogError(_("You cannot sort by transaction id on your PostgreSQL release. You need at least 8.3."));
-		xactSortColumn = 2;
-	}
-
 	// Re-initialize all columns' image
 	for (int i = 0; i < xactList->GetColumnCount(); i++)
 	{
@@ -3130,9 +2309,8 @@ void frmStatus::OnSortXactGrid(wxListEvent &event)
 	else
 		SetColumnImage(xactList, xactSortColumn - 1, 1);
 
-	// Refresh grid
-	wxTimerEvent evt;
-	OnRefreshXactTimer(evt);
+	// Sort the rows already read
+	xactList->Sort(xactSortColumn - 1, xactSortOrder == wxT("ASC"));
 }
 
 
@@ -3171,6 +2349,1380 @@ void frmStatus::OnChgColSizeXactGrid(wxListEvent &event)
 }
 
 
+// Run a query, reconnecting first if the connection was lost. Returns
+// NULL if there is no result.
+static pgSet *ExecuteStatusSet(pgConn *c, const wxString &sql)
+{
+	if (c->GetStatus() != PGCONN_OK && !c->Reconnect())
+		return NULL;
+
+	pgSet *set = c->ExecuteSet(sql);
+	if (set && c->GetLastResultStatus() != PGRES_TUPLES_OK)
+	{
+		delete set;
+		set = NULL;
+	}
+	return set;
+}
+
+
+statusListView::statusListView(wxWindow *parent, int id)
+	: ctlListView(parent, id, wxDefaultPosition, wxDefaultSize, wxLC_VIRTUAL | wxSUNKEN_BORDER)
+{
+	snapshot = NULL;
+	sortColumn = 0;
+	sortAscending = true;
+	highlight = false;
+}
+
+
+statusListView::~statusListView()
+{
+	if (snapshot)
+		delete snapshot;
+}
+
+
+void statusListView::AddNumberColumn(const wxString &text, int size)
+{
+	AddColumn(text, size);
+
+	while (colTypes.GetCount() < (size_t)GetColumnCount())
+		colTypes.Add(STATUSCOL_TEXT);
+	colTypes.Last() = STATUSCOL_NUMBER;
+}
+
+
+statusRow *statusListView::GetRow(long item) const
+{
+	if (item < 0 || item >= (long)rows.GetCount())
+		return NULL;
+	return rows.Item(item);
+}
+
+
+// Show the rows of a refresh, the list takes the snapshot over. Only the
+// visible items are drawn again, and only if something changed.
+void statusListView::SetSnapshot(statusSnapshot *snap)
+{
+	bool changed = !snapshot || snap->removed.GetCount() > 0 ||
+	               snap->rows.GetCount() != rows.GetCount();
+	size_t i;
+
+	for (i = 0 ; !changed && i < snap->rows.GetCount() ; i++)
+		changed = snap->rows.Item(i)->state != STATUSROW_SAME;
+
+	// The rows may move, the selection follows them
+	wxStringToStringHashMap selected;
+	GetSelectedKeys(selected);
+
+	if (snapshot)
+		delete snapshot;
+	snapshot = snap;
+
+	rows = snapshot->rows;
+	SortRows();
+
+	if ((long)rows.GetCount() != GetItemCount())
+		SetItemCount(rows.GetCount());
+
+	SetSelectedKeys(selected);
+
+	if (changed)
+		Refresh();
+}
+
+
+void statusListView::Sort(int col, bool ascending)
+{
+	wxStringToStringHashMap selected;
+	GetSelectedKeys(selected);
+
+	sortColumn = col;
+	sortAscending = ascending;
+	SortRows();
+
+	SetSelectedKeys(selected);
+	Refresh();
+}
+
+
+void statusListView::GetSelectedKeys(wxStringToStringHashMap &keys)
+{
+	long item = GetFirstSelected();
+	while (item >= 0)
+	{
+		statusRow *row = GetRow(item);
+		if (row)
+			keys[row->key] = wxEmptyString;
+		item = GetNextSelected(item);
+	}
+}
+
+
+// Only the items whose selection changes are touched, so that no
+// selection event is sent for the rows which stay selected
+void statusListView::SetSelectedKeys(const wxStringToStringHashMap &keys)
+{
+	if (keys.empty() && !GetSelectedItemCount())
+		return;
+
+	for (size_t i = 0 ; i < rows.GetCount() ; i++)
+	{
+		bool select = keys.find(rows.Item(i)->key) != keys.end();
+		if (select != IsSelected(i))
+			Select(i, select);
+	}
+}
+
+
+void statusListView::SetHighlight(bool _highlight)
+{
+	if (_highlight)
+	{
+		attrs[STATUSHIGHLIGHT_ACTIVE].SetBackgroundColour(wxColour(settings->GetActiveProcessColour()));
+		attrs[STATUSHIGHLIGHT_IDLE].SetBackgroundColour(wxColour(settings->GetIdleProcessColour()));
+		attrs[STATUSHIGHLIGHT_BLOCKED].SetBackgroundColour(wxColour(settings->GetBlockedProcessColour()));
+		attrs[STATUSHIGHLIGHT_SLOW].SetBackgroundColour(wxColour(settings->GetSlowProcessColour()));
+	}
+
+	if (highlight != _highlight)
+	{
+		highlight = _highlight;
+		Refresh();
+	}
+}
+
+
+wxString statusListView::OnGetItemText(long item, long col) const
+{
+	statusRow *row = GetRow(item);
+	if (!row || col < 0 || col >= (long)row->cells.GetCount())
+		return wxEmptyString;
+
+	return row->cells.Item(col);
+}
+
+
+int statusListView::OnGetItemImage(long item) const
+{
+	// The image list only holds the sort arrows of the headers
+	return -1;
+}
+
+
+wxListItemAttr *statusListView::OnGetItemAttr(long item) const
+{
+	statusRow *row = GetRow(item);
+	if (!highlight || !row)
+		return NULL;
+
+	return (wxListItemAttr *)&attrs[row->highlight];
+}
+
+
+// The rows are sorted by one thread only, the UI one
+static int sortCol;
+static int sortDirection;
+static bool sortNumeric;
+
+static int StatusRowCmp(statusRow **a, statusRow **b)
+{
+	int res = 0;
+
+	if (sortNumeric)
+	{
+		if ((*a)->sortNumber < (*b)->sortNumber)
+			res = -1;
+		else if ((*a)->sortNumber > (*b)->sortNumber)
+			res = 1;
+	}
+	else
+	{
+		const wxArrayString &cellsa = (*a)->cells, &cellsb = (*b)->cells;
+
+		if (sortCol < (int)cellsa.GetCount() && sortCol < (int)cellsb.GetCount())
+			res = cellsa.Item(sortCol).Cmp(cellsb.Item(sortCol));
+	}
+
+	// Keep the rows in a stable order from one refresh to the next
+	if (!res)
+		res = (*a)->key.Cmp((*b)->key);
+
+	return res * sortDirection;
+}
+
+
+void statusListView::SortRows()
+{
+	if (rows.GetCount() < 2)
+		return;
+
+	sortCol = sortColumn;
+	sortDirection = sortAscending ? 1 : -1;
+	sortNumeric = sortColumn < (int)colTypes.GetCount() && colTypes.Item(sortColumn) == STATUSCOL_NUMBER;
+
+	// Convert the numbers once, not on each comparison. Empty values
+	// come first.
+	if (sortNumeric)
+	{
+		for (size_t i = 0 ; i < rows.GetCount() ; i++)
+		{
+			statusRow *row = rows.Item(i);
+
+			if (sortColumn >= (int)row->cells.GetCount() || !row->cells.Item(sortColumn).ToDouble(&row->sortNumber))
+				row->sortNumber = -DBL_MAX;
+		}
+	}
+
+	rows.Sort(StatusRowCmp);
+}
+
+
+statusRefreshThread::statusRefreshThread(wxEvtHandler *_caller, pgConn *_conn, long _ownPid)
+	: wxThread(wxTHREAD_JOINABLE), condition(mutex)
+{
+	caller = _caller;
+	conn = _conn;
+	locksConn = NULL;
+	newLocksConn = NULL;
+	ownPid = _ownPid;
+	pending = 0;
+	stopping = false;
+
+	BuildQueries();
+}
+
+
+statusRefreshThread::~statusRefreshThread()
+{
+	if (newLocksConn)
+		delete newLocksConn;
+	if (locksConn)
+		delete locksConn;
+	if (conn)
+		delete conn;
+}
+
+
+// Ask for a list to be read, requests for a list which is still waiting
+// are merged
+void statusRefreshThread::Refresh(int pane)
+{
+	wxMutexLocker lock(mutex);
+
+	if (pane != PANE_STATUS && pane != PANE_LOCKS && pane != PANE_XACT)
+		return;
+
+	pending |= (1 << pane);
+	condition.Signal();
+}
+
+
+// Read the locks through another connection (in another database), the
+// thread takes it over
+void statusRefreshThread::SetLocksConnection(pgConn *_conn)
+{
+	wxMutexLocker lock(mutex);
+
+	if (newLocksConn)
+		delete newLocksConn;
+	newLocksConn = _conn;
+}
+
+
+void statusRefreshThread::Stop()
+{
+	wxMutexLocker lock(mutex);
+
+	stopping = true;
+	condition.Signal();
+}
+
+
+void *statusRefreshThread::Entry()
+{
+	while (true)
+	{
+		int panes;
+
+		{
+			wxMutexLocker lock(mutex);
+
+			while (!pending && !stopping)
+				condition.Wait();
+
+			if (stopping)
+				break;
+
+			panes = pending;
+			pending = 0;
+
+			if (newLocksConn)
+			{
+				if (locksConn)
+					delete locksConn;
+				locksConn = newLocksConn;
+				newLocksConn = NULL;
+				lockRows.clear();
+			}
+		}
+
+		statusSnapshot *snap;
+
+		for (int pane = PANE_STATUS ; pane <= PANE_XACT ; pane++)
+		{
+			if (!(panes & (1 << pane)) || TestDestroy())
+				continue;
+
+			switch (pane)
+			{
+				case PANE_STATUS:
+					snap = ReadStatus();
+					break;
+				case PANE_LOCKS:
+					snap = ReadLocks();
+					break;
+				default:
+					snap = ReadXacts();
+					break;
+			}
+
+			wxCommandEvent ev(STATUS_REFRESH_EVENT, pane);
+			ev.SetClientData(snap);
+			caller->AddPendingEvent(ev);
+		}
+	}
+
+	return NULL;
+}
+
+
+bool statusRefreshThread::IsOwnPid(long pid)
+{
+	return pid == ownPid || pid == conn->GetBackendPID() ||
+	       (locksConn && pid == locksConn->GetBackendPID());
+}
+
+
+void statusRefreshThread::BuildQueries()
+{
+	wxString pidcol = conn->BackendMinimumVersion(9, 2) ? wxT("p.pid") : wxT("p.procpid");
+	wxString querycol = conn->BackendMinimumVersion(9, 2) ? wxT("query") : wxT("current_query");
+
+	// Activity
+	statusSql = wxT("SELECT ");
+
+	// PID
+	statusSql += pidcol + wxT(" AS pid, ");
+
+	// Application name (when available)
+	if (conn->BackendMinimumVersion(8, 5))
+		statusSql += wxT("application_name, ");
+
+	// Database, and user name
+	statusSql += wxT("datname, usename,\n");
+
+	// Client connection method
+	if (conn->BackendMinimumVersion(8, 1))
+	{
+		statusSql += wxT("CASE WHEN client_port=-1 THEN 'local pipe' ");
+		if (conn->BackendMinimumVersion(9, 1))
+			statusSql += wxT("WHEN length(client_hostname)>0 THEN client_hostname||':'||client_port ");
+		statusSql += wxT("ELSE textin(inet_out(client_addr))||':'||client_port END AS client,\n");
+	}
+
+	// Backend start timestamp
+	if (conn->BackendMinimumVersion(8, 1))
+		statusSql += wxT("date_trunc('second', backend_start) AS backend_start, ");
+
+	// Query start timestamp (when available)
+	if (conn->BackendMinimumVersion(9, 2))
+	{
+		statusSql += wxT("CASE WHEN state='active' THEN date_trunc('second', query_start)::text ELSE '' END ");
+	}
+	else if (conn->BackendMinimumVersion(7, 4))
+	{
+		statusSql += wxT("CASE WHEN ") + querycol + wxT("='' OR ") + querycol + wxT("='<IDLE>' THEN '' ")
+		             wxT("     ELSE date_trunc('second', query_start)::text END ");
+	}
+	else
+	{
+		statusSql += wxT("'' ");
+	}
+	statusSql += wxT("AS query_start,\n");
+
+	// Transaction start timestamp
+	if (conn->BackendMinimumVersion(8, 3))
+		statusSql += wxT("date_trunc('second', xact_start) AS xact_start, ");
+
+	// State
+	if (conn->BackendMinimumVersion(9, 2))
+		statusSql += wxT("state, date_trunc('second', state_change) AS state_change, ");
+
+	// Xmin and XID
+	if (conn->BackendMinimumVersion(9, 4))
+		statusSql += wxT("backend_xid::text, backend_xmin::text, ");
+
+	// Blocked by...
+	statusSql += wxT("(SELECT min(l1.pid) FROM pg_locks l1 WHERE GRANTED AND (")
+	             wxT("relation IN (SELECT relation FROM pg_locks l2 WHERE l2.pid=") + pidcol + wxT(" AND NOT granted)")
+	             wxT(" OR ")
+	             wxT("transactionid IN (SELECT transactionid FROM pg_locks l3 WHERE l3.pid=") + pidcol + wxT(" AND NOT granted)")
+	             wxT(")) AS blockedby,\n");
+
+	// Query
+	statusSql += querycol + wxT(" AS query,\n");
+
+	// Slow query?
+	if (conn->BackendMinimumVersion(9, 2))
+	{
+		statusSql += wxT("CASE WHEN query_start IS NULL OR state<>'active' THEN false ELSE query_start < now() - '10 seconds'::interval END ");
+	}
+	else if (conn->BackendMinimumVersion(7, 4))
+	{
+		statusSql += wxT("CASE WHEN query_start IS NULL OR ") + querycol + wxT(" LIKE '<IDLE>%' THEN false ELSE query_start < now() - '10 seconds'::interval END ");
+	}
+	else
+	{
+		statusSql += wxT("false");
+	}
+	statusSql += wxT("AS slowquery\n");
+
+	// And the rest of the query...
+	statusSql += wxT("FROM pg_stat_activity p ");
+
+	// Locks
+	if (conn->BackendMinimumVersion(8, 3))
+	{
+		locksSql = wxT("SELECT pg_stat_get_backend_pid(svrid) AS pid, ")
+		           wxT("(SELECT datname FROM pg_database WHERE oid = pgl.database) AS dbname, ")
+		           wxT("coalesce(pgc.relname, pgl.relation::text) AS class, ")
+		           wxT("pg_get_userbyid(pg_stat_get_backend_userid(svrid)) as user, ")
+		           wxT("pgl.virtualxid::text, pgl.virtualtransaction::text AS transaction, pgl.mode, pgl.granted, ")
+		           wxT("date_trunc('second', pg_stat_get_backend_activity_start(svrid)) AS query_start, ")
+		           wxT("pg_stat_get_backend_activity(svrid) AS query ")
+		           wxT("FROM pg_stat_get_backend_idset() svrid, pg_locks pgl ")
+		           wxT("LEFT JOIN pg_class pgc ON pgl.relation=pgc.oid ")
+		           wxT("WHERE pgl.pid = pg_stat_get_backend_pid(svrid) ");
+	}
+	else if (conn->BackendMinimumVersion(7, 4))
+	{
+		locksSql = wxT("SELECT pg_stat_get_backend_pid(svrid) AS pid, ")
+		           wxT("(SELECT datname FROM pg_database WHERE oid = pgl.database) AS dbname, ")
+		           wxT("coalesce(pgc.relname, pgl.relation::text) AS class, ")
+		           wxT("pg_get_userbyid(pg_stat_get_backend_userid(svrid)) as user, ")
+		           wxT("pgl.transaction, pgl.mode, pgl.granted, ")
+		           wxT("date_trunc('second', pg_stat_get_backend_activity_start(svrid)) AS query_start, ")
+		           wxT("pg_stat_get_backend_activity(svrid) AS query ")
+		           wxT("FROM pg_stat_get_backend_idset() svrid, pg_locks pgl ")
+		           wxT("LEFT JOIN pg_class pgc ON pgl.relation=pgc.oid ")
+		           wxT("WHERE pgl.pid = pg_stat_get_backend_pid(svrid) ");
+	}
+	else
+	{
+		locksSql = wxT("SELECT pg_stat_get_backend_pid(svrid) AS pid, ")
+		           wxT("(SELECT datname FROM pg_database WHERE oid = pgl.database) AS dbname, ")
+		           wxT("coalesce(pgc.relname, pgl.relation::text) AS class, ")
+		           wxT("pg_get_userbyid(pg_stat_get_backend_userid(svrid)) as user, ")
+		           wxT("pgl.transaction, pgl.mode, pgl.granted, ")
+		           wxT("pg_stat_get_backend_activity(svrid) AS query ")
+		           wxT("FROM pg_stat_get_backend_idset() svrid, pg_locks pgl ")
+		           wxT("LEFT JOIN pg_class pgc ON pgl.relation=pgc.oid ")
+		           wxT("WHERE pgl.pid = pg_stat_get_backend_pid(svrid) ");
+	}
+
+	// Prepared transactions
+	if (conn->BackendMinimumVersion(8, 3))
+		xactSql = wxT("SELECT transaction::text, gid, prepared, owner, database ")
+		          wxT("FROM pg_prepared_xacts ");
+	else
+		xactSql = wxT("SELECT transaction, gid, prepared, owner, database ")
+		          wxT("FROM pg_prepared_xacts ");
+}
+
+
+statusSnapshot *statusRefreshThread::ReadStatus()
+{
+	statusSnapshot *snap = new statusSnapshot(PANE_STATUS);
+
+	pgSet *dataSet1 = ExecuteStatusSet(conn, statusSql);
+	if (!dataSet1)
+	{
+		snap->ok = false;
+		return snap;
+	}
+
+	snap->rows.Alloc(dataSet1->NumRows());
+
+	while (!dataSet1->Eof())
+	{
+		long pid = dataSet1->GetLong(wxT("pid"));
+
+		if (!IsOwnPid(pid))
+		{
+			statusRow *row = new statusRow;
+			wxString qry = dataSet1->GetVal(wxT("query"));
+
+			row->pid = pid;
+			row->key = NumToStr(pid);
+			row->query = qry;
+
+			row->cells.Add(row->key);
+			if (conn->BackendMinimumVersion(8, 5))
+				row->cells.Add(dataSet1->GetVal(wxT("application_name")));
+			row->cells.Add(dataSet1->GetVal(wxT("datname")));
+			row->cells.Add(dataSet1->GetVal(wxT("usename")));
+
+			if (conn->BackendMinimumVersion(8, 1))
+			{
+				row->cells.Add(dataSet1->GetVal(wxT("client")));
+				row->cells.Add(dataSet1->GetVal(wxT("backend_start")));
+			}
+			if (conn->BackendMinimumVersion(7, 4))
+				row->cells.Add(dataSet1->GetVal(wxT("query_start")));
+
+			if (conn->BackendMinimumVersion(8, 3))
+				row->cells.Add(dataSet1->GetVal(wxT("xact_start")));
+
+			if (conn->BackendMinimumVersion(9, 2))
+			{
+				row->cells.Add(dataSet1->GetVal(wxT("state")));
+				row->cells.Add(dataSet1->GetVal(wxT("state_change")));
+			}
+
+			if (conn->BackendMinimumVersion(9, 4))
+			{
+				row->cells.Add(dataSet1->GetVal(wxT("backend_xid")));
+				row->cells.Add(dataSet1->GetVal(wxT("backend_xmin")));
+			}
+
+			wxString blockedby = dataSet1->GetVal(wxT("blockedby"));
+			row->cells.Add(blockedby);
+			row->cells.Add(qry);
+
+			// How the row is highlighted
+			if (qry == wxT("<IDLE>") || qry == wxT("<IDLE> in transaction0"))
+				row->highlight = STATUSHIGHLIGHT_IDLE;
+			if (conn->BackendMinimumVersion(9, 2))
+			{
+				if (dataSet1->GetVal(wxT("state")) != wxT("active"))
+					row->highlight = STATUSHIGHLIGHT_IDLE;
+			}
+			if (blockedby.Length() > 0)
+				row->highlight = STATUSHIGHLIGHT_BLOCKED;
+			if (dataSet1->GetBool(wxT("slowquery")))
+				row->highlight = STATUSHIGHLIGHT_SLOW;
+
+			snap->rows.Add(row);
+		}
+		dataSet1->MoveNext();
+	}
+	delete dataSet1;
+
+	Compare(snap, statusRows);
+	return snap;
+}
+
+
+statusSnapshot *statusRefreshThread::ReadLocks()
+{
+	statusSnapshot *snap = new statusSnapshot(PANE_LOCKS);
+
+	pgConn *c = conn;
+	if (locksConn && locksConn->GetStatus() == PGCONN_OK)
+		c = locksConn;
+
+	pgSet *dataSet2 = ExecuteStatusSet(c, locksSql);
+	if (!dataSet2)
+	{
+		snap->ok = false;
+		return snap;
+	}
+
+	snap->rows.Alloc(dataSet2->NumRows());
+
+	// A backend may hold the same lock more than once
+	wxStringToStringHashMap seen;
+
+	while (!dataSet2->Eof())
+	{
+		long pid = dataSet2->GetLong(wxT("pid"));
+
+		if (!IsOwnPid(pid))
+		{
+			statusRow *row = new statusRow;
+
+			row->pid = pid;
+			row->cells.Add(NumToStr(pid));
+			row->cells.Add(dataSet2->GetVal(wxT("dbname")));
+			row->cells.Add(dataSet2->GetVal(wxT("class")));
+			row->cells.Add(dataSet2->GetVal(wxT("user")));
+			if (c->BackendMinimumVersion(8, 3))
+				row->cells.Add(dataSet2->GetVal(wxT("virtualxid")));
+			row->cells.Add(dataSet2->GetVal(wxT("transaction")));
+			row->cells.Add(dataSet2->GetVal(wxT("mode")));
+
+			row->key = row->cells[0];
+			for (size_t i = 1 ; i < row->cells.GetCount() ; i++)
+				row->key += wxT("\t") + row->cells[i];
+
+			wxString &count = seen[row->key];
+			count += wxT("+");
+			row->key += count;
+
+			if (dataSet2->GetVal(wxT("granted")) == wxT("t"))
+				row->cells.Add(_("Yes"));
+			else
+				row->cells.Add(_("No"));
+
+			wxString qry = dataSet2->GetVal(wxT("query"));
+
+			if (c->BackendMinimumVersion(7, 4))
+			{
+				if (qry.IsEmpty() || qry == wxT("<IDLE>"))
+					row->cells.Add(wxEmptyString);
+				else
+					row->cells.Add(dataSet2->GetVal(wxT("query_start")));
+			}
+			row->cells.Add(qry.Left(250));
+
+			snap->rows.Add(row);
+		}
+		dataSet2->MoveNext();
+	}
+	delete dataSet2;
+
+	Compare(snap, lockRows);
+	return snap;
+}
+
+
+statusSnapshot *statusRefreshThread::ReadXacts()
+{
+	statusSnapshot *snap = new statusSnapshot(PANE_XACT);
+
+	pgSet *dataSet3 = ExecuteStatusSet(conn, xactSql);
+	if (!dataSet3)
+	{
+		snap->ok = false;
+		return snap;
+	}
+
+	snap->rows.Alloc(dataSet3->NumRows());
+
+	while (!dataSet3->Eof())
+	{
+		statusRow *row = new statusRow;
+
+		row->key = dataSet3->GetVal(wxT("gid"));
+		row->cells.Add(NumToStr(dataSet3->GetLong(wxT("transaction"))));
+		row->cells.Add(row->key);
+		row->cells.Add(dataSet3->GetVal(wxT("prepared")));
+		row->cells.Add(dataSet3->GetVal(wxT("owner")));
+		row->cells.Add(dataSet3->GetVal(wxT("database")));
+
+		snap->rows.Add(row);
+		dataSet3->MoveNext();
+	}
+	delete dataSet3;
+
+	Compare(snap, xactRows);
+	return snap;
+}
+
+
+// Find the rows which were added or changed since the previous refresh,
+// and the ones which are gone
+void statusRefreshThread::Compare(statusSnapshot *snap, wxStringToStringHashMap &previous)
+{
+	wxStringToStringHashMap current;
+	wxStringToStringHashMap::iterator it;
+	size_t i;
+
+	for (i = 0 ; i < snap->rows.GetCount() ; i++)
+	{
+		statusRow *row = snap->rows[i];
+
+		wxString contents = NumToStr((long)row->highlight);
+		for (size_t col = 0 ; col < row->cells.GetCount() ; col++)
+			contents += wxT("\t") + row->cells[col];
+
+		it = previous.find(row->key);
+		if (it == previous.end())
+			row->state = STATUSROW_NEW;
+		else if (it->second != contents)
+			row->state = STATUSROW_CHANGED;
+		else
+			row->state = STATUSROW_SAME;
+
+		current[row->key] = contents;
+	}
+
+	for (it = previous.begin() ; it != previous.end() ; ++it)
+	{
+		if (current.find(it->first) == current.end())
+			snap->removed.Add(it->first);
+	}
+
+	previous = current;
+}
+
+
+logListView::logListView(wxWindow *parent, int id, size_t _capacity)
+	: ctlListView(parent, id, wxDefaultPosition, wxDefaultSize, wxLC_VIRTUAL | wxSUNKEN_BORDER)
+{
+	capacity = _capacity;
+	first = 0;
+}
+
+
+logListView::~logListView()
+{
+	WX_CLEAR_ARRAY(rows);
+}
+
+
+void logListView::Store(statusRow *row)
+{
+	if (rows.GetCount() < capacity)
+		rows.Add(row);
+	else
+	{
+		// Full, the row replaces the oldest one
+		delete rows.Item(first);
+		rows[first] = row;
+		first = (first + 1) % capacity;
+	}
+}
+
+
+void logListView::Update()
+{
+	if ((long)rows.GetCount() != GetItemCount())
+		SetItemCount(rows.GetCount());
+	Refresh();
+}
+
+
+// Add the rows of a snapshot, the list takes them over
+void logListView::AppendRows(statusSnapshot *snap)
+{
+	for (size_t i = 0 ; i < snap->rows.GetCount() ; i++)
+		Store(snap->rows.Item(i));
+	snap->rows.Clear();
+	delete snap;
+
+	Update();
+}
+
+
+void logListView::AppendMessage(const wxString &msg)
+{
+	statusRow *row = new statusRow;
+	row->cells.Add(msg);
+	Store(row);
+
+	Update();
+}
+
+
+void logListView::DeleteRows()
+{
+	WX_CLEAR_ARRAY(rows);
+	first = 0;
+
+	SetItemCount(0);
+	Refresh();
+}
+
+
+wxString logListView::OnGetItemText(long item, long col) const
+{
+	if (item < 0 || item >= (long)rows.GetCount())
+		return wxEmptyString;
+
+	statusRow *row = rows.Item((first + item) % rows.GetCount());
+	if (col < 0 || col >= (long)row->cells.GetCount())
+		return wxEmptyString;
+
+	return row->cells.Item(col);
+}
+
+
+int logListView::OnGetItemImage(long item) const
+{
+	return -1;
+}
+
+
+statusLogThread::statusLogThread(wxEvtHandler *_caller, pgConn *_conn, const wxString &_logFormat, bool _logFormatKnown, bool _logHasTimestamp, long _maxLogSize)
+	: wxThread(wxTHREAD_JOINABLE), condition(mutex)
+{
+	caller = _caller;
+	conn = _conn;
+
+	logFormat = _logFormat;
+	logFmtPos = logFormat.Find('%', true);
+	logFormatKnown = _logFormatKnown;
+	logHasTimestamp = _logHasTimestamp;
+	maxLogSize = _maxLogSize;
+
+	// Known format: the level, then the log entry, after the timestamp
+	// if there is one
+	idxLevelCol = -1;
+	idxLogEntryCol = 0;
+	if (logFormatKnown)
+	{
+		idxLevelCol++;
+		idxLogEntryCol++;
+		if (logHasTimestamp)
+		{
+			idxLevelCol++;
+			idxLogEntryCol++;
+		}
+	}
+
+	pollPending = false;
+	stopping = false;
+	serial = 0;
+
+	fileSerial = 0;
+	csvFormat = false;
+	skipFirst = false;
+	readLength = 0;
+	chunkSize = LOG_MIN_CHUNK;
+
+	batch = NULL;
+}
+
+
+statusLogThread::~statusLogThread()
+{
+	WX_CLEAR_ARRAY(requests);
+	if (batch)
+		delete batch;
+	if (conn)
+		delete conn;
+}
+
+
+// Ask for a logfile to be read. If it is not a rotated one, the rows of
+// the files asked for before are not wanted anymore, and the rows will
+// come with the serial returned.
+long statusLogThread::Open(const wxString &filename, bool _skipFirst, bool rotated)
+{
+	wxMutexLocker lock(mutex);
+
+	statusLogRequest *req = new statusLogRequest;
+	req->filename = filename;
+	req->skipFirst = _skipFirst;
+	req->rotated = rotated;
+	if (!rotated)
+		serial++;
+	req->serial = serial;
+
+	requests.Add(req);
+	condition.Signal();
+
+	return serial;
+}
+
+
+void statusLogThread::Poll()
+{
+	wxMutexLocker lock(mutex);
+
+	pollPending = true;
+	condition.Signal();
+}
+
+
+void statusLogThread::Stop()
+{
+	wxMutexLocker lock(mutex);
+
+	stopping = true;
+	condition.Signal();
+}
+
+
+// Is there no need to go on reading the current logfile?
+bool statusLogThread::Superseded()
+{
+	wxMutexLocker lock(mutex);
+
+	if (stopping)
+		return true;
+
+	for (size_t i = 0 ; i < requests.GetCount() ; i++)
+	{
+		if (!requests.Item(i)->rotated)
+			return true;
+	}
+	return false;
+}
+
+
+void *statusLogThread::Entry()
+{
+	while (true)
+	{
+		statusLogRequest *req = NULL;
+
+		{
+			wxMutexLocker lock(mutex);
+
+			while (requests.IsEmpty() && !pollPending && !stopping)
+				condition.Wait();
+
+			if (stopping)
+				break;
+
+			if (!requests.IsEmpty())
+			{
+				req = requests.Item(0);
+				requests.RemoveAt(0);
+			}
+			pollPending = false;
+		}
+
+		bool opened = (req != NULL);
+		if (opened)
+		{
+			fileName = req->filename;
+			fileSerial = req->serial;
+			csvFormat = fileName.Right(4) == wxT(".csv");
+			skipFirst = req->skipFirst;
+			readLength = 0;
+			chunkSize = LOG_MIN_CHUNK;
+			partialBytes.SetDataLen(0);
+			partialRecord.Empty();
+
+			if (req->rotated)
+				AddLine(_("pgadmin:Logfile rotated."), false);
+
+			delete req;
+		}
+
+		if (fileName.IsEmpty())
+			continue;
+
+		pgSet *set = ExecuteStatusSet(conn, wxT("SELECT pg_file_length(") + conn->qtDbString(fileName) + wxT(") AS len"));
+		if (!set)
+		{
+			Post(false);
+			continue;
+		}
+		long length = set->GetLong(wxT("len"));
+		delete set;
+
+		// Only read the end of a big logfile, its first line is
+		// probably truncated
+		if (opened && skipFirst)
+		{
+			if (maxLogSize && length > maxLogSize)
+				readLength = length - maxLogSize;
+			else
+				skipFirst = false;
+		}
+
+		Read(length);
+		Post();
+	}
+
+	return NULL;
+}
+
+
+void statusLogThread::Read(long length)
+{
+	while (length > readLength && !Superseded())
+	{
+		pgSet *set = ExecuteStatusSet(conn, wxT("SELECT pg_file_read(") +
+		                              conn->qtDbString(fileName) + wxT(", ") + NumToStr(readLength) +
+		                              wxT(", ") + NumToStr(chunkSize) + wxT(")"));
+		if (!set)
+		{
+			Post(false);
+			return;
+		}
+
+		char *raw = set->GetCharPtr(0);
+		if (!raw || !*raw)
+		{
+			delete set;
+			break;
+		}
+
+		size_t len = strlen(raw);
+		readLength += len;
+
+		// Read more at once while whole chunks come back
+		if ((long)len >= chunkSize && chunkSize < LOG_MAX_CHUNK)
+			chunkSize *= 2;
+
+		partialBytes.AppendData(raw, len);
+		delete set;
+
+		// Only whole lines are converted, so that no character is split
+		// between two reads
+		char *data = (char *)partialBytes.GetData();
+		size_t total = partialBytes.GetDataLen();
+		size_t end = total;
+
+		while (end > 0 && data[end - 1] != '\n')
+			end--;
+
+		if (end > 0)
+		{
+			Parse(data, end);
+			memmove(data, data + end, total - end);
+			partialBytes.SetDataLen(total - end);
+		}
+
+		Post();
+	}
+}
+
+
+// Split lines (or CSV records) and convert them into rows, in one pass
+void statusLogThread::Parse(const char *data, size_t len)
+{
+	wxString str(data, wxConvUTF8, len);
+	if (str.IsEmpty())
+		str = wxString(data, *conn->GetConv(), len);
+
+	if (str.IsEmpty())
+	{
+		AddLine(_("pgadmin:The server log contains entries in multiple encodings and cannot be displayed by pgAdmin."), false);
+		return;
+	}
+
+	if (csvFormat)
+	{
+		if (!partialRecord.IsEmpty())
+		{
+			str = partialRecord + str;
+			partialRecord.Empty();
+		}
+
+		// In the middle of the logfile, find the start of a record: they
+		// start with a timestamp
+		if (skipFirst)
+		{
+			int pos = str.Find(wxT("\n20"));
+			if (pos < 0)
+				return;
+			str = str.Mid(pos + 1);
+			skipFirst = false;
+		}
+
+		CSVRecordTokenizer tk(str);
+		wxArrayString fields;
+
+		while (tk.GetNextRecord(fields))
+			AddRecord(fields);
+
+		partialRecord = tk.GetRemainder();
+	}
+	else
+	{
+		const wxChar *chars = str.wx_str();
+		size_t count = str.length();
+		size_t start = 0;
+
+		for (size_t pos = 0 ; pos < count ; pos++)
+		{
+			if (chars[pos] != wxT('\n'))
+				continue;
+
+			wxString line(chars + start, pos - start);
+			start = pos + 1;
+
+			if (skipFirst)
+			{
+				// could be truncated
+				skipFirst = false;
+				continue;
+			}
+
+			line.Trim();
+			if (!line.IsEmpty())
+				AddLine(line);
+		}
+	}
+}
+
+
+static void SetCell(statusRow *row, int col, const wxString &val)
+{
+	if (col < 0)
+		return;
+
+	while ((int)row->cells.GetCount() <= col)
+		row->cells.Add(wxEmptyString);
+	row->cells[col] = val;
+}
+
+
+statusRow *statusLogThread::AddRow(int col, const wxString &val)
+{
+	if (!batch)
+		batch = new statusSnapshot(PANE_LOG);
+
+	statusRow *row = new statusRow;
+	SetCell(row, col, val);
+	batch->rows.Add(row);
+
+	return row;
+}
+
+
+// Send the rows read to the window
+void statusLogThread::Post(bool ok)
+{
+	if (ok && (!batch || batch->rows.IsEmpty()))
+		return;
+
+	if (!batch)
+		batch = new statusSnapshot(PANE_LOG);
+	batch->ok = ok;
+	batch->serial = fileSerial;
+
+	wxCommandEvent ev(STATUS_REFRESH_EVENT, PANE_LOG);
+	ev.SetClientData(batch);
+	caller->AddPendingEvent(ev);
+
+	batch = NULL;
+}
+
+
+// A line of a log which is not in CSV format
+void statusLogThread::AddLine(const wxString &str, bool formatted)
+{
+	statusRow *row;
+
+	if (!logFormatKnown)
+		AddRow(0, str);
+	else if (str.Find(':') < 0)
+	{
+		// Must be a continuation of a previous line.
+		AddRow(idxLogEntryCol, str);
+	}
+	else if (!formatted)
+	{
+		// Not from a log, from pgAdmin itself.
+		row = AddRow(idxLevelCol, str.BeforeFirst(':'));
+		SetCell(row, idxLogEntryCol, str.AfterFirst(':'));
+	}
+	else if (conn->GetIsGreenplum())
+	{
+		// Greenplum 3.2 and before.  log_line_prefix =  "%m|%u|%d|%p|%I|%X|:-"
+
+		wxString logSeverity;
+		// Skip prefix, get message.  In GPDB, always follows ":-".
+		wxString rest = str.Mid(str.Find(wxT(":-")) + 1) ;
+		if (rest.Length() > 0 && rest[0] == wxT('-'))
+			rest = rest.Mid(1);
+
+		// Separate loglevel from message
+
+		if (rest.Length() > 1 && rest[0] != wxT(' ') && rest.Find(':') > 0)
+		{
+			logSeverity = rest.BeforeFirst(':');
+			rest = rest.AfterFirst(':').Mid(2);
+		}
+
+		wxString ts = str.BeforeFirst(logFormat.c_str()[logFmtPos + 2]);
+		if (ts.Length() < 20  || (logHasTimestamp && (ts.Left(2) != wxT("20") || str.Find(':') < 0)))
+		{
+			// No Timestamp?  Must be a continuation of a previous line?
+			// Not sure if it is possible to get here.
+			AddRow(2, rest);
+		}
+		else if (logSeverity.Length() > 1)
+		{
+			// Normal case:  Start of a new log record.
+			row = AddRow(0, ts);
+			SetCell(row, 1, logSeverity);
+			SetCell(row, 2, rest);
+		}
+		else
+		{
+			// Continuation of previous line
+			AddRow(2, rest);
+		}
+	}
+	else if (logHasTimestamp)
+	{
+		// All Non-csv-format non-GPDB PostgreSQL systems.
+		wxString rest = str.Mid(logFmtPos + 22).AfterFirst(':');
+		wxString ts = str.Mid(logFmtPos, str.Length() - rest.Length() - logFmtPos - 1);
+
+		int pos = ts.Find(logFormat.c_str()[logFmtPos + 2], true);
+		row = AddRow(0, ts.Left(pos));
+		SetCell(row, idxLevelCol, ts.Mid(pos + logFormat.Length() - logFmtPos - 2));
+		SetCell(row, idxLogEntryCol, rest.Mid(2));
+	}
+	else
+	{
+		wxString rest = str.Mid(logFormat.Length());
+
+		int pos = rest.Find(':');
+
+		if (pos < 0)
+			AddRow(0, rest);
+		else
+		{
+			row = AddRow(0, rest.BeforeFirst(':'));
+			SetCell(row, idxLogEntryCol, rest.AfterFirst(':').Mid(2));
+		}
+	}
+}
+
+
+static wxString Field(const wxArrayString &fields, size_t n)
+{
+	if (n < fields.GetCount())
+		return fields.Item(n);
+	return wxEmptyString;
+}
+
+
+// A record of a log in CSV format (GPDB 3.3 and later, or PostgreSQL if
+// only the csv log is enabled)
+void statusLogThread::AddRecord(const wxArrayString &fields)
+{
+	statusRow *row;
+	size_t i;
+
+	wxString logTime = Field(fields, 0);
+
+	if (logHasTimestamp && !logTime.StartsWith(wxT("20")))
+	{
+		// Does not start with an expected timestamp... Must be garbage,
+		// or we are out of sync in our CSV handling.
+		// We shouldn't ever get here.
+		wxString str;
+		for (i = 0 ; i < fields.GetCount() ; i++)
+		{
+			if (i)
+				str += wxT(",");
+			str += fields.Item(i);
+		}
+		AddRow(2, str);
+		return;
+	}
+
+	bool gpdb = conn->GetIsGreenplum();
+
+	// GPDB has more fields before the severity: thread, port (PostgreSQL
+	// puts it with the host), session time, transaction, session, command
+	// count, segment, slice and the distributed, local and sub transactions
+	wxString logDatabase = Field(fields, 2);
+	wxString logSession = Field(fields, gpdb ? 9 : 5);
+	wxString logCmdcount, logSegment;
+	if (gpdb)
+	{
+		logCmdcount = Field(fields, 10);
+		logSegment = Field(fields, 11);
+	}
+
+	size_t sev = gpdb ? 16 : 11;
+	wxString logSeverity = Field(fields, sev);
+	wxString logState = Field(fields, sev + 1);
+	wxString logMessage = Field(fields, sev + 2);
+	wxString logDetail = Field(fields, sev + 3);
+	wxString logHint = Field(fields, sev + 4);
+	wxString logDebug = Field(fields, sev + 8);
+
+	// GPDB only, after the function, file and line (PostgreSQL puts them
+	// together)
+	wxString logStack = Field(fields, 29);
+
+	row = AddRow(0, logTime);      // Insert timestamp (with time zone)
+	SetCell(row, 1, logSeverity);
+
+	// Display the logMessage, breaking it into lines
+	wxStringTokenizer lm(logMessage, wxT("\n"));
+	SetCell(row, 2, lm.GetNextToken());
+
+	SetCell(row, 3, logSession);
+	SetCell(row, 4, logCmdcount);
+	SetCell(row, 5, logDatabase);
+	if ((!gpdb) || (logSegment.length() > 0 && logSegment != wxT("seg-1")))
+	{
+		SetCell(row, 6, logSegment);
+	}
+	else
+	{
+		// If we are reading the masterDB log only, the logSegment won't
+		// have anything useful in it.  Look in the logMessage, and see if the
+		// segment info exists in there.  It will always be at the end.
+		if (logMessage.length() > 0 && logMessage[logMessage.length() - 1] == wxT(')'))
+		{
+			int segpos = -1;
+			segpos = logMessage.Find(wxT("(seg"));
+			if (segpos <= 0)
+				segpos = logMessage.Find(wxT("(mir"));
+			if (segpos > 0)
+			{
+				logSegment = logMessage.Mid(segpos + 1);
+				if (logSegment.Find(wxT(' ')) > 0)
+					logSegment = logSegment.Mid(0, logSegment.Find(wxT(' ')));
+				SetCell(row, 6, logSegment);
+			}
+		}
+	}
+
+	// The rest of the lines from the logMessage
+	while (lm.HasMoreTokens())
+		AddRow(2, lm.GetNextToken());
+
+	// Add the detail
+	wxStringTokenizer ld(logDetail, wxT("\n"));
+	while (ld.HasMoreTokens())
+		AddRow(2, ld.GetNextToken());
+
+	// And the hint
+	wxStringTokenizer lh(logHint, wxT("\n"));
+	while (lh.HasMoreTokens())
+		AddRow(2, lh.GetNextToken());
+
+	if (logDebug.length() > 0)
+	{
+		wxString logState3 = logState.Mid(0, 3);
+		if (logState3 == wxT("426") || logState3 == wxT("22P") || logState3 == wxT("427")
+		        || logState3 == wxT("42P") || logState3 == wxT("458")
+		        || logMessage.Mid(0, 9) == wxT("duration:") || logSeverity == wxT("FATAL") || logSeverity == wxT("PANIC"))
+		{
+			// If not redundant, add the statement from the debug_string
+			wxStringTokenizer ls(logDebug, wxT("\n"));
+			if (ls.HasMoreTokens())
+				AddRow(2, wxT("statement: ") + ls.GetNextToken());
+			while (ls.HasMoreTokens())
+				AddRow(2, ls.GetNextToken());
+		}
+	}
+
+	if (gpdb)
+		if (logSeverity == wxT("PANIC") ||
+		        (logSeverity == wxT("FATAL") && logState != wxT("57P03") && logState != wxT("53300")))
+		{
+			// If this is a severe error, add the stack trace.
+			wxStringTokenizer ls(logStack, wxT("\n"));
+			if (ls.HasMoreTokens())
+			{
+				row = AddRow(1, wxT("STACK"));
+				SetCell(row, 2, ls.GetNextToken());
+			}
+			while (ls.HasMoreTokens())
+				AddRow(2, ls.GetNextToken());
+		}
+}
+
+
 serverStatusFactory::serverStatusFactory(menuFactoryList *list, wxMenu *mnu, ctlMenuToolbar *toolbar) : actionFactory(list)
 {
 	mnu->Append(id, _("&Server Status"), _("Displays the current database status."));
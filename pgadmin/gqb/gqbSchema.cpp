@@ -20,6 +20,7 @@
 #include "gqb/gqbObject.h"
 #include "gqb/gqbTable.h"
 #include "gqb/gqbBrowser.h"
+#include "db/pgCatalogCache.h"
 
 gqbSchema::gqbSchema(gqbObject *parent, wxString name, pgConn *connection, OID oid)
 	: gqbObject(name, parent, connection, oid)
@@ -36,48 +37,51 @@ void gqbSchema::createObjects(gqbBrowser *tablesBrowser, OID oidVal, wxTreeItemI
 
 void gqbSchema::createTables(gqbBrowser *tablesBrowser, wxTreeItemId parentNode, OID oidVal, int tableImage, int viewImage, int xTableImage)
 {
-	wxString query;
-
-	// Get the child objects.
-	query = wxT("SELECT oid, relname, relkind\n")
-	        wxT("  FROM pg_class\n")
-	        wxT(" WHERE relkind IN ('r','v','x','m') AND relnamespace = ") + NumToStr(oidVal) + wxT(";");
-
-	pgSet *tables = conn->ExecuteSet(query);
+	// Get the child objects from the catalog snapshot of the database. The
+	// snapshot may be refreshed while the columns are read, so only copies
+	// of the relations are kept.
+	pgCatalogCache *catalog = pgCatalogCache::Get(conn);
+	pgCatalogRelationArray tables;
+	wxArrayString names;
+	wxArrayLong oids;
+	wxString kinds;
 	wxTreeItemId parent;
 
-	if (tables)
-	{
-		while (!tables->Eof())
-		{
-			gqbTable *table = 0;
-			wxString tmpname = tables->GetVal(wxT("relname"));
-			wxString relkind = tables->GetVal(wxT("relkind"));
+	if (catalog)
+		catalog->GetRelations(oidVal, wxT("rvxm"), tables);
 
-			if (relkind == wxT("r")) // Table
-			{
-				table = new gqbTable(this, tmpname, conn, GQB_TABLE, tables->GetOid(wxT("oid")));
-				parent = tablesBrowser->AppendItem(parentNode, tables->GetVal(wxT("relname")) , tableImage, tableImage, table);
-			}
-			else if (relkind == wxT("v") || relkind == wxT("m"))
-			{
-				table = new gqbTable(this, tmpname, conn, GQB_VIEW, tables->GetOid(wxT("oid")));
-				parent = tablesBrowser->AppendItem(parentNode, tables->GetVal(wxT("relname")) , viewImage, viewImage, table);
-			}
-			else if (relkind == wxT("x"))  // Greenplum external table
-			{
-				table = new gqbTable(this, tmpname, conn, GQB_TABLE, tables->GetOid(wxT("oid")));
-				parent = tablesBrowser->AppendItem(parentNode, tables->GetVal(wxT("relname")), xTableImage, xTableImage, table);
-			}
+	for (size_t i = 0; i < tables.GetCount(); i++)
+	{
+		names.Add(tables.Item(i)->name);
+		oids.Add((long)tables.Item(i)->oid);
+		kinds += tables.Item(i)->kind;
+	}
+	tables.Clear();
 
-			// Create columns inside this table.
-			if (table)
-				table->createObjects(tablesBrowser, conn, tables->GetOid(wxT("oid")), parent);
+	for (size_t i = 0; i < names.GetCount(); i++)
+	{
+		OID relOid = (OID)oids.Item(i);
+		gqbTable *table = 0;
 
-			tables->MoveNext();
+		if (kinds[i] == wxT('r')) // Table
+		{
+			table = new gqbTable(this, names.Item(i), conn, GQB_TABLE, relOid);
+			parent = tablesBrowser->AppendItem(parentNode, names.Item(i), tableImage, tableImage, table);
+		}
+		else if (kinds[i] == wxT('v') || kinds[i] == wxT('m'))
+		{
+			table = new gqbTable(this, names.Item(i), conn, GQB_VIEW, relOid);
+			parent = tablesBrowser->AppendItem(parentNode, names.Item(i), viewImage, viewImage, table);
+		}
+		else if (kinds[i] == wxT('x'))  // Greenplum external table
+		{
+			table = new gqbTable(this, names.Item(i), conn, GQB_TABLE, relOid);
+			parent = tablesBrowser->AppendItem(parentNode, names.Item(i), xTableImage, xTableImage, table);
 		}
 
-		delete tables;
+		// Create columns inside this table.
+		if (table)
+			table->createObjects(tablesBrowser, conn, relOid, parent);
 	}
 
 	tablesBrowser->SortChildren(parentNode);
@@ -20,6 +20,7 @@
 #include "gqb/gqbTable.h"
 #include "gqb/gqbColumn.h"
 #include "gqb/gqbArrayCollection.h"
+#include "db/pgCatalogCache.h"
 
 gqbTable::gqbTable(gqbObject *parent, wxString name, pgConn *connection, type_gqbObject type, OID oid)
 	: gqbObjectCollection(name, parent, connection, oid)
@@ -47,37 +48,22 @@ void gqbTable::createObjects(gqbBrowser *_tablesBrowser,  pgConn *_conn, OID oid
 
 void gqbTable::createColumns(pgConn *conn, gqbBrowser *tablesBrowser, wxTreeItemId parentNode,  OID oidVal)
 {
+	// The columns of all the tables of the schema come with the first table
+	pgCatalogCache *catalog = pgCatalogCache::Get(conn);
+	const pgCatalogAttributeArray *columns = catalog ? catalog->GetAttributes(conn, oidVal) : NULL;
 
-	wxString systemRestriction;
-	if (!settings->GetShowSystemObjects())
-		systemRestriction = wxT("\n   AND attnum > 0");
-
-	wxString sql =
-	    wxT("SELECT attname FROM pg_attribute att\n")
-	    wxT(" WHERE attrelid = ")
-	    + NumToStr(oidVal)
-	    + systemRestriction + wxT("\n")
-	    wxT("   AND attisdropped IS FALSE\n")
-	    wxT(" ORDER BY attnum");
-
-	pgSet *columns = conn->ExecuteSet(sql);
-	if (columns)
+	if (columns && tablesBrowser)
 	{
-		while (!columns->Eof())
+		for (size_t i = 0; i < columns->GetCount(); i++)
 		{
-			if (tablesBrowser)
-			{
-				//Disable, Column SHOULDN'T be added to tree only use for debug purposes tablesBrowser->AppendItem(parentNode, columns->GetVal(wxT("attname")) , -1, -1);
-				wxString tmpname = wxString(columns->GetVal(wxT("attname")));
-				gqbColumn *column = new gqbColumn(this, tmpname, conn);
-				this->addColumn(column);
-				columns->MoveNext();
-			}
-			else
-				break;
-		}
+			const pgCatalogAttribute &att = columns->Item(i);
+			if (att.num <= 0 && !settings->GetShowSystemObjects())
+				continue;
 
-		delete columns;
+			//Disable, Column SHOULDN'T be added to tree only use for debug purposes tablesBrowser->AppendItem(parentNode, att.name, -1, -1);
+			gqbColumn *column = new gqbColumn(this, att.name, conn);
+			this->addColumn(column);
+		}
 	}
 }
 
@@ -35,6 +35,9 @@
 // Image
 #include "images/gqbJoinCursor.pngc"
 
+// Anchors, join stubs and join kinds are drawn out of the tables and the lines between anchors
+#define DAMAGE_MARGIN 30
+
 BEGIN_EVENT_TABLE(gqbView, wxScrolledWindow)
 	EVT_SIZE(gqbView::OnSize)
 	EVT_PAINT(gqbView::onPaint)
@@ -148,7 +151,16 @@ void gqbView::onEraseBackGround(wxEraseEvent &event)
 void gqbView::onPaint(wxPaintEvent &event)
 {
 	wxPaintDC dcc(this);                          // Prepare Context for Buffered Draw
-	wxBufferedDC dc(&dcc, canvasSize);
+	int w, h;
+	GetClientSize(&w, &h);
+	w = w > 0 ? w : 1;
+	h = h > 0 ? h : 1;
+	if(!paintBuffer.IsOk() || paintBuffer.GetWidth() != w || paintBuffer.GetHeight() != h)
+		paintBuffer.Create(w, h);
+	wxBufferedDC dc(&dcc, paintBuffer);
+
+	// Only the objects in the area to update are drawn again
+	dc.SetClippingRegion(GetUpdateRegion().GetBox());
 	drawAll(dc, true);                            // Call Function to draw all
 }
 
@@ -317,6 +329,7 @@ void gqbView::onMotion(wxMouseEvent &event)
 	if(event.ButtonDown() && !changeTOpressed)
 	{
 		this->SetFocus();
+		damage = wxRect();
 
 		// Which kind of button down was? join creation [click on any column at the
 		// right of checkbox and drag & drop] or table moving [click on title and drag & drop]
@@ -505,13 +518,22 @@ void gqbView::onMotion(wxMouseEvent &event)
 				// GQB-TODO: same as gqbGraphBehavior.h [find a way to not hard code the 17 default value]
 				if((pos.x > collectionSelected->position.x + 17) || (pos.x < collectionSelected->position.x) )
 				{
+					// Only the area left and the area taken by the table are drawn again
+					damage.Union(getObjectArea(collectionSelected));
 					graphBehavior->UpdatePosObject(collectionSelected, pos.x, pos.y, 40);
+					damage.Union(getObjectArea(collectionSelected));
 				}
 
 				// Don't draw too much when dragging table around canvas [lower cpu use]
 				if(refresh % refreshRate == 0)
 				{
-					this->Refresh();
+					if(!damage.IsEmpty())
+					{
+						wxRect copy = damage;
+						this->CalcScrolledPosition(copy.x, copy.y, &copy.x, &copy.y);
+						this->RefreshRect(copy);
+						damage = wxRect();
+					}
 					refresh = 1;
 				}
 				else
@@ -554,9 +576,52 @@ void gqbView::OnKeyDown(wxKeyEvent &event)
 }
 
 
+// The lines of a join, its anchors and its kind
+static wxRect getJoinArea(const wxPoint &o, const wxPoint &d)
+{
+	wxRect area(wxMin(o.x, d.x), wxMin(o.y, d.y), abs(o.x - d.x) + 1, abs(o.y - d.y) + 1);
+	area.Inflate(DAMAGE_MARGIN, DAMAGE_MARGIN);
+	return area;
+}
+
+
+// The table with the joins from and to it
+wxRect gqbView::getObjectArea(gqbQueryObject *queryTable)
+{
+	wxRect area(queryTable->position, wxSize(queryTable->getWidth(), queryTable->getHeight()));
+	area.Inflate(DAMAGE_MARGIN, DAMAGE_MARGIN);
+
+	gqbIteratorBase *j = queryTable->createJoinsIterator();
+	while(j->HasNext())
+	{
+		gqbQueryJoin *tmp = (gqbQueryJoin *)j->Next();
+		area.Union(getJoinArea(tmp->getSourceAnchor(), tmp->getDestAnchor()));
+	}
+	delete j;
+
+	gqbIteratorBase *r = queryTable->createRegJoinsIterator();
+	while(r->HasNext())
+	{
+		gqbQueryJoin *tmp = (gqbQueryJoin *)r->Next();
+		area.Union(getJoinArea(tmp->getSourceAnchor(), tmp->getDestAnchor()));
+	}
+	delete r;
+
+	return area;
+}
+
+
 void gqbView::drawAll(wxMemoryDC &bdc, bool adjustScrolling)
 {
 	bdc.Clear();
+
+	// Objects out of the clipping region, if any, are not drawn
+	wxRect visible;
+	bdc.GetClippingBox(&visible.x, &visible.y, &visible.width, &visible.height);
+	if(adjustScrolling)
+		this->CalcUnscrolledPosition(visible.x, visible.y, &visible.x, &visible.y);
+	bool cull = !visible.IsEmpty();
+
 	if(!iterator)
 		// Get an iterator for the objects (tables/views) in the model.
 		iterator = this->model->createQueryIterator();
@@ -567,6 +632,16 @@ void gqbView::drawAll(wxMemoryDC &bdc, bool adjustScrolling)
 	while(iterator->HasNext())
 	{
 		gqbQueryObject *tmp = (gqbQueryObject *)iterator->Next();
+
+		// The size is known once the table has been drawn
+		if(cull && tmp->getWidth() > 0 && tmp->getHeight() > 0)
+		{
+			wxRect tableArea(tmp->position, wxSize(tmp->getWidth(), tmp->getHeight()));
+			tableArea.Inflate(DAMAGE_MARGIN, DAMAGE_MARGIN);
+			if(!visible.Intersects(tableArea))
+				continue;
+		}
+
 		wxPoint pt = wxPoint(tmp->position);      // Use a copy because I don't want to store the modified
 		// version of point after CalcScrolledPosition was called
 
@@ -593,6 +668,9 @@ void gqbView::drawAll(wxMemoryDC &bdc, bool adjustScrolling)
 				wxPoint o = join->getSourceAnchor();
 				wxPoint d = join->getDestAnchor();
 
+				if(cull && !visible.Intersects(getJoinArea(o, d)))
+					continue;
+
 				if (adjustScrolling)
 				{
 					// adjust coordinates origin
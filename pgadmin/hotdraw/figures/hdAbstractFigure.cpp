@@ -45,7 +45,7 @@ bool hdAbstractFigure::includes(hdIFigure *figure)
 void hdAbstractFigure::draw(wxBufferedDC &context, hdDrawingView *view)
 {
 	//Hack to Allow creations of limits for figures movements, but what to do should be defined at derivated classes
-	spaceForMovement = view->canvasSize;
+	setSpaceForMovement(view->canvasSize);
 	hdIFigure::draw(context, view);
 	basicDraw(context, view);
 }
@@ -123,6 +123,11 @@ bool hdAbstractFigure::containsPoint(int posIdx, int x, int y)
 	return basicDisplayBox.Contains(posIdx, x, y);
 }
 
+void hdAbstractFigure::setSpaceForMovement(wxSize space)
+{
+	spaceForMovement = space;
+}
+
 void hdAbstractFigure::onFigureChanged(int posIdx, hdIFigure *figure)
 {
 	//go to figure procedure to alert observers of changes on this figure
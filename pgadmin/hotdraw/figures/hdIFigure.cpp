@@ -107,6 +107,10 @@ hdITool *hdIFigure::CreateFigureTool(hdDrawingView *view, hdITool *defaultTool)
 	return defaultTool;
 }
 
+void hdIFigure::setSpaceForMovement(wxSize space)
+{
+}
+
 bool hdIFigure::isSelected(int posIdx)
 {
 	return selected[posIdx];
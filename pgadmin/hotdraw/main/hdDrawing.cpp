@@ -30,6 +30,7 @@ hdDrawing::hdDrawing(hdDrawingEditor *owner)
 	usedView = NULL;
 	ownerEditor = owner;
 	drawingName = wxEmptyString;
+	indexedPosIdx = -1;
 }
 
 hdDrawing::~hdDrawing()
@@ -56,7 +57,10 @@ hdDrawing::~hdDrawing()
 void hdDrawing::add(hdIFigure *figure)
 {
 	if(figures)
+	{
 		figures->addItem(figure);
+		invalidateIndex();
+	}
 }
 
 void hdDrawing::remove(hdIFigure *figure)
@@ -64,6 +68,7 @@ void hdDrawing::remove(hdIFigure *figure)
 	if(figures)
 	{
 		figures->removeItem(figure);
+		invalidateIndex();
 		if(usedView)
 			figure->moveTo(usedView->getIdx(), -1, -1);
 	}
@@ -78,21 +83,52 @@ bool hdDrawing::includes(hdIFigure *figure)
 
 hdIFigure *hdDrawing::findFigure(int posIdx, int x, int y)
 {
-	hdIFigure *tmp = NULL, *out = NULL;
-	hdIteratorBase *iterator = figures->createIterator();
-	while(iterator->HasNext())
+	//Only figures near the point are asked, in the same order than before
+	hdFigureArray nearFigures;
+	findFigures(posIdx, hdRect(x, y, 1, 1), nearFigures);
+
+	for(size_t i = 0; i < nearFigures.GetCount(); i++)
 	{
-		tmp = (hdIFigure *)iterator->Next();
-		if(tmp->containsPoint(posIdx, x, y))
-		{
-			out = tmp;
-			break;
-		}
+		if(nearFigures.Item(i)->containsPoint(posIdx, x, y))
+			return nearFigures.Item(i);
 	}
 
-	delete iterator;;
+	return NULL;
+}
+
+void hdDrawing::findFigures(int posIdx, const hdRect &rect, hdFigureArray &found)
+{
+	if(indexedPosIdx != posIdx)
+		rebuildIndex(posIdx);
+	figuresIndex.findFigures(rect, found);
+}
+
+//Figures moved by tools are indexed again, with the lines connected to them
+void hdDrawing::updateFigure(int posIdx, hdIFigure *figure)
+{
+	if(indexedPosIdx != posIdx)
+		return;
+
+	figuresIndex.updateFigure(figure, posIdx);
 
-	return out;
+	hdIteratorBase *iterator = figure->observersEnumerator();
+	while(iterator->HasNext())
+		figuresIndex.updateFigure((hdIFigure *)iterator->Next(), posIdx);
+	delete iterator;
+}
+
+//Any other change of the figures is indexed again at next look up
+void hdDrawing::invalidateIndex()
+{
+	indexedPosIdx = -1;
+}
+
+void hdDrawing::rebuildIndex(int posIdx)
+{
+	figuresIndex.clear();
+	for(int i = 0; i < figures->count(); i++)
+		figuresIndex.addFigure((hdIFigure *)figures->getItemAt(i), posIdx, i);
+	indexedPosIdx = posIdx;
 }
 
 void hdDrawing::recalculateDisplayBox(int posIdx)
@@ -116,20 +152,39 @@ void hdDrawing::recalculateDisplayBox(int posIdx)
 	}
 
 	delete iterator;
+
+	//All the display boxes were just asked
+	rebuildIndex(posIdx);
 }
 
 void hdDrawing::bringToFront(hdIFigure *figure)
 {
 	//To bring to front this figure need to be at last position when is draw
 	//because this reason sendToBack (last position) is used.
+	int index = figures->getIndex(figure);
 	figures->sendToBack(figure);
+
+	//Only the figures swapped change their order
+	if(indexedPosIdx >= 0 && index >= 0)
+	{
+		figuresIndex.setOrder((hdIFigure *)figures->getItemAt(index), index);
+		figuresIndex.setOrder(figure, figures->count() - 1);
+	}
 }
 
 void hdDrawing::sendToBack(hdIFigure *figure)
 {
 	//To send to back this figure need to be at first position when is draw
 	//because this reason bringToFront (1st position) is used.
+	int index = figures->getIndex(figure);
 	figures->bringToFront(figure);
+
+	//Only the figures swapped change their order
+	if(indexedPosIdx >= 0 && index >= 0)
+	{
+		figuresIndex.setOrder((hdIFigure *)figures->getItemAt(index), index);
+		figuresIndex.setOrder(figure, 0);
+	}
 }
 
 hdRect &hdDrawing::DisplayBox()
@@ -150,6 +205,7 @@ hdIteratorBase *hdDrawing::figuresInverseEnumerator()
 void hdDrawing::deleteAllFigures()
 {
 	selection->removeAll();
+	invalidateIndex();
 
 	hdIFigure *tmp;
 	while(figures->count() > 0)
@@ -164,6 +220,7 @@ void hdDrawing::deleteAllFigures()
 void hdDrawing::removeAllFigures()
 {
 	selection->removeAll();
+	invalidateIndex();
 
 	hdIFigure *tmp;
 	while(figures->count() > 0)
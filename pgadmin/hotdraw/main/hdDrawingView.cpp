@@ -29,6 +29,9 @@
 #include "images/check.pngc"
 #include "images/ddcancel.pngc"
 
+// Handles, line terminals and pen widths can be drawn out of the display box
+#define DAMAGE_MARGIN 24
+
 BEGIN_EVENT_TABLE(hdDrawingView, wxScrolledWindow)
 	EVT_PAINT(                     hdDrawingView::onPaint)
 	EVT_MOTION(                    hdDrawingView::onMotion)
@@ -73,6 +76,7 @@ hdDrawingView::hdDrawingView(int diagram, wxWindow *ddParent, hdDrawingEditor *e
 	cancelTxtButton = new wxBitmapButton(this, 1981, wxBitmap(*ddcancel_png_img), wxDefaultPosition, wxDefaultSize, wxBORDER_NONE);
 	cancelTxtButton->Hide();
 	canvasMenu = NULL;
+	hasDamage = false;
 	_tool = NULL;
 	_tool = new hdSelectionTool(this);
 }
@@ -91,16 +95,38 @@ hdDrawingView::~hdDrawingView()
 
 void hdDrawingView::onPaint(wxPaintEvent &event)
 {
-	// Prepare Context for Buffered Draw
+	// Prepare Context for Buffered Draw, only the visible area is buffered
 	wxPaintDC dcc(this);
-	wxBufferedDC dc(&dcc, canvasSize);
+	int w, h;
+	GetClientSize(&w, &h);
+	w = hdGeometry::max(w, 1);
+	h = hdGeometry::max(h, 1);
+	if(!paintBuffer.IsOk() || paintBuffer.GetWidth() != w || paintBuffer.GetHeight() != h)
+		paintBuffer.Create(w, h);
+	wxBufferedDC dc(&dcc, paintBuffer);
+
+	// Only the figures in the area to update are drawn again
+	wxRect update = GetUpdateRegion().GetBox();
+	dc.SetClippingRegion(update);
 	dc.Clear();
+	hdRect area(0, 0, update.width, update.height);
+	CalcUnscrolledPosition(update.x, update.y, &area.x, &area.y);
+
 	hdIFigure *toDraw = NULL;
 	hdIteratorBase *iterator = drawing->figuresEnumerator();
 
 	while(iterator->HasNext())
 	{
 		toDraw = (hdIFigure *)iterator->Next();
+
+		hdRect box = toDraw->displayBox().gethdRect(diagramIndex);
+		box.Inflate(DAMAGE_MARGIN, DAMAGE_MARGIN);
+		if(!box.Intersects(area))
+		{
+			toDraw->setSpaceForMovement(canvasSize);
+			continue;
+		}
+
 		if(toDraw->isSelected(diagramIndex))
 			toDraw->drawSelected(dc, this);
 		else
@@ -206,12 +232,15 @@ hdIHandle *hdDrawingView::findHandle(int posIdx, double x, double y)
 	hdIFigure *tmpFigure = NULL;
 	hdIHandle *tmpHandle = NULL, *out = NULL;
 
-
-	//Look for handles at each figure in SelectionEnumerator
-	hdIteratorBase *selectionIterator = drawing->selectionFigures(); //selection->createIterator();
+	//Look for handles at each figure in SelectionEnumerator, if near the point
+	hdFigureArray nearFigures;
+	drawing->findFigures(posIdx, hdRect((int) x, (int) y, 1, 1), nearFigures);
+	hdIteratorBase *selectionIterator = drawing->selectionFigures();
 	while(selectionIterator->HasNext())
 	{
 		tmpFigure = (hdIFigure *)selectionIterator->Next();
+		if(nearFigures.Index(tmpFigure) == wxNOT_FOUND)
+			continue;
 		hdIteratorBase *handlesIterator = tmpFigure->handlesEnumerator()->createIterator();
 		while(handlesIterator->HasNext())
 		{
@@ -247,7 +276,7 @@ void hdDrawingView::onMotion(wxMouseEvent &event)
 		if(event.Dragging())
 		{
 			_tool->mouseDrag(ddEvent);
-			this->Refresh();			//only a dragging event on montion will change model
+			repairDamage();			//only a dragging event on montion will change model
 		}
 		else
 		{
@@ -355,6 +384,7 @@ void hdDrawingView::simpleTextToolChangeHandler(wxCommandEvent &event)
 		simpleTextToolEdit->SetSize(simpleTextFigure->displayBox().GetSize());
 		okTxtButton->SetPosition(wxPoint(p.x + simpleTextToolEdit->GetSize().GetWidth() + 4, p.y));
 		cancelTxtButton->SetPosition(wxPoint(okTxtButton->GetPosition().x + okTxtButton->GetSize().GetWidth() + 4, p.y));
+		drawing->invalidateIndex();
 	}
 	else if(!simpleTextFigure)
 	{
@@ -397,6 +427,7 @@ void hdDrawingView::OnGenericPopupClick(wxCommandEvent &event)
 	simpleTextFigure = NULL;
 	menuFigure = NULL;
 	canvasMenu = NULL;
+	drawing->invalidateIndex();
 
 	event.Skip();
 }
@@ -469,5 +500,57 @@ void hdDrawingView::OnGenericViewPopupClick(wxCommandEvent &event)
 
 void hdDrawingView::notifyChanged()
 {
+	drawing->invalidateIndex();
+	drawingEditor->notifyChanged();
+}
+
+//Only the figure moved and its lines are indexed again
+void hdDrawingView::notifyMoved(hdIFigure *figure)
+{
+	drawing->updateFigure(diagramIndex, figure);
 	drawingEditor->notifyChanged();
 }
+
+//Figures can be changed out of the tools of the view, by the model, before
+//a refresh of all the view
+void hdDrawingView::Refresh(bool eraseBackground, const wxRect *rect)
+{
+	if(!rect && drawing)
+		drawing->invalidateIndex();
+	wxScrolledWindow::Refresh(eraseBackground, rect);
+}
+
+void hdDrawingView::addDamage(hdIFigure *figure)
+{
+	hdRect box = figure->displayBox().gethdRect(diagramIndex);
+
+	hdIteratorBase *iterator = figure->observersEnumerator();
+	while(iterator->HasNext())
+	{
+		hdIFigure *observer = (hdIFigure *)iterator->Next();
+		box.add(observer->displayBox().gethdRect(diagramIndex));
+	}
+	delete iterator;
+
+	box.Inflate(DAMAGE_MARGIN, DAMAGE_MARGIN);
+	if(hasDamage)
+		damage.add(box);
+	else
+		damage = box;
+	hasDamage = true;
+}
+
+void hdDrawingView::repairDamage()
+{
+	if(!hasDamage)
+	{
+		Refresh();
+		return;
+	}
+
+	//Figures moved were indexed again by the tool
+	hdRect copy = damage;
+	CalcScrolledPosition(copy.x, copy.y, &copy.x, &copy.y);
+	RefreshRect(copy);
+	hasDamage = false;
+}
@@ -86,8 +86,11 @@ void hdDragTrackerTool::mouseDrag(hdMouseEvent &event)
 			while(iterator->HasNext())
 			{
 				tmp = (hdIFigure *)iterator->Next();
+				//Only the area left and the area taken by the figure are drawn again
+				event.getView()->addDamage(tmp);
 				tmp->moveBy(event.getView()->getIdx(), x - lastX, y - lastY);
-				event.getView()->notifyChanged();
+				event.getView()->addDamage(tmp);
+				event.getView()->notifyMoved(tmp);
 			}
 			delete iterator;
 		}
@@ -96,11 +96,14 @@ void hdSelectAreaTool::mouseDrag(hdMouseEvent &event)
 
 void hdSelectAreaTool::selectFiguresOnRect(bool shiftPressed, hdDrawingView *view)
 {
+	//Only figures at the rect are asked, from last to first as before
+	hdFigureArray nearFigures;
+	view->getDrawing()->findFigures(view->getIdx(), selectionRect, nearFigures);
+
 	hdIFigure *figure;
-	hdIteratorBase *iterator = view->getDrawing()->figuresInverseEnumerator();
-	while(iterator->HasNext())
+	for(int i = nearFigures.GetCount() - 1; i >= 0; i--)
 	{
-		figure = (hdIFigure *)iterator->Next();
+		figure = nearFigures.Item(i);
 		if(selectionRect.Contains(figure->displayBox().gethdRect(view->getIdx())))
 		{
 			if(shiftPressed)
@@ -113,7 +116,6 @@ void hdSelectAreaTool::selectFiguresOnRect(bool shiftPressed, hdDrawingView *vie
 			}
 		}
 	}
-	delete iterator;
 }
 
 void hdSelectAreaTool::drawSelectionRect(hdDrawingView *view)
@@ -0,0 +1,180 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// hdFigureIndex.cpp - Uniform grid of the display boxes of the figures of a diagram
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// App headers
+#include "hotdraw/utilities/hdFigureIndex.h"
+#include "hotdraw/utilities/hdGeometry.h"
+#include "hotdraw/figures/hdIFigure.h"
+
+// Size in pixels of the side of a cell of the grid
+#define INDEX_CELL_SIZE 128
+// Cells by side of the grid, figures beyond it are at the last cell
+#define INDEX_MAX_CELLS 4096
+// Handles, line tolerances and terminals can be out of the display box
+#define INDEX_MARGIN 24
+
+hdFigureIndex::hdFigureIndex()
+{
+}
+
+hdFigureIndex::~hdFigureIndex()
+{
+	clear();
+}
+
+void hdFigureIndex::clear()
+{
+	entries.clear();
+	cells.clear();
+}
+
+void hdFigureIndex::addFigure(hdIFigure *figure, int posIdx, int order)
+{
+	hdFigureIndexEntry entry;
+	entry.box = indexedBox(figure, posIdx);
+	entry.order = order;
+	entries[figure] = entry;
+	addToCells(figure, entry.box);
+}
+
+void hdFigureIndex::updateFigure(hdIFigure *figure, int posIdx)
+{
+	hdFigureEntriesMap::iterator it = entries.find(figure);
+	if(it == entries.end())
+		return;
+
+	hdRect box = indexedBox(figure, posIdx);
+	if(box == it->second.box)
+		return;
+
+	removeFromCells(figure, it->second.box);
+	it->second.box = box;
+	addToCells(figure, box);
+}
+
+void hdFigureIndex::setOrder(hdIFigure *figure, int order)
+{
+	hdFigureEntriesMap::iterator it = entries.find(figure);
+	if(it != entries.end())
+		it->second.order = order;
+}
+
+bool hdFigureIndex::includes(hdIFigure *figure)
+{
+	return entries.find(figure) != entries.end();
+}
+
+// Figures are sorted by one thread only, the UI one
+static hdFigureEntriesMap *sortEntries;
+
+static int hdFigureOrderCmp(hdIFigure **a, hdIFigure **b)
+{
+	return (*sortEntries)[*a].order - (*sortEntries)[*b].order;
+}
+
+void hdFigureIndex::findFigures(const hdRect &rect, hdFigureArray &found)
+{
+	found.Clear();
+
+	//A point is a rect of one pixel, else it never intersects
+	hdRect area = rect;
+	if(area.width < 0)
+	{
+		area.x += area.width;
+		area.width = -area.width;
+	}
+	if(area.height < 0)
+	{
+		area.y += area.height;
+		area.height = -area.height;
+	}
+	area.width = hdGeometry::max(area.width, 1);
+	area.height = hdGeometry::max(area.height, 1);
+
+	int firstX, firstY, lastX, lastY, i, j;
+	size_t k;
+	hdFigureArray candidates;
+	getCells(area, firstX, firstY, lastX, lastY);
+	for(i = firstX; i <= lastX; i++)
+	{
+		for(j = firstY; j <= lastY; j++)
+		{
+			hdFigureCellsMap::iterator cell = cells.find(i * INDEX_MAX_CELLS + j);
+			if(cell == cells.end())
+				continue;
+			for(k = 0; k < cell->second.GetCount(); k++)
+			{
+				if(entries[cell->second.Item(k)].box.Intersects(area))
+					candidates.Add(cell->second.Item(k));
+			}
+		}
+	}
+
+	if(candidates.GetCount() > 1)
+	{
+		sortEntries = &entries;
+		candidates.Sort(hdFigureOrderCmp);
+	}
+
+	//A figure covering several cells is found once by each one
+	for(k = 0; k < candidates.GetCount(); k++)
+	{
+		if(k == 0 || candidates.Item(k) != candidates.Item(k - 1))
+			found.Add(candidates.Item(k));
+	}
+}
+
+hdRect hdFigureIndex::indexedBox(hdIFigure *figure, int posIdx)
+{
+	hdRect box = figure->displayBox().gethdRect(posIdx);
+	box.Inflate(INDEX_MARGIN, INDEX_MARGIN);
+	return box;
+}
+
+void hdFigureIndex::addToCells(hdIFigure *figure, const hdRect &box)
+{
+	int firstX, firstY, lastX, lastY, i, j;
+	getCells(box, firstX, firstY, lastX, lastY);
+	for(i = firstX; i <= lastX; i++)
+		for(j = firstY; j <= lastY; j++)
+			cells[i * INDEX_MAX_CELLS + j].Add(figure);
+}
+
+void hdFigureIndex::removeFromCells(hdIFigure *figure, const hdRect &box)
+{
+	int firstX, firstY, lastX, lastY, i, j;
+	getCells(box, firstX, firstY, lastX, lastY);
+	for(i = firstX; i <= lastX; i++)
+	{
+		for(j = firstY; j <= lastY; j++)
+		{
+			hdFigureCellsMap::iterator cell = cells.find(i * INDEX_MAX_CELLS + j);
+			if(cell == cells.end())
+				continue;
+			cell->second.Remove(figure);
+			if(cell->second.IsEmpty())
+				cells.erase(cell);
+		}
+	}
+}
+
+void hdFigureIndex::getCells(const hdRect &box, int &firstX, int &firstY, int &lastX, int &lastY)
+{
+	firstX = hdGeometry::min(hdGeometry::max(box.x, 0) / INDEX_CELL_SIZE, INDEX_MAX_CELLS - 1);
+	firstY = hdGeometry::min(hdGeometry::max(box.y, 0) / INDEX_CELL_SIZE, INDEX_MAX_CELLS - 1);
+	lastX = hdGeometry::min(hdGeometry::max(box.x + box.width - 1, 0) / INDEX_CELL_SIZE, INDEX_MAX_CELLS - 1);
+	lastY = hdGeometry::min(hdGeometry::max(box.y + box.height - 1, 0) / INDEX_CELL_SIZE, INDEX_MAX_CELLS - 1);
+}
@@ -12,6 +12,7 @@
 pgadmin3_SOURCES += \
 	hotdraw/utilities/hdArrayCollection.cpp \
 	hotdraw/utilities/hdCollection.cpp \
+	hotdraw/utilities/hdFigureIndex.cpp \
 	hotdraw/utilities/hdGeometry.cpp \
 	hotdraw/utilities/hdKeyEvent.cpp \
 	hotdraw/utilities/hdMouseEvent.cpp \
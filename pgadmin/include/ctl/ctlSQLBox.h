@@ -19,6 +19,7 @@
 
 #include "db/pgConn.h"
 #include "dlg/dlgFindReplace.h"
+#include "ctl/explainPlan.h"
 
 // These structs are from Scintilla.h which isn't easily #included :-(
 struct CharacterRange
@@ -86,6 +87,12 @@ public:
 	void SetTitle(wxString &title);
 	wxString GetTitle(bool withChangeInd = true);
 	wxString GetChangeIndicator();
+	// The plans explained in the tab, the oldest first
+	void AddExplainRun(const wxString &json);
+	const ExplainRunArray &GetExplainRuns()
+	{
+		return m_explainRuns;
+	}
 
 	DECLARE_DYNAMIC_CLASS(ctlSQLBox)
 	DECLARE_EVENT_TABLE()
@@ -113,6 +120,7 @@ private:
 	wxString m_changestr;
 	bool m_changed;
 	int m_origin;
+	ExplainRunArray m_explainRuns;
 
 	friend class QueryPrintout;
 };
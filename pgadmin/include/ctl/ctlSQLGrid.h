@@ -23,7 +23,7 @@ public:
 	ctlSQLGrid();
 
 	wxString GetExportLine(int row);
-	wxString GetExportLine(int row, wxArrayInt cols);
+	wxString GetExportLine(int row, const wxArrayInt &cols);
 	wxString GetExportLine(int row, int col1, int col2);
 	virtual bool IsColText(int col)
 	{
@@ -58,6 +58,8 @@ public:
 	pgError GetResultError();
 
 	void DisplayData(bool single = false);
+	void DisplayPartialData();
+	void ClearData();
 
 	bool GetRowCountSuppressed()
 	{
@@ -73,6 +75,9 @@ public:
 	wxArrayLong colTypClasses;
 
 private:
+	void SetupColumns(pgSet *set);
+	void AppendRows(long rows);
+
 	pgQueryThread *thread;
 	pgConn *conn;
 	bool rowcountSuppressed;
@@ -94,9 +99,16 @@ public:
 	{
 		return;
 	}
-	void SetThread(pgQueryThread *t)
+	// The result-set being displayed, and the number of its rows known to
+	// the grid (a streamed result-set grows, while it is displayed)
+	void SetDataSet(pgSet *s, long rows = 0);
+	pgSet *GetDataSet()
+	{
+		return set;
+	}
+	void SetNumberRows(long rows)
 	{
-		thread = t;
+		numRows = rows;
 	}
 	bool DeleteRows(size_t pos = 0, size_t numRows = 1)
 	{
@@ -108,7 +120,13 @@ public:
 	}
 
 private:
-	pgQueryThread *thread;
+	pgSet *set;
+	long numRows;
+
+	// Display options, read once per result-set rather than for each cell
+	bool indicateNull;
+	size_t maxColSize;
+	wxString decimalMark, thousandsSeparator;
 };
 
 #endif
@@ -20,7 +20,13 @@
 class pgObject;
 class pgCollection;
 class pgaFactory;
+class pgConn;
+class pgQueryThread;
+class pgQueryResultEvent;
 class ctlTreeFindTimer;
+class ctlTreeLoader;
+
+WX_DEFINE_ARRAY_PTR(ctlTreeLoader *, ctlTreeLoaderArray);
 
 class ctlTree : public wxTreeCtrl
 {
@@ -41,15 +47,40 @@ public:
 	pgCollection *FindCollection(pgaFactory &factory, wxTreeItemId parent);
 	wxTreeItemId FindItem(const wxTreeItemId &item, const wxString &str);
 	void NavigateTree(int keyCode);
+
+	// Load the objects of the collection in the background, adding them to
+	// the tree in batches as they arrive
+	bool LoadObjects(pgCollection *collection);
+	bool IsLoading(const wxTreeItemId &item);
+	// Wait for the objects of the item to be loaded, and add all of them
+	void CompleteLoading(const wxTreeItemId &item);
+	// Cancel loading the objects of the item, and its children
+	bool CancelLoading(const wxTreeItemId &item);
+
 	virtual ~ctlTree();
 
 	DECLARE_EVENT_TABLE()
 
 private:
 	void OnChar(wxKeyEvent &event);
+	void OnItemDeleted(wxTreeEvent &event);
+	void OnLoadProgress(pgQueryResultEvent &event);
+	void OnLoadResult(pgQueryResultEvent &event);
+	void OnLoadTimer(wxTimerEvent &event);
+
+	bool AddLoadedObjects(ctlTreeLoader *loader);
+	void ProcessLoaders();
+	void FinishLoading(ctlTreeLoader *loader);
+	void AddPlaceholder(ctlTreeLoader *loader);
+	void RemovePlaceholder(ctlTreeLoader *loader);
+
 	wxString m_findPrefix;
 	ctlTreeFindTimer *m_findTimer;
 
+	ctlTreeLoaderArray m_loaders;
+	wxTimer m_loadTimer;
+	bool m_removingPlaceholder;
+
 	friend class ctlTreeFindTimer;
 };
 
@@ -79,6 +110,25 @@ private:
 };
 
 
+// A collection, whose objects are being loaded in the background on a
+// connection of its own
+class ctlTreeLoader
+{
+public:
+	ctlTreeLoader(pgCollection *coll, pgConn *cn);
+	~ctlTreeLoader();
+
+	pgCollection *collection;
+	wxTreeItemId item, placeholder;
+	pgConn *conn;
+	pgQueryThread *thread;
+	// Number of rows of the result turned into objects
+	long rowsAdded;
+	// The query has completed
+	bool completed;
+};
+
+
 class treeObjectIterator
 {
 public:
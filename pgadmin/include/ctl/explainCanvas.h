@@ -31,8 +31,14 @@
 
 
 class ExplainShape;
+class ExplainLine;
 class ExplainPopup;
 class ExplainText;
+class ExplainNode;
+class ExplainPlan;
+class ExplainNodeList;
+
+WX_DEFINE_ARRAY_PTR(ExplainShape *, ExplainShapeArray);
 
 class ExplainCanvas : public wxShapeCanvas
 {
@@ -42,14 +48,48 @@ public:
 
 	void ShowPopup(ExplainShape *s);
 	void SetExplainString(const wxString &str);
+	// Show the output of EXPLAIN (FORMAT JSON); false, if it is not that
+	bool SetExplainJson(const wxString &str);
 	void Clear();
 	void SaveAsImage(const wxString &fileName, wxBitmapType imageType);
 
+	// The list to show the nodes of the plans read from JSON in
+	void SetNodeList(ExplainNodeList *list)
+	{
+		nodeList = list;
+	}
+	// Scroll to the shape of the node, and frame it
+	void ShowNode(ExplainNode *node);
+
+	wxShape *FindShape(double x, double y, int *attachment, wxClassInfo *info = NULL, wxShape *notImage = NULL);
+
 private:
 	void OnMouseMotion(wxMouseEvent &ev);
+	void OnPaint(wxPaintEvent &ev);
+
+	void AddNodeShapes(ExplainNode *node, ExplainShape *upper, long level);
+	// Place the shapes, once all of them are there
+	void LayoutShapes();
+	void CountShapes(ExplainShape *s);
+	void PlaceShapes(ExplainShape *s, wxArrayInt &next);
+	// Draw the shapes and lines within rect only
+	void DrawShapes(wxDC &dc, const wxRect &rect);
+	// The first shape of the column of the level not above y; with
+	// subtrees, the first one whose kids reach down to y
+	size_t FindInColumn(int level, double y, bool subtrees);
 
 	ExplainShape *rootShape;
 	ExplainPopup *popup;
+	ExplainPlan *plan;
+	ExplainNodeList *nodeList;
+	ExplainShape *markedShape;
+
+	// The shapes by level, each level from the top down; the shapes of
+	// a level start at columnStart[level]
+	ExplainShapeArray columns;
+	wxArrayInt columnStart;
+	int maxLevel;
+	int x0, y0, xoffs, yoffs;
 
 	DECLARE_EVENT_TABLE()
 };
@@ -60,6 +100,7 @@ class ExplainShape : public wxBitmapShape
 public:
 	ExplainShape(const wxImage &bmp, const wxString &description, long tokenNo = -1, long detailNo = -1);
 	static ExplainShape *Create(long level, ExplainShape *last, const wxString &str);
+	static ExplainShape *Create(long level, ExplainShape *last, ExplainNode *node);
 
 	void SetCondition(const wxString &str)
 	{
@@ -81,6 +122,23 @@ public:
 	{
 		return upperShape;
 	}
+	// NULL, unless the plan was read from JSON
+	ExplainNode *GetNode()
+	{
+		return node;
+	}
+	// The same as AddLine(), without looking for the line in the lines
+	// the shapes have already
+	void AddLineTo(ExplainLine *l, ExplainShape *upper);
+
+	// Framed, e.g. when picked from the list of the nodes
+	void SetMarked(bool mark)
+	{
+		marked = mark;
+	}
+
+	// The colour of the share of a node of the total
+	static wxColour GetHeatColour(double share);
 	double GetAverageCost()
 	{
 		return (costHigh - costLow) / 2 + costLow;
@@ -91,12 +149,16 @@ protected:
 	void OnLeftClick(double x, double y, int keys = 0, int attachment = 0);
 
 	ExplainShape *upperShape;
+	ExplainShapeArray kids;
+	ExplainLine *line;
+	ExplainNode *node;
 
 	void SetLabel(const wxString &str, int tokenNo = -1, int detailNo = -1);
 
 	long level;
 	wxString description, detail, condition, label;
-	wxString cost, actual;
+	wxString cost, actual, analysis;
+	bool marked;
 	double costLow, costHigh;
 	long rows, width;
 	int kidCount, kidNo;
@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// explainNodeList.h - The nodes of a plan, by what they took
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef EXPLAINNODELIST_H
+#define EXPLAINNODELIST_H
+
+// wxWindows headers
+#include <wx/wx.h>
+
+#include "ctl/ctlListView.h"
+#include "ctl/explainPlan.h"
+
+class ExplainCanvas;
+
+
+// A virtual list of all the nodes of the plan shown by an explain canvas,
+// the ones which took the largest share of the total first. It can be
+// sorted by any column; picking a node shows it in the canvas.
+class ExplainNodeList : public ctlListView
+{
+public:
+	ExplainNodeList(wxWindow *parent, ExplainCanvas *canvas);
+
+	// The plan is the canvas', NULL when it is cleared
+	void SetPlan(ExplainPlan *plan);
+	void Sort(int col, bool ascending);
+
+	virtual wxString OnGetItemText(long item, long col) const;
+	virtual wxListItemAttr *OnGetItemAttr(long item) const;
+
+private:
+	void OnColumnClick(wxListEvent &ev);
+	void OnItemSelected(wxListEvent &ev);
+
+	void AddNodes(ExplainNode *node);
+	void SortNodes();
+
+	ExplainCanvas *explainCanvas;
+
+	// All the nodes of the plan, in the displayed order
+	ExplainNodeArray nodes;
+
+	int sortColumn;
+	bool sortAscending;
+
+	wxListItemAttr attr;
+
+	DECLARE_EVENT_TABLE()
+};
+
+#endif
@@ -0,0 +1,193 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// explainPlan.h - Plans of EXPLAIN (FORMAT JSON)
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef EXPLAINPLAN_H
+#define EXPLAINPLAN_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/datetime.h>
+#include <wx/dynarray.h>
+#include <wx/hashmap.h>
+
+class ExplainNode;
+class explainJsonValue;
+
+WX_DEFINE_ARRAY_PTR(ExplainNode *, ExplainNodeArray);
+
+
+// A node of a plan, with the properties EXPLAIN gives it; those not
+// known here are kept as details, in the order they came in.
+class ExplainNode
+{
+public:
+	ExplainNode(ExplainNode *upper);
+	~ExplainNode();
+
+	// The heading of the node, the way EXPLAIN shows it as text, e.g.
+	// "Index Scan using pk on t (cost=...) (actual time=...)"
+	wxString GetHeading() const;
+	// The same, without the costs and the actual values
+	wxString GetName() const;
+
+	// The time of all the loops, kids included; -1 if not known
+	double GetTime() const
+	{
+		return analyzed && actualTotal >= 0 ? actualTotal * actualLoops : -1;
+	}
+	// How many times more, or less, rows there were than estimated;
+	// 1 if just right, or not known
+	double GetRowsError() const;
+	bool IsUnderestimated() const
+	{
+		return analyzed && actualRows > planRows;
+	}
+
+	ExplainNode *GetUpper() const
+	{
+		return upper;
+	}
+	const ExplainNodeArray &GetKids() const
+	{
+		return kids;
+	}
+
+	wxString nodeType, strategy, joinType, operation, setopCommand;
+	wxString parentRelationship, subplanName;
+	wxString relationName, schema, alias, indexName, scanDirection;
+	wxString cteName, functionName;
+
+	double startupCost, totalCost, planRows;
+	long planWidth;
+
+	// Only with ANALYZE; the times are in ms, per loop
+	bool analyzed;
+	double actualStartup, actualTotal, actualRows, actualLoops;
+
+	// Only with BUFFERS
+	long sharedHit, sharedRead, localHit, localRead, tempRead, tempWritten;
+
+	// E.g. "Filter", "Index Cond", "Sort Key", "Rows Removed by Filter"
+	wxArrayString detailNames, detailValues;
+
+	// What the node took itself, without its kids: the time, if known,
+	// and the cost. The share is of the time of the plans if known,
+	// else of their cost, between 0 and 1.
+	double exclusiveTime, exclusiveCost, share;
+
+private:
+	ExplainNode *upper;
+	ExplainNodeArray kids;
+
+	friend class ExplainPlan;
+};
+
+
+// The plans of the statements explained at once
+class ExplainPlan
+{
+public:
+	// NULL, if the text is not the output of EXPLAIN (FORMAT JSON)
+	static ExplainPlan *Parse(const wxString &json);
+	~ExplainPlan();
+
+	const ExplainNodeArray &GetRoots() const
+	{
+		return roots;
+	}
+	// The number of nodes of all the plans
+	size_t GetCount() const
+	{
+		return count;
+	}
+
+	// Whether there are actual times, i.e. ANALYZE with TIMING
+	bool IsTimed() const
+	{
+		return timed;
+	}
+	// The time the statements took, -1 if not known
+	double GetTotalTime() const;
+	double GetTotalCost() const;
+
+	// Only with ANALYZE, in ms, all the statements together; -1 if not known
+	double planningTime, executionTime;
+
+private:
+	ExplainPlan();
+
+	// Work out the exclusive times and costs of the node and its kids
+	void Analyze(ExplainNode *node);
+	void SetShares(ExplainNode *node, double total);
+
+	// The node of the value of a "Plan" key, and its kids
+	static ExplainNode *ReadNode(const explainJsonValue *value, ExplainNode *upper, size_t &count);
+
+	ExplainNodeArray roots;
+	size_t count;
+	bool timed;
+};
+
+
+// A plan explained in the query tool, kept as it came, to be compared
+// with the later ones
+class ExplainRun
+{
+public:
+	wxString json;
+	wxDateTime time;
+};
+
+WX_DECLARE_OBJARRAY(ExplainRun, ExplainRunArray);
+
+
+// A node of the plan before, and the node of the plan after it matches;
+// either may be missing
+class ExplainDiffRow
+{
+public:
+	ExplainNode *before, *after;
+	int depth;
+	// E.g. another join method, or other estimates
+	wxString changes;
+};
+
+WX_DECLARE_OBJARRAY(ExplainDiffRow, ExplainDiffRowArray);
+WX_DECLARE_HASH_MAP(ExplainNode *, wxString, wxPointerHash, wxPointerEqual, ExplainSignatureMap);
+
+
+// The nodes of two plans of the same query, side by side. The kids of
+// two matching nodes match, if they have the same relations below them,
+// else by their place among the kids.
+class ExplainPlanDiff
+{
+public:
+	ExplainPlanDiff(ExplainPlan *before, ExplainPlan *after);
+
+	// In the order of the plan before; the nodes only in the plan after
+	// follow the ones matching next to them
+	const ExplainDiffRowArray &GetRows() const
+	{
+		return rows;
+	}
+
+private:
+	wxString AddSignatures(ExplainNode *node);
+	void MatchNodes(ExplainNode *before, ExplainNode *after, int depth);
+	void AddUnmatched(ExplainNode *node, bool before, int depth);
+	static wxString GetChanges(ExplainNode *before, ExplainNode *after);
+
+	ExplainDiffRowArray rows;
+	// The relations below each node, sorted
+	ExplainSignatureMap signatures;
+};
+
+#endif
@@ -26,6 +26,8 @@ pgadmin3_SOURCES += \
 	include/ctl/ctlProgressStatusBar.h \
 	include/ctl/ctlTree.h \
 	include/ctl/explainCanvas.h \
+	include/ctl/explainNodeList.h \
+	include/ctl/explainPlan.h \
 	include/ctl/timespin.h \
 	include/ctl/wxgridsel.h \
 	include/ctl/xh_calb.h \
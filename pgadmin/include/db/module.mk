@@ -10,6 +10,8 @@
 #######################################################################
 
 pgadmin3_SOURCES += \
+	  include/db/pgCatalogCache.h \
+	  include/db/pgCompletionIndex.h \
 	  include/db/pgConn.h \
 	  include/db/pgQueryThread.h \
 	  include/db/pgQueryResultEvent.h \
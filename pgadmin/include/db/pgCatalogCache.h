@@ -0,0 +1,162 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgCatalogCache.h - Client-side snapshot of the catalogs of a database
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGCATALOGCACHE_H
+#define PGCATALOGCACHE_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/hashmap.h>
+#include <wx/dynarray.h>
+
+#include "utils/misc.h"
+
+class pgConn;
+
+// A schema, type or function of the snapshot
+typedef struct pgCatalogNamespace
+{
+	OID oid;
+	wxString name;
+} pgCatalogNamespace;
+
+typedef struct pgCatalogType
+{
+	OID oid, nspOid;
+	wxString name;
+} pgCatalogType;
+
+typedef struct pgCatalogFunction
+{
+	OID oid, nspOid;
+	wxString name, arguments;
+} pgCatalogFunction;
+
+// A column of a relation
+typedef struct pgCatalogAttribute
+{
+	wxString name;
+	long num;
+	OID typeOid;
+	bool notNull;
+} pgCatalogAttribute;
+
+WX_DECLARE_OBJARRAY(pgCatalogNamespace, pgCatalogNamespaceArray);
+WX_DECLARE_OBJARRAY(pgCatalogType, pgCatalogTypeArray);
+WX_DECLARE_OBJARRAY(pgCatalogFunction, pgCatalogFunctionArray);
+WX_DECLARE_OBJARRAY(pgCatalogAttribute, pgCatalogAttributeArray);
+
+// A table, view, sequence etc. Its columns are loaded with the first use,
+// for all the relations of the schema at once.
+class pgCatalogRelation
+{
+public:
+	OID oid, nspOid, relfilenode;
+	wxString name, xmin;
+	wxChar kind;
+	// Count and xmin of its pg_attribute rows, as of the last check
+	wxString attStamp;
+
+	bool attributesLoaded;
+	pgCatalogAttributeArray attributes;
+};
+
+WX_DECLARE_HASH_MAP(OID, pgCatalogRelation *, wxIntegerHash, wxIntegerEqual, pgCatalogRelationMap);
+WX_DECLARE_STRING_HASH_MAP(pgCatalogRelation *, pgCatalogRelationNameMap);
+WX_DEFINE_ARRAY_PTR(pgCatalogRelation *, pgCatalogRelationArray);
+
+
+class pgCatalogCache
+{
+public:
+	// The snapshot of the database of the connection. It is checked for
+	// changes on the server, when it was not checked for a while.
+	static pgCatalogCache *Get(pgConn *conn);
+	// Have the snapshot checked for changes with its next use, or loaded
+	// again in full (e.g. when the user refreshes the browser)
+	static void Invalidate(pgConn *conn, bool reload = false);
+	// Free the snapshots, when the application exits
+	static void ClearAll();
+
+	// A snapshot of its own, e.g. for a background thread
+	pgCatalogCache();
+	~pgCatalogCache();
+
+	// Load what changed since the last check (all, if forced). Relations
+	// and their columns got earlier are not valid any more after it.
+	bool Refresh(pgConn *conn, bool force = false);
+	// Have the next Refresh() check the server
+	void Expire()
+	{
+		lastCheck = wxDateTime();
+	}
+	// The stamps of the catalogs as of the last check
+	wxString GetStamp() const
+	{
+		return nspStamp + wxT("/") + relStamp + wxT("/") + attStamp + wxT("/") + typStamp + wxT("/") + proStamp;
+	}
+	// Load the columns of all the relations, which have none loaded yet
+	void LoadMissingAttributes(pgConn *conn);
+
+	OID FindNamespace(const wxString &name);
+	pgCatalogRelation *FindRelation(OID nspOid, const wxString &name);
+	pgCatalogRelation *GetRelation(OID oid);
+	// The relations of the schema, having one of the given relkinds
+	void GetRelations(OID nspOid, const wxString &kinds, pgCatalogRelationArray &relations);
+	// The columns of the relation, ordered by their number
+	const pgCatalogAttributeArray *GetAttributes(pgConn *conn, OID relOid);
+
+	const pgCatalogNamespaceArray &GetNamespaces()
+	{
+		return namespaces;
+	}
+	const pgCatalogTypeArray &GetTypes()
+	{
+		return types;
+	}
+	const pgCatalogFunctionArray &GetFunctions()
+	{
+		return functions;
+	}
+	const pgCatalogRelationMap &GetRelations()
+	{
+		return relations;
+	}
+
+	// Identifies the database of the connection
+	static wxString GetKey(pgConn *conn);
+
+private:
+
+	void LoadNamespaces(pgConn *conn);
+	void LoadRelations(pgConn *conn);
+	void LoadAttributes(pgConn *conn, const wxString &restriction);
+	// Drop the columns of the relations, whose pg_attribute rows changed
+	void CheckAttributes(pgConn *conn);
+	void LoadTypes(pgConn *conn);
+	void LoadFunctions(pgConn *conn);
+	// Key of a relation by its schema and name
+	static wxString NameKey(OID nspOid, const wxString &name);
+
+	pgCatalogNamespaceArray namespaces;
+	pgCatalogRelationMap relations;
+	// The same relations, by NameKey()
+	pgCatalogRelationNameMap relationsByName;
+	pgCatalogTypeArray types;
+	pgCatalogFunctionArray functions;
+
+	// Catalog stamps of the last check, and when it happened
+	wxString nspStamp, relStamp, attStamp, typStamp, proStamp;
+	wxDateTime lastCheck;
+	bool reloadAll;
+};
+
+#endif
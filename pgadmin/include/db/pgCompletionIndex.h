@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgCompletionIndex.h - Local index of identifiers for tab completion
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGCOMPLETIONINDEX_H
+#define PGCOMPLETIONINDEX_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/hashmap.h>
+
+class pgConn;
+class pgCatalogCache;
+
+// What to complete, keep in sync with utils/tabcomplete.c
+enum
+{
+	COMPLETE_INDEX_SCHEMAS = 1,
+	COMPLETE_INDEX_RELATIONS,
+	COMPLETE_INDEX_FUNCTIONS,
+	COMPLETE_INDEX_ATTRIBUTES
+};
+
+WX_DECLARE_STRING_HASH_MAP(wxArrayString, pgCompletionColumnMap);
+
+// Sorted, quoted identifiers of a database. An index is never changed
+// once built; a newer one replaces it.
+class pgCompletionIndex
+{
+public:
+	// Find the completions of text in the index of the database of the
+	// connection, without going to the server. Returns false, if there
+	// is no index yet, or it cannot answer that kind of completion.
+	// The index gets built and refreshed in the background.
+	static bool Complete(pgConn *conn, int kind, const wxString &relkinds, const wxString &text,
+	                     const wxString &addon, wxArrayString &result);
+	// Have the index built again from freshly loaded catalogs with its next use
+	static void Invalidate(pgConn *conn);
+	// Wait for the refreshes and free all the indexes, when exiting
+	static void ClearAll();
+
+	pgCompletionIndex(pgCatalogCache *catalog, const wxArrayString &searchPath);
+
+private:
+	// The schemas, or the qualified names, the way psql offers them
+	void CompleteSchemaPart(const wxArrayString &qualified, const wxString &text, wxArrayString &result);
+
+	static void AddMatches(const wxArrayString &names, const wxString &prefix, wxArrayString &result);
+
+	// Names are kept separately for each of these relkinds
+	static const wxString relKinds;
+
+	wxArrayString schemas;
+	wxArrayString visibleRelations[7], catalogRelations[7], qualifiedRelations[7];
+	wxArrayString visibleFunctions, qualifiedFunctions;
+	pgCompletionColumnMap columns;
+};
+
+#endif
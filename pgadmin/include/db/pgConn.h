@@ -82,6 +82,15 @@ typedef struct pgError
 	void SetError(PGresult *_res = NULL, wxMBConv *_conv = NULL);
 } pgError;
 
+// A cached data type
+typedef struct pgTypeCacheEntry
+{
+	wxString name;
+	OID baseType;
+} pgTypeCacheEntry;
+
+WX_DECLARE_HASH_MAP(OID, pgTypeCacheEntry, wxIntegerHash, wxIntegerEqual, pgTypeCache);
+
 class pgConn
 {
 public:
@@ -259,8 +268,24 @@ public:
 	bool EndPutCopy(const wxString errormsg);
 	bool GetCopyFinalStatus(void);
 
+	// COPY ... TO STDOUT: GetCopyData returns the length of the next row
+	// (release it with FreeCopyData), -1 at the end of the data or -2 on
+	// error
+	bool StartCopyOut(const wxString query);
+	int GetCopyData(char **buffer);
+	void FreeCopyData(char *buffer);
+
 	bool TableHasColumn(wxString schemaname, wxString tblname, const wxString &colname);
 
+	// Names of the data types of result-sets, resolved for all the given
+	// types with one query, and kept until a command may have changed them
+	void CacheTypes(const wxArrayLong &typeOids, const wxArrayLong &typeMods);
+	wxString GetTypeName(OID typeOid);
+	wxString GetFullTypeName(OID typeOid, long typeMod);
+	OID GetBaseType(OID typeOid);
+	void CheckTypeCache(PGresult *res);
+	void ClearTypeCache();
+
 protected:
 	PGconn   *conn;
 	PGcancel *m_cancelConn;
@@ -291,6 +316,11 @@ private:
 	bool Initialize();
 
 	wxString qtString(const wxString &value);
+	static wxString TypeModKey(OID typeOid, long typeMod);
+
+	pgTypeCache typeCache;
+	wxStringToStringHashMap typeModCache;
+	wxCriticalSection typeCacheLock;
 
 	bool features[32];
 	int minorVersion, majorVersion, patchVersion;
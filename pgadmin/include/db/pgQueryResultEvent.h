@@ -18,12 +18,14 @@
 class pgBatchQuery;
 
 extern const wxEventType PGQueryResultEvent;
+extern const wxEventType PGQueryProgressEvent;
 
 
 class pgQueryResultEvent : public wxCommandEvent
 {
 public:
-	pgQueryResultEvent(unsigned long _thrdId, pgBatchQuery *_qry, int _id = 0);
+	pgQueryResultEvent(unsigned long _thrdId, pgBatchQuery *_qry, int _id = 0,
+	                   wxEventType _type = PGQueryResultEvent);
 	pgQueryResultEvent(const pgQueryResultEvent &_ev);
 
 	// Required for sending with wxPostEvent()
@@ -76,4 +78,9 @@ typedef void (wxEvtHandler::*pgQueryResultEventFunc)(pgQueryResultEvent &);
 	DECLARE_EVENT_TABLE_ENTRY(PGQueryResultEvent, id1, id2, \
 	pgQueryResultEventHandler(fn), (wxObject*) NULL),
 
+// Rows of a streamed result have arrived (the query is still running)
+#define EVT_PGQUERYPROGRESS(id, fn)                                \
+	DECLARE_EVENT_TABLE_ENTRY(PGQueryProgressEvent, id, wxID_ANY,  \
+	pgQueryResultEventHandler(fn), (wxObject*) NULL),
+
 #endif // PGQUERYRESULTEVENT_H
@@ -141,6 +141,7 @@ protected:
 	Oid                m_insertedOid;   // Inserted Oid
 	wxString           m_message;       // Message generated during query execution
 	pgError            m_err;           // Error
+	wxString           m_stmtName;      // Prepared statement to execute as
 
 private:
 	// Do not allow copy construction and '=' operator (shadow copying)
@@ -160,6 +161,7 @@ private:
 	friend class pgQueryThread;
 };
 WX_DEFINE_ARRAY_PTR(pgBatchQuery *, pgBatchQueryArray);
+WX_DEFINE_ARRAY_PTR(pgSet *, pgSetArray);
 
 class pgQueryThread : public wxThread
 {
@@ -186,11 +188,38 @@ public:
 
 	void SetEventOnCancellation(bool eventOnCancelled);
 
-	void AddQuery(
+	// Stream the rows of the result to be retrieved using the libpq
+	// single-row mode. The result-set (DataSet) becomes available with the
+	// first row, and grows while the query is running. A PGQueryProgressEvent
+	// is sent to the caller, whenever new rows have been added.
+	// Not more than maxRows rows will be kept (0 - no limit).
+	void EnableStreaming(long maxRows = 0);
+	bool IsStreaming()
+	{
+		return m_streaming;
+	}
+
+	int AddQuery(
 	    const wxString &_qry, pgParamsArray *_params = NULL,
 	    long _eventId = 0, void *_data = NULL, bool _useCallable = false,
 	    int _resultToRetrieve = -1);
 
+	// Queue the query to be executed as the named prepared statement, which
+	// is prepared on the connection, when used for the first time
+	int AddPreparedQuery(const wxString &_name, const wxString &_qry,
+	                     pgParamsArray *_params = NULL);
+
+	// Wait (up to timeout ms) for the query at the given index to complete
+	bool WaitForQuery(int _idx, long timeout);
+
+	// Forget all the queries (and their results), once they have completed
+	void ClearQueries();
+
+	const wxArrayString &GetPreparedStatements() const
+	{
+		return m_prepared;
+	}
+
 	virtual void *Entry();
 	bool DataValid(int _idx = -1) const
 	{
@@ -257,6 +286,13 @@ public:
 private:
 	int Execute();
 	int RaiseEvent(int _retval = 0);
+	int RaiseProgressEvent();
+	bool WaitForInput(long timeout);
+
+	// Streaming support
+	void StreamRow(PGresult *row, bool keep);
+	void FlushStreamedRows(bool force);
+	void RetireStreamedSet(pgSet *&set);
 
 	// Queries to be executed
 	pgBatchQueryArray  m_queries;
@@ -264,6 +300,14 @@ private:
 	int                m_currIndex;
 	// Connection object
 	pgConn            *m_conn;
+	// Number of queries completed
+	int                m_completed;
+	// Protects adding the queries and counting the completed ones, and
+	// signals both
+	wxMutex            m_queueLock;
+	wxCondition        m_queueCond;
+	// Statements prepared on the connection by this thread
+	wxArrayString      m_prepared;
 	// Execution cancelled?
 	bool               m_cancelled;
 	// Raise events even when cancelled the execution
@@ -285,6 +329,23 @@ private:
 	// Notice Handler
 	void              *m_noticeHandler;
 
+	// Stream the result rows
+	bool               m_streaming;
+	// Maximum number of rows to be kept, while streaming (0 - no limit)
+	long               m_streamWindow;
+	// Result-set receiving the rows of the current statement
+	pgSet             *m_streamSet;
+	// Rows received, but not yet added to m_streamSet
+	PGresult          *m_streamChunk;
+	// Completed streamed result-set of an earlier statement
+	pgSet             *m_streamResult;
+	// Rows discarded, when exceeding the window
+	long               m_streamSkipped;
+	wxLongLong         m_streamLastFlush;
+	wxLongLong         m_streamLastEvent;
+	// Streamed result-sets, which are not the result of the query anymore.
+	// These may still be in use by the caller, and released with the thread.
+	pgSetArray         m_retiredSets;
 };
 
 #endif
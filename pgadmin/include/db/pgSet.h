@@ -15,6 +15,7 @@
 // wxWindows headers
 #include <wx/wx.h>
 #include <wx/datetime.h>
+#include <wx/thread.h>
 
 // PostgreSQL headers
 #include <libpq-fe.h>
@@ -32,6 +33,11 @@ typedef enum
 
 class pgConn;
 
+WX_DEFINE_ARRAY_PTR(PGresult *, pgResultArray);
+
+class pgSetBlock;
+WX_DECLARE_HASH_MAP(long, pgSetBlock *, wxIntegerHash, wxIntegerEqual, pgSetBlockMap);
+
 // Class declarations
 class pgSet
 {
@@ -39,8 +45,10 @@ public:
 	pgSet();
 	pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt);
 	~pgSet();
+	// The rows of a streamed result are counted by the query thread
 	long NumRows() const
 	{
+		wxCriticalSectionLocker lock(chunkLock);
 		return nRows;
 	}
 	long NumCols() const
@@ -50,7 +58,7 @@ public:
 
 	void MoveNext()
 	{
-		if (pos <= nRows) pos++;
+		if (pos <= NumRows()) pos++;
 	}
 	void MovePrevious()
 	{
@@ -58,12 +66,12 @@ public:
 	}
 	void MoveFirst()
 	{
-		if (nRows) pos = 1;
+		if (NumRows()) pos = 1;
 		else pos = 0;
 	}
 	void MoveLast()
 	{
-		pos = nRows;
+		pos = NumRows();
 	}
 	void Locate(long l)
 	{
@@ -75,11 +83,12 @@ public:
 	}
 	bool Bof() const
 	{
-		return (!nRows || pos < 1);
+		return (!NumRows() || pos < 1);
 	}
 	bool Eof() const
 	{
-		return (!nRows || pos > nRows);
+		long rows = NumRows();
+		return (!rows || pos > rows);
 	}
 	wxString ColName(const int col) const;
 	OID ColTypeOid(const int col) const;
@@ -97,10 +106,7 @@ public:
 	{
 		return PQfsize(res, col);
 	}
-	bool IsNull(const int col) const
-	{
-		return (PQgetisnull(res, pos - 1, col) != 0);
-	}
+	bool IsNull(const int col) const;
 	int ColScale(const int col) const;
 	int ColNumber(const wxString &colName) const;
 	bool HasColumn(const wxString &colname) const;
@@ -108,6 +114,9 @@ public:
 
 	wxString GetVal(const int col) const;
 	wxString GetVal(const wxString &col) const;
+	// Converted value of a column in the current row, NULL for a null value.
+	// The pointer is valid until the next call.
+	const wxChar *GetValPtr(const int col, size_t &len) const;
 	long GetLong(const int col) const;
 	long GetLong(const wxString &col) const;
 	bool GetBool(const int col) const;
@@ -140,15 +149,63 @@ public:
 		return wxEmptyString;
 	}
 
+	// Support for results streamed in by pgQueryThread (libpq single-row
+	// mode). The rows arrive in chunks, which are appended while the query
+	// is still running. No catalog lookups are made on the connection until
+	// the streaming has been finished, as it is still busy with the query.
+	// The current row is left to the reader, it starts at the first row,
+	// whenever that one arrives.
+	void AppendRows(PGresult *chunk);
+	void SetStreaming(bool streaming);
+	bool IsStreaming() const
+	{
+		wxCriticalSectionLocker lock(chunkLock);
+		return isStreaming;
+	}
+
+	// Keep the converted values of the rows read, in blocks per column,
+	// for a result-set, which is read repeatedly (i.e. shown in a grid)
+	void SetCacheValues(bool cache)
+	{
+		cacheValues = cache;
+	}
+
 protected:
 	pgConn *conn;
 	PGresult *res;
 	long pos, nRows, nCols;
 	wxString ExecuteScalar(const wxString &sql) const;
+	PGresult *RowResult(int &tuple) const
+	{
+		return RowResult(pos - 1, tuple);
+	}
+	PGresult *RowResult(long row, int &tuple) const;
+	pgSetBlock *GetBlock(const int col) const;
+	void ClearCache();
+	static pgTypClass TypClassFromOid(OID typeOid);
 	wxMBConv &conv;
 	bool needColQuoting;
 	mutable wxArrayString colTypes, colFullTypes;
-	wxArrayInt colClasses;
+	mutable wxArrayInt colClasses;
+	mutable bool typesResolved;
+	void ResolveTypes() const;
+
+	// Row store of a streamed result: chunks[0] is res, chunkStarts holds
+	// the (zero based) row number of the first row of each chunk. These,
+	// nRows and isStreaming are only used with chunkLock held, as the
+	// query thread changes them while the result is read.
+	bool isStreaming;
+	pgResultArray chunks;
+	wxArrayLong chunkStarts;
+	mutable size_t lastChunk;
+	mutable wxCriticalSection chunkLock;
+
+	// Cache of the converted values (see GetValPtr), the blocks are
+	// released in the order they were loaded
+	bool cacheValues;
+	mutable pgSetBlockMap cacheBlocks;
+	mutable wxArrayLong cacheOrder;
+	mutable size_t cacheSize;
 };
 
 
@@ -22,6 +22,7 @@ class SelSchemaPage;
 class SelTablesPage;
 class ReportPage;
 class ddStubTable;
+class wxProgressDialog;
 
 enum
 {
@@ -35,6 +36,8 @@ enum
 };
 
 WX_DECLARE_STRING_HASH_MAP( ddStubTable *, stubTablesHashMap);
+WX_DECLARE_HASH_MAP( OID, ddStubTable *, wxIntegerHash, wxIntegerEqual, stubTablesOidHashMap);
+WX_DECLARE_STRING_HASH_MAP( OID, oidsHashMap);
 WX_DEFINE_SORTED_ARRAY_INT(int, wxSortedArrayInt);
 
 // Stub tables related classes
@@ -44,6 +47,7 @@ public:
 	// Implement and replace at this and other dd related classes as Generation Wizard static wxArrayString getSchemasNames(...);
 	static wxArrayString getTablesNames(pgConn *connection, wxString schemaName);
 	static ddStubTable *getTable(pgConn *connection, wxString tableName, OID tableOid);
+	static bool getTables(pgConn *connection, oidsHashMap &oids, stubTablesHashMap &tables, wxProgressDialog *progress = NULL);
 	static ddTableFigure *getTableFigure(ddStubTable *table);
 	static void getAllRelationships(pgConn *connection, stubTablesHashMap &tables, ddDatabaseDesign *design);
 	static int getPgColumnNum(pgConn *connection, wxString schemaName, wxString tableName, wxString columnName);
@@ -54,8 +58,8 @@ public:
 	static bool isModelSameDbFk(pgConn *connection, OID destTableOid, wxString schemaName, wxString fkName, wxString sourceTableName, wxString destTableName, ddStubTable *destStubTable, ddRelationshipFigure *relation);
 
 private:
-	static bool setUniqueConstraints(pgConn *connection, ddStubTable *table);
-	static bool setPkName(pgConn *connection, ddStubTable *table);
+	static ddStubTable *getStub(stubTablesOidHashMap &stubs, OID tableOid);
+	static void updateProgress(wxProgressDialog *progress, long rowsDone, long rowsTotal);
 	static int sortFunc(int n1, int n2)
 	{
 		return n1 - n2;
@@ -103,8 +107,6 @@ public:
 //
 //
 
-WX_DECLARE_STRING_HASH_MAP( OID, oidsHashMap);
-
 class ddDBReverseEngineering : public wxWizard
 {
 public:
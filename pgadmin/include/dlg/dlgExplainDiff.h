@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// dlgExplainDiff.h - Compare two plans explained in a query tab
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef DLGEXPLAINDIFF_H
+#define DLGEXPLAINDIFF_H
+
+#include <wx/wx.h>
+
+#include "dlg/dlgClasses.h"
+#include "ctl/ctlListView.h"
+#include "ctl/explainPlan.h"
+
+WX_DEFINE_ARRAY_PTR(ExplainPlan *, ExplainPlanArray);
+
+
+// The rows of a plan diff: the node before and the node after side by
+// side, with what each took
+class ExplainDiffList : public ctlListView
+{
+public:
+	ExplainDiffList(wxWindow *parent);
+
+	// The diff is the dialog's, NULL to clear the list
+	void SetDiff(ExplainPlanDiff *diff, bool timed);
+
+	virtual wxString OnGetItemText(long item, long col) const;
+	virtual wxListItemAttr *OnGetItemAttr(long item) const;
+
+private:
+	// The time of the node if the plans are timed, else its cost
+	double GetValue(ExplainNode *node) const;
+	void SetHeading(int col, const wxString &text);
+
+	ExplainPlanDiff *planDiff;
+	bool planTimed;
+
+	wxListItemAttr changedAttr, unmatchedAttr;
+};
+
+
+class dlgExplainDiff : public pgDialog
+{
+public:
+	dlgExplainDiff(wxWindow *parent, const ExplainRunArray &runs);
+	~dlgExplainDiff();
+
+private:
+	void OnChangeRun(wxCommandEvent &ev);
+	void ShowDiff();
+	wxString GetTotal(ExplainPlan *plan) const;
+
+	ExplainDiffList *lstNodes;
+
+	// One for each run, NULL if it cannot be read any more
+	ExplainPlanArray plans;
+	ExplainPlanDiff *planDiff;
+
+	DECLARE_EVENT_TABLE()
+};
+
+#endif
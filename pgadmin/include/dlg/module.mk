@@ -22,6 +22,7 @@ pgadmin3_SOURCES += \
 	include/dlg/dlgDatabase.h \
 	include/dlg/dlgDomain.h \
 	include/dlg/dlgEventTrigger.h \
+	include/dlg/dlgExplainDiff.h \
 	include/dlg/dlgExtension.h \
 	include/dlg/dlgEditGridOptions.h \
 	include/dlg/dlgFindReplace.h \
@@ -21,6 +21,8 @@
 #include "dlg/dlgClasses.h"
 #include "ctl/ctlSQLGrid.h"
 
+class pgQueryResultEvent;
+
 //
 // This number MUST be incremented if changing any of the default perspectives
 //
@@ -42,23 +44,56 @@ public:
 	cacheLine()
 	{
 		cols = 0;
+		original = 0;
 		stored = false;
 		readOnly = false;
+		pending = false;
+		cached = false;
 	}
 	~cacheLine()
 	{
-		if (cols) delete[] cols;
+		if (original) delete[] original;
 	}
 
-	wxString *cols;
+	wxString *cols;         // from the cacheCellArena of the table
+	wxString *original;     // contents in the database, while an update is pending
 	bool stored, readOnly;
+	bool pending;           // waiting for the next flush; an insert if there's no original
+	bool cached;            // same as the row in the dataSet, may be dropped and read again
+};
+
+WX_DEFINE_ARRAY_PTR(cacheLine *, cacheLineArray);
+WX_DEFINE_ARRAY_PTR(wxString *, cacheCellsArray);
+WX_DEFINE_ARRAY_PTR(pgQueryThread *, pgQueryThreadArray);
+
+
+// The cells of the cache lines, nCols strings each. They are carved out
+// of large chunks, and reused once released.
+class cacheCellArena
+{
+public:
+	cacheCellArena(int columns);
+	~cacheCellArena();
+	wxString *Alloc();
+	void Release(wxString *cells);
+	int GetColumns()
+	{
+		return nCols;
+	}
+
+private:
+	int nCols;
+	int chunkUsed;
+	cacheCellsArray chunks, freeCells;
 };
 
 
 class cacheLinePool
 {
 public:
-	cacheLinePool(int initialLines);
+	// With maxBytes, lines set cached are dropped again, the ones read
+	// longest ago first, when they hold more than that
+	cacheLinePool(int initialLines, cacheCellArena *cells, size_t maxBytes = 0);
 	~cacheLinePool();
 	cacheLine *operator[] (int line)
 	{
@@ -68,9 +103,39 @@ public:
 	bool IsFilled(int lineNo);
 	void Delete(int lineNo);
 
+	// The line got filled from the dataSet; never used with Delete()
+	void SetCached(int lineNo);
+	bool HasDropped()
+	{
+		return dropped;
+	}
+	// No lines are dropped between Pin() and Unpin(), e.g. while the lines
+	// of a selection are used one after another
+	void Pin()
+	{
+		pinned++;
+	}
+	void Unpin()
+	{
+		pinned--;
+	}
+
 private:
+	cacheLine *NewLine();
+	void FreeLine(cacheLine *line);
+
 	cacheLine **ptr;
 	int anzLines;
+
+	cacheCellArena *arena;
+	cacheLineArray chunks, freeLines;
+	int chunkUsed;
+
+	// Cached lines in the order they were read, from cachedHead on
+	wxArrayInt cachedLines, cachedSizes;
+	size_t cachedHead, cachedBytes, maxBytes;
+	bool dropped;
+	int pinned;
 };
 
 
@@ -199,6 +264,34 @@ public:
 
 	bool Paste();
 
+	// In batch mode, stored lines are queued and written by FlushLines(),
+	// all at once in a single transaction
+	void SetBatchMode(bool batch)
+	{
+		batchMode = batch;
+	}
+	bool GetBatchMode()
+	{
+		return batchMode;
+	}
+	bool HasPendingLines()
+	{
+		return !pendingLines.IsEmpty();
+	}
+	bool FlushLines();
+	// Delete the rows (sorted ascending) with a single statement
+	bool DeleteRowList(const wxArrayInt &rows);
+
+	// The dataSet is the first page of rows in primary key order; the next
+	// pages are fetched in the background, when scrolling close to the end
+	void SetPaging(int rows, bool descending, const wxString &filter, const wxString &order, double estimatedRows);
+	bool IsPaging()
+	{
+		return pageRows > 0;
+	}
+	void PageComplete(pgQueryResultEvent &event);
+	wxString GetPagingStatus();
+
 private:
 	pgQueryThread *thread;
 	pgConn *connection;
@@ -209,9 +302,26 @@ private:
 	wxString primaryKeyColNumbers;
 
 	cacheLine *GetLine(int row);
+	pgSet *LocateLine(int lineNo);
+	void FetchPage();
+	int FindRow(cacheLine *line);
+	void RemoveLine(size_t pos);
+	void RemovePending(cacheLine *line);
+	void GetKeyColumns(wxArrayInt &keyCols);
+	wxString KeyValue(const wxString *cols, int col);
 	wxString MakeKey(cacheLine *line);
+	wxString KeyTuple(const wxString *cols);
+	void AddSavedKey(cacheLine *line, const wxString *oldCols);
 	void SetNumberEditor(int col, int len);
 
+	bool QueueLine(cacheLine *line);
+	void GetChangedColumns(cacheLine *line, wxArrayInt &changed);
+	pgSet *ExecuteInsert(const cacheLineArray &lines);
+	bool ExecuteUpdate(const cacheLineArray &lines, const wxArrayInt &changed);
+	void ShowFlushErrors(const wxString &error);
+	void ShowStatus(const wxString &text);
+
+	cacheCellArena *cells;
 	cacheLinePool *dataPool, *addPool;
 	cacheLine savedLine;
 	int lastRow;
@@ -228,6 +338,18 @@ private:
 
 	wxArrayInt colMap;
 
+	bool batchMode;
+	cacheLineArray pendingLines;
+
+	int pageRows;               // rows per page, 0 if all rows are in the dataSet
+	bool pageDescending, morePages;
+	wxString pageFilter, pageOrder;
+	double pageEstimate;        // rows in the table, as estimated by the statistics
+	pgQueryThreadArray pages;   // the first one is the thread
+	pgQueryThread *pageThread;  // fetching the next page
+	pgConn *pageConn;
+	wxArrayString savedKeys;    // keys of the rows saved, not fetched again by the next pages
+
 	friend class ctlSQLEditGrid;
 };
 
@@ -279,7 +401,7 @@ private:
 	void OnDelete(wxCommandEvent &event);
 	void OnOptions(wxCommandEvent &event);
 	void OnSave(wxCommandEvent &event);
-	bool DoSave();
+	bool DoSave(bool flush = true);
 	void CancelChange();
 	void OnUndo(wxCommandEvent &event);
 	void OnCellChange(wxGridEvent &event);
@@ -295,6 +417,9 @@ private:
 	void OnDescSort(wxCommandEvent &event);
 	void OnRemoveSort(wxCommandEvent &event);
 	void OnPaste(wxCommandEvent &event);
+	void OnBatchSave(wxCommandEvent &event);
+	void OnPageRows(wxCommandEvent &event);
+	void OnPageComplete(pgQueryResultEvent &event);
 	void OnLabelDoubleClick(wxGridEvent &event);
 	void OnLabelRightClick(wxGridEvent &event);
 	void OnCellRightClick(wxGridEvent &event);
@@ -321,6 +446,8 @@ private:
 	bool hasOids;
 	wxString tableName;
 	wxString primaryKeyColNumbers;
+	wxString primaryKey;        // quoted columns, to page through the rows
+	double estimatedRows;
 	wxString orderBy;
 	bool autoOrderBy;
 	wxString rowFilter;
@@ -14,6 +14,7 @@
 
 
 class ctlSQLResult;
+class pgConn;
 class pgSet;
 
 #include "dlg/dlgClasses.h"
@@ -27,6 +28,11 @@ public:
 
 	bool Export(pgSet *set);
 
+	// Streams the result of a single query straight to the file with
+	// COPY ... TO STDOUT, when the server and the chosen options allow it
+	bool PrepareCopy(pgConn *conn, const wxString &query);
+	bool Export(pgConn *conn, long &rows);
+
 private:
 	void OnChange(wxCommandEvent &ev);
 	void OnHelp(wxCommandEvent &ev);
@@ -35,8 +41,47 @@ private:
 	void OnBrowseFile(wxCommandEvent &ev);
 
 	wxWindow *parent;
+	wxString copyQuery, copyHeader;
 
 	DECLARE_EVENT_TABLE()
 };
 
+
+// Reads the rows of a running COPY ... TO STDOUT and writes them to the
+// export file through a buffer, so memory use does not grow with the data
+class exportCopyThread : public wxThread
+{
+public:
+	exportCopyThread(pgConn *_conn, wxFile *_file, const wxString &_header, bool _unicode, bool _crlf);
+	void *Entry();
+
+	void GetProgress(long &rowCount, wxULongLong &byteCount);
+	long GetSkipped() const
+	{
+		return skipped;
+	}
+	bool WriteFailed() const
+	{
+		return writeFailed;
+	}
+
+private:
+	void Write(const char *data, size_t len);
+	void WriteRow(const char *data, size_t len);
+	void Flush();
+
+	pgConn *conn;
+	wxFile *file;
+	wxString header;
+	wxMBConv *fileConv;
+	bool unicode, crlf, passThrough, writeFailed;
+	long skipped;
+
+	wxMemoryBuffer buffer;
+
+	wxCriticalSection progressLock;
+	long rows;
+	wxULongLong bytes;
+};
+
 #endif
@@ -17,6 +17,99 @@
 #include "utils/factory.h"
 
 class frmMain;
+class wxFile;
+
+WX_DEFINE_ARRAY_PTR(wxMemoryBuffer *, importBlockArray);
+
+// Blocks of whole records on their way from the file to the COPY streams.
+// The queue is bounded, so the reader can't run ahead of the server
+class importQueue
+{
+public:
+	importQueue(size_t _maxBlocks);
+	~importQueue();
+
+	bool Push(wxMemoryBuffer *block);
+	wxMemoryBuffer *Pop();
+	void Close();
+	void Abort();
+	bool IsAborted();
+
+private:
+	wxMutex lock;
+	wxCondition changed;
+	importBlockArray blocks;
+	size_t maxBlocks;
+	bool closed, aborted;
+};
+
+
+enum
+{
+	IMPORT_TEXT = 0,
+	IMPORT_CSV,
+	IMPORT_BINARY
+};
+
+// Reads the file and cuts it into blocks on record boundaries; binary
+// files are passed on as they are
+class importReaderThread : public wxThread
+{
+public:
+	importReaderThread(wxFile *_file, importQueue *_queue, int _format, char _quote, char _escape, bool _skipHeader);
+	void *Entry();
+
+	wxFileOffset GetBytesRead();
+	bool ReadFailed() const
+	{
+		return readFailed;
+	}
+
+private:
+	size_t ScanRecords(const char *data, size_t start, size_t len, bool first);
+
+	wxFile *file;
+	importQueue *queue;
+	int format;
+	char quote, escape;
+	bool skipHeader, readFailed;
+
+	// Scanner state at the end of the data scanned so far
+	bool inQuotes, afterEscape;
+
+	wxCriticalSection progressLock;
+	wxFileOffset bytesRead;
+};
+
+
+// Sends the blocks it takes from the queue down one COPY ... FROM STDIN
+class importStreamThread : public wxThread
+{
+public:
+	importStreamThread(pgConn *_conn, importQueue *_queue);
+	void *Entry();
+
+	pgConn *GetConnection() const
+	{
+		return conn;
+	}
+	wxFileOffset GetBytesSent();
+	bool Failed() const
+	{
+		return failed;
+	}
+
+private:
+	pgConn *conn;
+	importQueue *queue;
+	bool failed;
+
+	wxCriticalSection progressLock;
+	wxFileOffset bytesSent;
+};
+
+WX_DEFINE_ARRAY_PTR(importStreamThread *, importStreamThreadArray);
+
 
 class frmImport : public pgDialog
 {
@@ -29,10 +122,14 @@ private:
 	void OnSelectFilename(wxCommandEvent &ev);
 	void OnChangeFormat(wxCommandEvent &ev);
 	void OnOK(wxCommandEvent &ev);
+	void OnCancel(wxCommandEvent &ev);
+
+	bool RunCopy(const wxString &query, wxFile *file);
+	void ShowProgress(importStreamThreadArray &streams, wxFileOffset bytesRead, wxFileOffset fileLength, wxLongLong elapsed);
 
 	pgConn *connection;
 	pgObject *object;
-	bool done;
+	bool done, importing, cancelled;
 
 	DECLARE_EVENT_TABLE()
 };
@@ -131,9 +131,11 @@ private:
 	wxBitmapComboBox *cbConnection;
 	wxTextCtrl *scratchPad;
 	wxComboBox *sqlQueries;
+	wxTextCtrl *sqlQueriesFilter;
 	wxButton *btnDeleteCurrent;
 	wxButton *btnDeleteAll;
-	wxArrayString histoQueries;
+	// The history serials of the queries in the combobox
+	wxArrayLong histoSerials;
 
 	ctlAuiNotebook *sqlQueryBook;  //container for all SQL tabs
 	size_t sqlQueryCounter;  //for initial tab names
@@ -186,6 +188,7 @@ private:
 	void OnExecScript(wxCommandEvent &event);
 	void OnExecFile(wxCommandEvent &event);
 	void OnExplain(wxCommandEvent &event);
+	void OnCompareExplain(wxCommandEvent &event);
 	void OnCommit(wxCommandEvent &event);
 	void OnRollback(wxCommandEvent &event);
 	void OnBuffers(wxCommandEvent &event);
@@ -247,6 +250,7 @@ private:
 	void updateMenu(bool allowUpdateModelSize = true);
 	void execQuery(const wxString &query, int resultToRetrieve = 0, bool singleResult = false, const int queryOffset = 0, bool toFile = false, bool explain = false, bool verbose = false);
 	void OnQueryComplete(pgQueryResultEvent &ev);
+	void OnQueryProgress(pgQueryResultEvent &ev);
 	void completeQuery(bool done, bool explain, bool verbose);
 	bool isBeginNotRequired(wxString query);
 	void OnScriptComplete(wxCommandEvent &ev);
@@ -259,8 +263,10 @@ private:
 	void OnMacroManage(wxCommandEvent &event);
 
 	void LoadQueries();
-	void SaveQueries();
+	void AppendQuery(size_t pos);
+	void AddQuery(const wxString &query);
 	void OnChangeQuery(wxCommandEvent &event);
+	void OnFilterQueries(wxCommandEvent &event);
 
 	wxBitmap CreateBitmap(const wxColour &colour);
 	wxColour GetServerColour(pgConn *connection);
@@ -339,6 +345,7 @@ enum
 	CTL_TIMERFRM,
 	CTL_NTBKGQB,
 	CTL_SQLQUERYCBOX,
+	CTL_SQLQUERYFILTER,
 	CTL_DELETECURRENTBTN,
 	CTL_DELETEALLBTN,
 	CTL_SCRATCHPAD
@@ -18,6 +18,7 @@
 #include <wx/listctrl.h>
 #include <wx/spinctrl.h>
 #include <wx/notebook.h>
+#include <wx/thread.h>
 
 // wxAUI
 #include <wx/aui/aui.h>
@@ -25,6 +26,10 @@
 #include "dlg/dlgClasses.h"
 #include "utils/factory.h"
 #include "ctl/ctlAuiNotebook.h"
+#include "ctl/ctlListView.h"
+
+class pgConn;
+class pgSet;
 
 enum
 {
@@ -82,11 +87,268 @@ enum
 #endif
 
 
-static wxCriticalSection gs_critsect;
+
+BEGIN_DECLARE_EVENT_TYPES()
+extern const wxEventType STATUS_REFRESH_EVENT;
+END_DECLARE_EVENT_TYPES()
+
+
+// Row states, compared to the previous refresh
+enum
+{
+	STATUSROW_SAME = 0,
+	STATUSROW_CHANGED,
+	STATUSROW_NEW
+};
+
+
+// Highlighting of the activity list
+enum
+{
+	STATUSHIGHLIGHT_ACTIVE = 0,
+	STATUSHIGHLIGHT_IDLE,
+	STATUSHIGHLIGHT_BLOCKED,
+	STATUSHIGHLIGHT_SLOW
+};
 
 
 // Class declarations
 
+// A row of the activity, locks or prepared transactions list
+class statusRow
+{
+public:
+	statusRow()
+	{
+		pid = 0;
+		sortNumber = 0;
+		highlight = STATUSHIGHLIGHT_ACTIVE;
+		state = STATUSROW_NEW;
+	}
+
+	// Identifies the row from one refresh to the next (the PID in
+	// the activity list)
+	wxString key;
+	wxArrayString cells;
+	long pid;
+	int highlight;
+	int state;
+
+	// The full query of the activity list
+	wxString query;
+
+	// Value of the sorted column, when it holds numbers
+	double sortNumber;
+};
+
+WX_DEFINE_ARRAY_PTR(statusRow *, statusRowArray);
+
+
+// The rows of one list, read by one refresh
+class statusSnapshot
+{
+public:
+	statusSnapshot(int _pane)
+	{
+		pane = _pane;
+		ok = true;
+		serial = 0;
+	}
+	~statusSnapshot()
+	{
+		WX_CLEAR_ARRAY(rows);
+	}
+
+	int pane;
+	bool ok;
+	statusRowArray rows;
+
+	// The logfile read which gave the rows of the log list
+	long serial;
+
+	// Keys of the rows gone since the previous refresh
+	wxArrayString removed;
+};
+
+
+// How a column of the lists is sorted
+enum
+{
+	STATUSCOL_TEXT = 0,
+	STATUSCOL_NUMBER
+};
+
+
+// A virtual list showing the rows of the last refresh, sorted on
+// the client
+class statusListView : public ctlListView
+{
+public:
+	statusListView(wxWindow *parent, int id);
+	~statusListView();
+
+	void AddNumberColumn(const wxString &text, int size);
+	void SetSnapshot(statusSnapshot *snap);
+	void Sort(int col, bool ascending);
+	void SetHighlight(bool highlight);
+
+	statusRow *GetRow(long item) const;
+
+	virtual wxString OnGetItemText(long item, long col) const;
+	virtual int OnGetItemImage(long item) const;
+	virtual wxListItemAttr *OnGetItemAttr(long item) const;
+
+private:
+	void SortRows();
+	void GetSelectedKeys(wxStringToStringHashMap &keys);
+	void SetSelectedKeys(const wxStringToStringHashMap &keys);
+
+	statusSnapshot *snapshot;
+
+	// The rows of the snapshot, in the displayed order
+	statusRowArray rows;
+
+	wxArrayInt colTypes;
+	int sortColumn;
+	bool sortAscending;
+
+	bool highlight;
+	wxListItemAttr attrs[4];
+};
+
+
+// A virtual list showing the last rows read from the server log. It keeps
+// a fixed number of rows, the oldest ones are dropped.
+class logListView : public ctlListView
+{
+public:
+	logListView(wxWindow *parent, int id, size_t _capacity);
+	~logListView();
+
+	void AppendRows(statusSnapshot *snap);
+	void AppendMessage(const wxString &msg);
+	void DeleteRows();
+
+	virtual wxString OnGetItemText(long item, long col) const;
+	virtual int OnGetItemImage(long item) const;
+
+private:
+	void Store(statusRow *row);
+	void Update();
+
+	// A ring of rows, the oldest one is at first
+	statusRowArray rows;
+	size_t capacity, first;
+};
+
+
+// Runs the queries of the activity, locks and prepared transactions lists
+// on its own connections, and posts the rows to the status window
+class statusRefreshThread : public wxThread
+{
+public:
+	statusRefreshThread(wxEvtHandler *_caller, pgConn *_conn, long _ownPid);
+	~statusRefreshThread();
+
+	void Refresh(int pane);
+	void SetLocksConnection(pgConn *_conn);
+	void Stop();
+
+	virtual void *Entry();
+
+private:
+	void BuildQueries();
+	statusSnapshot *ReadStatus();
+	statusSnapshot *ReadLocks();
+	statusSnapshot *ReadXacts();
+	void Compare(statusSnapshot *snap, wxStringToStringHashMap &previous);
+	bool IsOwnPid(long pid);
+
+	wxEvtHandler *caller;
+	pgConn *conn, *locksConn, *newLocksConn;
+	long ownPid;
+
+	wxMutex mutex;
+	wxCondition condition;
+	int pending;
+	bool stopping;
+
+	// The statements depend on the server version only
+	wxString statusSql, locksSql, xactSql;
+
+	// Contents of the rows sent last, by key
+	wxStringToStringHashMap statusRows, lockRows, xactRows;
+};
+
+
+
+// A logfile to read
+class statusLogRequest
+{
+public:
+	wxString filename;
+	bool skipFirst;
+	bool rotated;
+	long serial;
+};
+
+WX_DEFINE_ARRAY_PTR(statusLogRequest *, statusLogRequestArray);
+
+
+// Reads the server log on its own connection, in chunks which grow while
+// there is much to read, parses the lines and posts them to the status
+// window
+class statusLogThread : public wxThread
+{
+public:
+	statusLogThread(wxEvtHandler *_caller, pgConn *_conn, const wxString &_logFormat, bool _logFormatKnown, bool _logHasTimestamp, long _maxLogSize);
+	~statusLogThread();
+
+	long Open(const wxString &filename, bool _skipFirst, bool rotated);
+	void Poll();
+	void Stop();
+
+	virtual void *Entry();
+
+private:
+	bool Superseded();
+	void Read(long length);
+	void Parse(const char *data, size_t len);
+	void AddLine(const wxString &str, bool formatted = true);
+	void AddRecord(const wxArrayString &fields);
+	statusRow *AddRow(int col, const wxString &val);
+	void Post(bool ok = true);
+
+	wxEvtHandler *caller;
+	pgConn *conn;
+
+	wxString logFormat;
+	int logFmtPos;
+	bool logFormatKnown, logHasTimestamp;
+	int idxLevelCol, idxLogEntryCol;
+	long maxLogSize;
+
+	wxMutex mutex;
+	wxCondition condition;
+	statusLogRequestArray requests;
+	bool pollPending;
+	bool stopping;
+	long serial;
+
+	// The logfile being read, used by the thread only
+	wxString fileName;
+	long fileSerial;
+	bool csvFormat, skipFirst;
+	long readLength, chunkSize;
+
+	// Data of a line not complete yet
+	wxMemoryBuffer partialBytes;
+	wxString partialRecord;
+
+	statusSnapshot *batch;
+};
+
+
 class frmStatus : public pgFrame
 {
 public:
@@ -98,7 +360,10 @@ private:
 	wxAuiManager manager;
 
 	frmMain *mainForm;
-	pgConn *connection, *locks_connection;
+	pgConn *connection;
+	statusRefreshThread *refresher;
+	statusLogThread *logReader;
+	long logSerial;
 
 	wxString logFormat;
 	bool logHasTimestamp, logFormatKnown;
@@ -107,14 +372,9 @@ private:
 	wxDateTime logfileTimestamp, latestTimestamp;
 	wxString logDirectory, logfileName;
 
-	wxString savedPartialLine;
-
 	bool showCurrent, isCurrent;
 
-	long backend_pid;
-
 	bool loaded;
-	long logfileLength;
 
 	int currentPane;
 
@@ -134,18 +394,16 @@ private:
 	wxTimer *statusTimer, *locksTimer, *xactTimer, *logTimer;
 	int statusRate, locksRate, xactRate, logRate;
 
-	ctlListView   *statusList;
-	ctlListView   *lockList;
-	ctlListView   *xactList;
-	ctlListView   *logList;
+	statusListView *statusList;
+	statusListView *lockList;
+	statusListView *xactList;
+	logListView   *logList;
 
 	wxMenu        *actionMenu;
 	wxMenu        *statusPopupMenu;
 	wxMenu        *lockPopupMenu;
 	wxMenu        *xactPopupMenu;
 
-	wxArrayString queries;
-
 	int statusColWidth[12], lockColWidth[10], xactColWidth[5];
 
 	int cboToRate();
@@ -178,6 +436,7 @@ private:
 	void OnRefreshLocksTimer(wxTimerEvent &event);
 	void OnRefreshXactTimer(wxTimerEvent &event);
 	void OnRefreshLogTimer(wxTimerEvent &event);
+	void OnRefreshed(wxCommandEvent &event);
 
 	void SetColumnImage(ctlListView *list, int col, int image);
 	void OnSortStatusGrid(wxListEvent &event);
@@ -222,9 +481,7 @@ private:
 	int fillLogfileCombo();
 	void emptyLogfileCombo();
 
-	void addLogFile(wxDateTime *dt, bool skipFirst);
-	void addLogFile(const wxString &filename, const wxDateTime timestamp, long len, long &read, bool skipFirst);
-	void addLogLine(const wxString &str, bool formatted = true, bool csv_log_format = false);
+	void addLogFile(wxDateTime *dt, bool skipFirst, bool rotated = false);
 
 	void checkConnection();
 
@@ -55,6 +55,8 @@ enum
 	MNU_ASCSORT,
 	MNU_DESCSORT,
 	MNU_REMOVESORT,
+	MNU_BATCHSAVE,
+	MNU_PAGEROWS,
 	MNU_PASTE,
 	MNU_CLEAR,
 	MNU_FIND,
@@ -67,6 +69,7 @@ enum
 	MNU_EXPLAIN,
 	MNU_EXPLAINANALYZE,
 	MNU_EXPLAINOPTIONS,
+	MNU_EXPLAINDIFF,
 	MNU_DOCOMMIT,
 	MNU_DOROLLBACK,
 	MNU_VERBOSE,
@@ -143,6 +146,12 @@ enum
 	QUERY_COMPLETE = MNU_MACROS_MANAGE + 100,
 	PGSCRIPT_COMPLETE,
 
+	// Used by the object browser, while loading objects in the background
+	TREE_LOAD_COMPLETE,
+
+	// Used by the edit grid, when the next page of rows has been fetched
+	EDITGRID_PAGE_COMPLETE,
+
 	// This is a dummy menu item
 	MNU_DUMMY = QUERY_COMPLETE + 1000,
 
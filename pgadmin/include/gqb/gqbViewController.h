@@ -198,6 +198,8 @@ private:
 	gqbGridOrderTable *orderByLGridTable, *orderByRGridTable;   // Data model for order by grid internals
 	wxSize canvasSize, modelSize;
 	bool changeTOpressed;
+	wxRect damage;                // Area changed by dragging a table, still to be drawn again
+	wxBitmap paintBuffer;         // Reused by each paint, as large as the visible area
 
 	// just a point to the selected item on the collection, shouldn't be destroy inside this class
 	gqbQueryObject *collectionSelected, *joinSource, *joinDest, *cTempSelected;
@@ -213,6 +215,7 @@ private:
 	void OnMenuTableDelete(wxCommandEvent &event);
 	void OnMenuTableSetAlias(wxCommandEvent &event);
 	void OnRefresh(wxCommandEvent &ev);
+	wxRect getObjectArea(gqbQueryObject *queryTable);
 
 	wxArrayString joinTypeChoices;
 
@@ -33,6 +33,7 @@ public:
 	virtual void moveTo(int posIdx, int x, int y);
 	virtual bool containsPoint(int posIdx, int x, int y);
 	virtual void onFigureChanged(int posIdx, hdIFigure *figure);
+	virtual void setSpaceForMovement(wxSize space);
 
 protected:
 	virtual void basicDraw(wxBufferedDC &context, hdDrawingView *view);
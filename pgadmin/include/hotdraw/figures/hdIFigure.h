@@ -54,6 +54,8 @@ public:
 	virtual void setKindId(int objectId = -1);
 	virtual int getKindId();
 	virtual hdITool *CreateFigureTool(hdDrawingView *view, hdITool *defaultTool);
+	//Hack to allow limits for movements of figures not drawn because they are out of view
+	virtual void setSpaceForMovement(wxSize space);
 
 protected:
 	hdMultiPosRect basicDisplayBox;
@@ -14,6 +14,7 @@
 
 #include "hotdraw/figures/hdIFigure.h"
 #include "hotdraw/utilities/hdRect.h"
+#include "hotdraw/utilities/hdFigureIndex.h"
 
 
 // Main model of drawing
@@ -26,6 +27,9 @@ public:
 	virtual void remove(hdIFigure *figure);
 	virtual bool includes(hdIFigure *figure);
 	virtual hdIFigure *findFigure(int posIdx, int x, int y);
+	virtual void findFigures(int posIdx, const hdRect &rect, hdFigureArray &found);
+	virtual void updateFigure(int posIdx, hdIFigure *figure);
+	virtual void invalidateIndex();
 	virtual void recalculateDisplayBox(int posIdx);
 	virtual void bringToFront(hdIFigure *figure);
 	virtual void sendToBack(hdIFigure *figure);
@@ -81,5 +85,9 @@ private:
 	hdCollection *handles;
 	hdRect displayBox;
 	wxString drawingName;
+	//Figures by their display boxes at the diagram indexed, if any (-1)
+	void rebuildIndex(int posIdx);
+	hdFigureIndex figuresIndex;
+	int indexedPosIdx;
 };
 #endif
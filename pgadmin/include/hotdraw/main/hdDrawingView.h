@@ -86,6 +86,10 @@ public:
 		diagramIndex = newDiagramIndex;
 	};
 	void notifyChanged();
+	void notifyMoved(hdIFigure *figure);
+	virtual void Refresh(bool eraseBackground = true, const wxRect *rect = NULL);
+	//Area of a figure (and the lines connected to it) changed by a tool, to be drawn again
+	void addDamage(hdIFigure *figure);
 protected:
 	int diagramIndex;
 private:
@@ -99,6 +103,13 @@ private:
 	//Hack to allow auto scrolling when dragging mouse.
 	hdPoint startDrag;
 
+	//Refresh the damaged area only, or all the view if no tool reported it
+	void repairDamage();
+	hdRect damage;
+	bool hasDamage;
+	//Reused by each paint, as large as the visible area
+	wxBitmap paintBuffer;
+
 	//Hack to avoid selection rectangle drawing bug
 	hdRect selRect;
 	wxPoint selPoints[5];
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// hdFigureIndex.h - Uniform grid of the display boxes of the figures of a diagram
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef HDFIGUREINDEX_H
+#define HDFIGUREINDEX_H
+
+#include <wx/dynarray.h>
+#include <wx/hashmap.h>
+#include "hotdraw/utilities/hdRect.h"
+
+class hdIFigure;
+
+WX_DEFINE_ARRAY_PTR(hdIFigure *, hdFigureArray);
+
+class hdFigureIndexEntry
+{
+public:
+	hdRect box;		//display box as indexed, inflated by the margin
+	int order;		//position of the figure at the drawing, first is drawn first
+};
+
+WX_DECLARE_HASH_MAP(hdIFigure *, hdFigureIndexEntry, wxPointerHash, wxPointerEqual, hdFigureEntriesMap);
+WX_DECLARE_HASH_MAP(long, hdFigureArray, wxIntegerHash, wxIntegerEqual, hdFigureCellsMap);
+
+// Figures are looked up by the cells of the grid their display box covers,
+// instead of asking to all figures of the drawing
+class hdFigureIndex : public wxObject
+{
+public:
+	hdFigureIndex();
+	virtual ~hdFigureIndex();
+	void clear();
+	void addFigure(hdIFigure *figure, int posIdx, int order);
+	void updateFigure(hdIFigure *figure, int posIdx);
+	void setOrder(hdIFigure *figure, int order);
+	bool includes(hdIFigure *figure);
+	//Figures that can be at the rect, sorted by their order
+	void findFigures(const hdRect &rect, hdFigureArray &found);
+protected:
+
+private:
+	hdRect indexedBox(hdIFigure *figure, int posIdx);
+	void addToCells(hdIFigure *figure, const hdRect &box);
+	void removeFromCells(hdIFigure *figure, const hdRect &box);
+	void getCells(const hdRect &box, int &firstX, int &firstY, int &lastX, int &lastY);
+	hdFigureEntriesMap entries;
+	hdFigureCellsMap cells;
+};
+#endif
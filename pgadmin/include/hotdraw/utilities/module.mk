@@ -13,6 +13,7 @@ pgadmin3_SOURCES += \
 	include/hotdraw/utilities/hdArrayCollection.h \
 	include/hotdraw/utilities/hdCollection.h \
 	include/hotdraw/utilities/hdCollectionBase.h \
+	include/hotdraw/utilities/hdFigureIndex.h \
 	include/hotdraw/utilities/hdGeometry.h \
 	include/hotdraw/utilities/hdKeyEvent.h \
 	include/hotdraw/utilities/hdMultiPosRect.h \
@@ -28,6 +28,26 @@ private:
 
 	pgsThread *m_app;
 
+	/** Query split into text (even entries) and variables (odd entries). */
+	mutable wxArrayString m_parts;
+
+	/** How each variable is substituted (see pgsExecute.cpp). */
+	mutable wxArrayInt m_binds;
+
+	/** Whether the query has been split yet. */
+	mutable bool m_compiled;
+
+	/** Whether the query may go through the extended protocol. */
+	mutable bool m_extended;
+
+	/** Statement and parameter types of the last execution. */
+	mutable wxString m_last_key;
+
+	/** Name of the prepared statement for m_last_key (if prepared). */
+	mutable wxString m_stmt_name;
+
+	void compile() const;
+
 public:
 
 	pgsExecute(const wxString &query, pgsOutputStream *cout = 0,
@@ -23,6 +23,11 @@ class pgsString;
  * number otherwise it is a string. The difference between a string stored
  * in this object and a string stored in pgsString is that a string in pgsNumber
  * cannot be concatenated with another one in pgsPlus.
+ *
+ * Integers that fit in 64 bits are also kept as native values so that loop
+ * counters and comparisons do not go through MAPM. The string is then only
+ * built when value() is needed. Reals and overflowing integers keep using
+ * MAPM so that results stay exact.
  */
 class pgsNumber : public pgsVariable
 {
@@ -59,12 +64,23 @@ public:
 
 protected:
 
-	wxString m_data;
+	/** String form of the number, built lazily for native integers */
+	mutable wxString m_data;
+
+	/** Whether m_data is up to date */
+	mutable bool m_formatted;
+
+	/** Whether m_int holds the value of this integer */
+	bool m_native;
+
+	wxLongLong_t m_int;
 
 public:
 
 	explicit pgsNumber(const wxString &data, const bool &is_real = pgsInt);
 
+	explicit pgsNumber(const wxLongLong_t &data);
+
 	virtual ~pgsNumber();
 
 	virtual pgsVariable *clone() const;
@@ -85,6 +101,12 @@ public:
 
 	static pgsTypes num_type(const wxString &num);
 
+private:
+
+	bool native(const pgsVariable &rhs, wxLongLong_t &rhs_int) const;
+
+	static bool parse_int(const wxString &num, wxLongLong_t &res);
+
 public:
 
 	virtual pgsNumber number() const;
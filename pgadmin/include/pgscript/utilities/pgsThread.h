@@ -17,6 +17,7 @@
 #include <wx/thread.h>
 
 class pgConn;
+class pgQueryThread;
 class pgsApplication;
 class pgsStmtList;
 
@@ -49,6 +50,12 @@ private:
 	/** Location of the last error if there was one otherwise -1 */
 	int m_last_error_line;
 
+	/** Long-lived worker executing the queries, started on first use. */
+	pgQueryThread *m_executor;
+
+	/** Counter for naming the statements prepared by the scripts. */
+	static long ms_statements;
+
 public:
 
 	/** Parses a file with the provided encoding. */
@@ -69,6 +76,12 @@ public:
 	/** Retrieves the connection to the database. */
 	pgConn *connection();
 
+	/** Retrieves the worker executing the queries (0 if it cannot run). */
+	pgQueryThread *executor();
+
+	/** Generates a name for a new prepared statement. */
+	wxString statement_name();
+
 	/** Gets a lock on the output stream. */
 	void LockOutput();
 
@@ -87,6 +100,9 @@ private:
 
 	pgsThread &operator=(const pgsThread &that);
 
+	/** Deallocates the prepared statements and stops the worker. */
+	void stop_executor();
+
 };
 
 #endif /*PGSTHREAD_H_*/
@@ -21,6 +21,8 @@ public:
 	pgSequenceFactory();
 	virtual dlgProperty *CreateDialog(frmMain *frame, pgObject *node, pgObject *parent);
 	virtual pgObject *CreateObjects(pgCollection *obj, ctlTree *browser, const wxString &restr = wxEmptyString);
+	virtual wxString GetObjectsQuery(pgCollection *obj, const wxString &restr = wxEmptyString);
+	virtual pgObject *CreateObject(pgCollection *obj, pgSet *set);
 	virtual pgCollection *CreateCollection(pgObject *obj);
 	int GetReplicatedIconId()
 	{
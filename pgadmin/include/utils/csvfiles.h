@@ -50,4 +50,27 @@ protected:
 	const wxString m_string;        // the string we tokenize into lines
 	size_t   m_pos;                 // the current position in m_string
 };
+
+// Splits CSV data into records and their fields in a single pass,
+// instead of finding the lines first and tokenizing each of them again.
+class CSVRecordTokenizer : public wxObject
+{
+public:
+	CSVRecordTokenizer(const wxString &str): m_string(str), m_pos(0) { }
+
+	// Get the fields of the next record.  Returns false if there is
+	// no complete record left (no newline char at end), the incomplete
+	// record is then returned by GetRemainder().
+	bool GetNextRecord(wxArrayString &fields);
+
+	wxString GetRemainder() const
+	{
+		return m_string.Mid(m_pos);
+	}
+
+protected:
+
+	const wxString m_string;        // the string we tokenize into records
+	size_t   m_pos;                 // the start of the next record in m_string
+};
 #endif
@@ -29,6 +29,7 @@ class dlgProperty;
 class ctlTree;
 class pgCollection;
 class pgSchema;
+class pgSet;
 class pgaCollectionFactory;
 
 
@@ -40,6 +41,16 @@ public:
 	{
 		return 0;
 	}
+	// Factories, which can be loaded in the background, return the query
+	// listing their objects, and create an object from the current row
+	virtual wxString GetObjectsQuery(pgCollection *obj, const wxString &restr = wxEmptyString)
+	{
+		return wxEmptyString;
+	}
+	virtual pgObject *CreateObject(pgCollection *obj, pgSet *set)
+	{
+		return 0;
+	}
 	virtual pgCollection *CreateCollection(pgObject *obj) = 0;
 	virtual bool IsCollection()
 	{
@@ -115,6 +126,8 @@ public:
 		return itemFactory;
 	}
 	pgObject *CreateObjects(pgCollection  *obj, ctlTree *browser, const wxString &restr = wxEmptyString);
+	wxString GetObjectsQuery(pgCollection *obj, const wxString &restr = wxEmptyString);
+	pgObject *CreateObject(pgCollection *obj, pgSet *set);
 
 protected:
 	virtual bool IsCollection()
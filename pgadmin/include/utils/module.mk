@@ -17,6 +17,7 @@ pgadmin3_SOURCES += \
 	include/utils/pgfeatures.h \
 	include/utils/pgDefs.h \
 	include/utils/pgconfig.h \
+	include/utils/queryHistory.h \
 	include/utils/registry.h \
 	include/utils/sysLogger.h \
 	include/utils/sysProcess.h \
@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// queryHistory.h - The queries executed in the query tool
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef QUERYHISTORY_H
+#define QUERYHISTORY_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/ffile.h>
+#include <wx/dynarray.h>
+
+// A query of the history. Its text stays in the file, until it is needed.
+class queryHistoryEntry
+{
+public:
+	long serial, stamp;
+	wxString database;
+	unsigned long hash;
+
+	// Where the text is in the file, in bytes of UTF-8
+	long offset, length;
+
+	bool textLoaded;
+	wxString text;
+};
+
+WX_DEFINE_ARRAY_PTR(queryHistoryEntry *, queryHistoryEntryArray);
+
+
+// The history is kept in a file, which is only ever appended to: every
+// query executed, and every query deleted, adds a record. Opening it only
+// reads the headers of the records. The file is rewritten once most of it
+// is made of records no longer needed.
+// Several instances of pgAdmin can share the file: they write it holding
+// a lock file, and each rewrite starts it with a new generation, so the
+// others know their offsets are not valid any more.
+class queryHistory
+{
+public:
+	// The history in the file of the settings, shared by all query windows
+	static queryHistory *Get();
+
+	// Add an executed query, as the newest one; an older copy of it goes,
+	// and so do the oldest ones beyond the maximum of the settings
+	bool Add(const wxString &query, const wxString &database);
+	void Delete(long serial);
+	void Clear();
+
+	// The queries, the oldest first
+	size_t GetCount() const
+	{
+		return entries.GetCount();
+	}
+	long GetSerial(size_t pos) const
+	{
+		return entries.Item(pos)->serial;
+	}
+	// The position of the query, wxNOT_FOUND once it was deleted
+	int FindSerial(long serial) const;
+	wxString GetText(size_t pos);
+	// The start of the query, enough to list it; only that much is read
+	wxString GetLabel(size_t pos);
+
+	// The positions of the queries containing text, ignoring the case
+	void Search(const wxString &text, wxArrayInt &positions);
+
+	// Take over what other instances wrote to the file. The positions
+	// of the queries change; their serials stay, if they are still there.
+	// Returns false, if a record is still being written.
+	bool Sync();
+
+private:
+	queryHistory(const wxString &name);
+	~queryHistory();
+
+	void Load();
+	// Read the records from offset from, up to length bytes of the file;
+	// returns false, if they end broken
+	bool ReadRecords(long from, long length);
+	// Read the file again in full, when another instance rewrote it
+	void Reload();
+	// Read the queries of a history file written as XML; it is only
+	// written again as records when locked
+	bool ImportXml(bool locked);
+	// Write the file again, with just the queries there are
+	bool Compact();
+	bool Open();
+	bool AppendRecord(const wxString &header, const char *text, long length, long *offset);
+	// Read the bytes at offset, if the file is still the generation read
+	bool ReadText(long offset, char *buf, long length);
+	// Held while writing the file, by one instance at a time
+	bool Lock();
+	void Unlock();
+	// Delete the query at pos, with a record
+	void Drop(size_t pos);
+	void Remove(size_t pos);
+	// Delete the oldest queries beyond the maximum of the settings
+	void Trim();
+
+	static unsigned long Hash(const char *text, long length);
+	static wxString NewGeneration();
+
+	wxString fileName;
+	wxFFile file;
+	queryHistoryEntryArray entries;
+	long nextSerial, fileSize;
+	// Of the file as read, empty if it has no generation record yet
+	wxString generation;
+	// False while the file is still the XML of an older version, which
+	// could not be written again; records must not be appended to it
+	bool appendable;
+};
+
+#endif
@@ -29,7 +29,7 @@
 
 #include <wx/thread.h>
 #include <wx/arrstr.h>
-#include <wx/hashset.h>
+#include <wx/dynarray.h>
 #include "utils/misc.h"
 
 struct _LIBSSH2_CHANNEL;
@@ -37,6 +37,9 @@ struct _LIBSSH2_SESSION;
 struct _LIBSSH2_USERAUTH_KBDINT_PROMPT;
 struct _LIBSSH2_USERAUTH_KBDINT_RESPONSE;
 
+// Bytes a forwarded connection holds in each direction
+#define SSH_TUNNEL_BUFFER_SIZE 16384
+
 enum enAuthenticationMethod
 {
 	AUTH_NONE = 0,
@@ -48,8 +51,23 @@ enum enAuthenticationMethod
 void LogSSHTunnelErrors(const wxString &msg, const int &id, struct _LIBSSH2_SESSION *session = NULL);
 static wxMutex g_SSHThreadMutex;
 
-WX_DECLARE_HASH_SET( int, wxIntegerHash, wxIntegerEqual, subThreadSDSet);
-static subThreadSDSet g_setSocketDescriptor;
+// A connection forwarded through the tunnel, and what it still has to
+// pass on in either direction
+class CSSHTunnelChannel
+{
+public:
+	CSSHTunnelChannel(int sock, const struct sockaddr_in &sin);
+
+	int m_sock;
+	struct sockaddr_in m_sin;
+	struct _LIBSSH2_CHANNEL *m_channel;
+
+	char m_toServer[SSH_TUNNEL_BUFFER_SIZE], m_toClient[SSH_TUNNEL_BUFFER_SIZE];
+	long m_toServerLen, m_toServerOff, m_toClientLen, m_toClientOff;
+};
+
+WX_DEFINE_ARRAY_PTR(CSSHTunnelChannel *, CSSHTunnelChannelArray);
+WX_DEFINE_ARRAY_PTR(struct _LIBSSH2_CHANNEL *, CSSHTunnelClosingArray);
 
 class CSSHTunnelThread :
 	public wxThread
@@ -79,6 +97,27 @@ private:
 	                                 int num_prompts, const struct _LIBSSH2_USERAUTH_KBDINT_PROMPT *prompts, struct _LIBSSH2_USERAUTH_KBDINT_RESPONSE *res, void **abstract);
 	bool IsHostKeyVerified(const wxString &newHostKey);
 
+	// All the connections are served by the thread's loop, none of them
+	// may block the session
+	bool AcceptConnection();
+	// False, once the connection is done with
+	bool ForwardChannel(CSSHTunnelChannel *chan, bool readable, bool &progress);
+	void CloseChannel(CSSHTunnelChannel *chan);
+	// True, once the channel is closed and freed; else it is tried again
+	// with the next pass
+	bool FinishClose(struct _LIBSSH2_CHANNEL *channel);
+	// Close the connections, the session and the sockets
+	void Release();
+
+	CSSHTunnelChannelArray m_channels;
+	// Channels of connections done with, waiting for the server to close
+	CSSHTunnelClosingArray m_closing;
+	// The one channel being opened; libssh2 opens one at a time
+	CSSHTunnelChannel *m_opening;
+
+	wxMutex m_stopLock;
+	bool m_running, m_stop;
+
 	int m_listensock, m_sock;
 	struct sockaddr_in m_sin;
 	socklen_t m_sinlen;
@@ -98,22 +137,4 @@ private:
 	enAuthenticationMethod m_enAuthMethod;
 };
 
-class CSubThread :
-	public wxThread
-{
-public:
-	CSubThread(const struct sockaddr_in sin, const wxString remote_desthost, const unsigned int remote_destport,
-	           struct _LIBSSH2_SESSION *session, int forwardsock);
-	virtual ~CSubThread(void);
-	virtual void *Entry();
-
-private:
-	struct sockaddr_in m_sin;
-	wxString m_remote_desthost;
-	unsigned int m_remote_destport;
-	struct _LIBSSH2_SESSION *m_subThreadSession;
-	struct _LIBSSH2_CHANNEL *m_channel;
-	int m_forwardsock;
-};
-
 #endif
@@ -26,10 +26,15 @@ enum LOG_LEVEL
 	LOG_DEBUG = 4
 };
 
+class sysLogWriter;
+
 // Class declarations
 class sysLogger : public wxLog
 {
 public:
+	sysLogger();
+	~sysLogger();
+
 #if wxCHECK_VERSION(2, 9, 0)
 	void DoLogTextAtLevel(wxLogLevel level, const wxString &msg);
 #else
@@ -39,9 +44,15 @@ public:
 	static wxLogLevel logLevel;
 	static wxString logFile;
 
+	// Wait until the messages logged so far are in the logfile
+	void FlushLog();
+
 private:
-	void WriteLog(const wxString &msg);
+	void WriteLog(const wxString &msg, bool flush);
 	bool SilenceMessage(const wxString &msg);
+
+	// Writes the messages on a thread of its own
+	sysLogWriter *writer;
 };
 
 #define wxLOG_Notice (wxLOG_User+1)
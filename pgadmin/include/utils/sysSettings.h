@@ -703,6 +703,26 @@ public:
 	{
 		WriteLong(wxT("frmQuery/MaxRows"), newval);
 	}
+	bool GetStreamResults() const
+	{
+		bool b;
+		Read(wxT("frmQuery/StreamResults"), &b, true);
+		return b;
+	}
+	void SetStreamResults(const bool newval)
+	{
+		WriteBool(wxT("frmQuery/StreamResults"), newval);
+	}
+	long GetStreamMaxRows() const
+	{
+		long l;
+		Read(wxT("frmQuery/StreamMaxRows"), &l, 0L);
+		return l;
+	}
+	void SetStreamMaxRows(const long newval)
+	{
+		WriteLong(wxT("frmQuery/StreamMaxRows"), newval);
+	}
 	long GetMaxColSize() const
 	{
 		long l;
@@ -62,6 +62,8 @@
 #include "frm/frmSplash.h"
 #include "dlg/dlgSelectConnection.h"
 #include "db/pgConn.h"
+#include "db/pgCatalogCache.h"
+#include "db/pgCompletionIndex.h"
 #include "utils/sysLogger.h"
 #include "utils/registry.h"
 #include "frm/frmHint.h"
@@ -838,9 +840,16 @@ int pgAdmin3::OnExit()
 		delete updateThread;
 	}
 
+	pgCompletionIndex::ClearAll();
+	pgCatalogCache::ClearAll();
+
 	// Delete the settings object to ensure settings are saved.
 	delete settings;
 
+	// Get the queued log messages into the logfile
+	if (logger)
+		((sysLogger *)logger)->FlushLog();
+
 #ifdef __WXMSW__
 	WSACleanup();
 #endif
@@ -11,6 +11,7 @@
 #include "pgAdmin3.h"
 #include "pgscript/expressions/pgsExecute.h"
 
+#include <limits.h>
 #include <wx/regex.h>
 #include "db/pgConn.h"
 #include "db/pgQueryThread.h"
@@ -20,9 +21,57 @@
 #include "pgscript/utilities/pgsUtilities.h"
 #include "pgscript/utilities/pgsThread.h"
 
+// How a variable is put into the query
+enum
+{
+	PGS_BIND_TEXT = 0,  // Its value goes into the text of the query
+	PGS_BIND_QUOTED,    // '@var' becomes a parameter of unknown type, like the literal,
+	                    // where the server can tell its type (e.g. after an operator)
+	PGS_BIND_NUMBER     // @var becomes a parameter, when it holds a number
+};
+
+static bool is_var_char(wxChar c)
+{
+	return wxIsalnum(c) || c == wxT('_') || c == wxT('#') || c == wxT('@');
+}
+
+// May a value follow (or precede) this character, e.g. an operator?
+static bool is_value_start(wxChar c)
+{
+	return c != 0 && wxStrchr(wxT("(,=<>!+-*/%|["), c) != NULL;
+}
+
+// In a list (select list, VALUES, arguments) nothing gives a parameter its
+// type, which servers before 10 refuse
+static bool is_list_start(wxChar c)
+{
+	return c == wxT('(') || c == wxT(',');
+}
+
+static bool is_value_end(wxChar c)
+{
+	return c == 0 || wxStrchr(wxT(")],;=<>!+-*/%|:"), c) != NULL;
+}
+
+// Nearest character before (or from) pos, which is not a space
+static wxChar prev_char(const wxString &s, int pos)
+{
+	while (pos >= 0 && wxIsspace(s[pos]))
+		pos--;
+	return pos >= 0 ? (wxChar)s[pos] : 0;
+}
+
+static wxChar next_char(const wxString &s, size_t pos)
+{
+	while (pos < s.Length() && wxIsspace(s[pos]))
+		pos++;
+	return pos < s.Length() ? (wxChar)s[pos] : 0;
+}
+
 pgsExecute::pgsExecute(const wxString &query, pgsOutputStream *cout,
                        pgsThread *app) :
-	pgsExpression(), m_query(query), m_cout(cout), m_app(app)
+	pgsExpression(), m_query(query), m_cout(cout), m_app(app),
+	m_compiled(false), m_extended(false)
 {
 
 }
@@ -45,6 +94,9 @@ pgsExecute &pgsExecute::operator=(const pgsExecute &that)
 		m_query = that.m_query;
 		m_app = that.m_app;
 		m_query = that.m_query;
+		m_compiled = false;
+		m_last_key = wxEmptyString;
+		m_stmt_name = wxEmptyString;
 	}
 	return (*this);
 }
@@ -54,175 +106,319 @@ wxString pgsExecute::value() const
 	return m_query;
 }
 
+void pgsExecute::compile() const
+{
+	m_parts.Clear();
+	m_binds.Clear();
+
+	// Only single statements of these kinds can be sent with parameters,
+	// or prepared
+	wxString stmt = m_query.Strip(wxString::both);
+	size_t wordlen = 0;
+	while (wordlen < stmt.Length() && wxIsalpha(stmt[wordlen]))
+		wordlen++;
+	wxString keyword = stmt.Left(wordlen).Lower();
+	m_extended = keyword == wxT("select") || keyword == wxT("insert")
+	             || keyword == wxT("update") || keyword == wxT("delete")
+	             || keyword == wxT("values") || keyword == wxT("with");
+
+	// Variables are only bound where the quotes can be followed reliably:
+	// not with comments, dollar quoting, or E'', B'', U&'' strings
+	bool canBind = m_extended && m_query.Find(wxT("--")) == wxNOT_FOUND
+	               && m_query.Find(wxT("/*")) == wxNOT_FOUND
+	               && m_query.Find(wxT('$')) == wxNOT_FOUND;
+	for (size_t i = 1; canBind && i < m_query.Length(); i++)
+	{
+		if (m_query[i] == wxT('\'') && (is_var_char(m_query[i - 1]) || m_query[i - 1] == wxT('&')
+		                                 || m_query[i - 1] == wxT('\\')))
+			canBind = false;
+	}
+
+	wxString text;
+	bool inQuote = false;
+	size_t len = m_query.Length();
+	size_t i = 0;
+
+	while (i < len)
+	{
+		wxChar c = m_query[i];
+
+		// A backslash escapes @ and itself
+		if (c == wxT('\\') && i + 1 < len
+		        && (m_query[i + 1] == wxT('@') || m_query[i + 1] == wxT('\\')))
+		{
+			text += m_query[i + 1];
+			i += 2;
+			continue;
+		}
+
+		if (c == wxT('@') && i > 0 && m_query[i - 1] != wxT('\\')
+		        && i + 1 < len && is_var_char(m_query[i + 1]))
+		{
+			size_t end = i + 1;
+			while (end < len && is_var_char(m_query[end]))
+				end++;
+
+			int bind = PGS_BIND_TEXT;
+			if (canBind && inQuote)
+			{
+				// '@var' on its own, where a literal may stand; in a list
+				// it stays a literal
+				wxChar before = prev_char(text, (int)text.Length() - 2);
+				if (text.EndsWith(wxT("'")) && is_value_start(before) && !is_list_start(before)
+				        && end < len && m_query[end] == wxT('\'')
+				        && (end + 1 >= len || m_query[end + 1] != wxT('\''))
+				        && is_value_end(next_char(m_query, end + 1)))
+				{
+					bind = PGS_BIND_QUOTED;
+					text.RemoveLast();
+					end++;
+					inQuote = false;
+				}
+			}
+			else if (canBind)
+			{
+				if (is_value_start(prev_char(text, (int)text.Length() - 1))
+				        && is_value_end(next_char(m_query, end)))
+					bind = PGS_BIND_NUMBER;
+			}
+
+			m_parts.Add(text);
+			m_parts.Add(m_query.Mid(i, end - i));
+			m_binds.Add(bind);
+			text.Empty();
+			i = end;
+			continue;
+		}
+
+		if (c == wxT('\''))
+			inQuote = !inQuote;
+		text += c;
+		i++;
+	}
+	m_parts.Add(text);
+
+	m_compiled = true;
+}
+
 pgsOperand pgsExecute::eval(pgsVarMap &vars) const
 {
-	// Copy statement locally
-	wxString stmt(m_query);
+	if (!m_compiled)
+		compile();
 
-	// Build regular expressions
-	wxRegEx identifier(wxT("([^\\])(@[a-zA-Z0-9_#@]+)"));
-	wxRegEx escaped(wxT("\\\\(@|\\\\)")); // Backslash followed by @ or backslash
-	wxASSERT(identifier.IsValid() && escaped.IsValid());
+	wxMBConv *conv = &wxConvLibc;
+	if (m_app != 0 && m_app->connection() != 0)
+		conv = m_app->connection()->GetConv();
 
-	// Replace variables in statement
-	while (identifier.Matches(stmt))
+	// Put the variables in: 'stmt' is executed, 'shown' is reported
+	wxString stmt, shown, types;
+	pgParamsArray *params = 0;
+
+	for (size_t k = 0; k < m_parts.GetCount(); k++)
 	{
-		wxString var = identifier.GetMatch(stmt, 2);
-		wxString chr = identifier.GetMatch(stmt, 1);
-		if (vars.find(var) != vars.end())
+		if (k % 2 == 0)
 		{
-			wxString res = vars[var]->eval(vars)->value();
-			identifier.ReplaceFirst(&stmt, chr + pgsUtilities::escape_quotes(res));
+			stmt += m_parts[k];
+			shown += m_parts[k];
+			continue;
 		}
-		else
+
+		const wxString &var = m_parts[k];
+		int bind = m_binds[k / 2];
+		wxString quote = bind == PGS_BIND_QUOTED ? wxT("'") : wxT("");
+
+		if (vars.find(var) == vars.end())
+		{
+			stmt += quote + var + quote;
+			shown += quote + var + quote;
+			continue;
+		}
+
+		pgsOperand val = vars[var]->eval(vars);
+		wxString res = val->value();
+
+		wxString literal = res;
+		literal.Replace(wxT("'"), wxT("''"));
+		literal = quote + literal + quote;
+		shown += literal;
+
+		Oid type = 0;
+		bool asParam = bind == PGS_BIND_QUOTED;
+		if (bind == PGS_BIND_NUMBER && val->is_number())
+		{
+			// The same type as the literal would have
+			asParam = true;
+			type = PGOID_TYPE_NUMERIC;
+			wxLongLong_t num;
+			if (val->is_integer() && res.ToLongLong(&num))
+				type = (num >= INT_MIN && num <= INT_MAX) ? PGOID_TYPE_INT4 : PGOID_TYPE_INT8;
+		}
+
+		if (asParam)
 		{
-			identifier.ReplaceFirst(&stmt, chr + wxT("\\\\") + var);
+			if (params == 0)
+				params = new pgParamsArray();
+			params->Add(new pgParam(type, &res, conv));
+			stmt += wxString::Format(wxT("$%d"), (int)params->GetCount());
+			types += wxString::Format(wxT(" %ld"), (long)type);
 		}
+		else
+			stmt += literal;
 	}
-	escaped.ReplaceAll(&stmt, wxT("\\1"));
 
 	// Perform operations only if we have a valid connection
 	if (m_app != 0 && m_app->connection() != 0 && !m_app->TestDestroy())
 	{
-		pgQueryThread thread(m_app->connection(), stmt);
+		pgQueryThread *executor = m_app->executor();
+
+		if (executor == 0)
+		{
+			if (params != 0)
+			{
+				WX_CLEAR_ARRAY((*params));
+				delete params;
+			}
+			wxLogError(wxT("PGSCRIPT: Cannot create query thread for the query:\n%s"),
+			           m_query.c_str());
+			return pnew pgsRecord(1);
+		}
 
-		if (thread.Create() == wxTHREAD_NO_ERROR)
+		// The second time the same statement runs, it gets prepared
+		int idx;
+		wxString key = stmt + wxT("\n") + types;
+		if (m_extended && key == m_last_key)
 		{
-			if (thread.Run() == wxTHREAD_NO_ERROR)
+			if (m_stmt_name.IsEmpty())
+				m_stmt_name = m_app->statement_name();
+			idx = executor->AddPreparedQuery(m_stmt_name, stmt, params);
+		}
+		else
+		{
+			m_last_key = key;
+			m_stmt_name = wxEmptyString;
+			idx = executor->AddQuery(stmt, params);
+		}
+
+		while (!executor->WaitForQuery(idx, 100))
+		{
+			if (m_app->TestDestroy() || !executor->IsAlive()) // wxThread::TestDestroy()
+			{
+				executor->CancelExecution();
+				return pnew pgsRecord(1);
+			}
+		}
+
+		pgsRecord *rec = 0;
+
+		if (executor->ReturnCode(idx) != PGRES_COMMAND_OK
+		        && executor->ReturnCode(idx) != PGRES_TUPLES_OK)
+		{
+			if (m_cout != 0)
+			{
+				m_app->LockOutput();
+
+				(*m_cout) << PGSOUTWARNING;
+				wxString message(shown + wxT("\n") + executor
+				                 ->GetMessagesAndClear(idx).Strip(wxString::both));
+				wxRegEx multilf(wxT("(\n)+"));
+				multilf.ReplaceAll(&message, wxT("\n"));
+				message.Replace(wxT("\n"), wxT("\n")
+				                + generate_spaces(PGSOUTWARNING.Length()));
+				(*m_cout) << message << wxT("\n");
+
+				m_app->UnlockOutput();
+			}
+		}
+		else if (!m_app->TestDestroy())
+		{
+			if (m_cout != 0)
+			{
+				m_app->LockOutput();
+
+				(*m_cout) << PGSOUTQUERY;
+				wxString message(executor->GetMessagesAndClear(idx)
+				                 .Strip(wxString::both));
+				if (!message.IsEmpty())
+					message = shown + wxT("\n") + message;
+				else
+					message = shown;
+				wxRegEx multilf(wxT("(\n)+"));
+				multilf.ReplaceAll(&message, wxT("\n"));
+				message.Replace(wxT("\n"), wxT("\n")
+				                + generate_spaces(PGSOUTQUERY.Length()));
+				(*m_cout) << message << wxT("\n");
+
+				m_app->UnlockOutput();
+			}
+
+			if (executor->DataValid(idx))
 			{
-				while (true)
+				pgSet *set = executor->DataSet(idx);
+				set->MoveFirst();
+				rec = pnew pgsRecord(set->NumCols());
+				wxArrayLong columns_int; // List of columns that contain integers
+				wxArrayLong columns_real; // List of columns that contain reals
+				for (long i = 0; i < set->NumCols(); i++)
 				{
-					if (m_app->TestDestroy()) // wxThread::TestDestroy()
-					{
-						thread.Delete();
-						break;
-					}
-					else if (thread.IsRunning())
+					rec->set_column_name(i, set->ColName(i));
+					wxString col_type = set->ColType(i);
+					if (!col_type.CmpNoCase(wxT("bigint"))
+					        || !col_type.CmpNoCase(wxT("smallint"))
+					        || !col_type.CmpNoCase(wxT("integer")))
 					{
-						m_app->Yield();
-						m_app->Sleep(20);
+						columns_int.Add(i);
 					}
-					else
+					else if (!col_type.CmpNoCase(wxT("real"))
+					         || !col_type.CmpNoCase(wxT("double precision"))
+					         || !col_type.CmpNoCase(wxT("money"))
+					         || !col_type.CmpNoCase(wxT("numeric")))
 					{
-						thread.Wait();
-						break;
+						columns_real.Add(i);
 					}
 				}
-
-				if (thread.ReturnCode() != PGRES_COMMAND_OK
-				        && thread.ReturnCode() != PGRES_TUPLES_OK)
+				size_t line = 0;
+				while (!set->Eof())
 				{
-					if (m_cout != 0)
+					for (long i = 0; i < set->NumCols(); i++)
 					{
-						m_app->LockOutput();
-
-						(*m_cout) << PGSOUTWARNING;
-						wxString message(stmt + wxT("\n") + thread
-						                 .GetMessagesAndClear().Strip(wxString::both));
-						wxRegEx multilf(wxT("(\n)+"));
-						multilf.ReplaceAll(&message, wxT("\n"));
-						message.Replace(wxT("\n"), wxT("\n")
-						                + generate_spaces(PGSOUTWARNING.Length()));
-						(*m_cout) << message << wxT("\n");
-
-						m_app->UnlockOutput();
-					}
-				}
-				else if (!m_app->TestDestroy())
-				{
-					if (m_cout != 0)
-					{
-						m_app->LockOutput();
-
-						(*m_cout) << PGSOUTQUERY;
-						wxString message(thread.GetMessagesAndClear()
-						                 .Strip(wxString::both));
-						if (!message.IsEmpty())
-							message = stmt + wxT("\n") + message;
-						else
-							message = stmt;
-						wxRegEx multilf(wxT("(\n)+"));
-						multilf.ReplaceAll(&message, wxT("\n"));
-						message.Replace(wxT("\n"), wxT("\n")
-						                + generate_spaces(PGSOUTQUERY.Length()));
-						(*m_cout) << message << wxT("\n");
-
-						m_app->UnlockOutput();
-					}
+						wxString value = set->GetVal(i);
 
-					pgsRecord *rec = 0;
-
-					if (thread.DataValid())
-					{
-						pgSet *set = thread.DataSet();
-						set->MoveFirst();
-						rec = pnew pgsRecord(set->NumCols());
-						wxArrayLong columns_int; // List of columns that contain integers
-						wxArrayLong columns_real; // List of columns that contain reals
-						for (long i = 0; i < set->NumCols(); i++)
+						if (columns_int.Index(i) != wxNOT_FOUND
+						        && pgsNumber::num_type(value) == pgsNumber::pgsTInt)
 						{
-							rec->set_column_name(i, set->ColName(i));
-							wxString col_type = set->ColType(i);
-							if (!col_type.CmpNoCase(wxT("bigint"))
-							        || !col_type.CmpNoCase(wxT("smallint"))
-							        || !col_type.CmpNoCase(wxT("integer")))
-							{
-								columns_int.Add(i);
-							}
-							else if (!col_type.CmpNoCase(wxT("real"))
-							         || !col_type.CmpNoCase(wxT("double precision"))
-							         || !col_type.CmpNoCase(wxT("money"))
-							         || !col_type.CmpNoCase(wxT("numeric")))
-							{
-								columns_real.Add(i);
-							}
+							rec->insert(line, i, pnew pgsNumber(value, pgsInt));
 						}
-						size_t line = 0;
-						while (!set->Eof())
+						else if (columns_real.Index(i) != wxNOT_FOUND
+						         && pgsNumber::num_type(value) == pgsNumber::pgsTReal)
 						{
-							for (long i = 0; i < set->NumCols(); i++)
-							{
-								wxString value = set->GetVal(i);
-
-								if (columns_int.Index(i) != wxNOT_FOUND
-								        && pgsNumber::num_type(value) == pgsNumber::pgsTInt)
-								{
-									rec->insert(line, i, pnew pgsNumber(value, pgsInt));
-								}
-								else if (columns_real.Index(i) != wxNOT_FOUND
-								         && pgsNumber::num_type(value) == pgsNumber::pgsTReal)
-								{
-									rec->insert(line, i, pnew pgsNumber(value, pgsReal));
-								}
-								else
-								{
-									rec->insert(line, i, pnew pgsString(value));
-								}
-							}
-							set->MoveNext();
-							++line;
+							rec->insert(line, i, pnew pgsNumber(value, pgsReal));
+						}
+						else
+						{
+							rec->insert(line, i, pnew pgsString(value));
 						}
 					}
-					else
-					{
-						rec = pnew pgsRecord(1);
-						rec->insert(0, 0, pnew pgsNumber(wxT("1")));
-					}
-
-					return rec;
+					set->MoveNext();
+					++line;
 				}
 			}
 			else
 			{
-				wxLogError(wxT("PGSCRIPT: Cannot run query thread for the query:\n%s"),
-				           m_query.c_str());
+				rec = pnew pgsRecord(1);
+				rec->insert(0, 0, pnew pgsNumber(wxT("1")));
 			}
 		}
-		else
-		{
-			wxLogError(wxT("PGSCRIPT: Cannot create query thread for the query:\n%s"),
-			           m_query.c_str());
-		}
+
+		// The results are not needed anymore
+		executor->ClearQueries();
+
+		if (rec != 0)
+			return rec;
+	}
+	else if (params != 0)
+	{
+		WX_CLEAR_ARRAY((*params));
+		delete params;
 	}
 
 	// This must return a record whatever happens
@@ -11,26 +11,71 @@
 #include "pgAdmin3.h"
 #include "pgscript/objects/pgsNumber.h"
 
-#include <wx/regex.h>
 #include "pgscript/objects/pgsRecord.h"
 #include "pgscript/objects/pgsString.h"
 #include "pgscript/exceptions/pgsArithmeticException.h"
 #include "pgscript/exceptions/pgsCastException.h"
 
-#define PGS_INTEGER_FORM_1 wxT("^[+-]?[0-9]+$")
-#define PGS_REAL_FORM_1 wxT("^[+-]?[0-9]+[Ee][+-]?[0-9]+$")
-#define PGS_REAL_FORM_2 wxT("^[+-]?[0-9]*[.][0-9]+([Ee][+-]?[0-9]+)?$")
-#define PGS_REAL_FORM_3 wxT("^[+-]?[0-9]+[.][0-9]*([Ee][+-]?[0-9]+)?$")
+#define PGS_INT_MAX ((wxLongLong_t)(~(wxULongLong_t)0 >> 1))
+#define PGS_INT_MIN (-PGS_INT_MAX - 1)
+
+// Overflow-checked integer operations: they return false when the result
+// does not fit in 64 bits and MAPM must be used instead
+static bool pgs_int_plus(wxLongLong_t a, wxLongLong_t b, wxLongLong_t &res)
+{
+	if ((b > 0 && a > PGS_INT_MAX - b) || (b < 0 && a < PGS_INT_MIN - b))
+		return false;
+	res = a + b;
+	return true;
+}
+
+static bool pgs_int_minus(wxLongLong_t a, wxLongLong_t b, wxLongLong_t &res)
+{
+	if ((b < 0 && a > PGS_INT_MAX + b) || (b > 0 && a < PGS_INT_MIN + b))
+		return false;
+	res = a - b;
+	return true;
+}
+
+static bool pgs_int_times(wxLongLong_t a, wxLongLong_t b, wxLongLong_t &res)
+{
+	if (a > 0)
+	{
+		if (b > 0 ? a > PGS_INT_MAX / b : b < PGS_INT_MIN / a)
+			return false;
+	}
+	else
+	{
+		if (b > 0 ? a < PGS_INT_MIN / b : (a != 0 && b < PGS_INT_MAX / a))
+			return false;
+	}
+	res = a * b;
+	return true;
+}
 
 pgsNumber::pgsNumber(const wxString &data, const bool &is_real) :
 	pgsVariable(!is_real ? pgsVariable::pgsTInt : pgsVariable::pgsTReal),
-	m_data(data.Strip(wxString::both))
+	m_data(data.Strip(wxString::both)), m_formatted(true), m_native(false),
+	m_int(0)
 {
+	if (!is_real)
+		m_native = parse_int(m_data, m_int);
+
 	wxASSERT(is_valid());
 }
 
+pgsNumber::pgsNumber(const wxLongLong_t &data) :
+	pgsVariable(pgsVariable::pgsTInt), m_formatted(false), m_native(true),
+	m_int(data)
+{
+
+}
+
 bool pgsNumber::is_valid() const
 {
+	if (m_native)
+		return true;
+
 	pgsTypes type = num_type(m_data);
 	return (type == pgsTInt) || (type == pgsTReal && is_real());
 }
@@ -41,7 +86,8 @@ pgsNumber::~pgsNumber()
 }
 
 pgsNumber::pgsNumber(const pgsNumber &that) :
-	pgsVariable(that), m_data(that.m_data)
+	pgsVariable(that), m_data(that.m_data), m_formatted(that.m_formatted),
+	m_native(that.m_native), m_int(that.m_int)
 {
 	wxASSERT(is_valid());
 }
@@ -52,6 +98,9 @@ pgsNumber &pgsNumber::operator =(const pgsNumber &that)
 	{
 		pgsVariable::operator=(that);
 		m_data = that.m_data;
+		m_formatted = that.m_formatted;
+		m_native = that.m_native;
+		m_int = that.m_int;
 	}
 
 	wxASSERT(is_valid());
@@ -66,6 +115,12 @@ pgsVariable *pgsNumber::clone() const
 
 wxString pgsNumber::value() const
 {
+	if (!m_formatted)
+	{
+		m_data.Printf(wxT("%") wxLongLongFmtSpec wxT("d"), m_int);
+		m_formatted = true;
+	}
+
 	return m_data;
 }
 
@@ -76,191 +131,337 @@ pgsOperand pgsNumber::eval(pgsVarMap &vars) const
 
 pgsVariable::pgsTypes pgsNumber::num_type(const wxString &num)
 {
-	if (wxRegEx(PGS_INTEGER_FORM_1).Matches(num))
+	// Same as ^[+-]?[0-9]+$ for integers and ^[+-]?[0-9]+[Ee][+-]?[0-9]+$,
+	// ^[+-]?[0-9]*[.][0-9]+([Ee][+-]?[0-9]+)?$ or
+	// ^[+-]?[0-9]+[.][0-9]*([Ee][+-]?[0-9]+)?$ for reals
+	size_t i = 0, len = num.Length();
+	size_t int_digits = 0, frac_digits = 0;
+	bool dot = false, exponent = false;
+
+	if (i < len && (num[i] == wxT('+') || num[i] == wxT('-')))
+		i++;
+	while (i < len && num[i] >= wxT('0') && num[i] <= wxT('9'))
 	{
-		return pgsTInt;
+		i++;
+		int_digits++;
 	}
-	else if (( wxRegEx(PGS_REAL_FORM_1).Matches(num)
-	           || wxRegEx(PGS_REAL_FORM_2).Matches(num)
-	           || wxRegEx(PGS_REAL_FORM_3).Matches(num)))
+	if (i < len && num[i] == wxT('.'))
 	{
-		return pgsTReal;
+		dot = true;
+		i++;
+		while (i < len && num[i] >= wxT('0') && num[i] <= wxT('9'))
+		{
+			i++;
+			frac_digits++;
+		}
 	}
-	else
+	if (int_digits + frac_digits == 0)
+		return pgsTString;
+
+	if (i < len && (num[i] == wxT('E') || num[i] == wxT('e')))
 	{
+		size_t exp_digits = 0;
+		exponent = true;
+		i++;
+		if (i < len && (num[i] == wxT('+') || num[i] == wxT('-')))
+			i++;
+		while (i < len && num[i] >= wxT('0') && num[i] <= wxT('9'))
+		{
+			i++;
+			exp_digits++;
+		}
+		if (exp_digits == 0 || (!dot && int_digits == 0))
+			return pgsTString;
+	}
+
+	if (i != len)
 		return pgsTString;
+	else if (!dot && !exponent)
+		return pgsTInt;
+	else
+		return pgsTReal;
+}
+
+bool pgsNumber::parse_int(const wxString &num, wxLongLong_t &res)
+{
+	size_t i = 0, len = num.Length();
+	bool negative = false;
+
+	if (i < len && (num[i] == wxT('+') || num[i] == wxT('-')))
+	{
+		negative = (num[i] == wxT('-'));
+		i++;
+	}
+	if (i == len)
+		return false;
+
+	// Accumulate as a negative number so that the minimum value fits
+	wxLongLong_t val = 0;
+	for (; i < len; i++)
+	{
+		if (num[i] < wxT('0') || num[i] > wxT('9'))
+			return false;
+		int digit = num[i] - wxT('0');
+		if (val < (PGS_INT_MIN + digit) / 10)
+			return false;
+		val = val * 10 - digit;
+	}
+
+	if (!negative)
+	{
+		if (val == PGS_INT_MIN)
+			return false;
+		val = -val;
 	}
+
+	res = val;
+	return true;
+}
+
+bool pgsNumber::native(const pgsVariable &rhs, wxLongLong_t &rhs_int) const
+{
+	if (!m_native)
+		return false;
+
+	const pgsNumber *n = dynamic_cast<const pgsNumber *>(&rhs);
+	if (n == 0 || !n->m_native)
+		return false;
+
+	rhs_int = n->m_int;
+	return true;
 }
 
 pgsOperand pgsNumber::pgs_plus(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int, res;
+	if (native(rhs, rhs_int) && pgs_int_plus(m_int, rhs_int, res))
+	{
+		return pnew pgsNumber(res);
+	}
+	else if (rhs.is_number())
 	{
-		return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(m_data)
+		return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(value())
 		                      + num(rhs.value())), is_real() || rhs.is_real());
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_minus(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int, res;
+	if (native(rhs, rhs_int) && pgs_int_minus(m_int, rhs_int, res))
+	{
+		return pnew pgsNumber(res);
+	}
+	else if (rhs.is_number())
 	{
-		return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(m_data)
+		return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(value())
 		                      - num(rhs.value())), is_real() || rhs.is_real());
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_times(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int, res;
+	if (native(rhs, rhs_int) && pgs_int_times(m_int, rhs_int, res))
+	{
+		return pnew pgsNumber(res);
+	}
+	else if (rhs.is_number())
 	{
-		return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(m_data)
+		return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(value())
 		                      * num(rhs.value())), is_real() || rhs.is_real());
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_over(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int) && rhs_int != 0
+	        && !(m_int == PGS_INT_MIN && rhs_int == -1))
+	{
+		// Truncates toward zero like MAPM div
+		return pnew pgsNumber(wxLongLong_t(m_int / rhs_int));
+	}
+	else if (rhs.is_number())
 	{
 		if (num(rhs.value()) != 0)
 		{
 			if (is_real() || rhs.is_real())
-				return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(m_data)
+				return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(value())
 				                      / num(rhs.value())), is_real() || rhs.is_real());
 			else
-				return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(m_data)
+				return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(value())
 				                      .div(num(rhs.value()))), is_real() || rhs.is_real());
 		}
 		else
 		{
-			throw pgsArithmeticException(m_data, rhs.value());
+			throw pgsArithmeticException(value(), rhs.value());
 		}
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_modulo(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int) && rhs_int != 0)
+	{
+		// The remainder has the sign of the dividend like MAPM div_rem
+		return pnew pgsNumber(wxLongLong_t(rhs_int == -1 ? 0 : m_int % rhs_int));
+	}
+	else if (rhs.is_number())
 	{
 		if (num(rhs.value()) != 0)
 		{
-			return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(m_data)
+			return pnew pgsNumber(pgsMapm::pgs_mapm_str(num(value())
 			                      % num(rhs.value())), is_real() || rhs.is_real());
 		}
 		else
 		{
-			throw pgsArithmeticException(m_data, rhs.value());
+			throw pgsArithmeticException(value(), rhs.value());
 		}
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_equal(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int))
 	{
-		return pnew pgsNumber(num(m_data) == num(rhs.value())
+		return pnew pgsNumber(wxLongLong_t(m_int == rhs_int ? 1 : 0));
+	}
+	else if (rhs.is_number())
+	{
+		return pnew pgsNumber(num(value()) == num(rhs.value())
 		                      ? wxT("1") : wxT("0"));
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_different(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int))
 	{
-		return pnew pgsNumber(num(m_data) != num(rhs.value())
+		return pnew pgsNumber(wxLongLong_t(m_int != rhs_int ? 1 : 0));
+	}
+	else if (rhs.is_number())
+	{
+		return pnew pgsNumber(num(value()) != num(rhs.value())
 		                      ? wxT("1") : wxT("0"));
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_greater(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int))
+	{
+		return pnew pgsNumber(wxLongLong_t(m_int > rhs_int ? 1 : 0));
+	}
+	else if (rhs.is_number())
 	{
-		return pnew pgsNumber(num(m_data) > num(rhs.value())
+		return pnew pgsNumber(num(value()) > num(rhs.value())
 		                      ? wxT("1") : wxT("0"));
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_lower(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int))
+	{
+		return pnew pgsNumber(wxLongLong_t(m_int < rhs_int ? 1 : 0));
+	}
+	else if (rhs.is_number())
 	{
-		return pnew pgsNumber(num(m_data) < num(rhs.value())
+		return pnew pgsNumber(num(value()) < num(rhs.value())
 		                      ? wxT("1") : wxT("0"));
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_lower_equal(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int))
 	{
-		return pnew pgsNumber(num(m_data) <= num(rhs.value())
+		return pnew pgsNumber(wxLongLong_t(m_int <= rhs_int ? 1 : 0));
+	}
+	else if (rhs.is_number())
+	{
+		return pnew pgsNumber(num(value()) <= num(rhs.value())
 		                      ? wxT("1") : wxT("0"));
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_greater_equal(const pgsVariable &rhs) const
 {
-	if (rhs.is_number())
+	wxLongLong_t rhs_int;
+	if (native(rhs, rhs_int))
+	{
+		return pnew pgsNumber(wxLongLong_t(m_int >= rhs_int ? 1 : 0));
+	}
+	else if (rhs.is_number())
 	{
-		return pnew pgsNumber(num(m_data) >= num(rhs.value())
+		return pnew pgsNumber(num(value()) >= num(rhs.value())
 		                      ? wxT("1") : wxT("0"));
 	}
 	else
 	{
-		throw pgsArithmeticException(m_data, rhs.value());
+		throw pgsArithmeticException(value(), rhs.value());
 	}
 }
 
 pgsOperand pgsNumber::pgs_not() const
 {
-	return pnew pgsNumber(num(m_data) == 0 ? wxT("1") : wxT("0"));
+	if (m_native)
+		return pnew pgsNumber(wxLongLong_t(m_int == 0 ? 1 : 0));
+	return pnew pgsNumber(num(value()) == 0 ? wxT("1") : wxT("0"));
 }
 
 bool pgsNumber::pgs_is_true() const
 {
-	return (num(m_data) != 0 ? true : false);
+	if (m_native)
+		return m_int != 0;
+	return (num(value()) != 0 ? true : false);
 }
 
 pgsOperand pgsNumber::pgs_almost_equal(const pgsVariable &rhs) const
@@ -282,5 +483,5 @@ pgsRecord pgsNumber::record() const
 
 pgsString pgsNumber::string() const
 {
-	return pgsString(m_data);
+	return pgsString(value());
 }
@@ -11,17 +11,23 @@
 #include "pgAdmin3.h"
 #include "pgscript/utilities/pgsThread.h"
 
+#include "db/pgConn.h"
+#include "db/pgQueryThread.h"
+
 #include "pgscript/pgsApplication.h"
 #include "pgscript/statements/pgsProgram.h"
 #include "pgscript/utilities/pgsContext.h"
 #include "pgscript/utilities/pgsDriver.h"
 
+long pgsThread::ms_statements = 0;
+static wxCriticalSection s_statementsLock;
+
 pgsThread::pgsThread(pgsVarMap &vars, wxSemaphore &mutex,
                      pgConn *connection, const wxString &file, pgsOutputStream &out,
                      pgsApplication &app, wxMBConv *conv) :
 	wxThread(wxTHREAD_DETACHED), m_vars(vars), m_mutex(mutex),
 	m_connection(connection), m_data(file), m_out(out),
-	m_app(app), m_conv(conv), m_last_error_line(-1)
+	m_app(app), m_conv(conv), m_last_error_line(-1), m_executor(0)
 {
 	wxLogScript(wxT("Starting thread"));
 	m_mutex.Wait();
@@ -32,7 +38,7 @@ pgsThread::pgsThread(pgsVarMap &vars, wxSemaphore &mutex,
                      pgsApplication &app) :
 	wxThread(wxTHREAD_DETACHED), m_vars(vars), m_mutex(mutex),
 	m_connection(connection), m_data(string), m_out(out),
-	m_app(app), m_conv(0), m_last_error_line(-1)
+	m_app(app), m_conv(0), m_last_error_line(-1), m_executor(0)
 {
 	wxLogScript(wxT("Starting thread"));
 	m_mutex.Wait();
@@ -65,6 +71,8 @@ void *pgsThread::Entry()
 		wxLogScript(wxT("String  parsed"));
 	}
 
+	stop_executor();
+
 	return 0;
 }
 
@@ -73,6 +81,55 @@ pgConn *pgsThread::connection()
 	return m_connection;
 }
 
+pgQueryThread *pgsThread::executor()
+{
+	if (m_executor == 0 && m_connection != 0)
+	{
+		m_executor = new pgQueryThread(m_connection);
+		if (m_executor->Create() != wxTHREAD_NO_ERROR
+		        || m_executor->Run() != wxTHREAD_NO_ERROR)
+		{
+			delete m_executor;
+			m_executor = 0;
+		}
+	}
+	return m_executor;
+}
+
+wxString pgsThread::statement_name()
+{
+	// Unique in the process, so in each session too: statements left behind
+	// by an earlier script (see stop_executor) keep their names
+	wxCriticalSectionLocker lock(s_statementsLock);
+	return wxString::Format(wxT("pgscript_%ld"), ++ms_statements);
+}
+
+void pgsThread::stop_executor()
+{
+	if (m_executor == 0)
+		return;
+
+	// Leave no statements behind in the session; only outside of a
+	// transaction, which a failing DEALLOCATE could abort
+	const wxArrayString &prepared = m_executor->GetPreparedStatements();
+	if (!TestDestroy() && m_executor->IsAlive() && !prepared.IsEmpty()
+	        && m_connection->GetTxStatus() == PGCONN_TXSTATUS_IDLE)
+	{
+		wxString deallocate;
+		for (size_t i = 0; i < prepared.GetCount(); i++)
+			deallocate += wxT("DEALLOCATE ") + prepared.Item(i) + wxT(";");
+
+		int idx = m_executor->AddQuery(deallocate);
+		while (!m_executor->WaitForQuery(idx, 100) && m_executor->IsAlive())
+			;
+	}
+
+	m_executor->CancelExecution();
+	m_executor->Wait();
+	delete m_executor;
+	m_executor = 0;
+}
+
 void pgsThread::LockOutput()
 {
 	m_app.LockOutput();
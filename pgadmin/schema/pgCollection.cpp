@@ -135,11 +135,14 @@ void pgCollection::ShowTreeDetail(ctlTree *browser, frmMain *form, ctlListView *
 {
 	if (browser->GetChildrenCount(GetId(), false) == 0)
 	{
-		if (GetFactory())
+		// Load the objects in the background, if the factory supports it
+		if (GetFactory() && !browser->LoadObjects(this))
 			GetFactory()->CreateObjects(this, browser);
 	}
 
-	UpdateChildCount(browser);
+	// While loading, the count is kept up to date by the browser
+	if (!browser->IsLoading(GetId()))
+		UpdateChildCount(browser);
 	if (properties)
 	{
 		ShowList(browser, properties);
@@ -277,10 +277,8 @@ wxString pgSequenceCollection::GetTranslatedMessage(int kindOfMessage) const
 ///////////////////////////////////////////////////////////////////////////////
 
 
-pgObject *pgSequenceFactory::CreateObjects(pgCollection *collection, ctlTree *browser, const wxString &restriction)
+wxString pgSequenceFactory::GetObjectsQuery(pgCollection *collection, const wxString &restriction)
 {
-	pgSet *sequences;
-	pgSequence *sequence = 0;
 	wxString sql;
 
 	sql = wxT("SELECT cl.oid, relname, pg_get_userbyid(relowner) AS seqowner, relacl, description");
@@ -295,25 +293,42 @@ pgObject *pgSequenceFactory::CreateObjects(pgCollection *collection, ctlTree *br
 	       + restriction + wxT("\n")
 	       wxT(" ORDER BY relname");
 
-	sequences = collection->GetDatabase()->ExecuteSet(sql);
+	return sql;
+}
+
+
+pgObject *pgSequenceFactory::CreateObject(pgCollection *collection, pgSet *set)
+{
+	pgSequence *sequence = new pgSequence(collection->GetSchema(),
+	                                      set->GetVal(wxT("relname")));
+
+	sequence->iSetOid(set->GetOid(wxT("oid")));
+	sequence->iSetComment(set->GetVal(wxT("description")));
+	sequence->iSetOwner(set->GetVal(wxT("seqowner")));
+	sequence->iSetAcl(set->GetVal(wxT("relacl")));
+
+	if (collection->GetDatabase()->BackendMinimumVersion(9, 1))
+	{
+		sequence->iSetProviders(set->GetVal(wxT("providers")));
+		sequence->iSetLabels(set->GetVal(wxT("labels")));
+	}
+
+	return sequence;
+}
+
+
+pgObject *pgSequenceFactory::CreateObjects(pgCollection *collection, ctlTree *browser, const wxString &restriction)
+{
+	pgSet *sequences;
+	pgSequence *sequence = 0;
+
+	sequences = collection->GetDatabase()->ExecuteSet(GetObjectsQuery(collection, restriction));
 
 	if (sequences)
 	{
 		while (!sequences->Eof())
 		{
-			sequence = new pgSequence(collection->GetSchema(),
-			                          sequences->GetVal(wxT("relname")));
-
-			sequence->iSetOid(sequences->GetOid(wxT("oid")));
-			sequence->iSetComment(sequences->GetVal(wxT("description")));
-			sequence->iSetOwner(sequences->GetVal(wxT("seqowner")));
-			sequence->iSetAcl(sequences->GetVal(wxT("relacl")));
-
-			if (collection->GetDatabase()->BackendMinimumVersion(9, 1))
-			{
-				sequence->iSetProviders(sequences->GetVal(wxT("providers")));
-				sequence->iSetLabels(sequences->GetVal(wxT("labels")));
-			}
+			sequence = (pgSequence *)CreateObject(collection, sequences);
 
 			if (browser)
 			{
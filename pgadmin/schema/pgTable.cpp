@@ -1416,23 +1416,10 @@ void pgTable::ShowStatistics(frmMain *form, ctlListView *statistics)
 }
 
 
-pgObject *pgTableFactory::CreateObjects(pgCollection *collection, ctlTree *browser, const wxString &restriction)
+wxString pgTableFactory::GetObjectsQuery(pgCollection *collection, const wxString &restriction)
 {
 	wxString query;
-	pgTable *table = 0;
-
-	// Greenplum returns reltuples and relpages as tuples per segmentDB and pages per segmentDB,
-	// so we need to multiply them by the number of segmentDBs to get reasonable values.
-	long gp_segments = 1;
-	if (collection->GetConnection()->GetIsGreenplum())
-	{
-		query = wxT("SELECT count(*) AS gp_segments from pg_catalog.gp_configuration where definedprimary = 't' and content >= 0");
-		gp_segments = StrToLong(collection->GetDatabase()->ExecuteScalar(query));
-		if (gp_segments <= 1)
-			gp_segments = 1;
-	}
 
-	pgSet *tables;
 	if (collection->GetConnection()->BackendMinimumVersion(8, 0))
 	{
 		if (collection->GetConnection()->BackendMinimumVersion(12, 0)) {
@@ -1469,6 +1456,7 @@ pgObject *pgTableFactory::CreateObjects(pgCollection *collection, ctlTree *brows
 			query += wxT(", substring(array_to_string(rel.reloptions, ',') FROM 'fillfactor=([0-9]*)') AS fillfactor \n");
 		if (collection->GetConnection()->GetIsGreenplum())
 		{
+			query += wxT(", (SELECT count(*) FROM pg_catalog.gp_configuration WHERE definedprimary = 't' AND content >= 0) AS gp_segments \n");
 			query += wxT(", gpd.localoid, gpd.attrnums \n");
 			query += wxT(", substring(array_to_string(rel.reloptions, ',') from 'appendonly=([a-z]*)') AS appendonly \n");
 			query += wxT(", substring(array_to_string(rel.reloptions, ',') from 'compresslevel=([0-9]*)') AS compresslevel \n");
@@ -1554,133 +1542,162 @@ pgObject *pgTableFactory::CreateObjects(pgCollection *collection, ctlTree *brows
 		        + restriction +
 		        wxT(" ORDER BY rel.relname");
 	}
-	tables = collection->GetDatabase()->ExecuteSet(query);
-	if (tables)
+
+	return query;
+}
+
+
+pgObject *pgTableFactory::CreateObject(pgCollection *collection, pgSet *set)
+{
+	pgTable *table;
+
+	// Greenplum returns reltuples and relpages as tuples per segmentDB and pages per segmentDB,
+	// so we need to multiply them by the number of segmentDBs to get reasonable values.
+	long gp_segments = 1;
+	if (collection->GetConnection()->GetIsGreenplum())
 	{
-		while (!tables->Eof())
-		{
-			table = new pgTable(collection->GetSchema(), tables->GetVal(wxT("relname")));
+		gp_segments = set->GetLong(wxT("gp_segments"));
+		if (gp_segments <= 1)
+			gp_segments = 1;
+	}
 
-			table->iSetOid(tables->GetOid(wxT("oid")));
-			table->iSetOwner(tables->GetVal(wxT("relowner")));
-			table->iSetAcl(tables->GetVal(wxT("relacl")));
-			if (collection->GetConnection()->BackendMinimumVersion(8, 0))
-			{
-				if (tables->GetOid(wxT("spcoid")) == 0)
-					table->iSetTablespaceOid(collection->GetDatabase()->GetTablespaceOid());
-				else
-					table->iSetTablespaceOid(tables->GetOid(wxT("spcoid")));
+	table = new pgTable(collection->GetSchema(), set->GetVal(wxT("relname")));
 
-				if (tables->GetVal(wxT("spcname")) == wxEmptyString)
-					table->iSetTablespace(collection->GetDatabase()->GetTablespace());
-				else
-					table->iSetTablespace(tables->GetVal(wxT("spcname")));
-			}
-			if (collection->GetConnection()->BackendMinimumVersion(9, 0))
-			{
-				table->iSetOfTypeOid(tables->GetOid(wxT("reloftype")));
-				table->iSetOfType(tables->GetVal(wxT("typname")));
-			}
-			else
-			{
-				table->iSetOfTypeOid(0);
-				table->iSetOfType(wxT(""));
-			}
-			table->iSetComment(tables->GetVal(wxT("description")));
-			if (collection->GetConnection()->BackendMinimumVersion(9, 1))
-				table->iSetUnlogged(tables->GetVal(wxT("relpersistence")) == wxT("u"));
+	table->iSetOid(set->GetOid(wxT("oid")));
+	table->iSetOwner(set->GetVal(wxT("relowner")));
+	table->iSetAcl(set->GetVal(wxT("relacl")));
+	if (collection->GetConnection()->BackendMinimumVersion(8, 0))
+	{
+		if (set->GetOid(wxT("spcoid")) == 0)
+			table->iSetTablespaceOid(collection->GetDatabase()->GetTablespaceOid());
+		else
+			table->iSetTablespaceOid(set->GetOid(wxT("spcoid")));
+
+		if (set->GetVal(wxT("spcname")) == wxEmptyString)
+			table->iSetTablespace(collection->GetDatabase()->GetTablespace());
+		else
+			table->iSetTablespace(set->GetVal(wxT("spcname")));
+	}
+	if (collection->GetConnection()->BackendMinimumVersion(9, 0))
+	{
+		table->iSetOfTypeOid(set->GetOid(wxT("reloftype")));
+		table->iSetOfType(set->GetVal(wxT("typname")));
+	}
+	else
+	{
+		table->iSetOfTypeOid(0);
+		table->iSetOfType(wxT(""));
+	}
+	table->iSetComment(set->GetVal(wxT("description")));
+	if (collection->GetConnection()->BackendMinimumVersion(9, 1))
+		table->iSetUnlogged(set->GetVal(wxT("relpersistence")) == wxT("u"));
+	else
+		table->iSetUnlogged(false);
+	if (collection->GetConnection()->BackendMinimumVersion(12, 0)); else
+	table->iSetHasOids(set->GetBool(wxT("relhasoids")));
+	table->iSetEstimatedRows(set->GetDouble(wxT("reltuples")) * gp_segments);
+	if (collection->GetConnection()->BackendMinimumVersion(8, 2))
+	{
+		table->iSetFillFactor(set->GetVal(wxT("fillfactor")));
+	}
+	if (collection->GetConnection()->BackendMinimumVersion(8, 4))
+	{
+		table->iSetRelOptions(set->GetVal(wxT("reloptions")));
+		if (table->GetCustomAutoVacuumEnabled())
+		{
+			if (set->GetVal(wxT("autovacuum_enabled")).IsEmpty())
+				table->iSetAutoVacuumEnabled(2);
+			else if (set->GetBool(wxT("autovacuum_enabled")))
+				table->iSetAutoVacuumEnabled(1);
 			else
-				table->iSetUnlogged(false);
-			if (collection->GetConnection()->BackendMinimumVersion(12, 0)); else
-			table->iSetHasOids(tables->GetBool(wxT("relhasoids")));
-			table->iSetEstimatedRows(tables->GetDouble(wxT("reltuples")) * gp_segments);
-			if (collection->GetConnection()->BackendMinimumVersion(8, 2))
+				table->iSetAutoVacuumEnabled(0);
+			table->iSetAutoVacuumVacuumThreshold(set->GetVal(wxT("autovacuum_vacuum_threshold")));
+			table->iSetAutoVacuumVacuumScaleFactor(set->GetVal(wxT("autovacuum_vacuum_scale_factor")));
+			table->iSetAutoVacuumAnalyzeThreshold(set->GetVal(wxT("autovacuum_analyze_threshold")));
+			table->iSetAutoVacuumAnalyzeScaleFactor(set->GetVal(wxT("autovacuum_analyze_scale_factor")));
+			table->iSetAutoVacuumVacuumCostDelay(set->GetVal(wxT("autovacuum_vacuum_cost_delay")));
+			table->iSetAutoVacuumVacuumCostLimit(set->GetVal(wxT("autovacuum_vacuum_cost_limit")));
+			table->iSetAutoVacuumFreezeMinAge(set->GetVal(wxT("autovacuum_freeze_min_age")));
+			table->iSetAutoVacuumFreezeMaxAge(set->GetVal(wxT("autovacuum_freeze_max_age")));
+			table->iSetAutoVacuumFreezeTableAge(set->GetVal(wxT("autovacuum_freeze_table_age")));
+		}
+		table->iSetHasToastTable(set->GetBool(wxT("hastoasttable")));
+		if (table->GetHasToastTable())
+		{
+			table->iSetToastRelOptions(set->GetVal(wxT("toast_reloptions")));
+
+			if (table->GetToastCustomAutoVacuumEnabled())
 			{
-				table->iSetFillFactor(tables->GetVal(wxT("fillfactor")));
+				if (set->GetVal(wxT("toast_autovacuum_enabled")).IsEmpty())
+					table->iSetToastAutoVacuumEnabled(2);
+				else if (set->GetBool(wxT("toast_autovacuum_enabled")))
+					table->iSetToastAutoVacuumEnabled(1);
+				else
+					table->iSetToastAutoVacuumEnabled(0);
+
+				table->iSetToastAutoVacuumVacuumThreshold(set->GetVal(wxT("toast_autovacuum_vacuum_threshold")));
+				table->iSetToastAutoVacuumVacuumScaleFactor(set->GetVal(wxT("toast_autovacuum_vacuum_scale_factor")));
+				table->iSetToastAutoVacuumVacuumCostDelay(set->GetVal(wxT("toast_autovacuum_vacuum_cost_delay")));
+				table->iSetToastAutoVacuumVacuumCostLimit(set->GetVal(wxT("toast_autovacuum_vacuum_cost_limit")));
+				table->iSetToastAutoVacuumFreezeMinAge(set->GetVal(wxT("toast_autovacuum_freeze_min_age")));
+				table->iSetToastAutoVacuumFreezeMaxAge(set->GetVal(wxT("toast_autovacuum_freeze_max_age")));
+				table->iSetToastAutoVacuumFreezeTableAge(set->GetVal(wxT("toast_autovacuum_freeze_table_age")));
 			}
-			if (collection->GetConnection()->BackendMinimumVersion(8, 4))
-			{
-				table->iSetRelOptions(tables->GetVal(wxT("reloptions")));
-				if (table->GetCustomAutoVacuumEnabled())
-				{
-					if (tables->GetVal(wxT("autovacuum_enabled")).IsEmpty())
-						table->iSetAutoVacuumEnabled(2);
-					else if (tables->GetBool(wxT("autovacuum_enabled")))
-						table->iSetAutoVacuumEnabled(1);
-					else
-						table->iSetAutoVacuumEnabled(0);
-					table->iSetAutoVacuumVacuumThreshold(tables->GetVal(wxT("autovacuum_vacuum_threshold")));
-					table->iSetAutoVacuumVacuumScaleFactor(tables->GetVal(wxT("autovacuum_vacuum_scale_factor")));
-					table->iSetAutoVacuumAnalyzeThreshold(tables->GetVal(wxT("autovacuum_analyze_threshold")));
-					table->iSetAutoVacuumAnalyzeScaleFactor(tables->GetVal(wxT("autovacuum_analyze_scale_factor")));
-					table->iSetAutoVacuumVacuumCostDelay(tables->GetVal(wxT("autovacuum_vacuum_cost_delay")));
-					table->iSetAutoVacuumVacuumCostLimit(tables->GetVal(wxT("autovacuum_vacuum_cost_limit")));
-					table->iSetAutoVacuumFreezeMinAge(tables->GetVal(wxT("autovacuum_freeze_min_age")));
-					table->iSetAutoVacuumFreezeMaxAge(tables->GetVal(wxT("autovacuum_freeze_max_age")));
-					table->iSetAutoVacuumFreezeTableAge(tables->GetVal(wxT("autovacuum_freeze_table_age")));
-				}
-				table->iSetHasToastTable(tables->GetBool(wxT("hastoasttable")));
-				if (table->GetHasToastTable())
-				{
-					table->iSetToastRelOptions(tables->GetVal(wxT("toast_reloptions")));
+		}
+	}
+	table->iSetHasSubclass(set->GetBool(wxT("relhassubclass")));
+	table->iSetPrimaryKeyName(set->GetVal(wxT("conname")));
+	table->iSetIsReplicated(set->GetBool(wxT("isrepl")));
+	table->iSetTriggerCount(set->GetLong(wxT("triggercount")));
+	wxString cn = set->GetVal(wxT("conkey"));
+	cn = cn.Mid(1, cn.Length() - 2);
+	table->iSetPrimaryKeyColNumbers(cn);
 
-					if (table->GetToastCustomAutoVacuumEnabled())
-					{
-						if (tables->GetVal(wxT("toast_autovacuum_enabled")).IsEmpty())
-							table->iSetToastAutoVacuumEnabled(2);
-						else if (tables->GetBool(wxT("toast_autovacuum_enabled")))
-							table->iSetToastAutoVacuumEnabled(1);
-						else
-							table->iSetToastAutoVacuumEnabled(0);
-
-						table->iSetToastAutoVacuumVacuumThreshold(tables->GetVal(wxT("toast_autovacuum_vacuum_threshold")));
-						table->iSetToastAutoVacuumVacuumScaleFactor(tables->GetVal(wxT("toast_autovacuum_vacuum_scale_factor")));
-						table->iSetToastAutoVacuumVacuumCostDelay(tables->GetVal(wxT("toast_autovacuum_vacuum_cost_delay")));
-						table->iSetToastAutoVacuumVacuumCostLimit(tables->GetVal(wxT("toast_autovacuum_vacuum_cost_limit")));
-						table->iSetToastAutoVacuumFreezeMinAge(tables->GetVal(wxT("toast_autovacuum_freeze_min_age")));
-						table->iSetToastAutoVacuumFreezeMaxAge(tables->GetVal(wxT("toast_autovacuum_freeze_max_age")));
-						table->iSetToastAutoVacuumFreezeTableAge(tables->GetVal(wxT("toast_autovacuum_freeze_table_age")));
-					}
-				}
-			}
-			table->iSetHasSubclass(tables->GetBool(wxT("relhassubclass")));
-			table->iSetPrimaryKeyName(tables->GetVal(wxT("conname")));
-			table->iSetIsReplicated(tables->GetBool(wxT("isrepl")));
-			table->iSetTriggerCount(tables->GetLong(wxT("triggercount")));
-			wxString cn = tables->GetVal(wxT("conkey"));
-			cn = cn.Mid(1, cn.Length() - 2);
-			table->iSetPrimaryKeyColNumbers(cn);
-
-			if (collection->GetConnection()->GetIsGreenplum())
-			{
-				Oid lo = tables->GetOid(wxT("localoid"));
-				wxString db = tables->GetVal(wxT("attrnums"));
-				db = db.Mid(1, db.Length() - 2);
-				table->iSetDistributionColNumbers(db);
-				if (lo > 0 && db.Length() == 0)
-					table->iSetDistributionIsRandom();
-				table->iSetAppendOnly(tables->GetVal(wxT("appendonly")));
-				table->iSetCompressLevel(tables->GetVal(wxT("compresslevel")));
-				table->iSetOrientation(tables->GetVal(wxT("orientation")));
-				table->iSetCompressType(tables->GetVal(wxT("compresstype")));
-				table->iSetBlocksize(tables->GetVal(wxT("blocksize")));
-				table->iSetChecksum(tables->GetVal(wxT("checksum")));
-
-				table->iSetPartitionDef(wxT(""));
-				table->iSetIsPartitioned(false);
-
-				if (collection->GetConnection()->BackendMinimumVersion(8, 2, 9))
-				{
-					table->iSetIsPartitioned(tables->GetBool(wxT("ispartitioned")));
-				}
+	if (collection->GetConnection()->GetIsGreenplum())
+	{
+		Oid lo = set->GetOid(wxT("localoid"));
+		wxString db = set->GetVal(wxT("attrnums"));
+		db = db.Mid(1, db.Length() - 2);
+		table->iSetDistributionColNumbers(db);
+		if (lo > 0 && db.Length() == 0)
+			table->iSetDistributionIsRandom();
+		table->iSetAppendOnly(set->GetVal(wxT("appendonly")));
+		table->iSetCompressLevel(set->GetVal(wxT("compresslevel")));
+		table->iSetOrientation(set->GetVal(wxT("orientation")));
+		table->iSetCompressType(set->GetVal(wxT("compresstype")));
+		table->iSetBlocksize(set->GetVal(wxT("blocksize")));
+		table->iSetChecksum(set->GetVal(wxT("checksum")));
+
+		table->iSetPartitionDef(wxT(""));
+		table->iSetIsPartitioned(false);
+
+		if (collection->GetConnection()->BackendMinimumVersion(8, 2, 9))
+		{
+			table->iSetIsPartitioned(set->GetBool(wxT("ispartitioned")));
+		}
 
-			}
+	}
 
-			if (collection->GetConnection()->BackendMinimumVersion(9, 1))
-			{
-				table->iSetProviders(tables->GetVal(wxT("providers")));
-				table->iSetLabels(tables->GetVal(wxT("labels")));
-			}
+	if (collection->GetConnection()->BackendMinimumVersion(9, 1))
+	{
+		table->iSetProviders(set->GetVal(wxT("providers")));
+		table->iSetLabels(set->GetVal(wxT("labels")));
+	}
+
+	return table;
+}
+
+
+pgObject *pgTableFactory::CreateObjects(pgCollection *collection, ctlTree *browser, const wxString &restriction)
+{
+	pgTable *table = 0;
+
+	pgSet *tables = collection->GetDatabase()->ExecuteSet(GetObjectsQuery(collection, restriction));
+	if (tables)
+	{
+		while (!tables->Eof())
+		{
+			table = (pgTable *)CreateObject(collection, tables);
 
 			if (browser)
 			{
@@ -27,6 +27,7 @@ TMP_ui += \
 	ui/dlgDirectDbg.xrc \
 	ui/dlgDomain.xrc \
 	ui/dlgEventTrigger.xrc \
+	ui/dlgExplainDiff.xrc \
 	ui/dlgExtension.xrc \
 	ui/dlgEditGridOptions.xrc \
 	ui/dlgExtTable.xrc \
@@ -140,3 +140,56 @@ wxString CSVLineTokenizer::GetNextLine(bool &partial)
 
 	return token;
 }
+
+bool CSVRecordTokenizer::GetNextRecord(wxArrayString &fields)
+{
+	const wxChar *data = m_string.wx_str();
+	size_t len = m_string.length();
+	size_t pos = m_pos;
+
+	wxString field;
+	bool inquote = false;
+
+	fields.Empty();
+
+	for (; pos < len; pos++)
+	{
+		wxChar c = data[pos];
+
+		if (inquote)
+		{
+			if (c == wxT('\"'))
+			{
+				// A double doublequote is a doublequote in the field
+				if (pos + 1 < len && data[pos + 1] == wxT('\"'))
+				{
+					field += c;
+					pos++;
+				}
+				else
+					inquote = false;
+			}
+			else
+				field += c;
+		}
+		else if (c == wxT('\"'))
+			inquote = true;
+		else if (c == wxT(','))
+		{
+			fields.Add(field);
+			field.Empty();
+		}
+		else if (c == wxT('\n'))
+		{
+			fields.Add(field);
+			m_pos = pos + 1;
+			return true;
+		}
+		else if (c != wxT('\r'))
+			field += c;
+	}
+
+	// No newline char after the record, some must still be coming
+	fields.Empty();
+	return false;
+}
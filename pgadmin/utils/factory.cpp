@@ -215,6 +215,22 @@ pgObject *pgaCollectionFactory::CreateObjects(pgCollection  *obj, ctlTree *brows
 }
 
 
+wxString pgaCollectionFactory::GetObjectsQuery(pgCollection *obj, const wxString &restr)
+{
+	if (itemFactory)
+		return itemFactory->GetObjectsQuery(obj, restr);
+	return wxEmptyString;
+}
+
+
+pgObject *pgaCollectionFactory::CreateObject(pgCollection *obj, pgSet *set)
+{
+	if (itemFactory)
+		return itemFactory->CreateObject(obj, set);
+	return 0;
+}
+
+
 dlgProperty *pgaCollectionFactory::CreateDialog(frmMain *frame, pgObject *node, pgObject *parent)
 {
 	if (itemFactory)
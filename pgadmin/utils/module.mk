@@ -15,6 +15,7 @@ pgadmin3_SOURCES += \
 	utils/favourites.cpp \
 	utils/misc.cpp \
 	utils/pgconfig.cpp \
+	utils/queryHistory.cpp \
 	utils/registry.cpp \
 	utils/sysLogger.cpp \
 	utils/sysProcess.cpp \
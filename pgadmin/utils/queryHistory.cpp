@@ -0,0 +1,691 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// queryHistory.cpp - The queries executed in the query tool
+//
+//////////////////////////////////////////////////////////////////////////
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+
+#include "pgAdmin3.h"
+#include "utils/queryHistory.h"
+#include "utils/sysSettings.h"
+
+#include <libxml/parser.h>
+
+#define WXSTRING_FROM_XML(s) wxString((char *)s, wxConvUTF8)
+
+// The file is not rewritten while it is smaller than this
+#define HISTORY_COMPACT_SIZE  (64 * 1024)
+
+// Bytes of a query read for its label
+#define HISTORY_LABEL_SIZE    256
+
+// How long to wait for another instance writing the file, and when its
+// lock is left over from a crash (in seconds)
+#define HISTORY_LOCK_WAIT     2
+#define HISTORY_LOCK_STALE    30
+
+// Records of the file:
+//   H <generation>\n                               the first one, new with each rewrite
+//   Q <time> <hash> <bytes> <database>\n<query>\n   a query executed
+//   D <offset>\n                                   the query at offset deleted
+
+WX_DECLARE_HASH_MAP(long, queryHistoryEntry *, wxIntegerHash, wxIntegerEqual, queryHistoryOffsetMap);
+WX_DECLARE_HASH_MAP(unsigned long, queryHistoryEntry *, wxIntegerHash, wxIntegerEqual, queryHistoryHashMap);
+
+static queryHistory *history = NULL;
+
+
+queryHistory *queryHistory::Get()
+{
+	wxString name = settings->GetHistoryFile();
+
+	// The file may have been changed in the options; the serials go on,
+	// the query windows still know the ones of the other file
+	long serial = 0;
+	if (history && history->fileName != name)
+	{
+		serial = history->nextSerial;
+		delete history;
+		history = NULL;
+	}
+
+	if (!history)
+	{
+		history = new queryHistory(name);
+		history->nextSerial = serial;
+		history->Load();
+	}
+	return history;
+}
+
+
+queryHistory::queryHistory(const wxString &name)
+	: fileName(name)
+{
+	nextSerial = 0;
+	fileSize = 0;
+	appendable = true;
+}
+
+
+queryHistory::~queryHistory()
+{
+	WX_CLEAR_ARRAY(entries);
+}
+
+
+void queryHistory::Load()
+{
+	if (!wxFile::Exists(fileName) || !Open())
+		return;
+
+	// Nothing is written without the lock; if another instance holds it
+	// too long, the file is only read
+	bool locked = Lock();
+
+	// Older versions wrote the history as XML
+	char start[5];
+	file.Seek(0);
+	if (file.Read(start, sizeof(start)) == sizeof(start) && !strncmp(start, "<?xml", sizeof(start)))
+	{
+		file.Close();
+		appendable = false;
+		if (!ImportXml(locked))
+		{
+			wxMessageBox(_("Failed to load the history file!"));
+			if (locked)
+				::wxRemoveFile(fileName);
+		}
+		if (locked)
+			Unlock();
+		return;
+	}
+
+	bool complete = ReadRecords(0, (long)file.Length());
+
+	if (locked)
+	{
+		// Loading the file drops the same ones again
+		Trim();
+
+		// Records appended after a broken one, e.g. cut short by a crash,
+		// could not be found again
+		if (!complete)
+			Compact();
+		Unlock();
+	}
+}
+
+
+bool queryHistory::ReadRecords(long from, long length)
+{
+	// The queries deleted by the new records can be older ones
+	queryHistoryOffsetMap offsets;
+	size_t i;
+	for (i = 0; i < entries.GetCount(); i++)
+		offsets[entries.Item(i)->offset] = entries.Item(i);
+
+	bool complete = true;
+	char header[1024];
+	long recordStart = from;
+
+	file.Seek(from);
+	while (fgets(header, sizeof(header), file.fp()))
+	{
+		long stamp, offset, bytes;
+		unsigned long hash;
+		int database = 0;
+		char gen[64];
+
+		if (sscanf(header, "Q %ld %lx %ld %n", &stamp, &hash, &bytes, &database) >= 3 && database > 0)
+		{
+			// Skip the text, it is read with its first use
+			offset = ftell(file.fp());
+			if (bytes < 0 || offset + bytes + 1 > length || fseek(file.fp(), bytes + 1, SEEK_CUR))
+			{
+				complete = false;
+				break;
+			}
+
+			queryHistoryEntry *entry = new queryHistoryEntry();
+			entry->serial = nextSerial++;
+			entry->stamp = stamp;
+			entry->hash = hash;
+			entry->offset = offset;
+			entry->length = bytes;
+			entry->textLoaded = false;
+			entry->database = wxString(header + database, wxConvUTF8).Trim();
+
+			entries.Add(entry);
+			offsets[offset] = entry;
+		}
+		else if (sscanf(header, "D %ld", &offset) == 1)
+		{
+			queryHistoryOffsetMap::iterator it = offsets.find(offset);
+			if (it != offsets.end())
+			{
+				int pos = entries.Index(it->second);
+				if (pos != wxNOT_FOUND)
+					Remove(pos);
+				offsets.erase(it);
+			}
+		}
+		else if (!recordStart && sscanf(header, "H %63s", gen) == 1)
+			generation = wxString(gen, wxConvUTF8);
+		else
+		{
+			complete = false;
+			break;
+		}
+
+		// A record still being written by another instance is read next time
+		if (header[strlen(header) - 1] != '\n')
+		{
+			complete = false;
+			break;
+		}
+		recordStart = fileSize = (long)ftell(file.fp());
+	}
+
+	return complete && fileSize == length;
+}
+
+
+void queryHistory::Reload()
+{
+	// The queries still there keep their serials, as long as they ascend
+	queryHistoryEntryArray old = entries;
+	queryHistoryHashMap byHash;
+	size_t i;
+	for (i = 0; i < old.GetCount(); i++)
+		byHash[old.Item(i)->hash] = old.Item(i);
+
+	entries.Clear();
+	file.Close();
+	generation = wxEmptyString;
+	fileSize = 0;
+	if (Open())
+		ReadRecords(0, (long)file.Length());
+
+	long last = -1;
+	for (i = 0; i < entries.GetCount(); i++)
+	{
+		queryHistoryEntry *entry = entries.Item(i);
+		queryHistoryHashMap::iterator it = byHash.find(entry->hash);
+		queryHistoryEntry *match = it == byHash.end() ? NULL : it->second;
+
+		if (match && match->serial > last && match->length == entry->length &&
+		        match->stamp == entry->stamp && match->database == entry->database)
+		{
+			entry->serial = match->serial;
+			entry->textLoaded = match->textLoaded;
+			entry->text = match->text;
+		}
+		else
+			entry->serial = nextSerial++;
+		last = entry->serial;
+	}
+
+	WX_CLEAR_ARRAY(old);
+}
+
+
+bool queryHistory::Sync()
+{
+	if (!appendable)
+		return true;
+
+	// The generation and size of the file, as it is now
+	wxString gen;
+	long size = 0;
+	{
+		wxLogNull noLog;
+		wxFFile current;
+		if (wxFile::Exists(fileName) && current.Open(fileName, wxT("rb")))
+		{
+			char header[80], name[64];
+			if (fgets(header, sizeof(header), current.fp()) && sscanf(header, "H %63s", name) == 1)
+				gen = wxString(name, wxConvUTF8);
+			size = (long)current.Length();
+		}
+	}
+
+	// Written again by another instance: the offsets are not valid any more
+	if (gen != generation || size < fileSize)
+	{
+		Reload();
+		return true;
+	}
+
+	// Records appended by other instances
+	if (size > fileSize && Open())
+		return ReadRecords(fileSize, size);
+
+	return true;
+}
+
+
+bool queryHistory::Lock()
+{
+	wxString lockName = fileName + wxT(".lock");
+	wxLogNull noLog;
+
+	wxLongLong waitUntil = wxGetLocalTimeMillis() + HISTORY_LOCK_WAIT * 1000;
+	while (true)
+	{
+		wxFile lock;
+		if (lock.Create(lockName, false))
+			return true;
+
+		if (wxFile::Exists(lockName) && wxFileModificationTime(lockName) < time(NULL) - HISTORY_LOCK_STALE)
+			::wxRemoveFile(lockName);
+		else if (wxGetLocalTimeMillis() > waitUntil)
+			return false;
+		else
+			wxMilliSleep(10);
+	}
+}
+
+
+void queryHistory::Unlock()
+{
+	::wxRemoveFile(fileName + wxT(".lock"));
+}
+
+
+bool queryHistory::ImportXml(bool locked)
+{
+	xmlDocPtr doc = xmlParseFile((const char *)fileName.mb_str(wxConvUTF8));
+	if (doc == NULL)
+		return false;
+
+	xmlNodePtr cur = xmlDocGetRootElement(doc);
+	if (cur == NULL)
+	{
+		xmlFreeDoc(doc);
+		return true;
+	}
+
+	if (xmlStrcmp(cur->name, (const xmlChar *) "histoqueries"))
+	{
+		xmlFreeDoc(doc);
+		return false;
+	}
+
+	for (cur = cur->xmlChildrenNode; cur != NULL; cur = cur->next)
+	{
+		if (xmlStrcmp(cur->name, (const xmlChar *)"histoquery"))
+			continue;
+
+		xmlChar *key = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+		if (key)
+		{
+			wxString query = WXSTRING_FROM_XML(key);
+			if (!query.IsEmpty())
+			{
+				const wxCharBuffer buf = query.mb_str(wxConvUTF8);
+
+				queryHistoryEntry *entry = new queryHistoryEntry();
+				entry->serial = nextSerial++;
+				entry->stamp = 0;
+				entry->length = strlen(buf);
+				entry->hash = Hash(buf, entry->length);
+				entry->offset = 0;
+				entry->textLoaded = true;
+				entry->text = query;
+				entries.Add(entry);
+			}
+			xmlFree(key);
+		}
+	}
+
+	xmlFreeDoc(doc);
+
+	// The file is written again from the queries, so the ones trimmed
+	// need no records. If it cannot be, the XML is kept as it is, and
+	// read again next time.
+	Trim();
+	if (locked)
+		Compact();
+	return true;
+}
+
+
+bool queryHistory::Add(const wxString &query, const wxString &database)
+{
+	if (!Lock())
+		return false;
+
+	// Try again to write an imported XML history as records
+	if (!appendable && !Compact())
+	{
+		Unlock();
+		return false;
+	}
+	Sync();
+
+	const wxCharBuffer buf = query.mb_str(wxConvUTF8);
+	long length = strlen(buf);
+	unsigned long hash = Hash(buf, length);
+
+	size_t i;
+	for (i = 0; i < entries.GetCount(); i++)
+	{
+		queryHistoryEntry *entry = entries.Item(i);
+		if (entry->hash == hash && entry->length == length && GetText(i) == query)
+		{
+			Drop(i);
+			break;
+		}
+	}
+
+	wxString db = database;
+	db.Replace(wxT("\n"), wxT(" "));
+	db.Replace(wxT("\r"), wxT(" "));
+
+	queryHistoryEntry *entry = new queryHistoryEntry();
+	entry->serial = nextSerial++;
+	entry->stamp = (long)time(NULL);
+	entry->database = db;
+	entry->hash = hash;
+	entry->length = length;
+	entry->textLoaded = true;
+	entry->text = query;
+
+	if (!AppendRecord(wxString::Format(wxT("Q %ld %08lx %ld %s\n"), entry->stamp, hash, length, db.c_str()),
+	                  buf, length, &entry->offset))
+	{
+		delete entry;
+		Unlock();
+		return false;
+	}
+	entries.Add(entry);
+
+	// Loading the file drops the same ones again
+	Trim();
+
+	long textSize = 0;
+	for (i = 0; i < entries.GetCount(); i++)
+		textSize += entries.Item(i)->length;
+
+	// Rewrite the file once most of it is not needed any more
+	if (fileSize > HISTORY_COMPACT_SIZE && fileSize > 2 * textSize)
+		Compact();
+
+	Unlock();
+	return true;
+}
+
+
+void queryHistory::Delete(long serial)
+{
+	if (!Lock())
+		return;
+
+	Sync();
+	int pos = FindSerial(serial);
+	if (pos != wxNOT_FOUND)
+		Drop(pos);
+	Unlock();
+}
+
+
+void queryHistory::Clear()
+{
+	WX_CLEAR_ARRAY(entries);
+	if (Lock())
+	{
+		Compact();
+		Unlock();
+	}
+}
+
+
+int queryHistory::FindSerial(long serial) const
+{
+	// The serials ascend with the positions
+	size_t lo = 0, hi = entries.GetCount();
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (entries.Item(mid)->serial < serial)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < entries.GetCount() && entries.Item(lo)->serial == serial)
+		return lo;
+	return wxNOT_FOUND;
+}
+
+
+wxString queryHistory::GetLabel(size_t pos)
+{
+	queryHistoryEntry *entry = entries.Item(pos);
+
+	if (entry->textLoaded || entry->length <= HISTORY_LABEL_SIZE)
+		return GetText(pos).Left(HISTORY_LABEL_SIZE);
+
+	wxCharBuffer buf(HISTORY_LABEL_SIZE);
+	if (!ReadText(entry->offset, buf.data(), HISTORY_LABEL_SIZE))
+		return wxEmptyString;
+
+	// Not in the middle of a character
+	long length = HISTORY_LABEL_SIZE, start = length - 1;
+	while (start > 0 && (buf.data()[start] & 0xc0) == 0x80)
+		start--;
+	unsigned char lead = buf.data()[start];
+	long charLength = lead < 0x80 ? 1 : lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : 2;
+	if (start + charLength > length)
+		length = start;
+	buf.data()[length] = 0;
+	return wxString(buf, wxConvUTF8);
+}
+
+
+wxString queryHistory::GetText(size_t pos)
+{
+	queryHistoryEntry *entry = entries.Item(pos);
+
+	if (!entry->textLoaded)
+	{
+		// Not kept, if the file was written again meanwhile; the next
+		// Sync() finds the query again
+		wxCharBuffer buf(entry->length);
+		if (!ReadText(entry->offset, buf.data(), entry->length) || Hash(buf, entry->length) != entry->hash)
+			return wxEmptyString;
+
+		buf.data()[entry->length] = 0;
+		entry->text = wxString(buf, wxConvUTF8);
+		entry->textLoaded = true;
+	}
+	return entry->text;
+}
+
+
+bool queryHistory::ReadText(long offset, char *buf, long length)
+{
+	if (!Open())
+		return false;
+
+	// Another instance may have written the file again since it was read
+	if (!generation.IsEmpty())
+	{
+		char header[80], gen[64];
+		file.Seek(0);
+		if (!fgets(header, sizeof(header), file.fp()) || sscanf(header, "H %63s", gen) != 1 ||
+		        generation != wxString(gen, wxConvUTF8))
+			return false;
+	}
+
+	return file.Seek(offset) && file.Read(buf, length) == (size_t)length;
+}
+
+
+void queryHistory::Search(const wxString &text, wxArrayInt &positions)
+{
+	wxString lower = text.Lower();
+
+	for (size_t i = 0; i < entries.GetCount(); i++)
+	{
+		if (GetText(i).Lower().Find(lower) != wxNOT_FOUND)
+			positions.Add(i);
+	}
+}
+
+
+bool queryHistory::Compact()
+{
+	wxString tmpName = fileName + wxT(".tmp");
+	wxFFile out;
+
+	{
+		wxLogNull noLog;
+		if (!out.Open(tmpName, wxT("wb")))
+			return false;
+	}
+
+	// The offsets known to other instances are not valid in the new file
+	wxString gen = NewGeneration();
+	const wxCharBuffer genRecord = (wxT("H ") + gen + wxT("\n")).mb_str(wxConvUTF8);
+
+	// Where the texts will be, once the new file is in place
+	wxArrayLong offsets;
+	long pos = strlen(genRecord);
+	bool ok = out.Write(genRecord, pos) == (size_t)pos;
+
+	size_t i;
+	for (i = 0; i < entries.GetCount() && ok; i++)
+	{
+		queryHistoryEntry *entry = entries.Item(i);
+		const wxCharBuffer text = GetText(i).mb_str(wxConvUTF8);
+
+		// The same, unless the text could not be read
+		entry->length = strlen(text);
+		entry->hash = Hash(text, entry->length);
+
+		const wxCharBuffer header = wxString::Format(wxT("Q %ld %08lx %ld %s\n"),
+		                            entry->stamp, entry->hash, entry->length, entry->database.c_str()).mb_str(wxConvUTF8);
+
+		size_t headerLength = strlen(header);
+		ok = out.Write(header, headerLength) == headerLength &&
+		     out.Write(text, entry->length) == (size_t)entry->length &&
+		     out.Write("\n", 1) == 1;
+
+		offsets.Add(pos + headerLength);
+		pos += headerLength + entry->length + 1;
+	}
+
+	ok = out.Close() && ok;
+	file.Close();
+
+	if (!ok || !wxRenameFile(tmpName, fileName))
+	{
+		::wxRemoveFile(tmpName);
+		return false;
+	}
+
+	for (i = 0; i < entries.GetCount(); i++)
+		entries.Item(i)->offset = offsets.Item(i);
+	fileSize = pos;
+	generation = gen;
+	appendable = true;
+
+	return true;
+}
+
+
+bool queryHistory::Open()
+{
+	if (!file.IsOpened())
+	{
+		wxLogNull noLog;
+		file.Open(fileName, wxT("a+b"));
+	}
+	return file.IsOpened();
+}
+
+
+bool queryHistory::AppendRecord(const wxString &header, const char *text, long length, long *offset)
+{
+	if (!appendable || !Open())
+		return false;
+
+	const wxCharBuffer buf = header.mb_str(wxConvUTF8);
+	size_t headerLength = strlen(buf);
+
+	file.SeekEnd();
+	bool ok = true;
+	if (!file.Tell())
+	{
+		// A new file
+		generation = NewGeneration();
+		const wxCharBuffer genRecord = (wxT("H ") + generation + wxT("\n")).mb_str(wxConvUTF8);
+		ok = file.Write(genRecord, strlen(genRecord)) == strlen(genRecord);
+	}
+	ok = ok && file.Write(buf, headerLength) == headerLength;
+	if (offset)
+		*offset = (long)file.Tell();
+	if (text)
+		ok = ok && file.Write(text, length) == (size_t)length && file.Write("\n", 1) == 1;
+
+	file.Flush();
+	fileSize = (long)file.Tell();
+
+	return ok;
+}
+
+
+void queryHistory::Drop(size_t pos)
+{
+	AppendRecord(wxString::Format(wxT("D %ld\n"), entries.Item(pos)->offset), NULL, 0, NULL);
+	Remove(pos);
+}
+
+
+void queryHistory::Remove(size_t pos)
+{
+	delete entries.Item(pos);
+	entries.RemoveAt(pos);
+}
+
+
+void queryHistory::Trim()
+{
+	// Deleted for good, not just dropped, else they would be back with
+	// a higher maximum
+	long maxCount = settings->GetHistoryMaxQueries();
+	while (entries.GetCount() > 0 && (long)entries.GetCount() > maxCount)
+		Drop(0);
+}
+
+
+wxString queryHistory::NewGeneration()
+{
+	// Unique even for two rewrites within a second
+	static unsigned long count = 0;
+	return wxString::Format(wxT("%lx.%lx.%lx"), (unsigned long)time(NULL), wxGetProcessId(), count++);
+}
+
+
+unsigned long queryHistory::Hash(const char *text, long length)
+{
+	// FNV-1a
+	unsigned long hash = 2166136261UL;
+	for (long i = 0; i < length; i++)
+	{
+		hash ^= (unsigned char)text[i];
+		hash = (hash * 16777619UL) & 0xffffffffUL;
+	}
+	return hash;
+}
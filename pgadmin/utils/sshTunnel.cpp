@@ -19,6 +19,10 @@
 #include "utils/sshTunnel.h"
 #include "frm/frmMain.h"
 
+#ifndef WIN32
+#include <fcntl.h>
+#endif
+
 #pragma comment (lib, "Ws2_32.lib")
 
 typedef const char *(*inet_ntop_t) (int af, const void *src, char *dst, socklen_t size);
@@ -46,6 +50,38 @@ static inet_ntop_t gs_fnPtr_inet_ntop = &custom_inet_ntop;
 static inet_ntop_t gs_fnPtr_inet_ntop = &inet_ntop;
 #endif
 
+// How long the loop waits when nothing happens (in seconds)
+#define SSH_TUNNEL_IDLE_TIMEOUT 1
+
+static void CloseSocket(int sock)
+{
+#ifdef WIN32
+	closesocket(sock);
+#else
+	close(sock);
+#endif
+}
+
+static void SetNonBlocking(int sock)
+{
+#ifdef WIN32
+	u_long mode = 1;
+	ioctlsocket(sock, FIONBIO, &mode);
+#else
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// Did the last socket call fail just because it would have blocked?
+static bool WouldBlock()
+{
+#ifdef WIN32
+	return wxSysErrorCode() == WSAEWOULDBLOCK;
+#else
+	return wxSysErrorCode() == EAGAIN || wxSysErrorCode() == EWOULDBLOCK || wxSysErrorCode() == EINTR;
+#endif
+}
+
 char CSSHTunnelThread::m_keyboard_interactive_pwd[SSH_MAX_PASSWORD_LEN];
 
 CSSHTunnelThread::CSSHTunnelThread(const wxString tunnelhost, const wxString remote_desthost, const unsigned int remote_destport,
@@ -58,6 +94,8 @@ CSSHTunnelThread::CSSHTunnelThread(const wxString tunnelhost, const wxString rem
 	m_local_listenport = 0;
 	m_listensock = -1, m_sock = -1;
 	m_session = NULL;
+	m_opening = NULL;
+	m_running = m_stop = false;
 
 	memset(m_keyboard_interactive_pwd, 0 , strlen(m_keyboard_interactive_pwd));
 	strncpy(m_keyboard_interactive_pwd, (const char *)password.mb_str(wxConvUTF8), password.Length());
@@ -274,92 +312,321 @@ bool CSSHTunnelThread::Initialize()
 
 void *CSSHTunnelThread::Entry()
 {
-	while (1)
 	{
-		int forwardsock = accept(m_listensock, (struct sockaddr *) & m_sin, &m_sinlen);
-		if (-1 == forwardsock)
+		wxMutexLocker lock(m_stopLock);
+		if (m_stop)
+			return NULL;
+		m_running = true;
+	}
+
+	// Everything goes through this one loop, nothing may block it
+	libssh2_session_set_blocking(m_session, 0);
+	SetNonBlocking(m_listensock);
+
+	bool progress = false;
+	while (!m_stop)
+	{
+		fd_set readfds, writefds;
+		FD_ZERO(&readfds);
+		FD_ZERO(&writefds);
+
+		int maxsock = m_listensock > m_sock ? m_listensock : m_sock;
+		FD_SET(m_listensock, &readfds);
+		FD_SET(m_sock, &readfds);
+		if (libssh2_session_block_directions(m_session) & LIBSSH2_SESSION_BLOCK_OUTBOUND)
+			FD_SET(m_sock, &writefds);
+
+		size_t i;
+		for (i = 0; i < m_channels.GetCount(); i++)
+		{
+			CSSHTunnelChannel *chan = m_channels.Item(i);
+
+			// Read from the client once the last of it is passed on
+			if (chan->m_channel && !chan->m_toServerLen)
+				FD_SET(chan->m_sock, &readfds);
+			if (chan->m_toClientOff < chan->m_toClientLen)
+				FD_SET(chan->m_sock, &writefds);
+			if (chan->m_sock > maxsock)
+				maxsock = chan->m_sock;
+		}
+
+		// Don't wait while the last pass still got something done, or
+		// libssh2 has read the data of a channel while serving another one
+		// after it; select cannot tell about that data any more
+		for (i = 0; !progress && i < m_channels.GetCount(); i++)
+		{
+			CSSHTunnelChannel *chan = m_channels.Item(i);
+			if (chan->m_channel && chan->m_toClientOff == chan->m_toClientLen &&
+			        (libssh2_poll_channel_read(chan->m_channel, 0) || libssh2_channel_eof(chan->m_channel)))
+				progress = true;
+		}
+
+		struct timeval tv;
+		tv.tv_sec = progress ? 0 : SSH_TUNNEL_IDLE_TIMEOUT;
+		tv.tv_usec = 0;
+
+		int rc = select(maxsock + 1, &readfds, &writefds, NULL, &tv);
+		if (m_stop)
+			break;
+		if (rc == -1)
+		{
+			if (WouldBlock())
+				continue;
+			LogSSHTunnelErrors(wxString::Format(_("SSH error: select failed with error code %d"), wxSysErrorCode()), GetId());
+			break;
+		}
+
+		progress = false;
+		if (FD_ISSET(m_listensock, &readfds))
+		{
+			if (!AcceptConnection())
+				break;
+			progress = true;
+		}
+
+		for (i = m_channels.GetCount(); i > 0; i--)
+		{
+			CSSHTunnelChannel *chan = m_channels.Item(i - 1);
+			if (!ForwardChannel(chan, FD_ISSET(chan->m_sock, &readfds) != 0, progress))
+			{
+				CloseChannel(chan);
+				m_channels.RemoveAt(i - 1);
+				progress = true;
+			}
+		}
+
+		for (i = m_closing.GetCount(); i > 0; i--)
 		{
+			if (FinishClose(m_closing.Item(i - 1)))
+				m_closing.RemoveAt(i - 1);
+		}
+	}
+
+	wxMutexLocker lock(m_stopLock);
+	Release();
+	m_running = false;
+
+	return NULL;
+}
+
+bool CSSHTunnelThread::AcceptConnection()
+{
+	struct sockaddr_in sin;
+	socklen_t sinlen = sizeof(sin);
+
+	int forwardsock = accept(m_listensock, (struct sockaddr *) &sin, &sinlen);
+	if (-1 == forwardsock)
+	{
 #ifdef WIN32
-			if(wxSysErrorCode() != WSAEINTR && wxSysErrorCode() != WSAEBADF)
+		if (wxSysErrorCode() == WSAEWOULDBLOCK || wxSysErrorCode() == WSAECONNRESET)
+			return true;
+		if (wxSysErrorCode() != WSAEINTR && wxSysErrorCode() != WSAEBADF && wxSysErrorCode() != WSAEINVAL)
 #else
-			if(wxSysErrorCode() != EINTR && wxSysErrorCode() != EBADF && wxSysErrorCode() != ECONNABORTED)
+		if (WouldBlock() || wxSysErrorCode() == ECONNABORTED)
+			return true;
+		if (wxSysErrorCode() != EBADF && wxSysErrorCode() != EINVAL)
 #endif
+			LogSSHTunnelErrors(wxString::Format(_("SSH error: accept failed with error code %d"), wxSysErrorCode()), GetId());
+		return false;
+	}
+
+	SetNonBlocking(forwardsock);
+
+	wxLogInfo(wxT("Forwarding connection from %s:%d to %s:%d"), wxString(inet_ntoa(sin.sin_addr), wxConvLibc).c_str(),
+	          ntohs(sin.sin_port), m_remote_desthost.c_str(), m_remote_destport);
+
+	m_channels.Add(new CSSHTunnelChannel(forwardsock, sin));
+	return true;
+}
+
+bool CSSHTunnelThread::ForwardChannel(CSSHTunnelChannel *chan, bool readable, bool &progress)
+{
+	unsigned int sport = ntohs(chan->m_sin.sin_port);
+
+	if (!chan->m_channel)
+	{
+		if (m_opening && m_opening != chan)
+			return true;
+
+		m_opening = chan;
+		chan->m_channel = libssh2_channel_direct_tcpip_ex(m_session, m_remote_desthost.mb_str(), m_remote_destport,
+		                  inet_ntoa(chan->m_sin.sin_addr), sport);
+		if (!chan->m_channel)
+		{
+			if (libssh2_session_last_error(m_session, NULL, NULL, 0) == LIBSSH2_ERROR_EAGAIN)
+				return true;
+
+			m_opening = NULL;
+			wxLogInfo(_("SSH error: Could not open a direct-tcpip channel!"));
+			return false;
+		}
+		m_opening = NULL;
+		progress = true;
+	}
+
+	ssize_t len;
+
+	// Client to server
+	if (readable)
+	{
+		len = recv(chan->m_sock, chan->m_toServer, SSH_TUNNEL_BUFFER_SIZE, 0);
+		if (0 == len)
+		{
+			wxLogInfo(_("The client at %s:%d disconnected!"), wxString(inet_ntoa(chan->m_sin.sin_addr), wxConvLibc).c_str(), sport);
+			return false;
+		}
+		else if (len < 0)
+		{
+			if (!WouldBlock())
 			{
-				LogSSHTunnelErrors(wxString::Format(_("SSH error: accept failed with error code %d"), wxSysErrorCode()), GetId());
-				Cleanup();
+				wxLogInfo(_("SSH error: read failed with error code %d"), wxSysErrorCode());
+				return false;
 			}
+		}
+		else
+		{
+			chan->m_toServerLen = len;
+			chan->m_toServerOff = 0;
+		}
+	}
+	while (chan->m_toServerOff < chan->m_toServerLen)
+	{
+		len = libssh2_channel_write(chan->m_channel, chan->m_toServer + chan->m_toServerOff,
+		                            chan->m_toServerLen - chan->m_toServerOff);
+		if (LIBSSH2_ERROR_EAGAIN == len)
 			break;
+		else if (len < 0)
+		{
+			wxLogInfo(_("SSH error: libssh2_channel_write with error code %d"), (int)len);
+			return false;
 		}
+		chan->m_toServerOff += len;
+		progress = true;
+	}
+	if (chan->m_toServerOff == chan->m_toServerLen)
+		chan->m_toServerLen = chan->m_toServerOff = 0;
+
+	// Server to client; there is no descriptor to wait on for a channel,
+	// so each of them is asked on every pass
+	if (chan->m_toClientOff == chan->m_toClientLen)
+	{
+		chan->m_toClientLen = chan->m_toClientOff = 0;
 
-		// Create thread for read/write.
-		CSubThread *subThread = new CSubThread(m_sin, m_remote_desthost, m_remote_destport, m_session, forwardsock);
-		if ( subThread->Create() != wxTHREAD_NO_ERROR )
+		len = libssh2_channel_read(chan->m_channel, chan->m_toClient, SSH_TUNNEL_BUFFER_SIZE);
+		if (len > 0)
 		{
-			delete subThread;
-			subThread = NULL;
+			chan->m_toClientLen = len;
+			progress = true;
 		}
-		else
+		else if (len < 0 && LIBSSH2_ERROR_EAGAIN != len)
 		{
-			if (subThread->Run() != wxTHREAD_NO_ERROR )
-			{
-				delete subThread;
-				subThread = NULL;
-			}
-			else
-			{
-				g_SSHThreadMutex.Lock();
-				g_setSocketDescriptor.insert(forwardsock);
-				g_SSHThreadMutex.Unlock();
-			}
+			wxLogInfo(_("SSH error: libssh2_channel_read with error code %d"), (int)len);
+			return false;
+		}
+	}
+	while (chan->m_toClientOff < chan->m_toClientLen)
+	{
+		len = send(chan->m_sock, chan->m_toClient + chan->m_toClientOff, chan->m_toClientLen - chan->m_toClientOff, 0);
+		if (len < 0)
+		{
+			if (WouldBlock())
+				break;
+			wxLogInfo(_("SSH error: write failed with error code %d"), wxSysErrorCode());
+			return false;
 		}
+		chan->m_toClientOff += len;
+		progress = true;
 	}
 
-	return NULL;
+	if (chan->m_toClientOff == chan->m_toClientLen && libssh2_channel_eof(chan->m_channel))
+	{
+		wxLogInfo(_("Connection at %s:%d disconnected by server"),
+		          wxString(inet_ntoa(chan->m_sin.sin_addr), wxConvLibc).c_str(), sport);
+		return false;
+	}
+
+	return true;
+}
+
+void CSSHTunnelThread::CloseChannel(CSSHTunnelChannel *chan)
+{
+	CloseSocket(chan->m_sock);
+
+	if (m_opening == chan)
+		m_opening = NULL;
+
+	// The other channels go on while the server confirms the close
+	if (chan->m_channel && !FinishClose(chan->m_channel))
+		m_closing.Add(chan->m_channel);
+
+	delete chan;
+}
+
+bool CSSHTunnelThread::FinishClose(struct _LIBSSH2_CHANNEL *channel)
+{
+	if (libssh2_channel_close(channel) == LIBSSH2_ERROR_EAGAIN)
+		return false;
+	return libssh2_channel_free(channel) != LIBSSH2_ERROR_EAGAIN;
 }
 
 void CSSHTunnelThread::Cleanup()
 {
-	// Close all the sockets
-	g_SSHThreadMutex.Lock();
-	subThreadSDSet::iterator it;
-	for( it = g_setSocketDescriptor.begin(); it != g_setSocketDescriptor.end(); ++it )
+	wxMutexLocker lock(m_stopLock);
+	m_stop = true;
+
+	// A running loop releases everything as it ends. Shutting the listening
+	// socket down wakes it up where that works, else it notices within
+	// SSH_TUNNEL_IDLE_TIMEOUT.
+	if (m_running)
 	{
-		int socketDescriptor = *it;
+		if (m_listensock != -1)
+		{
 #ifdef WIN32
-		closesocket(socketDescriptor);
+			shutdown(m_listensock, SD_BOTH);
 #else
-		close(socketDescriptor);
+			shutdown(m_listensock, SHUT_RDWR);
 #endif
+		}
 	}
-	g_SSHThreadMutex.Unlock();
+	else
+		Release();
+}
 
-	Sleep(1000);
+void CSSHTunnelThread::Release()
+{
+	// Nobody else is served any more, so the channels may wait for the server
+	if (m_session)
+		libssh2_session_set_blocking(m_session, 1);
+
+	while (m_channels.GetCount())
+	{
+		CloseChannel(m_channels.Last());
+		m_channels.RemoveAt(m_channels.GetCount() - 1);
+	}
+	while (m_closing.GetCount())
+	{
+		FinishClose(m_closing.Last());
+		m_closing.RemoveAt(m_closing.GetCount() - 1);
+	}
 
 	if(m_session)
 	{
+		libssh2_session_set_blocking(m_session, 1);
 		libssh2_session_disconnect(m_session, "Client disconnecting normally");
 		libssh2_session_free(m_session);
 		m_session = NULL;
 	}
 
-	if (m_listensock)
+	if (m_listensock != -1)
 	{
-#ifdef WIN32
-		closesocket(m_listensock);
-#else
-		close(m_listensock);
-#endif
-		m_listensock = 0;
+		CloseSocket(m_listensock);
+		m_listensock = -1;
 	}
 
-	if (m_sock)
+	if (m_sock != -1)
 	{
-#ifdef WIN32
-		closesocket(m_sock);
-#else
-		close(m_sock);
-#endif
-		m_sock = 0;
+		CloseSocket(m_sock);
+		m_sock = -1;
 	}
 
 	libssh2_exit();
@@ -461,142 +728,12 @@ bool CSSHTunnelThread::IsHostKeyVerified(const wxString &newHostKey)
 	return bIsVerified;
 }
 
-CSubThread::CSubThread(const struct sockaddr_in sin, const wxString remote_desthost, const unsigned int remote_destport,
-                       LIBSSH2_SESSION *session, int forwardsock)
-	: m_sin(sin), m_remote_desthost(remote_desthost), m_remote_destport(remote_destport),
-	  m_subThreadSession(session), m_forwardsock(forwardsock)
-{
-}
-
-CSubThread::~CSubThread(void)
+CSSHTunnelChannel::CSSHTunnelChannel(int sock, const struct sockaddr_in &sin)
+	: m_sock(sock), m_sin(sin)
 {
-	g_SSHThreadMutex.Lock();
-	g_setSocketDescriptor.erase(m_forwardsock);
-	g_SSHThreadMutex.Unlock();
-}
-
-void *
-CSubThread::Entry()
-{
-	fd_set fds;
-	struct timeval tv;
-	ssize_t len, wr;
-	char buf[20480];
-	int rc, i = 0;
-
-	const char *shost = inet_ntoa(m_sin.sin_addr);
-	unsigned int sport = ntohs(m_sin.sin_port);
-
-	wxLogInfo(wxT("Forwarding connection from %s:%d to %s:%d"), wxString(inet_ntoa(m_sin.sin_addr), wxConvLibc).c_str(),
-	          sport, m_remote_desthost.c_str(), m_remote_destport);
-
-	/* Must use blocking here to avoid connect errors */
-	//libssh2_session_set_blocking(m_subThreadSession, 1);
-
-	while((m_channel = libssh2_channel_direct_tcpip_ex(m_subThreadSession, m_remote_desthost.mb_str(),
-	                   m_remote_destport, shost, sport)) == NULL)
-	{
-		rc = libssh2_session_last_error(m_subThreadSession, NULL, NULL, 0);
-		if (rc == LIBSSH2_ERROR_EAGAIN)
-			Sleep(10);
-		else
-			break;
-	}
-
-	/* Must use non-blocking IO hereafter due to the current libssh2 API */
-	libssh2_session_set_blocking(m_subThreadSession, 0);
-
-	if (!m_channel)
-	{
-		wxLogInfo(_("SSH error: Could not open a direct-tcpip channel!"));
-		goto shutdown;
-	}
-
-	while (1)
-	{
-		FD_ZERO(&fds);
-		FD_SET(m_forwardsock, &fds);
-		tv.tv_sec = 0;
-		tv.tv_usec = 100000;
-		rc = select(m_forwardsock + 1, &fds, NULL, NULL, &tv);
-		memset(buf, 0, sizeof(buf));
-		if (-1 == rc)
-		{
-			wxLogInfo(_("SSH error: select failed with error code %d"), wxSysErrorCode());
-			goto shutdown;
-		}
-		if (rc && FD_ISSET(m_forwardsock, &fds))
-		{
-			len = recv(m_forwardsock, buf, sizeof(buf), 0);
-			if (len < 0)
-			{
-				wxLogInfo(_("SSH error: read failed with error code %d"), wxSysErrorCode());
-				goto shutdown;
-			}
-			else if (0 == len)
-			{
-				wxLogInfo(_("The client at %s:%d disconnected!"), wxString(inet_ntoa(m_sin.sin_addr), wxConvLibc).c_str(), sport);
-				goto shutdown;
-			}
-			wr = 0;
-			do
-			{
-				i = libssh2_channel_write(m_channel, buf, len);
-
-				if (i < 0)
-				{
-					wxLogInfo(_("SSH error: libssh2_channel_write with error code %d"), i);
-					goto shutdown;
-				}
-				wr += i;
-			}
-			while (i > 0 && wr < len);
-		}
-		while (1)
-		{
-			len = libssh2_channel_read(m_channel, buf, sizeof(buf));
-
-			if (LIBSSH2_ERROR_EAGAIN == len)
-				break;
-			else if (len < 0)
-			{
-				wxLogInfo(_("SSH error: libssh2_channel_read with error code %d"), (int)len);
-				goto shutdown;
-			}
-			wr = 0;
-			while (wr < len)
-			{
-				i = send(m_forwardsock, buf + wr, len - wr, 0);
-				if (i <= 0)
-				{
-					wxLogInfo(_("SSH error: write failed with error code %d"), wxSysErrorCode());
-					goto shutdown;
-				}
-				wr += i;
-			}
-			if (libssh2_channel_eof(m_channel))
-			{
-				wxLogInfo(_("Connection at %s:%d disconnected by server"),
-				          wxString(inet_ntoa(m_sin.sin_addr), wxConvLibc).c_str(), sport);
-				goto shutdown;
-			}
-		}
-	}
-shutdown:
-#ifdef WIN32
-	closesocket(m_forwardsock);
-#else
-	close(m_forwardsock);
-#endif
-
-	if (m_channel)
-	{
-		libssh2_channel_close(m_channel);
-		libssh2_channel_free(m_channel);
-		m_channel = NULL;
-	}
-
-	return NULL;
+	m_channel = NULL;
+	m_toServerLen = m_toServerOff = 0;
+	m_toClientLen = m_toClientOff = 0;
 }
 
 void LogSSHTunnelErrors(const wxString &msg, const int &id, struct _LIBSSH2_SESSION *session)
@@ -13,9 +13,10 @@
 
 // wxWindows headers
 #include <wx/wx.h>
-#include <wx/ffile.h>
+#include <wx/filefn.h>
 #include <wx/datetime.h>
 #include <wx/log.h>
+#include <wx/thread.h>
 
 // App headers
 #if !defined(PGSCLI)
@@ -27,6 +28,210 @@
 wxLogLevel sysLogger::logLevel = LOG_ERRORS;
 wxString sysLogger::logFile = wxT("debug.log");
 
+// How long the writer lets messages pile up (in ms), and how many at most
+#define LOG_WRITE_INTERVAL  200
+#define LOG_BATCH_SIZE      256
+
+// The logfile is moved to <logfile>.1 when it gets bigger than this
+#define LOG_ROTATE_SIZE     (10 * 1024 * 1024)
+
+
+// Keeps the logfile open, and appends the queued messages to it in
+// batches. It uses stdio only, anything logged from here would end up
+// in its own queue.
+class sysLogWriter : public wxThread
+{
+public:
+	sysLogWriter();
+	~sysLogWriter();
+
+	void *Entry();
+
+	// Queue a message for the logfile; flush has it written right away
+	void Add(const wxString &fileName, const wxString &msg, bool flush);
+	// Wait until the messages queued so far are written
+	void Flush();
+	// Write what is left, and end the thread
+	void Stop();
+	// True once after the logfile could not be opened
+	bool TakeOpenError();
+
+private:
+	// False, if the logfile could not be opened
+	bool WriteBatch(const wxString &fileName, const wxArrayString &batch);
+
+	wxMutex lock;
+	wxCondition queued, written;
+
+	// Guarded by the lock
+	wxArrayString pending;
+	wxString pendingFile;
+	unsigned long queuedCount, writtenCount;
+	bool running, stopping, openError;
+
+	// Only used by the thread writing
+	FILE *file;
+	wxString openFile;
+};
+
+
+sysLogWriter::sysLogWriter()
+	: wxThread(wxTHREAD_JOINABLE), queued(lock), written(lock)
+{
+	queuedCount = writtenCount = 0;
+	running = stopping = openError = false;
+	file = NULL;
+
+	running = (Create() == wxTHREAD_NO_ERROR && Run() == wxTHREAD_NO_ERROR);
+}
+
+
+sysLogWriter::~sysLogWriter()
+{
+	if (file)
+		fclose(file);
+}
+
+
+void sysLogWriter::Add(const wxString &fileName, const wxString &msg, bool flush)
+{
+	wxMutexLocker locker(lock);
+
+	// Copies of their own; the strings are handed over to another thread
+	if (pendingFile != fileName)
+		pendingFile = wxString(fileName.c_str());
+	pending.Add(wxString(msg.c_str()));
+	queuedCount++;
+
+	if (!running)
+	{
+		// No thread, write it ourselves
+		if (!WriteBatch(pendingFile, pending))
+			openError = true;
+		pending.Clear();
+		writtenCount = queuedCount;
+	}
+	else if (flush || pending.GetCount() >= LOG_BATCH_SIZE)
+		queued.Signal();
+}
+
+
+void sysLogWriter::Flush()
+{
+	wxMutexLocker locker(lock);
+
+	unsigned long count = queuedCount;
+	if (running && writtenCount < count)
+	{
+		queued.Signal();
+		while (writtenCount < count)
+			written.Wait();
+	}
+}
+
+
+void sysLogWriter::Stop()
+{
+	if (!running)
+		return;
+
+	lock.Lock();
+	stopping = true;
+	queued.Signal();
+	lock.Unlock();
+
+	Wait();
+}
+
+
+bool sysLogWriter::TakeOpenError()
+{
+	wxMutexLocker locker(lock);
+
+	bool error = openError;
+	openError = false;
+	return error;
+}
+
+
+void *sysLogWriter::Entry()
+{
+	lock.Lock();
+	while (true)
+	{
+		if (pending.IsEmpty() && !stopping)
+			queued.WaitTimeout(LOG_WRITE_INTERVAL);
+
+		if (pending.IsEmpty())
+		{
+			if (stopping)
+				break;
+			continue;
+		}
+
+		// Take the whole queue, and write it without holding the lock
+		wxArrayString batch = pending;
+		wxString fileName = pendingFile;
+		unsigned long count = queuedCount;
+		pending.Clear();
+		lock.Unlock();
+
+		bool ok = WriteBatch(fileName, batch);
+		batch.Clear();
+
+		lock.Lock();
+		if (!ok)
+			openError = true;
+		writtenCount = count;
+		written.Broadcast();
+	}
+	lock.Unlock();
+
+	if (file)
+	{
+		fclose(file);
+		file = NULL;
+	}
+	return NULL;
+}
+
+
+bool sysLogWriter::WriteBatch(const wxString &fileName, const wxArrayString &batch)
+{
+	if (file && openFile != fileName)
+	{
+		fclose(file);
+		file = NULL;
+	}
+
+	if (!file)
+	{
+		file = wxFopen(fileName, wxT("a"));
+		if (!file)
+			return false;
+		openFile = fileName;
+	}
+
+	wxString text;
+	for (size_t i = 0; i < batch.GetCount(); i++)
+		text << batch[i] << wxT("\n");
+
+	const wxCharBuffer buf = text.mb_str(wxConvUTF8);
+	fwrite((const char *)buf, 1, strlen(buf), file);
+	fflush(file);
+
+	if (ftell(file) >= LOG_ROTATE_SIZE)
+	{
+		fclose(file);
+		file = NULL;
+
+		wxString rotated = fileName + wxT(".1");
+		wxRemove(rotated);
+		wxRename(fileName, rotated);
+	}
+	return true;
+}
+
 #if !wxCHECK_VERSION(2, 9, 0)
 
 // IMPLEMENT_LOG_FUNCTION(Sql) from wx../common/log.c
@@ -132,6 +337,26 @@ void wxLogScriptVerbose(const wxChar *szFormat, ...)
 
 #endif
 
+sysLogger::sysLogger()
+{
+	writer = new sysLogWriter();
+}
+
+
+sysLogger::~sysLogger()
+{
+	// Get everything into the logfile before we go
+	writer->Stop();
+	delete writer;
+}
+
+
+void sysLogger::FlushLog()
+{
+	writer->Flush();
+}
+
+
 #if wxCHECK_VERSION(2, 9, 0)
 void sysLogger::DoLogTextAtLevel(wxLogLevel level, const wxString &msg)
 #else
@@ -226,6 +451,11 @@ void sysLogger::DoLog(wxLogLevel level, const wxChar *msg, time_t timestamp)
 	delete time;
 #endif
 
+	// Errors are written right away, the rest in batches
+	bool error = (level == wxLOG_FatalError ||
+	              level == wxLOG_Error ||
+	              level == wxLOG_QuietError);
+
 	// Display the message if required
 	switch (logLevel)
 	{
@@ -236,7 +466,7 @@ void sysLogger::DoLog(wxLogLevel level, const wxChar *msg, time_t timestamp)
 			if (level == wxLOG_FatalError ||
 			        level == wxLOG_Error ||
 			        level == wxLOG_QuietError)
-				WriteLog(fullmsg);
+				WriteLog(fullmsg, error);
 			break;
 
 		case LOG_NOTICE:
@@ -244,7 +474,7 @@ void sysLogger::DoLog(wxLogLevel level, const wxChar *msg, time_t timestamp)
 			        level == wxLOG_Error ||
 			        level == wxLOG_QuietError ||
 			        level == wxLOG_Notice)
-				WriteLog(fullmsg);
+				WriteLog(fullmsg, error);
 			break;
 
 		case LOG_SQL:
@@ -256,45 +486,38 @@ void sysLogger::DoLog(wxLogLevel level, const wxChar *msg, time_t timestamp)
 			        level == wxLOG_Notice ||
 			        level == wxLOG_Sql ||
 			        level == wxLOG_Script)
-				WriteLog(fullmsg);
+				WriteLog(fullmsg, error);
 			break;
 
 		case LOG_DEBUG:
-			WriteLog(fullmsg);
+			WriteLog(fullmsg, error);
 			break;
 	}
 
+	// We may not be around much longer
+	if (level == wxLOG_FatalError)
+		FlushLog();
+
 	// Display a messagebox if required.
 #if !defined(PGSCLI)
+	if (writer->TakeOpenError() && wxThread::IsMain())
+		wxMessageBox(_("Cannot open the logfile!"), _("FATAL"), wxOK | wxCENTRE | wxICON_ERROR);
+
 	if (icon != 0 && !SilenceMessage(msg))
 		wxMessageBox(preamble + wxGetTranslation(msg), appearanceFactory->GetLongAppName(), wxOK | wxCENTRE | icon);
 #endif // PGSCLI
 }
 
 
-void sysLogger::WriteLog(const wxString &msg)
+void sysLogger::WriteLog(const wxString &msg, bool flush)
 {
 	wxString pid, logfile;
 
-	// Disable logging to prevent recursion in the event of a problem
-	wxLogNull foo;
-
 	pid.Printf(wxT("%ld"), wxGetProcessId());
 	logfile.Printf(wxT("%s"), logFile.c_str());
 	logfile.Replace(wxT("%ID"), pid);
 
-	wxFFile file(logfile, wxT("a"));
-
-#if !defined(PGSCLI)
-	if (!file.IsOpened())
-	{
-		wxMessageBox(_("Cannot open the logfile!"), _("FATAL"), wxOK | wxCENTRE | wxICON_ERROR);
-		return;
-	}
-#endif // PGSCLI
-
-	file.Write(msg + wxT("\n"));
-	file.Close();
+	writer->Add(logfile, msg, flush);
 }
 
 // Check to see if a message should be silenced (because it's meaningless
@@ -26,6 +26,16 @@
  * Callbacks to the C++ world
  */
 char *pg_query_to_single_ordered_string(char *query, void *dbptr);
+char *pg_complete_from_index(int kind, const char *relkinds, const char *text, const char *addon, void *dbptr);
+
+/*
+ * Completions the local identifier index can answer without a query,
+ * keep in sync with include/db/pgCompletionIndex.h
+ */
+#define COMPLETE_INDEX_SCHEMAS		1
+#define COMPLETE_INDEX_RELATIONS	2
+#define COMPLETE_INDEX_FUNCTIONS	3
+#define COMPLETE_INDEX_ATTRIBUTES	4
 
 
 /*
@@ -227,6 +237,54 @@ static char *complete_from_const(const char *text, const char *string)
 	return strdup(string);
 }
 
+/*
+ * Try the local identifier index for the completion queries it knows.
+ * Returns NULL if the query has to go to the server.
+ */
+static char *complete_from_index(const char *text, const char *query, const SchemaQuery *squery, const char *addon, void *dbptr)
+{
+	char relkinds[16];
+	const char *p;
+	int n = 0;
+
+	if (query != NULL)
+	{
+		if (strcmp(query, Query_for_list_of_schemas) == 0)
+			return pg_complete_from_index(COMPLETE_INDEX_SCHEMAS, "", text, "", dbptr);
+		if (strcmp(query, Query_for_list_of_attributes) == 0 && addon)
+			return pg_complete_from_index(COMPLETE_INDEX_ATTRIBUTES, "", text, addon, dbptr);
+		return NULL;
+	}
+
+	/* The addon of a schema query is more SQL */
+	if (addon)
+		return NULL;
+
+	if (strcmp(squery->catname, "pg_catalog.pg_proc p") == 0 && squery->selcondition == NULL)
+		return pg_complete_from_index(COMPLETE_INDEX_FUNCTIONS, "", text, "", dbptr);
+
+	if (strcmp(squery->catname, "pg_catalog.pg_class c") != 0 || squery->selcondition == NULL ||
+		strncmp(squery->selcondition, "c.relkind IN (", 14) != 0)
+		return NULL;
+
+	/* Pick the relkinds from a plain "c.relkind IN ('r', 'v')" */
+	for (p = squery->selcondition + 14; *p && *p != ')'; p++)
+	{
+		if (*p == '\'' && p[1] && p[2] == '\'' && n < (int)sizeof(relkinds) - 1)
+		{
+			relkinds[n++] = p[1];
+			p += 2;
+		}
+		else if (*p != ',' && *p != ' ')
+			return NULL;
+	}
+	if (*p != ')' || p[1] != '\0' || n == 0)
+		return NULL;
+	relkinds[n] = '\0';
+
+	return pg_complete_from_index(COMPLETE_INDEX_RELATIONS, relkinds, text, "", dbptr);
+}
+
 static char *_complete_from_query(const char *text, const char *query, const SchemaQuery *squery, const char *addon, void *dbptr)
 {
 	int string_length = strlen(text);
@@ -234,6 +292,10 @@ static char *_complete_from_query(const char *text, const char *query, const Sch
 	char *complete_query = NULL;
 	char *t;
 
+	t = complete_from_index(text, query, squery, addon, dbptr);
+	if (t != NULL)
+		return t;
+
 	e_text = malloc(string_length*2+1);
 	PQescapeString(e_text, text, string_length);
 